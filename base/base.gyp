@@ -164,6 +164,14 @@
             ],
           },
         }],
+        ['OS != "linux"', {
+          'sources!': [
+            'io_uring_file_engine.cc',
+            'io_uring_file_engine.h',
+            'message_pump_epoll.cc',
+            'message_pump_epoll.h',
+          ],
+        }],
         ['OS == "mac"', {
           'link_settings': {
             'libraries': [
@@ -182,6 +190,12 @@
         ['OS != "win"', {
             'dependencies': ['../third_party/libevent/libevent.gyp:libevent'],
         },],
+        ['target_arch == "ia32" or target_arch == "x64"', {
+          'dependencies': [
+            'base_simd_sse2',
+            'base_simd_ssse3',
+          ],
+        }],
         ['component=="shared_library"', {
           'conditions': [
             ['OS=="win"', {
@@ -206,6 +220,8 @@
         'event_recorder_win.cc',
         'file_descriptor_shuffle.cc',
         'file_descriptor_shuffle.h',
+        'io_uring_file_engine.cc',
+        'io_uring_file_engine.h',
         'linux_util.cc',
         'linux_util.h',
         'md5.cc',
@@ -219,6 +235,8 @@
         'message_pump_observer.h',
         'message_pump_aurax11.cc',
         'message_pump_aurax11.h',
+        'message_pump_epoll.cc',
+        'message_pump_epoll.h',
         'message_pump_libevent.cc',
         'message_pump_libevent.h',
         'message_pump_mac.h',
@@ -310,6 +328,64 @@
         '..',
       ],
     },
+    {
+      # The SSE2 versions of the UTF string conversion loops, which base picks
+      # at runtime. As for skia_opts, only these files are built with -msse2
+      # so that the compiler can't use SSE2 anywhere else in base.
+      'target_name': 'base_simd_sse2',
+      'type': 'static_library',
+      'toolsets': ['host', 'target'],
+      'variables': {
+        'optimize': 'max',
+      },
+      'sources': [
+        'utf_string_conversions_simd.h',
+        'utf_string_conversions_sse2.cc',
+      ],
+      'include_dirs': [
+        '..',
+      ],
+      'direct_dependent_settings': {
+        'defines': [
+          'BASE_UTF_SIMD',
+        ],
+      },
+      'conditions': [
+        ['os_posix == 1 and OS != "mac"', {
+          'cflags': [
+            '-msse2',
+          ],
+        }],
+      ],
+    },
+    {
+      # Same as base_simd_sse2, for the SSSE3 versions.
+      'target_name': 'base_simd_ssse3',
+      'type': 'static_library',
+      'toolsets': ['host', 'target'],
+      'variables': {
+        'optimize': 'max',
+      },
+      'sources': [
+        'utf_string_conversions_simd.h',
+        'utf_string_conversions_ssse3.cc',
+      ],
+      'include_dirs': [
+        '..',
+      ],
+      'conditions': [
+        ['os_posix == 1 and OS != "mac"', {
+          'cflags': [
+            '-mssse3',
+          ],
+        }],
+        ['OS == "mac"', {
+          'xcode_settings': {
+            'GCC_ENABLE_SUPPLEMENTAL_SSE3_INSTRUCTIONS': 'YES',
+          },
+        }],
+      ],
+    },
     {
       # TODO(rvargas): Remove this when gyp finally supports a clean model.
       # See bug 36232.
@@ -372,6 +448,7 @@
         'cpu_unittest.cc',
         'debug/leak_tracker_unittest.cc',
         'debug/stack_trace_unittest.cc',
+        'debug/trace_event_binary_unittest.cc',
         'debug/trace_event_unittest.cc',
         'debug/trace_event_win_unittest.cc',
         'dir_reader_posix_unittest.cc',
@@ -385,6 +462,8 @@
         'guid_unittest.cc',
         'hi_res_timer_manager_unittest.cc',
         'id_map_unittest.cc',
+        'incoming_task_queue_unittest.cc',
+        'io_uring_file_engine_unittest.cc',
         'i18n/break_iterator_unittest.cc',
         'i18n/char_iterator_unittest.cc',
         'i18n/case_conversion_unittest.cc',
@@ -394,8 +473,10 @@
         'i18n/rtl_unittest.cc',
         'i18n/string_search_unittest.cc',
         'i18n/time_formatting_unittest.cc',
+        'json/json_document_unittest.cc',
         'json/json_parser_unittest.cc',
         'json/json_reader_unittest.cc',
+        'json/json_stream_reader_unittest.cc',
         'json/json_value_converter_unittest.cc',
         'json/json_value_serializer_unittest.cc',
         'json/json_writer_unittest.cc',
@@ -424,16 +505,19 @@
         'message_loop_proxy_impl_unittest.cc',
         'message_loop_proxy_unittest.cc',
         'message_loop_unittest.cc',
+        'message_pump_epoll_unittest.cc',
         'message_pump_glib_unittest.cc',
         'message_pump_libevent_unittest.cc',
         'metrics/field_trial_unittest.cc',
         'metrics/histogram_unittest.cc',
+        'metrics/shared_histogram_table_unittest.cc',
         'metrics/stats_table_unittest.cc',
         'observer_list_unittest.cc',
         'path_service_unittest.cc',
         'pickle_unittest.cc',
         'platform_file_unittest.cc',
         'pr_time_unittest.cc',
+        'process_metrics_sampler_linux_unittest.cc',
         'process_util_unittest.cc',
         'process_util_unittest_mac.h',
         'process_util_unittest_mac.mm',
@@ -482,6 +566,7 @@
         'time_unittest.cc',
         'time_win_unittest.cc',
         'timer_unittest.cc',
+        'timer_wheel_unittest.cc',
         'tools_sanity_unittest.cc',
         'tracked_objects_unittest.cc',
         'tuple_unittest.cc',
@@ -581,6 +666,12 @@
             'message_pump_glib_unittest.cc',
           ]
         }],
+        ['OS != "linux"', {
+          'sources!': [
+            'io_uring_file_engine_unittest.cc',
+            'message_pump_epoll_unittest.cc',
+          ],
+        }],
         # This is needed to trigger the dll copy step on windows.
         # TODO(mark): This should not be necessary.
         ['OS == "win"', {
@@ -613,6 +704,58 @@
         }],
       ],
     },
+    {
+      'target_name': 'base_perftests',
+      'type': 'executable',
+      'sources': [
+        'debug/trace_event_perftest.cc',
+        'file_util_perftest.cc',
+        'file_util_proxy_perftest.cc',
+        'json/json_document_perftest.cc',
+        'json/json_stream_reader_perftest.cc',
+        'json/json_writer_perftest.cc',
+        'message_loop_perftest.cc',
+        'message_pump_epoll_perftest.cc',
+        'metrics/histogram_perftest.cc',
+        'process_metrics_sampler_linux_perftest.cc',
+        'string_split_perftest.cc',
+        'threading/sequenced_worker_pool_perftest.cc',
+        'threading/worker_pool_posix_perftest.cc',
+        'timer_perftest.cc',
+        'utf_string_conversions_perftest.cc',
+        'values_perftest.cc',
+      ],
+      'dependencies': [
+        'base',
+        'test_support_base',
+        'test_support_perf',
+        '../testing/gtest.gyp:gtest',
+      ],
+      'conditions': [
+        ['OS == "win"', {
+          'sources!': [
+            'threading/worker_pool_posix_perftest.cc',
+          ],
+        }],
+        ['OS != "linux"', {
+          'sources!': [
+            'message_pump_epoll_perftest.cc',
+            'process_metrics_sampler_linux_perftest.cc',
+          ],
+        }],
+      ],
+    },
+    {
+      # Converts binary traces written by TraceLog::StartStreaming() to JSON.
+      'target_name': 'trace_to_json',
+      'type': 'executable',
+      'sources': [
+        'debug/trace_to_json.cc',
+      ],
+      'dependencies': [
+        'base',
+      ],
+    },
     {
       'target_name': 'check_example',
       'type': 'executable',
@@ -18,6 +18,15 @@ const char kDisableBreakpad[]               = "disable-breakpad";
 // Enable DCHECKs in release mode.
 const char kEnableDCHECK[]                  = "enable-dcheck";
 
+// On Linux, makes FileUtilProxy run reads and writes through io_uring instead
+// of its worker TaskRunner, when the kernel supports it.
+const char kEnableIOUringFileIO[]           = "enable-io-uring-file-io";
+
+// On POSIX, runs WorkerPool tasks that aren't marked as slow on a fixed set of
+// work-stealing threads instead of the dynamic thread pool.
+const char kEnableWorkStealingWorkerPool[]  =
+    "enable-work-stealing-worker-pool";
+
 // Generates full memory crash dump.
 const char kFullMemoryCrashReport[]         = "full-memory-crash-report";
 
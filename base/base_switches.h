@@ -13,6 +13,8 @@ namespace switches {
 extern const char kDebugOnStart[];
 extern const char kDisableBreakpad[];
 extern const char kEnableDCHECK[];
+extern const char kEnableIOUringFileIO[];
+extern const char kEnableWorkStealingWorkerPool[];
 extern const char kFullMemoryCrashReport[];
 extern const char kNoErrorDialogs[];
 extern const char kTestChildProcess[];
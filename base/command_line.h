@@ -71,6 +71,11 @@ class BASE_EXPORT CommandLine {
   // only mutate if you know what you're doing!
   static CommandLine* ForCurrentProcess();
 
+  // Returns true if the CommandLine singleton has been initialized, so that
+  // code which may run before Init(), or in processes that never call it, can
+  // check before calling ForCurrentProcess().
+  static bool InitializedForCurrentProcess();
+
 #if defined(OS_WIN)
   static CommandLine FromString(const std::wstring& command_line);
 #endif
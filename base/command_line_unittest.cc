@@ -290,6 +290,7 @@ TEST(CommandLineTest, ProgramQuotes) {
 
 // Calling Init multiple times should not modify the previous CommandLine.
 TEST(CommandLineTest, Init) {
+  EXPECT_TRUE(CommandLine::InitializedForCurrentProcess());
   CommandLine* initial = CommandLine::ForCurrentProcess();
   EXPECT_FALSE(CommandLine::Init(0, NULL));
   CommandLine* current = CommandLine::ForCurrentProcess();
@@ -6,10 +6,12 @@
 
 #include <string.h>
 
+#include "base/basictypes.h"
 #include "build/build_config.h"
 
 #if defined(ARCH_CPU_X86_FAMILY)
 #if defined(_MSC_VER)
+#include <immintrin.h>  // For _xgetbv()
 #include <intrin.h>
 #endif
 #endif
@@ -30,12 +32,22 @@ CPU::CPU()
     has_ssse3_(false),
     has_sse41_(false),
     has_sse42_(false),
+    has_avx_(false),
+    has_avx2_(false),
     cpu_vendor_("unknown") {
   Initialize();
 }
 
 #if defined(ARCH_CPU_X86_FAMILY)
-#ifndef _MSC_VER
+#if defined(_MSC_VER)
+
+// Returns the extended control register |xcr|. Only valid if the OSXSAVE bit
+// of CPUID is set.
+uint64 xgetbv(uint32 xcr) {
+  return _xgetbv(xcr);
+}
+
+#else
 
 #if defined(__pic__) && defined(__i386__)
 
@@ -78,7 +90,18 @@ void __cpuidex(int cpu_info[4], int info_type, int info_index) {
 }
 
 #endif
-#endif  // _MSC_VER
+
+uint64 xgetbv(uint32 xcr) {
+  uint32 eax, edx;
+  __asm__ volatile (
+    "xgetbv"
+    : "=a"(eax), "=d"(edx)
+    : "c"(xcr)
+  );
+  return (static_cast<uint64>(edx) << 32) | eax;
+}
+
+#endif  // defined(_MSC_VER)
 #endif  // ARCH_CPU_X86_FAMILY
 
 void CPU::Initialize() {
@@ -118,6 +141,17 @@ void CPU::Initialize() {
     has_ssse3_ = (cpu_info[2] & 0x00000200) != 0;
     has_sse41_ = (cpu_info[2] & 0x00080000) != 0;
     has_sse42_ = (cpu_info[2] & 0x00100000) != 0;
+
+    // The YMM registers are only usable if the OS enabled XSAVE and saves
+    // both the XMM and the YMM state (bits 1 and 2 of XCR0).
+    const bool has_osxsave = (cpu_info[2] & 0x08000000) != 0;
+    has_avx_ = (cpu_info[2] & 0x10000000) != 0 && has_osxsave &&
+        (xgetbv(0) & 6) == 6;
+  }
+
+  if (num_ids >= 7 && has_avx_) {
+    __cpuidex(cpu_info, 7, 0);
+    has_avx2_ = (cpu_info[1] & 0x00000020) != 0;
   }
 #endif
 }
@@ -33,6 +33,10 @@ class BASE_EXPORT CPU {
   bool has_ssse3() const { return has_ssse3_; }
   bool has_sse41() const { return has_sse41_; }
   bool has_sse42() const { return has_sse42_; }
+  // AVX and AVX2 are only reported if the operating system saves the YMM
+  // registers on context switches.
+  bool has_avx() const { return has_avx_; }
+  bool has_avx2() const { return has_avx2_; }
 
  private:
   // Query the processor for CPUID information.
@@ -51,6 +55,8 @@ class BASE_EXPORT CPU {
   bool has_ssse3_;
   bool has_sse41_;
   bool has_sse42_;
+  bool has_avx_;
+  bool has_avx2_;
   std::string cpu_vendor_;
 };
 
@@ -0,0 +1,434 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/debug/trace_event_binary.h"
+
+#include <string.h>
+
+#include <vector>
+
+#include "base/debug/trace_event.h"
+#include "base/format_macros.h"
+#include "base/logging.h"
+#include "base/stringprintf.h"
+
+namespace base {
+namespace debug {
+
+namespace {
+
+const char kMagic[] = "TRCB";
+const size_t kMagicLength = 4;
+const unsigned char kFormatVersion = 1;
+
+const char kStringRecord = 'S';
+const char kEventRecord = 'E';
+
+void AppendVarint(uint64 value, std::string* out) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+void AppendSignedVarint(int64 value, std::string* out) {
+  AppendVarint((static_cast<uint64>(value) << 1) ^
+               static_cast<uint64>(value >> 63), out);
+}
+
+void AppendInlineString(const char* str, std::string* out) {
+  size_t length = strlen(str);
+  AppendVarint(0, out);
+  AppendVarint(length, out);
+  out->append(str, length);
+}
+
+// Reads the records of a binary trace from |data|, starting at |pos|.  All
+// Read methods return false if the data ends first, and set |truncated_|.
+class BinaryTraceReader {
+ public:
+  BinaryTraceReader(const std::string& data, size_t pos)
+      : data_(data),
+        pos_(pos),
+        truncated_(false) {}
+
+  bool AtEnd() const { return pos_ == data_.size(); }
+  bool truncated() const { return truncated_; }
+
+  bool ReadByte(unsigned char* value) {
+    if (pos_ >= data_.size())
+      return Truncated();
+    *value = static_cast<unsigned char>(data_[pos_++]);
+    return true;
+  }
+
+  bool ReadVarint(uint64* value) {
+    *value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      unsigned char byte;
+      if (!ReadByte(&byte))
+        return false;
+      *value |= static_cast<uint64>(byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+        return true;
+    }
+    return false;
+  }
+
+  bool ReadSignedVarint(int64* value) {
+    uint64 zigzag;
+    if (!ReadVarint(&zigzag))
+      return false;
+    *value = static_cast<int64>(zigzag >> 1) ^ -static_cast<int64>(zigzag & 1);
+    return true;
+  }
+
+  bool ReadBytes(uint64 length, std::string* value) {
+    if (length > data_.size() - pos_)
+      return Truncated();
+    value->assign(data_, pos_, static_cast<size_t>(length));
+    pos_ += static_cast<size_t>(length);
+    return true;
+  }
+
+  // Reads a string reference, looking interned strings up in |strings|.
+  bool ReadString(const std::vector<std::string>& strings,
+                  std::string* value) {
+    uint64 id;
+    if (!ReadVarint(&id))
+      return false;
+    if (id == 0) {
+      uint64 length;
+      return ReadVarint(&length) && ReadBytes(length, value);
+    }
+    if (id > strings.size())
+      return false;
+    *value = strings[static_cast<size_t>(id - 1)];
+    return true;
+  }
+
+ private:
+  bool Truncated() {
+    truncated_ = true;
+    return false;
+  }
+
+  const std::string& data_;
+  size_t pos_;
+  bool truncated_;
+
+  DISALLOW_COPY_AND_ASSIGN(BinaryTraceReader);
+};
+
+// Reads an event record and appends it as JSON, the same way
+// TraceEvent::AppendAsJSON() does, to |out|.
+bool AppendEventRecordAsJSON(BinaryTraceReader* reader,
+                             const std::vector<std::string>& strings,
+                             int process_id,
+                             int64* timestamp,
+                             std::string* out) {
+  unsigned char phase;
+  unsigned char flags;
+  std::string category;
+  std::string name;
+  int64 thread_id;
+  int64 timestamp_delta;
+  if (!reader->ReadByte(&phase) ||
+      !reader->ReadByte(&flags) ||
+      !reader->ReadString(strings, &category) ||
+      !reader->ReadString(strings, &name) ||
+      !reader->ReadSignedVarint(&thread_id) ||
+      !reader->ReadSignedVarint(&timestamp_delta)) {
+    return false;
+  }
+  *timestamp += timestamp_delta;
+  uint64 id = 0;
+  if ((flags & TRACE_EVENT_FLAG_HAS_ID) && !reader->ReadVarint(&id))
+    return false;
+
+  StringAppendF(out,
+      "{\"cat\":\"%s\",\"pid\":%i,\"tid\":%i,\"ts\":%" PRId64 ","
+      "\"ph\":\"%c\",\"name\":\"%s\",\"args\":{",
+      category.c_str(),
+      process_id,
+      static_cast<int>(thread_id),
+      *timestamp,
+      phase,
+      name.c_str());
+
+  unsigned char num_args;
+  if (!reader->ReadByte(&num_args))
+    return false;
+  for (unsigned char i = 0; i < num_args; ++i) {
+    std::string arg_name;
+    unsigned char type;
+    if (!reader->ReadString(strings, &arg_name) || !reader->ReadByte(&type))
+      return false;
+
+    TraceEvent::TraceValue value;
+    uint64 bits = 0;
+    int64 signed_bits = 0;
+    unsigned char byte = 0;
+    std::string string_value;
+    switch (type) {
+      case TRACE_VALUE_TYPE_BOOL:
+        if (!reader->ReadByte(&byte))
+          return false;
+        value.as_bool = !!byte;
+        break;
+      case TRACE_VALUE_TYPE_UINT:
+      case TRACE_VALUE_TYPE_POINTER:
+        if (!reader->ReadVarint(&bits))
+          return false;
+        value.as_uint = bits;
+        break;
+      case TRACE_VALUE_TYPE_INT:
+        if (!reader->ReadSignedVarint(&signed_bits))
+          return false;
+        value.as_int = signed_bits;
+        break;
+      case TRACE_VALUE_TYPE_DOUBLE:
+        for (int shift = 0; shift < 64; shift += 8) {
+          if (!reader->ReadByte(&byte))
+            return false;
+          bits |= static_cast<uint64>(byte) << shift;
+        }
+        memcpy(&value.as_double, &bits, sizeof(value.as_double));
+        break;
+      case TRACE_VALUE_TYPE_STRING:
+      case TRACE_VALUE_TYPE_COPY_STRING:
+        if (!reader->ReadString(strings, &string_value))
+          return false;
+        value.as_string = string_value.c_str();
+        break;
+      default:
+        return false;
+    }
+    if (type == TRACE_VALUE_TYPE_POINTER) {
+      // Written as a hex string like AppendValueAsJSON() does, but without
+      // going through a pointer that may be narrower than the original.
+      string_value = StringPrintf("%" PRIx64, static_cast<uint64>(bits));
+      value.as_string = string_value.c_str();
+      type = TRACE_VALUE_TYPE_STRING;
+    }
+
+    if (i > 0)
+      *out += ",";
+    *out += "\"";
+    *out += arg_name;
+    *out += "\":";
+    TraceEvent::AppendValueAsJSON(type, value, out);
+  }
+  *out += "}";
+
+  if (flags & TRACE_EVENT_FLAG_HAS_ID)
+    StringAppendF(out, ",\"id\":\"%" PRIx64 "\"", static_cast<uint64>(id));
+  *out += "}";
+  return true;
+}
+
+}  // namespace
+
+TraceEventBinaryWriter::TraceEventBinaryWriter(int process_id)
+    : process_id_(process_id),
+      next_string_id_(1),
+      previous_timestamp_(0) {
+}
+
+TraceEventBinaryWriter::~TraceEventBinaryWriter() {
+}
+
+void TraceEventBinaryWriter::AppendHeader(std::string* out) {
+  out->append(kMagic, kMagicLength);
+  out->push_back(static_cast<char>(kFormatVersion));
+  AppendVarint(static_cast<uint32>(process_id_), out);
+}
+
+void TraceEventBinaryWriter::AppendEvent(const TraceEvent& event,
+                                         std::string* out) {
+  // Names are only worth interning by contents if they are copies of a
+  // string the caller will pass again, which is what TRACE_EVENT_COPY_XXX is
+  // used for.  Copied string values are usually unique and written inline.
+  bool copy = !!(event.flags() & TRACE_EVENT_FLAG_COPY);
+
+  // String records have to come before the event that refers to them, so the
+  // event is encoded separately and appended last.
+  std::string record;
+  record.push_back(kEventRecord);
+  record.push_back(event.phase());
+  record.push_back(static_cast<char>(event.flags()));
+  AppendStaticString(TraceLog::GetCategoryName(event.category_enabled()),
+                     out, &record);
+  if (copy)
+    AppendCopiedString(event.name(), true, out, &record);
+  else
+    AppendStaticString(event.name(), out, &record);
+  AppendSignedVarint(event.thread_id(), &record);
+  int64 timestamp = event.timestamp().ToInternalValue();
+  AppendSignedVarint(timestamp - previous_timestamp_, &record);
+  previous_timestamp_ = timestamp;
+  if (event.flags() & TRACE_EVENT_FLAG_HAS_ID)
+    AppendVarint(event.id(), &record);
+
+  int num_args = 0;
+  while (num_args < kTraceMaxNumArgs && event.arg_name(num_args))
+    ++num_args;
+  record.push_back(static_cast<char>(num_args));
+  for (int i = 0; i < num_args; ++i) {
+    if (copy)
+      AppendCopiedString(event.arg_name(i), true, out, &record);
+    else
+      AppendStaticString(event.arg_name(i), out, &record);
+
+    unsigned char type = event.arg_type(i);
+    TraceEvent::TraceValue value = event.arg_value(i);
+    record.push_back(static_cast<char>(type));
+    switch (type) {
+      case TRACE_VALUE_TYPE_BOOL:
+        record.push_back(value.as_bool ? 1 : 0);
+        break;
+      case TRACE_VALUE_TYPE_UINT:
+        AppendVarint(value.as_uint, &record);
+        break;
+      case TRACE_VALUE_TYPE_INT:
+        AppendSignedVarint(value.as_int, &record);
+        break;
+      case TRACE_VALUE_TYPE_DOUBLE: {
+        uint64 bits;
+        memcpy(&bits, &value.as_double, sizeof(bits));
+        for (int shift = 0; shift < 64; shift += 8)
+          record.push_back(static_cast<char>(bits >> shift));
+        break;
+      }
+      case TRACE_VALUE_TYPE_POINTER:
+        AppendVarint(static_cast<uint64>(
+                         reinterpret_cast<intptr_t>(value.as_pointer)),
+                     &record);
+        break;
+      case TRACE_VALUE_TYPE_STRING:
+        if (value.as_string)
+          AppendStaticString(value.as_string, out, &record);
+        else
+          AppendInlineString("NULL", &record);
+        break;
+      case TRACE_VALUE_TYPE_COPY_STRING:
+        AppendCopiedString(value.as_string ? value.as_string : "NULL", false,
+                           out, &record);
+        break;
+      default:
+        NOTREACHED() << "Don't know how to encode this value";
+        record.push_back(TRACE_VALUE_TYPE_UINT);
+        record.push_back(0);
+        break;
+    }
+  }
+  out->append(record);
+}
+
+void TraceEventBinaryWriter::AppendStaticString(const char* str,
+                                                std::string* out,
+                                                std::string* record) {
+  uintptr_t key = reinterpret_cast<uintptr_t>(str);
+  base::hash_map<uintptr_t, int>::const_iterator it =
+      static_string_ids_.find(key);
+  int id;
+  if (it != static_string_ids_.end()) {
+    id = it->second;
+  } else {
+    id = AppendStringRecord(str, out);
+    static_string_ids_[key] = id;
+  }
+  AppendVarint(id, record);
+}
+
+void TraceEventBinaryWriter::AppendCopiedString(const char* str,
+                                                bool intern_copy,
+                                                std::string* out,
+                                                std::string* record) {
+  if (!intern_copy) {
+    AppendInlineString(str, record);
+    return;
+  }
+  std::string key(str);
+  base::hash_map<std::string, int>::const_iterator it =
+      copied_string_ids_.find(key);
+  int id;
+  if (it != copied_string_ids_.end()) {
+    id = it->second;
+  } else {
+    id = AppendStringRecord(str, out);
+    copied_string_ids_[key] = id;
+  }
+  AppendVarint(id, record);
+}
+
+int TraceEventBinaryWriter::AppendStringRecord(const char* str,
+                                               std::string* out) {
+  size_t length = strlen(str);
+  out->push_back(kStringRecord);
+  AppendVarint(length, out);
+  out->append(str, length);
+  return next_string_id_++;
+}
+
+bool ConvertBinaryTraceToJSON(const std::string& binary, std::string* json) {
+  json->clear();
+  if (binary.size() < kMagicLength ||
+      binary.compare(0, kMagicLength, kMagic) != 0) {
+    return false;
+  }
+
+  BinaryTraceReader reader(binary, kMagicLength);
+  unsigned char version;
+  uint64 process_id;
+  if (!reader.ReadByte(&version) || version != kFormatVersion ||
+      !reader.ReadVarint(&process_id)) {
+    return false;
+  }
+
+  std::vector<std::string> strings;
+  int64 timestamp = 0;
+  std::string event_json;
+  *json += "[";
+  bool first_event = true;
+  while (!reader.AtEnd()) {
+    unsigned char type;
+    reader.ReadByte(&type);
+    bool complete;
+    if (type == kStringRecord) {
+      uint64 length;
+      std::string str;
+      complete = reader.ReadVarint(&length) && reader.ReadBytes(length, &str);
+      if (complete)
+        strings.push_back(str);
+    } else if (type == kEventRecord) {
+      event_json.clear();
+      complete = AppendEventRecordAsJSON(&reader, strings,
+                                         static_cast<int>(process_id),
+                                         &timestamp, &event_json);
+      if (complete) {
+        if (!first_event)
+          *json += ",";
+        first_event = false;
+        *json += event_json;
+      }
+    } else {
+      return false;
+    }
+
+    if (!complete) {
+      // Anything but running out of data in the middle of a record means
+      // that this isn't a trace we can read.
+      if (!reader.truncated())
+        return false;
+      break;
+    }
+  }
+  *json += "]";
+  return true;
+}
+
+}  // namespace debug
+}  // namespace base
@@ -0,0 +1,91 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// A compact binary encoding of trace events, used by TraceLog to stream
+// events to a file while tracing (see TraceLog::StartStreaming). Traces in
+// this format can be converted to the JSON that TraceResultBuffer produces
+// with ConvertBinaryTraceToJSON(), or offline with the trace_to_json tool.
+//
+// A binary trace is a header followed by records. Integers are unsigned
+// LEB128 varints; signed integers are zigzag encoded first.
+//
+//   header:  "TRCB", a format version byte, varint process id.
+//   string:  'S', varint length, bytes. Defines the string with the next id,
+//            counting from 1.
+//   event:   'E', phase, flags, string category, string name, signed
+//            thread id, signed timestamp delta from the previous event in
+//            microseconds, varint id (only with TRACE_EVENT_FLAG_HAS_ID),
+//            number of arguments, then for each argument string name, value
+//            type and the value.
+//
+// A string is referenced by the id of a string record, or by 0 followed by
+// varint length and bytes for strings that are not interned.  Values are one
+// byte for bools, a varint for unsigned ints and pointers, a signed varint for
+// ints, 8 little-endian bytes for doubles and a string for strings.
+
+#ifndef BASE_DEBUG_TRACE_EVENT_BINARY_H_
+#define BASE_DEBUG_TRACE_EVENT_BINARY_H_
+#pragma once
+
+#include <string>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/hash_tables.h"
+
+namespace base {
+namespace debug {
+
+class TraceEvent;
+
+// Encodes TraceEvents in the binary trace format.  Category names and names
+// that are used again are interned, so each string is only written once per
+// trace.  Not thread safe.
+class BASE_EXPORT TraceEventBinaryWriter {
+ public:
+  explicit TraceEventBinaryWriter(int process_id);
+  ~TraceEventBinaryWriter();
+
+  // Appends the header that starts a binary trace to |out|.
+  void AppendHeader(std::string* out);
+
+  // Appends |event| to |out|, preceded by the string records it needs.
+  void AppendEvent(const TraceEvent& event, std::string* out);
+
+ private:
+  // Appends a reference to |str| to |record|, and the string record that
+  // defines it to |out| if it is interned and new.  Static strings are
+  // interned by address, copied strings by contents if |intern_copy| is set.
+  void AppendStaticString(const char* str,
+                          std::string* out,
+                          std::string* record);
+  void AppendCopiedString(const char* str,
+                          bool intern_copy,
+                          std::string* out,
+                          std::string* record);
+  // Appends the string record that defines the next id to |out|, and returns
+  // the id.
+  int AppendStringRecord(const char* str, std::string* out);
+
+  int process_id_;
+  int next_string_id_;
+  base::hash_map<uintptr_t, int> static_string_ids_;
+  base::hash_map<std::string, int> copied_string_ids_;
+  int64 previous_timestamp_;
+
+  DISALLOW_COPY_AND_ASSIGN(TraceEventBinaryWriter);
+};
+
+// Converts the binary trace |binary| to the JSON array that TraceResultBuffer
+// builds from the output of TraceLog::Flush(), and stores it in |json|.
+// A trace that ends in the middle of a record, as happens when the process
+// dies while streaming, is converted up to the last complete record.  Returns
+// false if |binary| is not a binary trace.
+BASE_EXPORT bool ConvertBinaryTraceToJSON(const std::string& binary,
+                                          std::string* json);
+
+}  // namespace debug
+}  // namespace base
+
+#endif  // BASE_DEBUG_TRACE_EVENT_BINARY_H_
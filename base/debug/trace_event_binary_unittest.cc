@@ -0,0 +1,222 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/debug/trace_event_binary.h"
+
+#include "base/at_exit.h"
+#include "base/bind.h"
+#include "base/debug/trace_event.h"
+#include "base/file_util.h"
+#include "base/json/json_reader.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/platform_file.h"
+#include "base/scoped_temp_dir.h"
+#include "base/stringprintf.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/thread.h"
+#include "base/values.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace debug {
+
+namespace {
+
+class TraceEventBinaryTest : public testing::Test {
+ public:
+  virtual void SetUp() OVERRIDE {
+    TraceLog::DeleteForTesting();
+    TraceLog::Resurrect();
+    ASSERT_FALSE(TraceLog::GetInstance()->IsEnabled());
+  }
+
+  // Encodes the events recorded on this thread with a
+  // TraceEventBinaryWriter, and returns them as TraceEvent::AppendAsJSON()
+  // writes them in |json|.
+  std::string EncodeRecordedEvents(std::string* json) {
+    TraceLog* trace_log = TraceLog::GetInstance();
+    TraceEventBinaryWriter writer(trace_log->process_id());
+    std::string binary;
+    writer.AppendHeader(&binary);
+    *json = "[";
+    for (size_t i = 0; i < trace_log->GetEventsSize(); ++i) {
+      if (i > 0)
+        *json += ",";
+      trace_log->GetEventAt(i).AppendAsJSON(json);
+      writer.AppendEvent(trace_log->GetEventAt(i), &binary);
+    }
+    *json += "]";
+    return binary;
+  }
+
+ private:
+  // We want our singleton torn down after each test.
+  ShadowingAtExitManager at_exit_manager_;
+};
+
+void TraceManyEvents(int thread_id, int num_events) {
+  for (int i = 0; i < num_events; i++) {
+    TRACE_EVENT_INSTANT2("all", "multi thread event",
+                         "thread", thread_id,
+                         "event", i);
+  }
+}
+
+// Signals |flushed| when a flush while streaming is complete.
+void SignalFlushed(WaitableEvent* flushed,
+                   const scoped_refptr<RefCountedString>& events) {
+  EXPECT_TRUE(events->data().empty());
+  flushed->Signal();
+}
+
+}  // namespace
+
+// The JSON converted from a binary trace is the same as the JSON for the
+// events it was written from.
+TEST_F(TraceEventBinaryTest, ConvertsToSameJSON) {
+  TraceLog::GetInstance()->SetEnabled(true);
+
+  std::string copied_name("copied name");
+  TRACE_EVENT_INSTANT0("all", "no args");
+  TRACE_EVENT_INSTANT2("all", "numbers", "int", -42, "double", 3.5);
+  TRACE_EVENT_INSTANT2("all", "more", "bool", true, "uint", 1ULL << 40);
+  TRACE_EVENT_INSTANT2("all", "strings", "static", "a \"quoted\" string",
+                       "copy", std::string("copied value"));
+  TRACE_EVENT_INSTANT1("all", "pointer", "ptr", &copied_name);
+  TRACE_EVENT_COPY_INSTANT1("all", copied_name.c_str(),
+                            copied_name.c_str(), 7);
+  TRACE_EVENT_COPY_INSTANT1("all", copied_name.c_str(),
+                            copied_name.c_str(), 8);
+  TRACE_EVENT_ASYNC_BEGIN0("other", "async", 0x1234);
+  TRACE_EVENT_INSTANT0("all", "no args");
+
+  std::string json;
+  std::string binary = EncodeRecordedEvents(&json);
+  TraceLog::GetInstance()->SetEnabled(false);
+
+  std::string converted;
+  EXPECT_TRUE(ConvertBinaryTraceToJSON(binary, &converted));
+  EXPECT_EQ(json, converted);
+  // Each name is only written once.
+  EXPECT_EQ(binary.find("no args"), binary.rfind("no args"));
+  EXPECT_EQ(binary.find("copied name"), binary.rfind("copied name"));
+}
+
+// A trace cut off in the middle converts up to the last complete event.
+TEST_F(TraceEventBinaryTest, ConvertsTruncatedTrace) {
+  TraceLog::GetInstance()->SetEnabled(true);
+  TraceManyEvents(0, 10);
+  std::string json;
+  std::string binary = EncodeRecordedEvents(&json);
+  TraceLog::GetInstance()->SetEnabled(false);
+
+  std::string header;
+  TraceEventBinaryWriter(TraceLog::GetInstance()->process_id()).AppendHeader(
+      &header);
+  size_t previous_size = 0;
+  for (size_t length = header.size(); length <= binary.size(); ++length) {
+    std::string converted;
+    ASSERT_TRUE(ConvertBinaryTraceToJSON(binary.substr(0, length),
+                                         &converted));
+    scoped_ptr<Value> root(JSONReader::Read(converted));
+    ListValue* events = NULL;
+    ASSERT_TRUE(root.get() && root->GetAsList(&events));
+    EXPECT_GE(events->GetSize(), previous_size);
+    previous_size = events->GetSize();
+  }
+  EXPECT_EQ(10u, previous_size);
+}
+
+TEST_F(TraceEventBinaryTest, RejectsOtherData) {
+  std::string converted;
+  EXPECT_FALSE(ConvertBinaryTraceToJSON("", &converted));
+  EXPECT_FALSE(ConvertBinaryTraceToJSON("[{\"cat\":\"all\"}]", &converted));
+
+  TraceEventBinaryWriter writer(1);
+  std::string binary;
+  writer.AppendHeader(&binary);
+  binary += "X";
+  EXPECT_FALSE(ConvertBinaryTraceToJSON(binary, &converted));
+}
+
+// Events from several threads are streamed to a file while tracing, and the
+// file converts to JSON with all of them and the thread names.  The threads
+// record in rounds that fit in the trace buffer, and each round is flushed
+// before the next starts, so no events are dropped however slowly the file
+// is written.
+TEST_F(TraceEventBinaryTest, Streaming) {
+  ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  FilePath path = temp_dir.path().AppendASCII("trace");
+  PlatformFile file = CreatePlatformFile(
+      path, PLATFORM_FILE_CREATE_ALWAYS | PLATFORM_FILE_WRITE, NULL, NULL);
+  ASSERT_NE(kInvalidPlatformFileValue, file);
+
+  TraceLog* trace_log = TraceLog::GetInstance();
+  WaitableEvent flushed(false, false);
+  trace_log->SetOutputCallback(base::Bind(&SignalFlushed, &flushed));
+  ASSERT_TRUE(trace_log->StartStreaming(file));
+  EXPECT_FALSE(trace_log->StartStreaming(file));
+  trace_log->SetEnabled(true);
+
+  // More events than the trace buffer holds.
+  const int num_threads = 4;
+  const int num_rounds = 15;
+  const int num_events_per_round = 10000;
+  const int num_events = num_rounds * num_events_per_round;
+  scoped_ptr<Thread> threads[num_threads];
+  scoped_ptr<WaitableEvent> round_done[num_threads];
+  for (int i = 0; i < num_threads; i++) {
+    threads[i].reset(new Thread(StringPrintf("Thread %d", i).c_str()));
+    threads[i]->Start();
+    round_done[i].reset(new WaitableEvent(false, false));
+  }
+  for (int round = 0; round < num_rounds; round++) {
+    for (int i = 0; i < num_threads; i++) {
+      threads[i]->message_loop()->PostTask(
+          FROM_HERE, base::Bind(&TraceManyEvents, i, num_events_per_round));
+      threads[i]->message_loop()->PostTask(
+          FROM_HERE, base::Bind(&WaitableEvent::Signal,
+                                base::Unretained(round_done[i].get())));
+    }
+    for (int i = 0; i < num_threads; i++)
+      round_done[i]->Wait();
+    trace_log->Flush();
+    flushed.Wait();
+  }
+  for (int i = 0; i < num_threads; i++)
+    threads[i]->Stop();
+
+  trace_log->SetEnabled(false);
+  trace_log->StopStreaming();
+  trace_log->SetOutputCallback(TraceLog::OutputCallback());
+  ClosePlatformFile(file);
+
+  std::string binary;
+  ASSERT_TRUE(file_util::ReadFileToString(path, &binary));
+  std::string json;
+  ASSERT_TRUE(ConvertBinaryTraceToJSON(binary, &json));
+  EXPECT_LT(binary.size() * 4, json.size());
+
+  scoped_ptr<Value> root(JSONReader::Read(json));
+  ListValue* events = NULL;
+  ASSERT_TRUE(root.get() && root->GetAsList(&events));
+  int num_recorded_events = 0;
+  int num_thread_names = 0;
+  for (size_t i = 0; i < events->GetSize(); ++i) {
+    DictionaryValue* event = NULL;
+    std::string name;
+    ASSERT_TRUE(events->GetDictionary(i, &event));
+    ASSERT_TRUE(event->GetString("name", &name));
+    if (name == "multi thread event")
+      num_recorded_events++;
+    else if (name == "thread_name")
+      num_thread_names++;
+  }
+  EXPECT_EQ(num_threads * num_events, num_recorded_events);
+  EXPECT_EQ(num_threads, num_thread_names);
+}
+
+}  // namespace debug
+}  // namespace base
@@ -8,13 +8,16 @@
 
 #include "base/bind.h"
 #include "base/debug/trace_event.h"
+#include "base/debug/trace_event_binary.h"
 #include "base/file_util.h"
 #include "base/format_macros.h"
 #include "base/lazy_instance.h"
+#include "base/memory/scoped_ptr.h"
 #include "base/memory/singleton.h"
 #include "base/process_util.h"
 #include "base/stringprintf.h"
 #include "base/string_tokenizer.h"
+#include "base/synchronization/waitable_event.h"
 #include "base/threading/platform_thread.h"
 #include "base/threading/thread_local.h"
 #include "base/utf_string_conversions.h"
@@ -42,6 +45,13 @@ namespace debug {
 // before throwing them away.
 const size_t kTraceEventBufferSize = 500000;
 const size_t kTraceEventBatchSize = 1000;
+// Number of events each thread records before it needs to take the lock to
+// hand its chunk over and get a new one.
+const size_t kTraceEventChunkSize = 64;
+// While streaming, full chunks are written out at least this often, or as
+// soon as this many are waiting.
+const int kTraceStreamingIntervalMs = 1000;
+const size_t kTraceStreamingChunkThreshold = 64;
 
 #define TRACE_EVENT_MAX_CATEGORIES 100
 
@@ -68,50 +78,6 @@ int g_category_index = 3; // skip initial 3 categories
 LazyInstance<ThreadLocalPointer<const char> >::Leaky
     g_current_thread_name = LAZY_INSTANCE_INITIALIZER;
 
-void AppendValueAsJSON(unsigned char type,
-                       TraceEvent::TraceValue value,
-                       std::string* out) {
-  std::string::size_type start_pos;
-  switch (type) {
-    case TRACE_VALUE_TYPE_BOOL:
-      *out += value.as_bool ? "true" : "false";
-      break;
-    case TRACE_VALUE_TYPE_UINT:
-      StringAppendF(out, "%" PRIu64, static_cast<uint64>(value.as_uint));
-      break;
-    case TRACE_VALUE_TYPE_INT:
-      StringAppendF(out, "%" PRId64, static_cast<int64>(value.as_int));
-      break;
-    case TRACE_VALUE_TYPE_DOUBLE:
-      StringAppendF(out, "%f", value.as_double);
-      break;
-    case TRACE_VALUE_TYPE_POINTER:
-      // JSON only supports double and int numbers.
-      // So as not to lose bits from a 64-bit pointer, output as a hex string.
-      StringAppendF(out, "\"%" PRIx64 "\"", static_cast<uint64>(
-                                     reinterpret_cast<intptr_t>(
-                                     value.as_pointer)));
-      break;
-    case TRACE_VALUE_TYPE_STRING:
-    case TRACE_VALUE_TYPE_COPY_STRING:
-      *out += "\"";
-      start_pos = out->size();
-      *out += value.as_string ? value.as_string : "NULL";
-      // insert backslash before special characters for proper json format.
-      while ((start_pos = out->find_first_of("\\\"", start_pos)) !=
-             std::string::npos) {
-        out->insert(start_pos, 1, '\\');
-        // skip inserted escape character and following character.
-        start_pos += 2;
-      }
-      *out += "\"";
-      break;
-    default:
-      NOTREACHED() << "Don't know how to print this value";
-      break;
-  }
-}
-
 }  // namespace
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -234,6 +200,51 @@ void TraceEvent::AppendEventsAsJSON(const std::vector<TraceEvent>& events,
   }
 }
 
+// static
+void TraceEvent::AppendValueAsJSON(unsigned char type,
+                                   TraceEvent::TraceValue value,
+                                   std::string* out) {
+  std::string::size_type start_pos;
+  switch (type) {
+    case TRACE_VALUE_TYPE_BOOL:
+      *out += value.as_bool ? "true" : "false";
+      break;
+    case TRACE_VALUE_TYPE_UINT:
+      StringAppendF(out, "%" PRIu64, static_cast<uint64>(value.as_uint));
+      break;
+    case TRACE_VALUE_TYPE_INT:
+      StringAppendF(out, "%" PRId64, static_cast<int64>(value.as_int));
+      break;
+    case TRACE_VALUE_TYPE_DOUBLE:
+      StringAppendF(out, "%f", value.as_double);
+      break;
+    case TRACE_VALUE_TYPE_POINTER:
+      // JSON only supports double and int numbers.
+      // So as not to lose bits from a 64-bit pointer, output as a hex string.
+      StringAppendF(out, "\"%" PRIx64 "\"", static_cast<uint64>(
+                                     reinterpret_cast<intptr_t>(
+                                     value.as_pointer)));
+      break;
+    case TRACE_VALUE_TYPE_STRING:
+    case TRACE_VALUE_TYPE_COPY_STRING:
+      *out += "\"";
+      start_pos = out->size();
+      *out += value.as_string ? value.as_string : "NULL";
+      // insert backslash before special characters for proper json format.
+      while ((start_pos = out->find_first_of("\\\"", start_pos)) !=
+             std::string::npos) {
+        out->insert(start_pos, 1, '\\');
+        // skip inserted escape character and following character.
+        start_pos += 2;
+      }
+      *out += "\"";
+      break;
+    default:
+      NOTREACHED() << "Don't know how to print this value";
+      break;
+  }
+}
+
 void TraceEvent::AppendAsJSON(std::string* out) const {
   int64 time_int64 = timestamp_.ToInternalValue();
   int process_id = TraceLog::GetInstance()->process_id();
@@ -316,14 +327,165 @@ void TraceResultBuffer::Finish() {
 //
 ////////////////////////////////////////////////////////////////////////////////
 
+// Events are written by the recording thread at index |size| and then
+// published with a release store of |size|, so Flush() can read the events
+// before |size| from another thread without blocking the recording thread.
+struct TraceLog::EventChunk {
+  EventChunk(ThreadLocalEventBuffer* owner, int first_event_id)
+      : owner(owner),
+        first_event_id(first_event_id),
+        flushed(0),
+        size(0) {}
+
+  // The buffer that recorded these events, or NULL once its thread exited.
+  // Only used to find the events of the current thread for testing.
+  ThreadLocalEventBuffer* owner;
+  // The per-thread sequence number of |events[0]|.
+  int first_event_id;
+  // Number of events already handed out by Flush().  Guarded by |lock_|.
+  size_t flushed;
+  volatile subtle::Atomic32 size;
+  TraceEvent events[kTraceEventChunkSize];
+};
+
+struct TraceLog::ThreadLocalEventBuffer {
+  explicit ThreadLocalEventBuffer(TraceLog* trace_log)
+      : trace_log(trace_log),
+        chunk(NULL),
+        next_event_id(0),
+        flushed_event_id(0),
+        retired_event_id(0) {}
+
+  TraceLog* const trace_log;
+  // The chunk events are currently recorded into.  Only changed by the
+  // recording thread, under |lock_|.
+  EventChunk* chunk;
+  // The sequence number of the next event.  Only used by the recording
+  // thread.
+  int next_event_id;
+  // Events with a lower sequence number have been flushed.  Guarded by
+  // |lock_|.
+  int flushed_event_id;
+  // Events with a lower sequence number are in |logged_chunks_| or flushed.
+  // Guarded by |lock_|.
+  int retired_event_id;
+};
+
+class TraceLog::StreamingThread : public PlatformThread::Delegate {
+ public:
+  StreamingThread(TraceLog* trace_log, PlatformFile file, int process_id)
+      : trace_log_(trace_log),
+        file_(file),
+        writer_(process_id),
+        wake_up_(false, false),
+        flush_requested_(false),
+        stop_requested_(0),
+        write_failed_(false) {}
+
+  // Makes the thread write out the full chunks without waiting for the next
+  // interval.
+  void WakeUp() {
+    wake_up_.Signal();
+  }
+
+  // Makes the thread write out all events logged so far, and then run
+  // |done_callback|, unless it is null, with an empty string.
+  void RequestFlush(const OutputCallback& done_callback) {
+    {
+      AutoLock lock(flush_lock_);
+      flush_requested_ = true;
+      if (!done_callback.is_null())
+        flush_callbacks_.push_back(done_callback);
+    }
+    wake_up_.Signal();
+  }
+
+  // Makes the thread write out all events logged so far and exit.
+  void Stop() {
+    subtle::Release_Store(&stop_requested_, 1);
+    wake_up_.Signal();
+  }
+
+  virtual void ThreadMain() OVERRIDE {
+    PlatformThread::SetName("TraceLog_StreamingThread");
+    std::string header;
+    writer_.AppendHeader(&header);
+    Write(header);
+
+    bool stop = false;
+    while (!stop) {
+      wake_up_.TimedWait(
+          TimeDelta::FromMilliseconds(kTraceStreamingIntervalMs));
+      stop = !!subtle::Acquire_Load(&stop_requested_);
+      bool flush;
+      std::vector<OutputCallback> flush_callbacks;
+      {
+        AutoLock lock(flush_lock_);
+        flush = stop || flush_requested_;
+        flush_requested_ = false;
+        flush_callbacks.swap(flush_callbacks_);
+      }
+
+      std::vector<EventChunk*> chunks;
+      std::vector<TraceEvent> events;
+      {
+        AutoLock lock(trace_log_->lock_);
+        trace_log_->TakeEventsToFlush(flush, &chunks, &events);
+      }  // release lock
+
+      std::vector<const TraceEvent*> events_to_write;
+      GetEventsToFlush(chunks, events, &events_to_write);
+      std::string data;
+      for (size_t i = 0; i < events_to_write.size(); ++i)
+        writer_.AppendEvent(*events_to_write[i], &data);
+      STLDeleteElements(&chunks);
+      Write(data);
+
+      for (size_t i = 0; i < flush_callbacks.size(); ++i)
+        flush_callbacks[i].Run(new RefCountedString());
+    }
+  }
+
+ private:
+  void Write(const std::string& data) {
+    if (data.empty() || write_failed_)
+      return;
+    int size = static_cast<int>(data.size());
+    if (WritePlatformFileAtCurrentPos(file_, data.data(), size) != size) {
+      // Keep going so the trace buffer doesn't fill up, but don't write
+      // anything after a gap.
+      DLOG(ERROR) << "Failed to write trace events; stopped streaming them.";
+      write_failed_ = true;
+    }
+  }
+
+  TraceLog* trace_log_;
+  PlatformFile file_;
+  TraceEventBinaryWriter writer_;
+  WaitableEvent wake_up_;
+  // Protects |flush_requested_| and |flush_callbacks_|.
+  Lock flush_lock_;
+  bool flush_requested_;
+  // The output callbacks of the Flush() calls that the next flush completes.
+  std::vector<OutputCallback> flush_callbacks_;
+  volatile subtle::Atomic32 stop_requested_;
+  bool write_failed_;
+
+  DISALLOW_COPY_AND_ASSIGN(StreamingThread);
+};
+
 // static
 TraceLog* TraceLog::GetInstance() {
   return Singleton<TraceLog, StaticMemorySingletonTraits<TraceLog> >::get();
 }
 
 TraceLog::TraceLog()
-    : enabled_(false)
-    , dispatching_to_observer_list_(false) {
+    : enabled_(false),
+      num_chunks_(0),
+      buffer_full_(0),
+      thread_local_event_buffer_(&TraceLog::OnThreadExit),
+      streaming_thread_(NULL),
+      dispatching_to_observer_list_(false) {
   // Trace is enabled or disabled on one thread while other threads are
   // accessing the enabled flag. We don't care whether edge-case events are
   // traced or not, so we allow races on the enabled flag to keep the trace
@@ -343,6 +505,15 @@ TraceLog::TraceLog()
 }
 
 TraceLog::~TraceLog() {
+  StopStreaming();
+  // Stop running OnThreadExit() for threads that recorded into this instance
+  // and make sure a resurrected instance starts with fresh per-thread state.
+  thread_local_event_buffer_.Free();
+  for (size_t i = 0; i < thread_buffers_.size(); ++i) {
+    delete thread_buffers_[i]->chunk;
+    delete thread_buffers_[i];
+  }
+  STLDeleteElements(&logged_chunks_);
 }
 
 const unsigned char* TraceLog::GetCategoryEnabled(const char* name) {
@@ -447,7 +618,6 @@ void TraceLog::SetEnabled(const std::vector<std::string>& included_categories,
                     OnTraceLogWillEnable());
   dispatching_to_observer_list_ = false;
 
-  logged_events_.reserve(1024);
   enabled_ = true;
   included_categories_ = included_categories;
   excluded_categories_ = excluded_categories;
@@ -535,7 +705,8 @@ void TraceLog::RemoveEnabledStateObserver(
 }
 
 float TraceLog::GetBufferPercentFull() const {
-  return (float)((double)logged_events_.size()/(double)kTraceEventBufferSize);
+  return (float)((double)(num_chunks_ * kTraceEventChunkSize) /
+                 (double)kTraceEventBufferSize);
 }
 
 void TraceLog::SetOutputCallback(const TraceLog::OutputCallback& cb) {
@@ -549,28 +720,111 @@ void TraceLog::SetBufferFullCallback(const TraceLog::BufferFullCallback& cb) {
 }
 
 void TraceLog::Flush() {
-  std::vector<TraceEvent> previous_logged_events;
+  std::vector<EventChunk*> previous_chunks;
+  std::vector<TraceEvent> previous_events;
   OutputCallback output_callback_copy;
   {
     AutoLock lock(lock_);
-    previous_logged_events.swap(logged_events_);
+    if (streaming_thread_) {
+      streaming_thread_->RequestFlush(output_callback_);
+      return;
+    }
+    TakeEventsToFlush(true, &previous_chunks, &previous_events);
     output_callback_copy = output_callback_;
   }  // release lock
 
-  if (output_callback_copy.is_null())
-    return;
+  if (!output_callback_copy.is_null()) {
+    std::vector<const TraceEvent*> events;
+    GetEventsToFlush(previous_chunks, previous_events, &events);
+    for (size_t i = 0; i < events.size(); i += kTraceEventBatchSize) {
+      scoped_refptr<RefCountedString> json_events_str_ptr =
+          new RefCountedString();
+      std::string* out = &json_events_str_ptr->data();
+      for (size_t j = i; j < i + kTraceEventBatchSize && j < events.size();
+           ++j) {
+        if (j > i)
+          *out += ",";
+        events[j]->AppendAsJSON(out);
+      }
+      output_callback_copy.Run(json_events_str_ptr);
+    }
+  }
+
+  STLDeleteElements(&previous_chunks);
+}
 
-  for (size_t i = 0;
-       i < previous_logged_events.size();
-       i += kTraceEventBatchSize) {
-    scoped_refptr<RefCountedString> json_events_str_ptr =
-        new RefCountedString();
-    TraceEvent::AppendEventsAsJSON(previous_logged_events,
-                                   i,
-                                   kTraceEventBatchSize,
-                                   &(json_events_str_ptr->data()));
-    output_callback_copy.Run(json_events_str_ptr);
+bool TraceLog::StartStreaming(PlatformFile file) {
+  AutoLock lock(lock_);
+  if (streaming_thread_)
+    return false;
+
+  scoped_ptr<StreamingThread> thread(
+      new StreamingThread(this, file, process_id_));
+  if (!PlatformThread::Create(0, thread.get(), &streaming_thread_handle_))
+    return false;
+  streaming_thread_ = thread.release();
+  return true;
+}
+
+void TraceLog::StopStreaming() {
+  StreamingThread* thread;
+  {
+    AutoLock lock(lock_);
+    if (!streaming_thread_)
+      return;
+    thread = streaming_thread_;
+    streaming_thread_ = NULL;
+  }  // release lock
+
+  thread->Stop();
+  PlatformThread::Join(streaming_thread_handle_);
+  delete thread;
+}
+
+void TraceLog::TakeEventsToFlush(bool include_current_chunks,
+                                 std::vector<EventChunk*>* chunks,
+                                 std::vector<TraceEvent>* events) {
+  lock_.AssertAcquired();
+
+  chunks->swap(logged_chunks_);
+  num_chunks_ -= chunks->size();
+  if (include_current_chunks) {
+    // The chunks still being recorded into stay with their threads; copy out
+    // what has been published so far.
+    for (size_t i = 0; i < thread_buffers_.size(); ++i) {
+      ThreadLocalEventBuffer* buffer = thread_buffers_[i];
+      EventChunk* chunk = buffer->chunk;
+      if (!chunk) {
+        buffer->flushed_event_id = buffer->retired_event_id;
+        continue;
+      }
+      size_t size = subtle::Acquire_Load(&chunk->size);
+      events->insert(events->end(),
+                     chunk->events + chunk->flushed,
+                     chunk->events + size);
+      chunk->flushed = size;
+      buffer->flushed_event_id = chunk->first_event_id + size;
+    }
+    events->insert(events->end(),
+                   metadata_events_.begin(), metadata_events_.end());
+    metadata_events_.clear();
   }
+  subtle::NoBarrier_Store(&buffer_full_, 0);
+}
+
+// static
+void TraceLog::GetEventsToFlush(const std::vector<EventChunk*>& chunks,
+                                const std::vector<TraceEvent>& events,
+                                std::vector<const TraceEvent*>* events_out) {
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    EventChunk* chunk = chunks[i];
+    for (size_t j = chunk->flushed;
+         j < static_cast<size_t>(chunk->size); ++j) {
+      events_out->push_back(&chunk->events[j]);
+    }
+  }
+  for (size_t i = 0; i < events.size(); ++i)
+    events_out->push_back(&events[i]);
 }
 
 int TraceLog::AddTraceEvent(char phase,
@@ -585,82 +839,230 @@ int TraceLog::AddTraceEvent(char phase,
                             long long threshold,
                             unsigned char flags) {
   DCHECK(name);
+  if (!*category_enabled)
+    return -1;
+  // Drop the event without touching the lock if there is no room for it.
+  if (subtle::NoBarrier_Load(&buffer_full_))
+    return -1;
+
   TimeTicks now = TimeTicks::NowFromSystemTraceTime();
-  BufferFullCallback buffer_full_callback_copy;
-  int ret_begin_id = -1;
-  {
+  int thread_id = static_cast<int>(PlatformThread::CurrentId());
+  UpdateThreadName(thread_id);
+
+  ThreadLocalEventBuffer* buffer = GetThreadLocalEventBuffer();
+  if (threshold_begin_id > -1) {
+    DCHECK(phase == TRACE_EVENT_PHASE_END);
     AutoLock lock(lock_);
-    if (!*category_enabled)
+    // Return now if there has been a flush since the begin event was posted.
+    if (threshold_begin_id < buffer->flushed_event_id)
       return -1;
-    if (logged_events_.size() >= kTraceEventBufferSize)
+    // Determine whether to drop the begin/end pair.
+    if (RemoveBeginEventBelowThreshold(buffer, threshold_begin_id, now,
+                                       threshold)) {
       return -1;
+    }
+  }
 
-    int thread_id = static_cast<int>(PlatformThread::CurrentId());
-
-    const char* new_name = PlatformThread::GetName();
-    // Check if the thread name has been set or changed since the previous
-    // call (if any), but don't bother if the new name is empty. Note this will
-    // not detect a thread name change within the same char* buffer address: we
-    // favor common case performance over corner case correctness.
-    if (new_name != g_current_thread_name.Get().Get() &&
-        new_name && *new_name) {
-      g_current_thread_name.Get().Set(new_name);
-      base::hash_map<int, std::string>::iterator existing_name =
-          thread_names_.find(thread_id);
-      if (existing_name == thread_names_.end()) {
-        // This is a new thread id, and a new name.
-        thread_names_[thread_id] = new_name;
-      } else {
-        // This is a thread id that we've seen before, but potentially with a
-        // new name.
-        std::vector<base::StringPiece> existing_names;
-        Tokenize(existing_name->second, ",", &existing_names);
-        bool found = std::find(existing_names.begin(),
-                               existing_names.end(),
-                               new_name) != existing_names.end();
-        if (!found) {
-          existing_name->second.push_back(',');
-          existing_name->second.append(new_name);
-        }
-      }
+  if (flags & TRACE_EVENT_FLAG_MANGLE_ID)
+    id ^= process_id_hash_;
+
+  EventChunk* chunk = buffer->chunk;
+  if (!chunk ||
+      static_cast<size_t>(chunk->size) == kTraceEventChunkSize) {
+    BufferFullCallback buffer_full_callback_copy;
+    {
+      AutoLock lock(lock_);
+      chunk = SwapChunk(buffer, &buffer_full_callback_copy);
+    }  // release lock
+
+    if (!chunk) {
+      if (!buffer_full_callback_copy.is_null())
+        buffer_full_callback_copy.Run();
+      return -1;
     }
+  }
+
+  // Only this thread writes to |chunk|, so the event can be filled in
+  // without the lock and then published to Flush().
+  subtle::Atomic32 index = chunk->size;
+  chunk->events[index] = TraceEvent(thread_id,
+                                    now, phase, category_enabled, name, id,
+                                    num_args, arg_names, arg_types, arg_values,
+                                    flags);
+  subtle::Release_Store(&chunk->size, index + 1);
+  return buffer->next_event_id++;
+}
 
-    if (threshold_begin_id > -1) {
-      DCHECK(phase == TRACE_EVENT_PHASE_END);
-      size_t begin_i = static_cast<size_t>(threshold_begin_id);
-      // Return now if there has been a flush since the begin event was posted.
-      if (begin_i >= logged_events_.size())
-        return -1;
-      // Determine whether to drop the begin/end pair.
-      TimeDelta elapsed = now - logged_events_[begin_i].timestamp();
-      if (elapsed < TimeDelta::FromMicroseconds(threshold)) {
-        // Remove begin event and do not add end event.
-        // This will be expensive if there have been other events in the
-        // mean time (should be rare).
-        logged_events_.erase(logged_events_.begin() + begin_i);
-        return -1;
+void TraceLog::UpdateThreadName(int thread_id) {
+  const char* new_name = PlatformThread::GetName();
+  // Check if the thread name has been set or changed since the previous
+  // call (if any), but don't bother if the new name is empty. Note this will
+  // not detect a thread name change within the same char* buffer address: we
+  // favor common case performance over corner case correctness.
+  if (new_name == g_current_thread_name.Get().Get() || !new_name ||
+      !*new_name) {
+    return;
+  }
+
+  g_current_thread_name.Get().Set(new_name);
+  AutoLock lock(lock_);
+  base::hash_map<int, std::string>::iterator existing_name =
+      thread_names_.find(thread_id);
+  if (existing_name == thread_names_.end()) {
+    // This is a new thread id, and a new name.
+    thread_names_[thread_id] = new_name;
+  } else {
+    // This is a thread id that we've seen before, but potentially with a
+    // new name.
+    std::vector<base::StringPiece> existing_names;
+    Tokenize(existing_name->second, ",", &existing_names);
+    bool found = std::find(existing_names.begin(),
+                           existing_names.end(),
+                           new_name) != existing_names.end();
+    if (!found) {
+      existing_name->second.push_back(',');
+      existing_name->second.append(new_name);
+    }
+  }
+}
+
+TraceLog::ThreadLocalEventBuffer* TraceLog::GetThreadLocalEventBuffer() {
+  ThreadLocalEventBuffer* buffer = static_cast<ThreadLocalEventBuffer*>(
+      thread_local_event_buffer_.Get());
+  if (!buffer) {
+    buffer = new ThreadLocalEventBuffer(this);
+    thread_local_event_buffer_.Set(buffer);
+    AutoLock lock(lock_);
+    thread_buffers_.push_back(buffer);
+  }
+  return buffer;
+}
+
+TraceLog::EventChunk* TraceLog::SwapChunk(
+    ThreadLocalEventBuffer* buffer,
+    BufferFullCallback* buffer_full_callback) {
+  lock_.AssertAcquired();
+
+  if (buffer->chunk) {
+    EventChunk* chunk = buffer->chunk;
+    buffer->chunk = NULL;
+    buffer->retired_event_id = chunk->first_event_id + chunk->size;
+    if (chunk->flushed < static_cast<size_t>(chunk->size)) {
+      logged_chunks_.push_back(chunk);
+      if (streaming_thread_ &&
+          logged_chunks_.size() >= kTraceStreamingChunkThreshold) {
+        streaming_thread_->WakeUp();
       }
+    } else {
+      delete chunk;
+      num_chunks_--;
     }
+  }
 
-    if (flags & TRACE_EVENT_FLAG_MANGLE_ID)
-      id ^= process_id_hash_;
+  if (num_chunks_ * kTraceEventChunkSize >= kTraceEventBufferSize) {
+    if (!subtle::NoBarrier_Load(&buffer_full_)) {
+      subtle::NoBarrier_Store(&buffer_full_, 1);
+      *buffer_full_callback = buffer_full_callback_;
+    }
+    return NULL;
+  }
+
+  buffer->chunk = new EventChunk(buffer, buffer->next_event_id);
+  num_chunks_++;
+  return buffer->chunk;
+}
 
-    ret_begin_id = static_cast<int>(logged_events_.size());
-    logged_events_.push_back(
-        TraceEvent(thread_id,
-                   now, phase, category_enabled, name, id,
-                   num_args, arg_names, arg_types, arg_values,
-                   flags));
+bool TraceLog::RemoveBeginEventBelowThreshold(ThreadLocalEventBuffer* buffer,
+                                              int begin_id,
+                                              TimeTicks now,
+                                              long long threshold) {
+  lock_.AssertAcquired();
 
-    if (logged_events_.size() == kTraceEventBufferSize) {
-      buffer_full_callback_copy = buffer_full_callback_;
+  // If the begin event was handed over with a full chunk it is kept, and the
+  // end event is recorded to match it.
+  EventChunk* chunk = buffer->chunk;
+  if (!chunk || begin_id < chunk->first_event_id)
+    return false;
+
+  size_t begin_i = static_cast<size_t>(begin_id - chunk->first_event_id);
+  size_t size = static_cast<size_t>(chunk->size);
+  DCHECK_LT(begin_i, size);
+  DCHECK_GE(begin_i, chunk->flushed);
+  TimeDelta elapsed = now - chunk->events[begin_i].timestamp();
+  if (elapsed >= TimeDelta::FromMicroseconds(threshold))
+    return false;
+
+  // Remove begin event and do not add end event.  This will be expensive if
+  // there have been other events in the mean time (should be rare).  Flush()
+  // only reads the chunk under the lock, so the events can be moved.
+  std::copy(chunk->events + begin_i + 1, chunk->events + size,
+            chunk->events + begin_i);
+  chunk->events[size - 1] = TraceEvent();
+  subtle::Release_Store(&chunk->size, static_cast<subtle::Atomic32>(size - 1));
+  buffer->next_event_id--;
+  return true;
+}
+
+void TraceLog::ThreadExiting(ThreadLocalEventBuffer* buffer) {
+  AutoLock lock(lock_);
+  EventChunk* chunk = buffer->chunk;
+  if (chunk) {
+    chunk->owner = NULL;
+    if (chunk->flushed < static_cast<size_t>(chunk->size)) {
+      logged_chunks_.push_back(chunk);
+    } else {
+      delete chunk;
+      num_chunks_--;
     }
-  }  // release lock
+  }
+  for (size_t i = 0; i < logged_chunks_.size(); ++i) {
+    if (logged_chunks_[i]->owner == buffer)
+      logged_chunks_[i]->owner = NULL;
+  }
+  thread_buffers_.erase(std::find(thread_buffers_.begin(),
+                                  thread_buffers_.end(),
+                                  buffer));
+  delete buffer;
+}
 
-  if (!buffer_full_callback_copy.is_null())
-    buffer_full_callback_copy.Run();
+// static
+void TraceLog::OnThreadExit(void* buffer) {
+  ThreadLocalEventBuffer* thread_buffer =
+      static_cast<ThreadLocalEventBuffer*>(buffer);
+  thread_buffer->trace_log->ThreadExiting(thread_buffer);
+}
 
-  return ret_begin_id;
+size_t TraceLog::GetEventsSize() {
+  ThreadLocalEventBuffer* buffer = GetThreadLocalEventBuffer();
+  AutoLock lock(lock_);
+  size_t num_events = 0;
+  for (size_t i = 0; i < logged_chunks_.size(); ++i) {
+    if (logged_chunks_[i]->owner == buffer)
+      num_events += logged_chunks_[i]->size - logged_chunks_[i]->flushed;
+  }
+  if (buffer->chunk)
+    num_events += buffer->chunk->size - buffer->chunk->flushed;
+  return num_events;
+}
+
+const TraceEvent& TraceLog::GetEventAt(size_t index) {
+  ThreadLocalEventBuffer* buffer = GetThreadLocalEventBuffer();
+  AutoLock lock(lock_);
+  std::vector<EventChunk*> chunks;
+  for (size_t i = 0; i < logged_chunks_.size(); ++i) {
+    if (logged_chunks_[i]->owner == buffer)
+      chunks.push_back(logged_chunks_[i]);
+  }
+  if (buffer->chunk)
+    chunks.push_back(buffer->chunk);
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    size_t num_events = chunks[i]->size - chunks[i]->flushed;
+    if (index < num_events)
+      return chunks[i]->events[chunks[i]->flushed + index];
+    index -= num_events;
+  }
+  NOTREACHED();
+  return chunks.back()->events[0];
 }
 
 void TraceLog::AddTraceEventEtw(char phase,
@@ -736,7 +1138,7 @@ void TraceLog::AddThreadNameMetadataEvents() {
       unsigned char arg_type;
       unsigned long long arg_value;
       trace_event_internal::SetTraceValue(it->second, &arg_type, &arg_value);
-      logged_events_.push_back(
+      metadata_events_.push_back(
           TraceEvent(it->first,
                      TimeTicks(), TRACE_EVENT_PHASE_METADATA,
                      &g_category_enabled[g_category_metadata],
@@ -12,12 +12,16 @@
 #include <string>
 #include <vector>
 
+#include "base/atomicops.h"
 #include "base/callback.h"
 #include "base/hash_tables.h"
 #include "base/memory/ref_counted_memory.h"
 #include "base/observer_list.h"
+#include "base/platform_file.h"
 #include "base/string_util.h"
 #include "base/synchronization/lock.h"
+#include "base/threading/platform_thread.h"
+#include "base/threading/thread_local_storage.h"
 #include "base/timer.h"
 
 // Older style trace macros with explicit id and extra data
@@ -82,7 +86,21 @@ class BASE_EXPORT TraceEvent {
                                  std::string* out);
   void AppendAsJSON(std::string* out) const;
 
+  // Appends |value| of the given TRACE_VALUE_TYPE_XXX |type| as JSON.
+  static void AppendValueAsJSON(unsigned char type,
+                                TraceValue value,
+                                std::string* out);
+
   TimeTicks timestamp() const { return timestamp_; }
+  int thread_id() const { return thread_id_; }
+  char phase() const { return phase_; }
+  unsigned char flags() const { return flags_; }
+  unsigned long long id() const { return id_; }
+  const unsigned char* category_enabled() const { return category_enabled_; }
+  // Arguments after the first NULL name are unused.
+  const char* arg_name(int index) const { return arg_names_[index]; }
+  unsigned char arg_type(int index) const { return arg_types_[index]; }
+  TraceValue arg_value(int index) const { return arg_values_[index]; }
 
   // Exposed for unittesting:
 
@@ -229,15 +247,30 @@ class BASE_EXPORT TraceLog {
   typedef base::Callback<void(void)> BufferFullCallback;
   void SetBufferFullCallback(const BufferFullCallback& cb);
 
-  // Flushes all logged data to the callback.
+  // Flushes all logged data to the callback.  While streaming, the data goes
+  // to the file instead, and the callback runs once with an empty string, on
+  // the streaming thread, after everything logged before the call has been
+  // written.
   void Flush();
 
+  // Starts writing logged data to |file| in the binary format described in
+  // trace_event_binary.h instead of handing it to the output callback. Full
+  // chunks of events are written from a background thread while recording
+  // continues, so long traces don't have to fit in the trace buffer. See
+  // Flush() for how to wait for the events logged so far to be written.
+  // Returns false if already streaming.
+  bool StartStreaming(PlatformFile file);
+
+  // Writes everything logged so far and stops streaming. Blocks until the
+  // background thread is done with |file|, which the caller still owns.
+  void StopStreaming();
+
   // Called by TRACE_EVENT* macros, don't call this directly.
   static const unsigned char* GetCategoryEnabled(const char* name);
   static const char* GetCategoryName(const unsigned char* category_enabled);
 
   // Called by TRACE_EVENT* macros, don't call this directly.
-  // Returns the index in the internal vector of the event if it was added, or
+  // Returns the per-thread sequence number of the event if it was added, or
   //         -1 if the event was not added.
   // On end events, the return value of the begin event can be specified along
   // with a threshold in microseconds. If the elapsed time between begin and end
@@ -274,12 +307,10 @@ class BASE_EXPORT TraceLog {
   // Allows resurrecting our singleton instance post-AtExit processing.
   static void Resurrect();
 
-  // Allow tests to inspect TraceEvents.
-  size_t GetEventsSize() const { return logged_events_.size(); }
-  const TraceEvent& GetEventAt(size_t index) const {
-    DCHECK(index < logged_events_.size());
-    return logged_events_[index];
-  }
+  // Allow tests to inspect the TraceEvents recorded on the current thread
+  // since the last flush.
+  size_t GetEventsSize();
+  const TraceEvent& GetEventAt(size_t index);
 
   void SetProcessID(int process_id);
 
@@ -288,19 +319,77 @@ class BASE_EXPORT TraceLog {
   // by the Singleton class.
   friend struct StaticMemorySingletonTraits<TraceLog>;
 
+  // A fixed-size block of events recorded by one thread.
+  struct EventChunk;
+  // The events recorded by one thread.  Only that thread adds events, so
+  // recording doesn't need |lock_| except when a chunk fills up.
+  struct ThreadLocalEventBuffer;
+  // Writes logged events to a file while streaming.
+  class StreamingThread;
+
   TraceLog();
   ~TraceLog();
   const unsigned char* GetCategoryEnabledInternal(const char* name);
   void AddThreadNameMetadataEvents();
   void AddClockSyncMetadataEvents();
 
-  // TODO(nduca): switch to per-thread trace buffers to reduce thread
-  // synchronization.
+  // Records the name of the current thread if it changed since the last event.
+  void UpdateThreadName(int thread_id);
+
+  // Returns the event buffer of the current thread, creating it if needed.
+  ThreadLocalEventBuffer* GetThreadLocalEventBuffer();
+
+  // Hands the full (or missing) chunk of |buffer| over to |logged_chunks_|
+  // and gives |buffer| a new one. Returns NULL if the trace buffer is full, in
+  // which case |buffer_full_callback| is set the first time this happens.
+  EventChunk* SwapChunk(ThreadLocalEventBuffer* buffer,
+                        BufferFullCallback* buffer_full_callback);
+
+  // If the begin event with sequence number |begin_id| is still in the
+  // current chunk of |buffer| and started less than |threshold| microseconds
+  // before |now|, removes it and returns true.  Must be called under lock.
+  bool RemoveBeginEventBelowThreshold(ThreadLocalEventBuffer* buffer,
+                                      int begin_id,
+                                      TimeTicks now,
+                                      long long threshold);
+
+  // Takes the chunks in |logged_chunks_| and, if |include_current_chunks| is
+  // set, copies of the events published in the current chunk of each thread
+  // and the metadata events.  Must be called under lock.
+  void TakeEventsToFlush(bool include_current_chunks,
+                         std::vector<EventChunk*>* chunks,
+                         std::vector<TraceEvent>* events);
+  // Lists the events taken by TakeEventsToFlush() in the order to output
+  // them.
+  static void GetEventsToFlush(const std::vector<EventChunk*>& chunks,
+                               const std::vector<TraceEvent>& events,
+                               std::vector<const TraceEvent*>* events_out);
+
+  // Retires the buffer of a thread that is exiting.
+  void ThreadExiting(ThreadLocalEventBuffer* buffer);
+  static void OnThreadExit(void* buffer);
+
+  // Protects everything below except for the events in the current chunk of
+  // each thread, which are published with atomic stores (see EventChunk).
   Lock lock_;
   bool enabled_;
   OutputCallback output_callback_;
   BufferFullCallback buffer_full_callback_;
-  std::vector<TraceEvent> logged_events_;
+  // Chunks that filled up or whose thread exited, waiting for Flush().
+  std::vector<EventChunk*> logged_chunks_;
+  // Events that don't belong to any thread, such as thread names.
+  std::vector<TraceEvent> metadata_events_;
+  // The buffers of all threads that recorded events.
+  std::vector<ThreadLocalEventBuffer*> thread_buffers_;
+  // Number of chunks in |logged_chunks_| or in use by |thread_buffers_|.
+  size_t num_chunks_;
+  // Set when no more chunks can be allocated, until the next Flush().  Read
+  // without |lock_| to drop events cheaply when the buffer is full.
+  volatile subtle::Atomic32 buffer_full_;
+  ThreadLocalStorage::Slot thread_local_event_buffer_;
+  // Set while streaming.
+  StreamingThread* streaming_thread_;
+  PlatformThreadHandle streaming_thread_handle_;
   std::vector<std::string> included_categories_;
   std::vector<std::string> excluded_categories_;
   bool dispatching_to_observer_list_;
@@ -0,0 +1,65 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/debug/trace_event.h"
+
+#include "base/perftimer.h"
+#include "base/stringprintf.h"
+#include "base/threading/simple_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace debug {
+
+namespace {
+
+// Stays below the TraceLog buffer size with 8 threads, so that no event is
+// dropped.
+const int kEventsPerThread = 50000;
+
+class TraceEventRecorder : public DelegateSimpleThread::Delegate {
+ public:
+  TraceEventRecorder() {}
+
+  virtual void Run() OVERRIDE {
+    for (int i = 0; i < kEventsPerThread; ++i)
+      TRACE_EVENT_INSTANT1("perf", "TraceEventPerfTest", "i", i);
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(TraceEventRecorder);
+};
+
+// Records |kEventsPerThread| events on each of |num_threads| threads at once
+// and logs the average time each thread spent per event.
+void RecordEvents(int num_threads) {
+  TraceLog* trace_log = TraceLog::GetInstance();
+  trace_log->SetEnabled("perf");
+
+  TraceEventRecorder recorder;
+  DelegateSimpleThreadPool threads("recorder", num_threads);
+  threads.AddWork(&recorder, num_threads);
+
+  PerfTimer timer;
+  threads.Start();
+  threads.JoinAll();
+  double nanoseconds = timer.Elapsed().InMicroseconds() * 1000.0;
+
+  trace_log->SetDisabled();
+  LogPerfResult(StringPrintf("TraceEvent_%d_threads", num_threads).c_str(),
+                nanoseconds / kEventsPerThread, "ns/event");
+}
+
+}  // namespace
+
+TEST(TraceEventPerfTest, OneThread) {
+  RecordEvents(1);
+}
+
+TEST(TraceEventPerfTest, EightThreads) {
+  RecordEvents(8);
+}
+
+}  // namespace debug
+}  // namespace base
@@ -1108,6 +1108,36 @@ TEST_F(TraceEventTestFixture, DataCapturedManyThreads) {
                                            num_threads, num_events);
 }
 
+// Test that events recorded into a partly flushed per-thread buffer are
+// reported exactly once.
+TEST_F(TraceEventTestFixture, DataCapturedAcrossFlushes) {
+  ManualTestSetUp();
+  TraceLog::GetInstance()->SetEnabled(true);
+
+  const int num_events = 1000;
+  for (int i = 0; i < num_events; i++) {
+    TRACE_EVENT_INSTANT2("all", "multi thread event",
+                         "thread", 0,
+                         "event", i);
+    if (i % 10 == 0)
+      TraceLog::GetInstance()->Flush();
+  }
+
+  TraceLog::GetInstance()->SetEnabled(false);
+
+  ValidateInstantEventPresentOnEveryThread(trace_parsed_, 1, num_events);
+  size_t num_multi_thread_events = 0;
+  for (size_t i = 0; i < trace_parsed_.GetSize(); i++) {
+    DictionaryValue* dict = NULL;
+    std::string name;
+    if (trace_parsed_.GetDictionary(i, &dict) &&
+        dict->GetString("name", &name) && name == "multi thread event") {
+      num_multi_thread_events++;
+    }
+  }
+  EXPECT_EQ(static_cast<size_t>(num_events), num_multi_thread_events);
+}
+
 // Test that thread and process names show up in the trace
 TEST_F(TraceEventTestFixture, ThreadNames) {
   ManualTestSetUp();
@@ -141,6 +141,29 @@ BASE_EXPORT bool CopyDirectory(const FilePath& from_path,
                                const FilePath& to_path,
                                bool recursive);
 
+#if defined(OS_POSIX)
+// These walk the tree under the given path on |num_threads| threads, which
+// read different directories at the same time, for trees with too many files
+// for the functions above.  Entries are only stat()ed when the operation
+// needs more than the type that readdir() reports.  They block until done,
+// and stop at the first failure, which may leave part of the work done.
+
+// Like Delete(path, true).  Symbolic links are deleted, not followed.
+BASE_EXPORT bool DeleteInParallel(const FilePath& path, int num_threads);
+
+// Like CopyDirectory(from_path, to_path, true).
+BASE_EXPORT bool CopyDirectoryInParallel(const FilePath& from_path,
+                                         const FilePath& to_path,
+                                         int num_threads);
+
+// Like CountFilesCreatedAfter(), but also counts the files in all the
+// subdirectories of |path|.
+BASE_EXPORT int CountFilesCreatedAfterInParallel(
+    const FilePath& path,
+    const base::Time& file_time,
+    int num_threads);
+#endif  // defined(OS_POSIX)
+
 // Returns true if the given path exists on the local filesystem,
 // false otherwise.
 BASE_EXPORT bool PathExists(const FilePath& path);
@@ -534,12 +557,20 @@ class BASE_EXPORT FileEnumerator {
   struct DirectoryEntryInfo {
     FilePath filename;
     struct stat stat;
+    // False when readdir() gave the type of the entry and |stat| only has
+    // that in st_mode.  GetFindInfo() fills in the rest.
+    bool has_stat;
   };
 
   // Read the filenames in source into the vector of DirectoryEntryInfo's
   static bool ReadDirectory(std::vector<DirectoryEntryInfo>* entries,
                             const FilePath& source, bool show_links);
 
+  // Stats |path| into |stat|, following symbolic links unless |show_links|.
+  // Returns false, with |stat| zeroed, if |path| can't be stat()ed.
+  static bool StatEntry(const FilePath& path, bool show_links,
+                        struct stat* stat);
+
   // The files in the current directory
   std::vector<DirectoryEntryInfo> directory_entries_;
 
@@ -0,0 +1,482 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// The parallel tree walks of file_util.h.  Each walk has a pool of threads
+// that take directories from a shared stack, read them, and push the
+// subdirectories they find, so that independent parts of the tree are read at
+// the same time.  What is done with each entry is up to a WalkVisitor.
+
+#include "base/file_util.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "base/atomicops.h"
+#include "base/basictypes.h"
+#include "base/compiler_specific.h"
+#include "base/eintr_wrapper.h"
+#include "base/file_path.h"
+#include "base/logging.h"
+#include "base/synchronization/condition_variable.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/simple_thread.h"
+#include "base/threading/thread_restrictions.h"
+#include "base/time.h"
+
+namespace file_util {
+
+namespace {
+
+#if defined(OS_LINUX)
+typedef struct stat64 stat_wrapper_t;
+#else
+typedef struct stat stat_wrapper_t;
+#endif
+
+// Stats entry |name| of |dir_path|, open as |dir_fd|, following symbolic
+// links if |follow_links|.  The *at() calls save the kernel a lookup of
+// |dir_path| for every entry; Mac OS X doesn't have them.
+int StatAt(int dir_fd,
+           const FilePath& dir_path,
+           const char* name,
+           bool follow_links,
+           stat_wrapper_t* sb) {
+#if defined(OS_MACOSX)
+  std::string path = dir_path.Append(name).value();
+  return follow_links ? stat(path.c_str(), sb) : lstat(path.c_str(), sb);
+#elif defined(OS_LINUX)
+  return fstatat64(dir_fd, name, sb, follow_links ? 0 : AT_SYMLINK_NOFOLLOW);
+#else
+  return fstatat(dir_fd, name, sb, follow_links ? 0 : AT_SYMLINK_NOFOLLOW);
+#endif
+}
+
+int UnlinkAt(int dir_fd, const FilePath& dir_path, const char* name) {
+#if defined(OS_MACOSX)
+  return unlink(dir_path.Append(name).value().c_str());
+#else
+  return unlinkat(dir_fd, name, 0);
+#endif
+}
+
+// Returns the d_type of entry |name| of |dir_path| when readdir() reported
+// |type|, which may be DT_UNKNOWN.  Returns DT_UNKNOWN if that can't be
+// found out.
+unsigned char ResolveType(int dir_fd,
+                          const FilePath& dir_path,
+                          const char* name,
+                          unsigned char type) {
+  if (type != DT_UNKNOWN)
+    return type;
+  stat_wrapper_t sb;
+  if (StatAt(dir_fd, dir_path, name, false, &sb) != 0)
+    return DT_UNKNOWN;
+  return IFTODT(sb.st_mode);
+}
+
+// A directory of a walk.  The walk leaves it once it has been read and all
+// its subdirectories have been left, and leaves its parent after that.
+struct WalkDirectory {
+  WalkDirectory(WalkDirectory* parent, const FilePath& path)
+      : parent(parent),
+        path(path),
+        pending(1) {
+  }
+
+  WalkDirectory* parent;
+  FilePath path;
+
+  // One while the directory is being read, plus one for each subdirectory
+  // that has not been left.
+  base::subtle::Atomic32 pending;
+};
+
+// What a walk does with what it finds.  The methods are called on the threads
+// of the walk, several at a time.
+class WalkVisitor {
+ public:
+  virtual ~WalkVisitor() {}
+
+  // Handles entry |name| of |dir|, which is open as |dir_fd|.  |type| is the
+  // d_type of the entry, DT_UNKNOWN if the file system doesn't report it.
+  // Sets |descend| to have the walk read the entry, which must then be a
+  // directory.  Returns false to stop the walk.
+  virtual bool VisitEntry(const WalkDirectory& dir,
+                          int dir_fd,
+                          const char* name,
+                          unsigned char type,
+                          bool* descend) = 0;
+
+  // Called when |dir| and everything under it have been visited.  Returns
+  // false to stop the walk.
+  virtual bool LeaveDirectory(const WalkDirectory& dir) {
+    return true;
+  }
+
+  // Called when |dir| can't be read.  Returns false to stop the walk.
+  virtual bool OnReadError(const WalkDirectory& dir) {
+    return false;
+  }
+};
+
+class ParallelTreeWalk : public base::DelegateSimpleThread::Delegate {
+ public:
+  explicit ParallelTreeWalk(WalkVisitor* visitor)
+      : visitor_(visitor),
+        pending_cv_(&lock_),
+        outstanding_(0),
+        failed_(0) {
+  }
+
+  // Walks the tree under the directory |root| on |num_threads| threads.
+  // Returns false if the walk was stopped.
+  bool Walk(const FilePath& root, int num_threads) {
+    DCHECK_GT(num_threads, 0);
+    pending_.push_back(new WalkDirectory(NULL, root));
+    outstanding_ = 1;
+
+    base::DelegateSimpleThreadPool pool("ParallelTreeWalk", num_threads);
+    pool.AddWork(this, num_threads);
+    pool.Start();
+    pool.JoinAll();
+    DCHECK(pending_.empty());
+    return !failed();
+  }
+
+  // base::DelegateSimpleThread::Delegate methods:
+  virtual void Run() OVERRIDE {
+    std::vector<WalkDirectory*> subdirectories;
+    for (;;) {
+      WalkDirectory* dir;
+      {
+        base::AutoLock lock(lock_);
+        while (pending_.empty() && outstanding_ > 0)
+          pending_cv_.Wait();
+        if (pending_.empty())
+          return;
+        dir = pending_.back();
+        pending_.pop_back();
+      }
+
+      subdirectories.clear();
+      if (!failed() && !ReadDirectory(dir, &subdirectories) &&
+          !visitor_->OnReadError(*dir)) {
+        Fail();
+      }
+      if (failed()) {
+        for (size_t i = 0; i < subdirectories.size(); ++i)
+          Leave(subdirectories[i]);
+        subdirectories.clear();
+      }
+      Leave(dir);
+
+      base::AutoLock lock(lock_);
+      pending_.insert(pending_.end(), subdirectories.begin(),
+                      subdirectories.end());
+      outstanding_ += static_cast<int>(subdirectories.size()) - 1;
+      if (outstanding_ == 0 || subdirectories.size() > 1)
+        pending_cv_.Broadcast();
+      else if (subdirectories.size() == 1)
+        pending_cv_.Signal();
+    }
+  }
+
+ private:
+  bool failed() const {
+    return base::subtle::Acquire_Load(&failed_) != 0;
+  }
+
+  void Fail() {
+    base::subtle::Release_Store(&failed_, 1);
+  }
+
+  // Visits the entries of |dir| and adds the subdirectories to walk to
+  // |subdirectories|.  Returns false if |dir| can't be read.
+  bool ReadDirectory(WalkDirectory* dir,
+                     std::vector<WalkDirectory*>* subdirectories) {
+    // Only the root may be a symbolic link; the walk only descends into
+    // directories, and must not follow a link put in the place of one.
+    int flags = O_RDONLY | O_DIRECTORY;
+    if (dir->parent)
+      flags |= O_NOFOLLOW;
+    int fd = HANDLE_EINTR(open(dir->path.value().c_str(), flags));
+    if (fd < 0) {
+      DPLOG(ERROR) << "Couldn't open " << dir->path.value();
+      return false;
+    }
+    DIR* dir_stream = fdopendir(fd);
+    if (!dir_stream) {
+      DPLOG(ERROR) << "fdopendir";
+      ignore_result(HANDLE_EINTR(close(fd)));
+      return false;
+    }
+
+    // readdir() is safe here because |dir_stream| is only used by this call.
+    bool read_ok = true;
+    while (!failed()) {
+      errno = 0;
+      struct dirent* dent = readdir(dir_stream);
+      if (!dent) {
+        if (errno != 0) {
+          DPLOG(ERROR) << "Couldn't read " << dir->path.value();
+          read_ok = false;
+        }
+        break;
+      }
+      if (strcmp(dent->d_name, ".") == 0 || strcmp(dent->d_name, "..") == 0)
+        continue;
+      bool descend = false;
+      if (!visitor_->VisitEntry(*dir, fd, dent->d_name, dent->d_type,
+                                &descend)) {
+        Fail();
+        break;
+      }
+      if (descend) {
+        base::subtle::NoBarrier_AtomicIncrement(&dir->pending, 1);
+        subdirectories->push_back(
+            new WalkDirectory(dir, dir->path.Append(dent->d_name)));
+      }
+    }
+    closedir(dir_stream);
+    return read_ok;
+  }
+
+  // Drops the count of |dir| that its reader or one of its subdirectories
+  // held, and leaves it and its parents as they are done.
+  void Leave(WalkDirectory* dir) {
+    while (dir &&
+           base::subtle::Barrier_AtomicIncrement(&dir->pending, -1) == 0) {
+      if (!failed() && !visitor_->LeaveDirectory(*dir))
+        Fail();
+      WalkDirectory* parent = dir->parent;
+      delete dir;
+      dir = parent;
+    }
+  }
+
+  WalkVisitor* visitor_;
+
+  // Protects |pending_| and |outstanding_|.
+  base::Lock lock_;
+
+  // Signaled when directories are added to |pending_|, and when the walk is
+  // over.
+  base::ConditionVariable pending_cv_;
+
+  // Directories waiting to be read, used as a stack to keep the walk deep
+  // rather than wide.
+  std::vector<WalkDirectory*> pending_;
+
+  // Directories pending or being read.  The walk is over when it is 0.
+  int outstanding_;
+
+  base::subtle::Atomic32 failed_;
+
+  DISALLOW_COPY_AND_ASSIGN(ParallelTreeWalk);
+};
+
+// Deletes files as it finds them, and directories once they are empty.
+class DeleteVisitor : public WalkVisitor {
+ public:
+  DeleteVisitor() {}
+
+  virtual bool VisitEntry(const WalkDirectory& dir,
+                          int dir_fd,
+                          const char* name,
+                          unsigned char type,
+                          bool* descend) OVERRIDE {
+    type = ResolveType(dir_fd, dir.path, name, type);
+    if (type == DT_DIR) {
+      *descend = true;
+      return true;
+    }
+    return UnlinkAt(dir_fd, dir.path, name) == 0 || errno == ENOENT;
+  }
+
+  virtual bool LeaveDirectory(const WalkDirectory& dir) OVERRIDE {
+    return rmdir(dir.path.value().c_str()) == 0;
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(DeleteVisitor);
+};
+
+// Creates the directories of the tree under |to_root| before they are read,
+// and copies the regular files in them.
+class CopyVisitor : public WalkVisitor {
+ public:
+  CopyVisitor(const FilePath& from_root, const FilePath& to_root)
+      : from_root_(from_root),
+        to_root_(to_root) {
+  }
+
+  virtual bool VisitEntry(const WalkDirectory& dir,
+                          int dir_fd,
+                          const char* name,
+                          unsigned char type,
+                          bool* descend) OVERRIDE {
+    FilePath from_path = dir.path.Append(name);
+    FilePath to_path = to_root_;
+    if (!from_root_.AppendRelativePath(from_path, &to_path))
+      return false;
+
+    if (type == DT_DIR || type == DT_UNKNOWN) {
+      // Directories need their mode, and entries of unknown type their type.
+      stat_wrapper_t sb;
+      if (StatAt(dir_fd, dir.path, name, false, &sb) != 0) {
+        DPLOG(ERROR) << "Couldn't stat " << from_path.value();
+        return false;
+      }
+      if (S_ISDIR(sb.st_mode)) {
+        if (mkdir(to_path.value().c_str(), sb.st_mode & 01777) != 0 &&
+            errno != EEXIST) {
+          DPLOG(ERROR) << "Couldn't create directory " << to_path.value();
+          return false;
+        }
+        *descend = true;
+        return true;
+      }
+      type = IFTODT(sb.st_mode);
+    }
+
+    if (type == DT_REG) {
+      if (!CopyFile(from_path, to_path)) {
+        DLOG(ERROR) << "Couldn't create file " << to_path.value();
+        return false;
+      }
+      return true;
+    }
+    DLOG(WARNING) << "Skipping non-regular file " << from_path.value();
+    return true;
+  }
+
+ private:
+  const FilePath from_root_;
+  const FilePath to_root_;
+
+  DISALLOW_COPY_AND_ASSIGN(CopyVisitor);
+};
+
+// Counts the entries whose status changed on or after |comparison_time|,
+// like CountFilesCreatedAfter().
+class CountVisitor : public WalkVisitor {
+ public:
+  explicit CountVisitor(time_t comparison_time)
+      : comparison_time_(comparison_time),
+        count_(0) {
+  }
+
+  int count() const { return base::subtle::NoBarrier_Load(&count_); }
+
+  virtual bool VisitEntry(const WalkDirectory& dir,
+                          int dir_fd,
+                          const char* name,
+                          unsigned char type,
+                          bool* descend) OVERRIDE {
+    type = ResolveType(dir_fd, dir.path, name, type);
+    *descend = type == DT_DIR;
+
+    stat_wrapper_t sb;
+    if (StatAt(dir_fd, dir.path, name, true, &sb) != 0) {
+      DPLOG(ERROR) << "Couldn't stat " << dir.path.Append(name).value();
+      return true;
+    }
+    // See CountFilesCreatedAfter() about the lost precision.
+    if (static_cast<time_t>(sb.st_ctime) >= comparison_time_)
+      base::subtle::NoBarrier_AtomicIncrement(&count_, 1);
+    return true;
+  }
+
+  virtual bool OnReadError(const WalkDirectory& dir) OVERRIDE {
+    return true;
+  }
+
+ private:
+  const time_t comparison_time_;
+  base::subtle::Atomic32 count_;
+
+  DISALLOW_COPY_AND_ASSIGN(CountVisitor);
+};
+
+}  // namespace
+
+bool DeleteInParallel(const FilePath& path, int num_threads) {
+  base::ThreadRestrictions::AssertIOAllowed();
+  stat_wrapper_t sb;
+#if defined(OS_LINUX)
+  int result = lstat64(path.value().c_str(), &sb);
+#else
+  int result = lstat(path.value().c_str(), &sb);
+#endif
+  if (result != 0)
+    return errno == ENOENT || errno == ENOTDIR;
+  if (!S_ISDIR(sb.st_mode))
+    return unlink(path.value().c_str()) == 0;
+
+  DeleteVisitor visitor;
+  return ParallelTreeWalk(&visitor).Walk(path, num_threads);
+}
+
+bool CopyDirectoryInParallel(const FilePath& from_path,
+                             const FilePath& to_path,
+                             int num_threads) {
+  base::ThreadRestrictions::AssertIOAllowed();
+  DCHECK(to_path.value().find('*') == std::string::npos);
+  DCHECK(from_path.value().find('*') == std::string::npos);
+
+  // As in CopyDirectory(), the destination must not be within the source.
+  FilePath real_to_path = to_path;
+  if (!PathExists(real_to_path))
+    real_to_path = real_to_path.DirName();
+  if (!AbsolutePath(&real_to_path))
+    return false;
+  FilePath real_from_path = from_path;
+  if (!AbsolutePath(&real_from_path))
+    return false;
+  if (real_to_path.value().size() >= real_from_path.value().size() &&
+      real_to_path.value().compare(0, real_from_path.value().size(),
+                                   real_from_path.value()) == 0) {
+    return false;
+  }
+
+  // If the destination is a directory, the source goes in it.
+  FilePath to_root = to_path;
+  if (DirectoryExists(to_path))
+    to_root = to_path.Append(from_path.BaseName());
+
+  struct stat from_info;
+  if (stat(from_path.value().c_str(), &from_info) != 0) {
+    DPLOG(ERROR) << "Couldn't stat " << from_path.value();
+    return false;
+  }
+  if (!S_ISDIR(from_info.st_mode))
+    return S_ISREG(from_info.st_mode) && CopyFile(from_path, to_root);
+  if (mkdir(to_root.value().c_str(), from_info.st_mode & 01777) != 0 &&
+      errno != EEXIST) {
+    DPLOG(ERROR) << "Couldn't create directory " << to_root.value();
+    return false;
+  }
+
+  CopyVisitor visitor(from_path, to_root);
+  return ParallelTreeWalk(&visitor).Walk(from_path, num_threads);
+}
+
+int CountFilesCreatedAfterInParallel(const FilePath& path,
+                                     const base::Time& comparison_time,
+                                     int num_threads) {
+  base::ThreadRestrictions::AssertIOAllowed();
+  CountVisitor visitor(comparison_time.ToTimeT());
+  ParallelTreeWalk(&visitor).Walk(path, num_threads);
+  return visitor.count();
+}
+
+}  // namespace file_util
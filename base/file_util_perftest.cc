@@ -0,0 +1,112 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/file_util.h"
+
+#include <string>
+#include <vector>
+
+#include "base/file_path.h"
+#include "base/perftimer.h"
+#include "base/scoped_temp_dir.h"
+#include "base/stringprintf.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace {
+
+// 1 GB, in 16 directories of 16 files.
+const int kNumDirectories = 16;
+const int kFilesPerDirectory = 16;
+const int kFileSize = 4 << 20;
+const double kTreeSizeInMB =
+    kNumDirectories * kFilesPerDirectory * (kFileSize / 1048576.0);
+
+// Copies |from| to |to| through a buffer, the way CopyFile() used to.
+bool CopyFileWithBuffer(const FilePath& from, const FilePath& to) {
+  FILE* infile = file_util::OpenFile(from, "rb");
+  if (!infile)
+    return false;
+  FILE* outfile = file_util::OpenFile(to, "wb");
+  if (!outfile) {
+    file_util::CloseFile(infile);
+    return false;
+  }
+  std::vector<char> buffer(32768);
+  bool result = true;
+  size_t bytes_read;
+  while ((bytes_read = fread(&buffer[0], 1, buffer.size(), infile)) > 0) {
+    if (fwrite(&buffer[0], 1, bytes_read, outfile) != bytes_read) {
+      result = false;
+      break;
+    }
+  }
+  result &= !ferror(infile);
+  file_util::CloseFile(infile);
+  return file_util::CloseFile(outfile) && result;
+}
+
+class FileUtilPerfTest : public testing::Test {
+ protected:
+  virtual void SetUp() OVERRIDE {
+    ASSERT_TRUE(dir_.CreateUniqueTempDir());
+    source_ = dir_.path().AppendASCII("source");
+    // Every file is different, so that no layer can share their data.
+    std::string contents(kFileSize, 'x');
+    for (int i = 0; i < kNumDirectories; ++i) {
+      FilePath directory = source_.AppendASCII(base::StringPrintf("%d", i));
+      ASSERT_TRUE(file_util::CreateDirectory(directory));
+      for (int j = 0; j < kFilesPerDirectory; ++j) {
+        for (int k = 0; k < kFileSize; k += 4096)
+          contents[k] = static_cast<char>(i * kFilesPerDirectory + j);
+        ASSERT_EQ(kFileSize, file_util::WriteFile(
+            directory.AppendASCII(base::StringPrintf("%d", j)),
+            contents.data(), kFileSize));
+      }
+    }
+  }
+
+  FilePath DestinationPath(const char* name) {
+    return dir_.path().AppendASCII(name);
+  }
+
+  void LogThroughput(const char* name, base::TimeDelta elapsed) {
+    LogPerfResult(name, kTreeSizeInMB / elapsed.InSecondsF(), "MB/s");
+  }
+
+  ScopedTempDir dir_;
+  FilePath source_;
+};
+
+}  // namespace
+
+TEST_F(FileUtilPerfTest, CopyDirectory) {
+  // The baseline copies every file through a buffer in user space.
+  FilePath buffered = DestinationPath("buffered");
+  PerfTimer buffered_timer;
+  for (int i = 0; i < kNumDirectories; ++i) {
+    std::string name = base::StringPrintf("%d", i);
+    ASSERT_TRUE(file_util::CreateDirectory(buffered.AppendASCII(name)));
+    for (int j = 0; j < kFilesPerDirectory; ++j) {
+      std::string file = base::StringPrintf("%d", j);
+      ASSERT_TRUE(CopyFileWithBuffer(
+          source_.AppendASCII(name).AppendASCII(file),
+          buffered.AppendASCII(name).AppendASCII(file)));
+    }
+  }
+  LogThroughput("CopyDirectory_buffered", buffered_timer.Elapsed());
+  ASSERT_TRUE(file_util::Delete(buffered, true));
+
+  FilePath copy = DestinationPath("copy");
+  PerfTimer copy_timer;
+  ASSERT_TRUE(file_util::CopyDirectory(source_, copy, true));
+  LogThroughput("CopyDirectory", copy_timer.Elapsed());
+  ASSERT_TRUE(file_util::Delete(copy, true));
+
+#if defined(OS_POSIX)
+  FilePath parallel = DestinationPath("parallel");
+  PerfTimer parallel_timer;
+  ASSERT_TRUE(file_util::CopyDirectoryInParallel(source_, parallel, 4));
+  LogThroughput("CopyDirectoryInParallel", parallel_timer.Elapsed());
+#endif
+}
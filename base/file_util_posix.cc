@@ -15,6 +15,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/errno.h>
+#if defined(OS_LINUX)
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#endif
 #include <sys/mman.h>
 #include <sys/param.h>
 #include <sys/stat.h>
@@ -30,6 +35,7 @@
 #include <glib.h>
 #endif
 
+#include <algorithm>
 #include <fstream>
 
 #include "base/basictypes.h"
@@ -783,6 +789,16 @@ void FileEnumerator::GetFindInfo(FindInfo* info) {
     return;
 
   DirectoryEntryInfo* cur_entry = &directory_entries_[current_directory_entry_];
+  if (!cur_entry->has_stat) {
+    // Keep the type that readdir() gave if the entry can't be stat()ed, for
+    // instance because it was removed since.
+    struct stat stat_info;
+    if (StatEntry(root_path_.Append(cur_entry->filename),
+                  (file_type_ & SHOW_SYM_LINKS) != 0, &stat_info)) {
+      memcpy(&cur_entry->stat, &stat_info, sizeof(cur_entry->stat));
+    }
+    cur_entry->has_stat = true;
+  }
   memcpy(&(info->stat), &(cur_entry->stat), sizeof(info->stat));
   info->filename.assign(cur_entry->filename.value());
 }
@@ -830,21 +846,16 @@ bool FileEnumerator::ReadDirectory(std::vector<DirectoryEntryInfo>* entries,
   while (readdir_r(dir, &dent_buf, &dent) == 0 && dent) {
     DirectoryEntryInfo info;
     info.filename = FilePath(dent->d_name);
-
-    FilePath full_name = source.Append(dent->d_name);
-    int ret;
-    if (show_links)
-      ret = lstat(full_name.value().c_str(), &info.stat);
-    else
-      ret = stat(full_name.value().c_str(), &info.stat);
-    if (ret < 0) {
-      // Print the stat() error message unless it was ENOENT and we're
-      // following symlinks.
-      if (!(errno == ENOENT && !show_links)) {
-        DPLOG(ERROR) << "Couldn't stat "
-                     << source.Append(dent->d_name).value();
-      }
+    // The type readdir() reports is enough to enumerate; the rest of the
+    // stat is only needed by GetFindInfo().  Links that are followed, and
+    // entries of unknown type, still need a stat to know what they are.
+    if (dent->d_type != DT_UNKNOWN && (show_links || dent->d_type != DT_LNK)) {
       memset(&info.stat, 0, sizeof(info.stat));
+      info.stat.st_mode = DTTOIF(dent->d_type);
+      info.has_stat = false;
+    } else {
+      StatEntry(source.Append(dent->d_name), show_links, &info.stat);
+      info.has_stat = true;
     }
     entries->push_back(info);
   }
@@ -853,6 +864,25 @@ bool FileEnumerator::ReadDirectory(std::vector<DirectoryEntryInfo>* entries,
   return true;
 }
 
+// static
+bool FileEnumerator::StatEntry(const FilePath& path, bool show_links,
+                               struct stat* stat_info) {
+  int ret;
+  if (show_links)
+    ret = lstat(path.value().c_str(), stat_info);
+  else
+    ret = stat(path.value().c_str(), stat_info);
+  if (ret < 0) {
+    // Print the stat() error message unless it was ENOENT and we're
+    // following symlinks.
+    if (!(errno == ENOENT && !show_links))
+      DPLOG(ERROR) << "Couldn't stat " << path.value();
+    memset(stat_info, 0, sizeof(*stat_info));
+    return false;
+  }
+  return true;
+}
+
 ///////////////////////////////////////////////
 // MemoryMappedFile
 
@@ -1003,30 +1033,20 @@ FilePath GetHomeDir() {
   return FilePath("/tmp");
 }
 
-bool CopyFile(const FilePath& from_path, const FilePath& to_path) {
-  base::ThreadRestrictions::AssertIOAllowed();
-  int infile = HANDLE_EINTR(open(from_path.value().c_str(), O_RDONLY));
-  if (infile < 0)
-    return false;
-
-  int outfile = HANDLE_EINTR(creat(to_path.value().c_str(), 0666));
-  if (outfile < 0) {
-    ignore_result(HANDLE_EINTR(close(infile)));
-    return false;
-  }
+namespace {
 
+// Copies what is left of |infile| to |outfile| from their current positions,
+// through a buffer.
+bool CopyFileContentsWithBuffer(int infile, int outfile) {
   const size_t kBufferSize = 32768;
   std::vector<char> buffer(kBufferSize);
-  bool result = true;
 
-  while (result) {
+  for (;;) {
     ssize_t bytes_read = HANDLE_EINTR(read(infile, &buffer[0], buffer.size()));
-    if (bytes_read < 0) {
-      result = false;
-      break;
-    }
+    if (bytes_read < 0)
+      return false;
     if (bytes_read == 0)
-      break;
+      return true;
     // Allow for partial writes
     ssize_t bytes_written_per_read = 0;
     do {
@@ -1034,13 +1054,203 @@ bool CopyFile(const FilePath& from_path, const FilePath& to_path) {
           outfile,
           &buffer[bytes_written_per_read],
           bytes_read - bytes_written_per_read));
-      if (bytes_written_partial < 0) {
-        result = false;
-        break;
-      }
+      if (bytes_written_partial < 0)
+        return false;
       bytes_written_per_read += bytes_written_partial;
     } while (bytes_written_per_read < bytes_read);
   }
+}
+
+#if defined(OS_LINUX)
+
+#if !defined(FICLONE)
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+
+// The ways to copy a range of a file, from the fastest to the one that always
+// works.  A copy moves down the list when the kernel or the file systems
+// don't support a way.
+enum CopyMethod {
+  COPY_METHOD_COPY_FILE_RANGE,
+  COPY_METHOD_SENDFILE,
+  COPY_METHOD_BUFFER
+};
+
+// Files at least this large are dropped from the page cache once copied, so
+// that copying a large tree doesn't push out everything else.
+const off64_t kDropFromCacheSize = 1 << 20;
+
+// Largest amount to copy in one system call.
+const size_t kMaxCopyChunk = 1 << 30;
+
+bool IsFallbackError(int error) {
+  return error == ENOSYS || error == EXDEV || error == EINVAL ||
+      error == EOPNOTSUPP || error == EBADF;
+}
+
+// Copies |length| bytes at |offset| of |infile| to the same offset of
+// |outfile|, starting with |*method| and moving it down the list as needed.
+// Sets |*end| to the offset the copy got to, which is before the end of the
+// range if |infile| ends earlier.
+bool CopyFileRange(int infile,
+                   int outfile,
+                   off64_t offset,
+                   off64_t length,
+                   CopyMethod* method,
+                   off64_t* end) {
+  std::vector<char> buffer;
+  while (length > 0) {
+    size_t chunk = static_cast<size_t>(std::min<off64_t>(length,
+                                                         kMaxCopyChunk));
+    ssize_t copied = -1;
+    switch (*method) {
+      case COPY_METHOD_COPY_FILE_RANGE: {
+#if defined(__NR_copy_file_range)
+        loff_t in_offset = offset;
+        loff_t out_offset = offset;
+        copied = syscall(__NR_copy_file_range, infile, &in_offset, outfile,
+                         &out_offset, chunk, 0);
+        if (copied < 0 && IsFallbackError(errno)) {
+          *method = COPY_METHOD_SENDFILE;
+          continue;
+        }
+#else
+        *method = COPY_METHOD_SENDFILE;
+        continue;
+#endif
+        break;
+      }
+      case COPY_METHOD_SENDFILE: {
+        // sendfile() writes at the file position of |outfile|.
+        off64_t in_offset = offset;
+        if (lseek64(outfile, offset, SEEK_SET) != offset)
+          return false;
+        copied = sendfile64(outfile, infile, &in_offset, chunk);
+        if (copied < 0 && IsFallbackError(errno)) {
+          *method = COPY_METHOD_BUFFER;
+          continue;
+        }
+        break;
+      }
+      case COPY_METHOD_BUFFER: {
+        const size_t kBufferSize = 32768;
+        buffer.resize(kBufferSize);
+        copied = pread64(infile, &buffer[0],
+                         std::min(chunk, kBufferSize), offset);
+        for (ssize_t written = 0; written < copied;) {
+          ssize_t result = HANDLE_EINTR(pwrite64(
+              outfile, &buffer[written], copied - written, offset + written));
+          if (result < 0)
+            return false;
+          written += result;
+        }
+        break;
+      }
+    }
+    if (copied < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    if (copied == 0) {
+      // copy_file_range() copies nothing from files of some pseudo file
+      // systems, which report a size they don't have, and sendfile() may
+      // stop short too.  Only a read tells that the file really ends here,
+      // because it is shorter than its size or got shorter.
+      if (*method == COPY_METHOD_BUFFER)
+        break;
+      *method = COPY_METHOD_BUFFER;
+      continue;
+    }
+    offset += copied;
+    length -= copied;
+  }
+  *end = offset;
+  return true;
+}
+
+// Copies |infile| to the empty |outfile|: as a reflink if the file system can
+// share the data, otherwise in the kernel, and through a buffer as a last
+// resort.  Holes in |infile| are kept.
+bool CopyFileContents(int infile, int outfile) {
+  if (ioctl(outfile, FICLONE, infile) == 0)
+    return true;
+
+  struct stat64 from_info;
+  struct stat64 to_info;
+  if (fstat64(infile, &from_info) != 0 || fstat64(outfile, &to_info) != 0)
+    return false;
+  // Special files may not report their size, or be seekable.
+  if (!S_ISREG(from_info.st_mode) || !S_ISREG(to_info.st_mode) ||
+      from_info.st_size == 0) {
+    return CopyFileContentsWithBuffer(infile, outfile);
+  }
+
+  const off64_t size = from_info.st_size;
+  posix_fadvise64(infile, 0, size, POSIX_FADV_SEQUENTIAL);
+  CopyMethod method = COPY_METHOD_COPY_FILE_RANGE;
+  // The size |outfile| must be extended to, if |infile| ends in a hole or
+  // ended before its size, since copying only writes data.
+  off64_t truncate_size = -1;
+  off64_t data = 0;
+  while (data < size) {
+    // Only the ranges with data are copied.  File systems that don't know
+    // about holes report the whole file as data.
+    off64_t data_start = lseek64(infile, data, SEEK_DATA);
+    if (data_start < 0) {
+      if (errno == ENXIO) {
+        truncate_size = size;  // Only a hole is left.
+        break;
+      }
+      data_start = data;
+    }
+    off64_t data_end = lseek64(infile, data_start, SEEK_HOLE);
+    if (data_end < 0 || data_end > size)
+      data_end = size;
+    off64_t copied_end;
+    if (!CopyFileRange(infile, outfile, data_start, data_end - data_start,
+                       &method, &copied_end)) {
+      return false;
+    }
+    if (copied_end < data_end) {
+      // |infile| ended early; the copy ends there too, after any hole that
+      // came before.
+      truncate_size = copied_end;
+      break;
+    }
+    data = data_end;
+  }
+
+  if (size >= kDropFromCacheSize)
+    posix_fadvise64(infile, 0, size, POSIX_FADV_DONTNEED);
+  if (truncate_size < 0)
+    return true;
+  return HANDLE_EINTR(ftruncate64(outfile, truncate_size)) == 0;
+}
+
+#else  // defined(OS_LINUX)
+
+bool CopyFileContents(int infile, int outfile) {
+  return CopyFileContentsWithBuffer(infile, outfile);
+}
+
+#endif  // defined(OS_LINUX)
+
+}  // namespace
+
+bool CopyFile(const FilePath& from_path, const FilePath& to_path) {
+  base::ThreadRestrictions::AssertIOAllowed();
+  int infile = HANDLE_EINTR(open(from_path.value().c_str(), O_RDONLY));
+  if (infile < 0)
+    return false;
+
+  int outfile = HANDLE_EINTR(creat(to_path.value().c_str(), 0666));
+  if (outfile < 0) {
+    ignore_result(HANDLE_EINTR(close(infile)));
+    return false;
+  }
+
+  bool result = CopyFileContents(infile, outfile);
 
   if (HANDLE_EINTR(close(infile)) < 0)
     result = false;
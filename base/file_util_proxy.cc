@@ -12,6 +12,10 @@
 #include "base/task_runner.h"
 #include "base/task_runner_util.h"
 
+#if defined(OS_LINUX)
+#include "base/io_uring_file_engine.h"
+#endif
+
 namespace base {
 
 namespace {
@@ -319,6 +323,14 @@ bool FileUtilProxy::Read(
   if (bytes_to_read < 0) {
     return false;
   }
+#if defined(OS_LINUX)
+  if (IOUringFileEngine* engine = IOUringFileEngine::GetInstance()) {
+    if (!MessageLoopProxy::current())
+      return false;
+    engine->Read(file, offset, bytes_to_read, callback);
+    return true;
+  }
+#endif
   ReadHelper* helper = new ReadHelper(bytes_to_read);
   return task_runner->PostTaskAndReply(
       FROM_HERE,
@@ -337,6 +349,14 @@ bool FileUtilProxy::Write(
   if (bytes_to_write <= 0 || buffer == NULL) {
     return false;
   }
+#if defined(OS_LINUX)
+  if (IOUringFileEngine* engine = IOUringFileEngine::GetInstance()) {
+    if (!MessageLoopProxy::current())
+      return false;
+    engine->Write(file, offset, buffer, bytes_to_write, callback);
+    return true;
+  }
+#endif
   WriteHelper* helper = new WriteHelper(buffer, bytes_to_write);
   return task_runner->PostTaskAndReply(
       FROM_HERE,
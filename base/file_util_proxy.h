@@ -109,6 +109,8 @@ class BASE_EXPORT FileUtilProxy {
 
   // Reads from a file. On success, the file pointer is moved to position
   // |offset + bytes_to_read| in the file. The callback can be null.
+  // With --enable-io-uring-file-io on Linux, Read() and Write() bypass
+  // |task_runner|; see IOUringFileEngine for what that means for ordering.
   static bool Read(
       TaskRunner* task_runner,
       PlatformFile file,
@@ -0,0 +1,129 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/file_util_proxy.h"
+
+#include <string>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/callback.h"
+#include "base/file_util.h"
+#include "base/logging.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/message_loop.h"
+#include "base/message_loop_proxy.h"
+#include "base/perftimer.h"
+#include "base/platform_file.h"
+#include "base/scoped_temp_dir.h"
+#include "base/stringprintf.h"
+#include "base/threading/thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+#if defined(OS_LINUX)
+#include "base/io_uring_file_engine.h"
+#endif
+
+namespace base {
+
+namespace {
+
+const int kNumFiles = 10000;
+const int kFileSize = 4096;
+
+// Files are opened this many at a time, to stay below the FD limit.
+const int kFilesPerBatch = 500;
+
+// Starts a read of |kFileSize| bytes of a file.
+typedef Callback<void(PlatformFile,
+                      const FileUtilProxy::ReadCallback&)> ReadFunction;
+
+void ReadWithTaskRunner(TaskRunner* task_runner,
+                        PlatformFile file,
+                        const FileUtilProxy::ReadCallback& callback) {
+  FileUtilProxy::Read(task_runner, file, 0, kFileSize, callback);
+}
+
+#if defined(OS_LINUX)
+void ReadWithIOUring(IOUringFileEngine* engine,
+                     PlatformFile file,
+                     const FileUtilProxy::ReadCallback& callback) {
+  engine->Read(file, 0, kFileSize, callback);
+}
+#endif
+
+void DidRead(int* pending,
+             PlatformFileError error,
+             const char* data,
+             int bytes_read) {
+  EXPECT_EQ(PLATFORM_FILE_OK, error);
+  EXPECT_EQ(kFileSize, bytes_read);
+  if (--*pending == 0)
+    MessageLoop::current()->Quit();
+}
+
+class FileUtilProxyPerfTest : public testing::Test {
+ protected:
+  virtual void SetUp() OVERRIDE {
+    ASSERT_TRUE(dir_.CreateUniqueTempDir());
+    std::string contents(kFileSize, 'x');
+    for (int i = 0; i < kNumFiles; ++i) {
+      FilePath path = dir_.path().AppendASCII(StringPrintf("%d", i));
+      ASSERT_EQ(kFileSize,
+                file_util::WriteFile(path, contents.data(), kFileSize));
+      paths_.push_back(path);
+    }
+  }
+
+  // Reads all the files with |read|, all the files of a batch at once, and
+  // logs the time spent waiting for the reads.
+  void ReadAllFiles(const ReadFunction& read, const char* name) {
+    TimeDelta elapsed;
+    for (int first = 0; first < kNumFiles; first += kFilesPerBatch) {
+      std::vector<PlatformFile> files;
+      for (int i = first; i < first + kFilesPerBatch && i < kNumFiles; ++i) {
+        files.push_back(CreatePlatformFile(
+            paths_[i], PLATFORM_FILE_OPEN | PLATFORM_FILE_READ, NULL, NULL));
+        ASSERT_NE(kInvalidPlatformFileValue, files.back());
+      }
+
+      int pending = files.size();
+      PerfTimer timer;
+      for (size_t i = 0; i < files.size(); ++i)
+        read.Run(files[i], Bind(&DidRead, &pending));
+      loop_.Run();
+      elapsed += timer.Elapsed();
+
+      for (size_t i = 0; i < files.size(); ++i)
+        ClosePlatformFile(files[i]);
+    }
+    LogPerfResult(name, kNumFiles / elapsed.InSecondsF(), "files/s");
+  }
+
+  MessageLoopForIO loop_;
+  ScopedTempDir dir_;
+  std::vector<FilePath> paths_;
+};
+
+}  // namespace
+
+TEST_F(FileUtilProxyPerfTest, ReadSmallFiles) {
+  Thread file_thread("FileUtilProxyPerfTestFileThread");
+  ASSERT_TRUE(file_thread.Start());
+  ReadAllFiles(Bind(&ReadWithTaskRunner,
+                    file_thread.message_loop_proxy()),
+               "FileUtilProxy_ReadSmallFiles_thread");
+
+#if defined(OS_LINUX)
+  scoped_ptr<IOUringFileEngine> engine(IOUringFileEngine::Create());
+  if (!engine.get()) {
+    LOG(WARNING) << "io_uring is not supported";
+    return;
+  }
+  ReadAllFiles(Bind(&ReadWithIOUring, engine.get()),
+               "FileUtilProxy_ReadSmallFiles_io_uring");
+#endif
+}
+
+}  // namespace base
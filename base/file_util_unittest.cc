@@ -21,6 +21,7 @@
 #include "base/file_util.h"
 #include "base/path_service.h"
 #include "base/scoped_temp_dir.h"
+#include "base/stringprintf.h"
 #include "base/threading/platform_thread.h"
 #include "base/utf_string_conversions.h"
 #include "testing/gtest/include/gtest/gtest.h"
@@ -712,6 +713,82 @@ TEST_F(FileUtilTest, NormalizeFilePathSymlinks) {
   // Infinite loop!
   ASSERT_FALSE(file_util::NormalizeFilePath(link_from, &normalized_path));
 }
+
+// Creates |depth| levels of |fanout| directories under |root|, with a file in
+// each directory.  Returns the number of files and directories created.
+int CreateTestTree(const FilePath& root, int depth, int fanout) {
+  CreateTextFile(root.Append(FPL("file.txt")), L"file");
+  int count = 1;
+  if (depth == 0)
+    return count;
+  for (int i = 0; i < fanout; ++i) {
+    FilePath dir = root.Append(StringPrintf("dir%d", i));
+    EXPECT_TRUE(file_util::CreateDirectory(dir));
+    count += 1 + CreateTestTree(dir, depth - 1, fanout);
+  }
+  return count;
+}
+
+TEST_F(FileUtilTest, DeleteInParallel) {
+  FilePath tree = temp_dir_.path().Append(FPL("tree"));
+  ASSERT_TRUE(file_util::CreateDirectory(tree));
+  CreateTestTree(tree, 3, 4);
+
+  // Links in the tree are deleted, what they point to is not.
+  FilePath outside = temp_dir_.path().Append(FPL("outside"));
+  ASSERT_TRUE(file_util::CreateDirectory(outside));
+  CreateTextFile(outside.Append(FPL("kept.txt")), L"kept");
+  ASSERT_TRUE(file_util::CreateSymbolicLink(
+      outside, tree.Append(FPL("dir1")).Append(FPL("link"))));
+
+  EXPECT_TRUE(file_util::DeleteInParallel(tree, 4));
+  EXPECT_FALSE(file_util::PathExists(tree));
+  EXPECT_TRUE(file_util::PathExists(outside.Append(FPL("kept.txt"))));
+
+  // Missing paths and single files work as with Delete().
+  EXPECT_TRUE(file_util::DeleteInParallel(tree, 4));
+  EXPECT_TRUE(file_util::DeleteInParallel(outside.Append(FPL("kept.txt")), 4));
+  EXPECT_FALSE(file_util::PathExists(outside.Append(FPL("kept.txt"))));
+}
+
+TEST_F(FileUtilTest, CopyDirectoryInParallel) {
+  FilePath from = temp_dir_.path().Append(FPL("from"));
+  ASSERT_TRUE(file_util::CreateDirectory(from));
+  int entries = CreateTestTree(from, 2, 3);
+  FilePath deep_file =
+      FilePath(FPL("dir2")).Append(FPL("dir1")).Append(FPL("file.txt"));
+
+  // To a new directory.
+  FilePath to = temp_dir_.path().Append(FPL("to"));
+  EXPECT_TRUE(file_util::CopyDirectoryInParallel(from, to, 3));
+  EXPECT_EQ(L"file", ReadTextFile(to.Append(deep_file)));
+  file_util::FileEnumerator enumerator(to, true, FILES_AND_DIRECTORIES);
+  FindResultCollector collector(enumerator);
+  EXPECT_EQ(entries, collector.size());
+
+  // Into an existing directory.
+  EXPECT_TRUE(file_util::CopyDirectoryInParallel(from, to, 3));
+  EXPECT_EQ(L"file", ReadTextFile(to.Append(FPL("from")).Append(deep_file)));
+
+  // Not into itself.
+  EXPECT_FALSE(file_util::CopyDirectoryInParallel(
+      from, from.Append(FPL("dir0")), 3));
+}
+
+TEST_F(FileUtilTest, CountFilesCreatedAfterInParallel) {
+  FilePath tree = temp_dir_.path().Append(FPL("tree"));
+  ASSERT_TRUE(file_util::CreateDirectory(tree));
+  int entries = CreateTestTree(tree, 3, 3);
+
+  base::Time now = base::Time::Now();
+  base::TimeDelta two_secs = base::TimeDelta::FromSeconds(2);
+  EXPECT_EQ(entries,
+            file_util::CountFilesCreatedAfterInParallel(tree, now - two_secs,
+                                                        2));
+  EXPECT_EQ(0,
+            file_util::CountFilesCreatedAfterInParallel(tree, now + two_secs,
+                                                        2));
+}
 #endif  // defined(OS_POSIX)
 
 TEST_F(FileUtilTest, DeleteNonExistent) {
@@ -1274,6 +1351,71 @@ TEST_F(FileUtilTest, CopyFile) {
   EXPECT_TRUE(file_util::PathExists(dest_file2));
 }
 
+#if defined(OS_LINUX)
+// Holes in the middle and at the end of a file are not filled in the copy.
+TEST_F(FileUtilTest, CopySparseFile) {
+  const int64 kFileSize = 64 << 20;
+  FilePath from = temp_dir_.path().Append(FILE_PATH_LITERAL("sparse"));
+  FILE* file = file_util::OpenFile(from, "wb");
+  ASSERT_TRUE(file != NULL);
+  ASSERT_EQ(4U, fwrite("head", 1, 4, file));
+  ASSERT_EQ(0, fseeko(file, kFileSize / 2, SEEK_SET));
+  ASSERT_EQ(6U, fwrite("middle", 1, 6, file));
+  ASSERT_EQ(0, ftruncate(fileno(file), kFileSize));
+  ASSERT_TRUE(file_util::CloseFile(file));
+
+  FilePath to = temp_dir_.path().Append(FILE_PATH_LITERAL("copy"));
+  ASSERT_TRUE(file_util::CopyFile(from, to));
+
+  std::string from_contents;
+  std::string to_contents;
+  ASSERT_TRUE(file_util::ReadFileToString(from, &from_contents));
+  ASSERT_TRUE(file_util::ReadFileToString(to, &to_contents));
+  EXPECT_EQ(static_cast<size_t>(kFileSize), to_contents.size());
+  EXPECT_TRUE(from_contents == to_contents);
+
+  // Only check the allocation where the file system kept the source sparse.
+  struct stat from_info;
+  struct stat to_info;
+  ASSERT_EQ(0, stat(from.value().c_str(), &from_info));
+  ASSERT_EQ(0, stat(to.value().c_str(), &to_info));
+  if (from_info.st_blocks * 512 < kFileSize / 2)
+    EXPECT_LT(to_info.st_blocks * 512, kFileSize / 2);
+}
+
+// Files of pseudo file systems may report a larger size than they have.  The
+// copy has what can be read from them, without padding.
+TEST_F(FileUtilTest, CopyFileShorterThanItsSize) {
+  const char* const kPseudoFiles[] = {
+    "/sys/kernel/mm/transparent_hugepage/enabled",
+    "/sys/power/state",
+    "/sys/kernel/profiling",
+  };
+  FilePath from;
+  std::string from_contents;
+  for (size_t i = 0; i < arraysize(kPseudoFiles); ++i) {
+    FilePath path(kPseudoFiles[i]);
+    int64 size;
+    if (file_util::GetFileSize(path, &size) &&
+        file_util::ReadFileToString(path, &from_contents) &&
+        static_cast<int64>(from_contents.size()) < size) {
+      from = path;
+      break;
+    }
+  }
+  if (from.empty()) {
+    LOG(WARNING) << "No file shorter than its size, skipping test";
+    return;
+  }
+
+  FilePath to = temp_dir_.path().Append(FILE_PATH_LITERAL("copy"));
+  ASSERT_TRUE(file_util::CopyFile(from, to));
+  std::string to_contents;
+  ASSERT_TRUE(file_util::ReadFileToString(to, &to_contents));
+  EXPECT_EQ(from_contents, to_contents);
+}
+#endif  // defined(OS_LINUX)
+
 // TODO(erikkay): implement
 #if defined(OS_WIN)
 TEST_F(FileUtilTest, GetFileCreationLocalTime) {
@@ -1790,6 +1932,44 @@ TEST_F(FileUtilTest, FileEnumeratorTest) {
                                             // (we don't care what).
 }
 
+TEST_F(FileUtilTest, FileEnumeratorFindInfo) {
+  FilePath dir = temp_dir_.path().Append(FILE_PATH_LITERAL("dir"));
+  ASSERT_TRUE(file_util::CreateDirectory(dir));
+  FilePath file = temp_dir_.path().Append(FILE_PATH_LITERAL("file.txt"));
+  ASSERT_EQ(4, file_util::WriteFile(file, "data", 4));
+
+  file_util::FileEnumerator enumerator(temp_dir_.path(), false,
+                                       FILES_AND_DIRECTORIES);
+  int found = 0;
+  for (FilePath path = enumerator.Next(); !path.empty();
+       path = enumerator.Next(), ++found) {
+    file_util::FileEnumerator::FindInfo info;
+    enumerator.GetFindInfo(&info);
+    if (path == dir) {
+      EXPECT_TRUE(file_util::FileEnumerator::IsDirectory(info));
+    } else {
+      EXPECT_EQ(file, path);
+      EXPECT_FALSE(file_util::FileEnumerator::IsDirectory(info));
+      EXPECT_EQ(4, file_util::FileEnumerator::GetFilesize(info));
+    }
+  }
+  EXPECT_EQ(2, found);
+}
+
+// The type of an entry is still known if it is removed before GetFindInfo().
+TEST_F(FileUtilTest, FileEnumeratorFindInfoOfRemovedEntry) {
+  FilePath dir = temp_dir_.path().Append(FILE_PATH_LITERAL("dir"));
+  ASSERT_TRUE(file_util::CreateDirectory(dir));
+
+  file_util::FileEnumerator enumerator(temp_dir_.path(), false,
+                                       FILES_AND_DIRECTORIES);
+  EXPECT_EQ(dir, enumerator.Next());
+  ASSERT_TRUE(file_util::Delete(dir, false));
+  file_util::FileEnumerator::FindInfo info;
+  enumerator.GetFindInfo(&info);
+  EXPECT_TRUE(file_util::FileEnumerator::IsDirectory(info));
+}
+
 TEST_F(FileUtilTest, AppendToFile) {
   FilePath data_dir =
       temp_dir_.path().Append(FILE_PATH_LITERAL("FilePathTest"));
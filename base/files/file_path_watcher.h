@@ -121,7 +121,8 @@ class BASE_EXPORT FilePathWatcher {
 
   // Invokes |callback| whenever updates to |path| are detected. This should be
   // called at most once, and from a MessageLoop of TYPE_IO. The callback will
-  // be invoked on the same loop. Returns true on success.
+  // be invoked on the same loop. Returns true on success. On Linux, changes
+  // that come in a quick burst are reported by a single callback.
   bool Watch(const FilePath& path, const Callback& callback);
 
  private:
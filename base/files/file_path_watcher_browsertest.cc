@@ -18,6 +18,7 @@
 #include "base/compiler_specific.h"
 #include "base/file_path.h"
 #include "base/file_util.h"
+#include "base/logging.h"
 #include "base/message_loop.h"
 #include "base/message_loop_proxy.h"
 #include "base/path_service.h"
@@ -785,6 +786,55 @@ bool ChangeFilePermissions(const FilePath& path, Permission perm, bool allow) {
 #endif
 }
 
+#if defined(OS_LINUX)
+void IncrementCount(int* count) {
+  ++*count;
+}
+
+// Counts a callback on |loop|, which owns |callbacks|.
+void PostCount(MessageLoop* loop, int* callbacks,
+               const FilePath& path, bool error) {
+  EXPECT_FALSE(error);
+  loop->PostTask(FROM_HERE, base::Bind(&IncrementCount, callbacks));
+}
+
+// Bursts of changes in a watched directory are coalesced, instead of running
+// the callback for each of them.
+TEST_F(FilePathWatcherTest, CoalesceBursts) {
+  const int kWrites = 10000;
+  FilePath dir(temp_dir_.path().AppendASCII("dir"));
+  ASSERT_TRUE(file_util::CreateDirectory(dir));
+
+  int callbacks = 0;
+  FilePathWatcher watcher;
+  file_thread_.message_loop_proxy()->PostTaskAndReply(
+      FROM_HERE,
+      base::Bind(SetupWatchCallback, dir, &watcher,
+                 base::Bind(&PostCount, &loop_, &callbacks)),
+      MessageLoop::QuitClosure());
+  loop_.Run();
+
+  for (int i = 0; i < kWrites; ++i) {
+    ASSERT_TRUE(WriteFile(dir.AppendASCII(base::StringPrintf("%d", i % 100)),
+                          "content"));
+  }
+
+  // Wait until the callbacks stop coming.
+  int last_callbacks = -1;
+  while (callbacks == 0 || callbacks != last_callbacks) {
+    last_callbacks = callbacks;
+    loop_.PostDelayedTask(FROM_HERE, MessageLoop::QuitClosure(),
+                          TestTimeouts::tiny_timeout());
+    loop_.Run();
+  }
+
+  // Without coalescing there is a callback per write, or more. How many are
+  // left depends on how fast the writes are, so only check for a large cut.
+  LOG(INFO) << callbacks << " callbacks for " << kWrites << " writes";
+  EXPECT_LT(callbacks, kWrites / 4);
+}
+#endif  // defined(OS_LINUX)
+
 #if defined(OS_MACOSX)
 // Linux implementation of FilePathWatcher doesn't catch attribute changes.
 // http://crbug.com/78043
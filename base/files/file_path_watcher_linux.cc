@@ -8,10 +8,9 @@
 #include <string.h>
 #include <sys/inotify.h>
 #include <sys/ioctl.h>
-#include <sys/select.h>
 #include <unistd.h>
 
-#include <algorithm>
+#include <map>
 #include <set>
 #include <utility>
 #include <vector>
@@ -35,16 +34,34 @@ namespace files {
 
 namespace {
 
+// Events that come in this soon after the first one of a burst are delivered
+// along with it, and repeated events for the same path are merged.
+const int kCoalescingWindowMs = 10;
+
 class FilePathWatcherImpl;
 
 // Singleton to manage all inotify watches.
 // TODO(tony): It would be nice if this wasn't a singleton.
 // http://crbug.com/38174
-class InotifyReader {
+class InotifyReader : public MessageLoopForIO::Watcher {
  public:
   typedef int Watch;  // Watch descriptor used by AddWatch and RemoveWatch.
   static const Watch kInvalidWatch = -1;
 
+  // A change to |child| in the directory of |watch|. |created| is true if
+  // |child| appeared, and stays true only if all the merged events agree.
+  struct Event {
+    Event(Watch watch, const FilePath::StringType& child, bool created)
+        : watch(watch),
+          child(child),
+          created(created) {}
+
+    Watch watch;
+    FilePath::StringType child;
+    bool created;
+  };
+  typedef std::vector<Event> EventVector;
+
   // Watch directory |path| for changes. |watcher| will be notified on each
   // change. Returns kInvalidWatch on failure.
   Watch AddWatch(const FilePath& path, FilePathWatcherImpl* watcher);
@@ -52,16 +69,29 @@ class InotifyReader {
   // Remove |watch|. Returns true on success.
   bool RemoveWatch(Watch watch, FilePathWatcherImpl* watcher);
 
-  // Callback for InotifyReaderTask.
-  void OnInotifyEvent(const inotify_event* event);
+  // MessageLoopForIO::Watcher implementation.
+  virtual void OnFileCanReadWithoutBlocking(int fd) OVERRIDE;
+  virtual void OnFileCanWriteWithoutBlocking(int fd) OVERRIDE;
 
  private:
   friend struct ::base::DefaultLazyInstanceTraits<InotifyReader>;
 
   typedef std::set<FilePathWatcherImpl*> WatcherSet;
+  typedef std::map<std::pair<Watch, FilePath::StringType>, size_t> EventIndex;
 
   InotifyReader();
-  ~InotifyReader();
+  virtual ~InotifyReader();
+
+  // Start and stop watching |inotify_fd_| on |thread_|.
+  void StartWatching();
+  void StopWatching();
+
+  // Adds |event| to |events_|, and starts the coalescing window if it is the
+  // first one.
+  void OnInotifyEvent(const inotify_event* event);
+
+  // Hands |events_| to the watchers at the end of the coalescing window.
+  void DispatchEvents();
 
   // We keep track of which delegates want to be notified on which watches.
   base::hash_map<Watch, WatcherSet> watchers_;
@@ -69,14 +99,19 @@ class InotifyReader {
   // Lock to protect watchers_.
   base::Lock lock_;
 
-  // Separate thread on which we run blocking read for inotify events.
+  // Separate IO thread on which inotify events are read and coalesced.
   base::Thread thread_;
 
   // File descriptor returned by inotify_init.
   const int inotify_fd_;
 
-  // Use self-pipe trick to unblock select during shutdown.
-  int shutdown_pipe_[2];
+  MessageLoopForIO::FileDescriptorWatcher fd_watcher_;
+
+  // Events read during the current coalescing window, in the order they first
+  // came in, and where to find each watch and child in |events_|. Only used
+  // on |thread_|.
+  EventVector events_;
+  EventIndex event_index_;
 
   // Flag set to true when startup was successful.
   bool valid_;
@@ -89,13 +124,9 @@ class FilePathWatcherImpl : public FilePathWatcher::PlatformDelegate,
  public:
   FilePathWatcherImpl();
 
-  // Called for each event coming from the watch. |fired_watch| identifies the
-  // watch that fired, |child| indicates what has changed, and is relative to
-  // the currently watched path for |fired_watch|. The flag |created| is true if
-  // the object appears.
-  void OnFilePathChanged(InotifyReader::Watch fired_watch,
-                         const FilePath::StringType& child,
-                         bool created);
+  // Called with the coalesced events of the watches of this instance. The
+  // delegate is notified at most once for all of |events|.
+  void OnFilePathsChanged(const InotifyReader::EventVector& events);
 
   // Start watching |path| for changes and notify |delegate| on each change.
   // Returns true if watch for |path| has been added successfully.
@@ -117,6 +148,16 @@ class FilePathWatcherImpl : public FilePathWatcher::PlatformDelegate,
   // Cleans up and stops observing the |message_loop_| thread.
   void CancelOnMessageLoopThread() OVERRIDE;
 
+  // Handles one event. |fired_watch| identifies the watch that fired, |child|
+  // indicates what has changed, and is relative to the currently watched path
+  // for |fired_watch|. The flag |created| is true if the object appears. Sets
+  // |*notify| if the delegate should be notified. Returns false if the
+  // watches could not be updated.
+  bool OnFilePathChanged(InotifyReader::Watch fired_watch,
+                         const FilePath::StringType& child,
+                         bool created,
+                         bool* notify) WARN_UNUSED_RESULT;
+
   // Inotify watches are installed for all directory components of |target_|. A
   // WatchEntry instance holds the watch descriptor for a component and the
   // subdirectory for that identifies the next component. If a symbolic link
@@ -150,63 +191,6 @@ class FilePathWatcherImpl : public FilePathWatcher::PlatformDelegate,
   DISALLOW_COPY_AND_ASSIGN(FilePathWatcherImpl);
 };
 
-void InotifyReaderCallback(InotifyReader* reader, int inotify_fd,
-                           int shutdown_fd) {
-  // Make sure the file descriptors are good for use with select().
-  CHECK_LE(0, inotify_fd);
-  CHECK_GT(FD_SETSIZE, inotify_fd);
-  CHECK_LE(0, shutdown_fd);
-  CHECK_GT(FD_SETSIZE, shutdown_fd);
-
-  while (true) {
-    fd_set rfds;
-    FD_ZERO(&rfds);
-    FD_SET(inotify_fd, &rfds);
-    FD_SET(shutdown_fd, &rfds);
-
-    // Wait until some inotify events are available.
-    int select_result =
-      HANDLE_EINTR(select(std::max(inotify_fd, shutdown_fd) + 1,
-                          &rfds, NULL, NULL, NULL));
-    if (select_result < 0) {
-      DPLOG(WARNING) << "select failed";
-      return;
-    }
-
-    if (FD_ISSET(shutdown_fd, &rfds))
-      return;
-
-    // Adjust buffer size to current event queue size.
-    int buffer_size;
-    int ioctl_result = HANDLE_EINTR(ioctl(inotify_fd, FIONREAD,
-                                          &buffer_size));
-
-    if (ioctl_result != 0) {
-      DPLOG(WARNING) << "ioctl failed";
-      return;
-    }
-
-    std::vector<char> buffer(buffer_size);
-
-    ssize_t bytes_read = HANDLE_EINTR(read(inotify_fd, &buffer[0],
-                                           buffer_size));
-
-    if (bytes_read < 0) {
-      DPLOG(WARNING) << "read from inotify fd failed";
-      return;
-    }
-
-    ssize_t i = 0;
-    while (i < bytes_read) {
-      inotify_event* event = reinterpret_cast<inotify_event*>(&buffer[i]);
-      size_t event_size = sizeof(inotify_event) + event->len;
-      DCHECK(i + event_size <= static_cast<size_t>(bytes_read));
-      reader->OnInotifyEvent(event);
-      i += event_size;
-    }
-  }
-}
-
 static base::LazyInstance<InotifyReader> g_inotify_reader =
     LAZY_INSTANCE_INITIALIZER;
 
@@ -214,31 +198,36 @@ InotifyReader::InotifyReader()
     : thread_("inotify_reader"),
       inotify_fd_(inotify_init()),
       valid_(false) {
-  shutdown_pipe_[0] = -1;
-  shutdown_pipe_[1] = -1;
-  if (inotify_fd_ >= 0 && pipe(shutdown_pipe_) == 0 && thread_.Start()) {
+  base::Thread::Options options(MessageLoop::TYPE_IO, 0);
+  if (inotify_fd_ >= 0 && thread_.StartWithOptions(options)) {
     thread_.message_loop()->PostTask(
-        FROM_HERE, base::Bind(&InotifyReaderCallback, this, inotify_fd_,
-                              shutdown_pipe_[0]));
+        FROM_HERE, base::Bind(&InotifyReader::StartWatching,
+                              base::Unretained(this)));
     valid_ = true;
   }
 }
 
 InotifyReader::~InotifyReader() {
   if (valid_) {
-    // Write to the self-pipe so that the select call in InotifyReaderTask
-    // returns.
-    ssize_t ret = HANDLE_EINTR(write(shutdown_pipe_[1], "", 1));
-    DPCHECK(ret > 0);
-    DCHECK_EQ(ret, 1);
+    thread_.message_loop()->PostTask(
+        FROM_HERE, base::Bind(&InotifyReader::StopWatching,
+                              base::Unretained(this)));
     thread_.Stop();
   }
   if (inotify_fd_ >= 0)
     close(inotify_fd_);
-  if (shutdown_pipe_[0] >= 0)
-    close(shutdown_pipe_[0]);
-  if (shutdown_pipe_[1] >= 0)
-    close(shutdown_pipe_[1]);
+}
+
+void InotifyReader::StartWatching() {
+  if (!MessageLoopForIO::current()->WatchFileDescriptor(
+          inotify_fd_, true, MessageLoopForIO::WATCH_READ, &fd_watcher_,
+          this)) {
+    LOG(WARNING) << "Failed to watch the inotify fd";
+  }
+}
+
+void InotifyReader::StopWatching() {
+  fd_watcher_.StopWatchingFileDescriptor();
 }
 
 InotifyReader::Watch InotifyReader::AddWatch(
@@ -278,19 +267,94 @@ bool InotifyReader::RemoveWatch(Watch watch,
   return true;
 }
 
+void InotifyReader::OnFileCanReadWithoutBlocking(int fd) {
+  DCHECK_EQ(inotify_fd_, fd);
+
+  // Adjust buffer size to current event queue size.
+  int buffer_size;
+  int ioctl_result = HANDLE_EINTR(ioctl(inotify_fd_, FIONREAD, &buffer_size));
+
+  if (ioctl_result != 0) {
+    DPLOG(WARNING) << "ioctl failed";
+    StopWatching();
+    return;
+  }
+
+  if (buffer_size <= 0)
+    return;
+
+  std::vector<char> buffer(buffer_size);
+
+  ssize_t bytes_read = HANDLE_EINTR(read(inotify_fd_, &buffer[0],
+                                         buffer_size));
+
+  if (bytes_read < 0) {
+    DPLOG(WARNING) << "read from inotify fd failed";
+    StopWatching();
+    return;
+  }
+
+  ssize_t i = 0;
+  while (i < bytes_read) {
+    inotify_event* event = reinterpret_cast<inotify_event*>(&buffer[i]);
+    size_t event_size = sizeof(inotify_event) + event->len;
+    DCHECK(i + event_size <= static_cast<size_t>(bytes_read));
+    OnInotifyEvent(event);
+    i += event_size;
+  }
+}
+
+void InotifyReader::OnFileCanWriteWithoutBlocking(int fd) {
+  NOTREACHED();
+}
+
 void InotifyReader::OnInotifyEvent(const inotify_event* event) {
   if (event->mask & IN_IGNORED)
     return;
 
   FilePath::StringType child(event->len ? event->name : FILE_PATH_LITERAL(""));
+  bool created = (event->mask & (IN_CREATE | IN_MOVED_TO)) != 0;
+
+  if (events_.empty()) {
+    thread_.message_loop()->PostDelayedTask(
+        FROM_HERE,
+        base::Bind(&InotifyReader::DispatchEvents, base::Unretained(this)),
+        TimeDelta::FromMilliseconds(kCoalescingWindowMs));
+  }
+
+  std::pair<EventIndex::iterator, bool> inserted = event_index_.insert(
+      std::make_pair(std::make_pair(event->wd, child), events_.size()));
+  if (inserted.second)
+    events_.push_back(Event(event->wd, child, created));
+  else
+    events_[inserted.first->second].created &= created;
+}
+
+void InotifyReader::DispatchEvents() {
+  typedef std::map<FilePathWatcherImpl*, EventVector> WatcherEvents;
+  WatcherEvents watcher_events;
+
   base::AutoLock auto_lock(lock_);
 
-  for (WatcherSet::iterator watcher = watchers_[event->wd].begin();
-       watcher != watchers_[event->wd].end();
-       ++watcher) {
-    (*watcher)->OnFilePathChanged(event->wd,
-                                  child,
-                                  event->mask & (IN_CREATE | IN_MOVED_TO));
+  for (EventVector::const_iterator event = events_.begin();
+       event != events_.end(); ++event) {
+    base::hash_map<Watch, WatcherSet>::const_iterator watchers =
+        watchers_.find(event->watch);
+    if (watchers == watchers_.end())
+      continue;
+    for (WatcherSet::const_iterator watcher = watchers->second.begin();
+         watcher != watchers->second.end();
+         ++watcher) {
+      watcher_events[*watcher].push_back(*event);
+    }
+  }
+  events_.clear();
+  event_index_.clear();
+
+  // This happens under |lock_| so that the watchers can't go away.
+  for (WatcherEvents::const_iterator watcher = watcher_events.begin();
+       watcher != watcher_events.end(); ++watcher) {
+    watcher->first->OnFilePathsChanged(watcher->second);
   }
 }
 
@@ -298,22 +362,36 @@ FilePathWatcherImpl::FilePathWatcherImpl()
     : delegate_(NULL) {
 }
 
-void FilePathWatcherImpl::OnFilePathChanged(InotifyReader::Watch fired_watch,
-                                            const FilePath::StringType& child,
-                                            bool created) {
+void FilePathWatcherImpl::OnFilePathsChanged(
+    const InotifyReader::EventVector& events) {
   if (!message_loop()->BelongsToCurrentThread()) {
     // Switch to message_loop_ to access watches_ safely.
     message_loop()->PostTask(FROM_HERE,
-        base::Bind(&FilePathWatcherImpl::OnFilePathChanged,
+        base::Bind(&FilePathWatcherImpl::OnFilePathsChanged,
                    this,
-                   fired_watch,
-                   child,
-                   created));
+                   events));
     return;
   }
 
   DCHECK(MessageLoopForIO::current());
 
+  bool notify = false;
+  for (InotifyReader::EventVector::const_iterator event = events.begin();
+       event != events.end(); ++event) {
+    if (!OnFilePathChanged(event->watch, event->child, event->created,
+                           &notify)) {
+      delegate_->OnFilePathError(target_);
+      return;
+    }
+  }
+  if (notify)
+    delegate_->OnFilePathChanged(target_);
+}
+
+bool FilePathWatcherImpl::OnFilePathChanged(InotifyReader::Watch fired_watch,
+                                            const FilePath::StringType& child,
+                                            bool created,
+                                            bool* notify) {
   // Find the entry in |watches_| that corresponds to |fired_watch|.
   WatchVector::const_iterator watch_entry(watches_.begin());
   for ( ; watch_entry != watches_.end(); ++watch_entry) {
@@ -337,10 +415,8 @@ void FilePathWatcherImpl::OnFilePathChanged(InotifyReader::Watch fired_watch,
       // as changes to symlinks on the target path will not have
       // IN_ISDIR set in the event masks. As a result we may sometimes
       // call UpdateWatches() unnecessarily.
-      if (change_on_target_path && !UpdateWatches()) {
-        delegate_->OnFilePathError(target_);
-        return;
-      }
+      if (change_on_target_path && !UpdateWatches())
+        return false;
 
       // Report the following events:
       //  - The target or a direct child of the target got changed (in case the
@@ -353,11 +429,12 @@ void FilePathWatcherImpl::OnFilePathChanged(InotifyReader::Watch fired_watch,
       if (target_changed ||
           (change_on_target_path && !created) ||
           (change_on_target_path && file_util::PathExists(target_))) {
-        delegate_->OnFilePathChanged(target_);
-        return;
+        *notify = true;
+        return true;
       }
     }
   }
+  return true;
 }
 
 bool FilePathWatcherImpl::Watch(const FilePath& path,
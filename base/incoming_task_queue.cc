@@ -0,0 +1,141 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/incoming_task_queue.h"
+
+#include <new>
+
+namespace base {
+
+namespace {
+
+const uintptr_t kFreeIndexMask = 0xFFFF;
+const int kFreeCountShift = 16;
+
+// Returns the free list head that points at |index| and replaces |free_head|.
+subtle::AtomicWord NextFreeHead(subtle::AtomicWord free_head,
+                                uintptr_t index) {
+  uintptr_t count = (static_cast<uintptr_t>(free_head) >> kFreeCountShift) + 1;
+  return static_cast<subtle::AtomicWord>((count << kFreeCountShift) | index);
+}
+
+}  // namespace
+
+IncomingTaskQueue::IncomingTaskQueue()
+    : head_(0),
+      free_head_(1),
+      pool_(new Node[kNodePoolSize]) {
+  COMPILE_ASSERT(kNodePoolSize <= static_cast<int>(kFreeIndexMask),
+                 node_pool_too_large_for_free_head);
+  for (int i = 0; i < kNodePoolSize - 1; ++i)
+    pool_[i].next_free = i + 2;
+}
+
+IncomingTaskQueue::~IncomingTaskQueue() {
+  Node* node = reinterpret_cast<Node*>(subtle::Acquire_Load(&head_));
+  while (node) {
+    Node* next = node->next;
+    node->pending_task()->~PendingTask();
+    FreeNode(node);
+    node = next;
+  }
+}
+
+bool IncomingTaskQueue::Push(PendingTask* pending_task) {
+  Node* node = AllocateNode();
+  new (node->storage.void_data()) PendingTask(*pending_task);
+  pending_task->task.Reset();
+
+  subtle::AtomicWord head = subtle::NoBarrier_Load(&head_);
+  for (;;) {
+    node->next = reinterpret_cast<Node*>(head);
+    // The release publishes the task to the thread that takes it.  Nodes are
+    // only ever removed all at once, so a head that compares equal is always
+    // the node that |next| points to.
+    subtle::AtomicWord previous = subtle::Release_CompareAndSwap(
+        &head_, head, reinterpret_cast<subtle::AtomicWord>(node));
+    if (previous == head)
+      return head == 0;
+    head = previous;
+  }
+}
+
+bool IncomingTaskQueue::TakeAll(TaskQueue* queue) {
+  subtle::AtomicWord head = subtle::NoBarrier_Load(&head_);
+  for (;;) {
+    if (!head)
+      return false;
+    subtle::AtomicWord previous =
+        subtle::Acquire_CompareAndSwap(&head_, head, 0);
+    if (previous == head)
+      break;
+    head = previous;
+  }
+
+  // The list runs from the newest task to the oldest; reverse it.
+  Node* oldest = NULL;
+  Node* node = reinterpret_cast<Node*>(head);
+  while (node) {
+    Node* next = node->next;
+    node->next = oldest;
+    oldest = node;
+    node = next;
+  }
+  while (oldest) {
+    Node* next = oldest->next;
+    queue->push(*oldest->pending_task());
+    oldest->pending_task()->~PendingTask();
+    FreeNode(oldest);
+    oldest = next;
+  }
+  return true;
+}
+
+bool IncomingTaskQueue::empty() const {
+  return subtle::Acquire_Load(&head_) == 0;
+}
+
+IncomingTaskQueue::Node* IncomingTaskQueue::AllocateNode() {
+  subtle::AtomicWord free_head = subtle::Acquire_Load(&free_head_);
+  for (;;) {
+    uintptr_t index = static_cast<uintptr_t>(free_head) & kFreeIndexMask;
+    if (!index)
+      return new Node;
+    // Another thread may take |node| and free it again before the swap, in
+    // which case |next_free| is stale but the count in the head has changed.
+    Node* node = &pool_[index - 1];
+    subtle::AtomicWord next = NextFreeHead(
+        free_head, subtle::NoBarrier_Load(&node->next_free));
+    subtle::AtomicWord previous =
+        subtle::Acquire_CompareAndSwap(&free_head_, free_head, next);
+    if (previous == free_head)
+      return node;
+    free_head = previous;
+  }
+}
+
+void IncomingTaskQueue::FreeNode(Node* node) {
+  if (node < pool_.get() || node >= pool_.get() + kNodePoolSize) {
+    delete node;
+    return;
+  }
+
+  uintptr_t index = node - pool_.get() + 1;
+  subtle::AtomicWord free_head = subtle::NoBarrier_Load(&free_head_);
+  for (;;) {
+    subtle::NoBarrier_Store(
+        &node->next_free,
+        static_cast<subtle::Atomic32>(
+            static_cast<uintptr_t>(free_head) & kFreeIndexMask));
+    // The release makes the destruction of the task visible to the thread
+    // that constructs the next one in the node.
+    subtle::AtomicWord previous = subtle::Release_CompareAndSwap(
+        &free_head_, free_head, NextFreeHead(free_head, index));
+    if (previous == free_head)
+      return;
+    free_head = previous;
+  }
+}
+
+}  // namespace base
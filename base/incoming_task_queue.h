@@ -0,0 +1,95 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_INCOMING_TASK_QUEUE_H_
+#define BASE_INCOMING_TASK_QUEUE_H_
+#pragma once
+
+#include "base/atomicops.h"
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/memory/aligned_memory.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/pending_task.h"
+
+namespace base {
+
+// A lock-free queue of PendingTasks that any number of threads may post to,
+// and that one thread takes the tasks out of.  It is the incoming queue of a
+// MessageLoop: posting a task is a couple of compare-and-swaps instead of a
+// lock acquisition, and the owning thread takes every queued task at once.
+// The nodes that hold the tasks come from a free list of nodes that are
+// allocated with the queue and recycled by the consuming thread, so that a
+// post only allocates when more than kNodePoolSize tasks are waiting.
+//
+// Push() reports whether the queue was empty, so that only the poster that
+// makes the queue non-empty needs to wake up the consumer.  Posters that
+// arrive before the consumer has taken the tasks are coalesced into that one
+// wakeup.
+class BASE_EXPORT IncomingTaskQueue {
+ public:
+  IncomingTaskQueue();
+  // Deletes the tasks that were never taken.  No thread may push concurrently.
+  ~IncomingTaskQueue();
+
+  // Adds a copy of |pending_task| to the queue, and resets
+  // pending_task->task before the copy is visible to the consuming thread, so
+  // that the last reference to the task is released there.  Returns true if
+  // the queue was empty.  Safe to call from any thread.
+  bool Push(PendingTask* pending_task);
+
+  // Appends all the tasks in the queue to |queue|, in the order they were
+  // pushed, and leaves this queue empty.  Returns false if there were none.
+  // Must only be called on the consuming thread.
+  bool TakeAll(TaskQueue* queue);
+
+  // Returns true if there are no tasks in the queue.  Safe to call from any
+  // thread, but the answer may be stale by the time it is used.
+  bool empty() const;
+
+ private:
+  // The number of nodes that are allocated with the queue.
+  static const int kNodePoolSize = 64;
+
+  // The tasks are kept in a singly-linked list of nodes that hold the link to
+  // the task pushed before them.  The task is constructed in place when the
+  // node is taken from the free list and destroyed when it goes back.
+  struct Node {
+    Node() : next(NULL), next_free(0) {}
+
+    PendingTask* pending_task() { return storage.data_as<PendingTask>(); }
+
+    AlignedMemory<sizeof(PendingTask), ALIGNOF(PendingTask)> storage;
+    Node* next;
+    // While the node is on the free list, the index in |pool_| plus one of the
+    // next free node, or 0 if it is the last one.
+    subtle::Atomic32 next_free;
+  };
+
+  // Returns a node from the free list, or a new heap allocated node if the
+  // free list is empty.  Safe to call from any thread.
+  Node* AllocateNode();
+
+  // Returns |node|, whose task has been destroyed, to the free list, or
+  // deletes it if it was not allocated with the queue.
+  void FreeNode(Node* node);
+
+  // The node of the most recently pushed task, or 0 if the queue is empty.
+  subtle::AtomicWord head_;
+
+  // The first node of the free list, as its index in |pool_| plus one in the
+  // low 16 bits, or 0 if the list is empty.  The bits above hold a count that
+  // changes with every update, so that a thread which read the head before
+  // another thread took that node off the list and put it back fails its
+  // compare-and-swap instead of installing a stale |next_free|.
+  subtle::AtomicWord free_head_;
+
+  scoped_array<Node> pool_;
+
+  DISALLOW_COPY_AND_ASSIGN(IncomingTaskQueue);
+};
+
+}  // namespace base
+
+#endif  // BASE_INCOMING_TASK_QUEUE_H_
@@ -0,0 +1,181 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/incoming_task_queue.h"
+
+#include <vector>
+
+#include "base/bind.h"
+#include "base/memory/ref_counted.h"
+#include "base/memory/scoped_vector.h"
+#include "base/threading/simple_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+// Records the tasks that run as (producer, index) pairs.
+typedef std::vector<std::pair<int, int> > RunOrder;
+
+void RecordTask(RunOrder* order, int producer, int index) {
+  order->push_back(std::make_pair(producer, index));
+}
+
+// Tells whether it has been deleted.
+class Canary : public RefCounted<Canary> {
+ public:
+  explicit Canary(bool* deleted) : deleted_(deleted) {}
+
+  void Run() {}
+
+ private:
+  friend class RefCounted<Canary>;
+  ~Canary() { *deleted_ = true; }
+
+  bool* deleted_;
+};
+
+PendingTask MakeTask(RunOrder* order, int producer, int index) {
+  return PendingTask(FROM_HERE, Bind(&RecordTask, order, producer, index));
+}
+
+// Runs the tasks in |queue|, oldest first.
+void RunTasks(TaskQueue* queue) {
+  while (!queue->empty()) {
+    queue->front().task.Run();
+    queue->pop();
+  }
+}
+
+// Pushes |num_tasks| tasks that record |producer| to |queue|.
+class Producer : public DelegateSimpleThread::Delegate {
+ public:
+  Producer(IncomingTaskQueue* queue, RunOrder* order, int producer,
+           int num_tasks)
+      : queue_(queue),
+        order_(order),
+        producer_(producer),
+        num_tasks_(num_tasks) {}
+
+  virtual void Run() OVERRIDE {
+    for (int i = 0; i < num_tasks_; ++i) {
+      PendingTask pending_task = MakeTask(order_, producer_, i);
+      queue_->Push(&pending_task);
+    }
+  }
+
+ private:
+  IncomingTaskQueue* queue_;
+  RunOrder* order_;
+  int producer_;
+  int num_tasks_;
+
+  DISALLOW_COPY_AND_ASSIGN(Producer);
+};
+
+}  // namespace
+
+TEST(IncomingTaskQueueTest, PushAndTakeAll) {
+  IncomingTaskQueue queue;
+  RunOrder order;
+  TaskQueue work_queue;
+  EXPECT_TRUE(queue.empty());
+  EXPECT_FALSE(queue.TakeAll(&work_queue));
+
+  // Only the push onto an empty queue reports it.
+  for (int i = 0; i < 3; ++i) {
+    PendingTask pending_task = MakeTask(&order, 0, i);
+    EXPECT_EQ(i == 0, queue.Push(&pending_task));
+    EXPECT_TRUE(pending_task.task.is_null());
+  }
+  EXPECT_FALSE(queue.empty());
+
+  // Tasks are appended after those already in the work queue, oldest first.
+  PendingTask first = MakeTask(&order, 1, 0);
+  work_queue.push(first);
+  EXPECT_TRUE(queue.TakeAll(&work_queue));
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(4u, work_queue.size());
+  RunTasks(&work_queue);
+  ASSERT_EQ(4u, order.size());
+  EXPECT_EQ(std::make_pair(1, 0), order[0]);
+  EXPECT_EQ(std::make_pair(0, 0), order[1]);
+  EXPECT_EQ(std::make_pair(0, 1), order[2]);
+  EXPECT_EQ(std::make_pair(0, 2), order[3]);
+
+  // Once the queue has been emptied, the next push reports it again.
+  PendingTask pending_task = MakeTask(&order, 0, 3);
+  EXPECT_TRUE(queue.Push(&pending_task));
+  EXPECT_TRUE(queue.TakeAll(&work_queue));
+  EXPECT_EQ(1u, work_queue.size());
+}
+
+// The queue holds the only reference to a pushed task, and deletes the tasks
+// that were never taken.
+TEST(IncomingTaskQueueTest, DeletesTasks) {
+  bool deleted = false;
+  {
+    IncomingTaskQueue queue;
+    PendingTask pending_task(FROM_HERE, Bind(&Canary::Run,
+                                             make_scoped_refptr(
+                                                 new Canary(&deleted))));
+    queue.Push(&pending_task);
+    EXPECT_FALSE(deleted);
+  }
+  EXPECT_TRUE(deleted);
+}
+
+// More tasks than there are nodes allocated with the queue keep their order,
+// and the nodes are reused once the tasks have been taken.
+TEST(IncomingTaskQueueTest, MoreTasksThanNodes) {
+  const int kNumTasks = 1000;
+  IncomingTaskQueue queue;
+  for (int round = 0; round < 3; ++round) {
+    RunOrder order;
+    for (int i = 0; i < kNumTasks; ++i) {
+      PendingTask pending_task = MakeTask(&order, round, i);
+      queue.Push(&pending_task);
+    }
+    TaskQueue work_queue;
+    EXPECT_TRUE(queue.TakeAll(&work_queue));
+    RunTasks(&work_queue);
+    ASSERT_EQ(static_cast<size_t>(kNumTasks), order.size());
+    for (int i = 0; i < kNumTasks; ++i)
+      EXPECT_EQ(std::make_pair(round, i), order[i]);
+  }
+}
+
+// Tasks from many threads all arrive, each thread's in the order it pushed
+// them, while the consumer takes them concurrently.
+TEST(IncomingTaskQueueTest, ManyProducers) {
+  const int kNumProducers = 4;
+  const int kNumTasks = 10000;
+  IncomingTaskQueue queue;
+  RunOrder order;
+  ScopedVector<Producer> producers;
+  ScopedVector<DelegateSimpleThread> threads;
+  for (int i = 0; i < kNumProducers; ++i) {
+    producers.push_back(new Producer(&queue, &order, i, kNumTasks));
+    threads.push_back(new DelegateSimpleThread(producers[i], "Producer"));
+    threads[i]->Start();
+  }
+
+  TaskQueue work_queue;
+  while (order.size() < static_cast<size_t>(kNumProducers * kNumTasks)) {
+    queue.TakeAll(&work_queue);
+    RunTasks(&work_queue);
+  }
+  for (int i = 0; i < kNumProducers; ++i)
+    threads[i]->Join();
+  EXPECT_TRUE(queue.empty());
+
+  std::vector<int> next_index(kNumProducers, 0);
+  for (size_t i = 0; i < order.size(); ++i) {
+    ASSERT_EQ(next_index[order[i].first], order[i].second);
+    ++next_index[order[i].first];
+  }
+}
+
+}  // namespace base
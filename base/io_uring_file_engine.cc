@@ -0,0 +1,596 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/io_uring_file_engine.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "base/atomicops.h"
+#include "base/base_switches.h"
+#include "base/bind.h"
+#include "base/bind_helpers.h"
+#include "base/command_line.h"
+#include "base/eintr_wrapper.h"
+#include "base/lazy_instance.h"
+#include "base/location.h"
+#include "base/logging.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/message_loop_proxy.h"
+#include "build/build_config.h"
+
+// The io_uring system calls, for C libraries that predate them.  Most
+// architectures take their numbers from the common system call table, but
+// MIPS offsets them by ABI.  Elsewhere the engine is simply unavailable.
+#if !defined(__NR_io_uring_setup)
+#if defined(ARCH_CPU_X86_FAMILY) || defined(ARCH_CPU_ARM_FAMILY)
+#define __NR_io_uring_setup 425
+#define __NR_io_uring_enter 426
+#define __NR_io_uring_register 427
+#elif defined(ARCH_CPU_MIPS_FAMILY) && defined(_MIPS_SIM) && \
+    _MIPS_SIM == _MIPS_SIM_ABI32
+#define __NR_io_uring_setup 4425
+#define __NR_io_uring_enter 4426
+#define __NR_io_uring_register 4427
+#endif
+#endif
+
+namespace base {
+
+// The parts of the io_uring ABI that the engine uses, as in
+// <linux/io_uring.h>, which is not available with older kernel headers.  The
+// layout is fixed, and the same for 32-bit and 64-bit processes.
+struct IOUringFileEngine::SubmissionEntry {
+  uint8 opcode;
+  uint8 flags;
+  uint16 ioprio;
+  int32 fd;
+  uint64 off;
+  uint64 addr;
+  uint32 len;
+  uint32 rw_flags;
+  uint64 user_data;
+  uint64 pad[3];
+};
+
+struct IOUringFileEngine::CompletionEntry {
+  uint64 user_data;
+  int32 res;
+  uint32 flags;
+};
+
+namespace {
+
+struct SubmissionRingOffsets {
+  uint32 head;
+  uint32 tail;
+  uint32 ring_mask;
+  uint32 ring_entries;
+  uint32 flags;
+  uint32 dropped;
+  uint32 array;
+  uint32 resv1;
+  uint64 resv2;
+};
+
+struct CompletionRingOffsets {
+  uint32 head;
+  uint32 tail;
+  uint32 ring_mask;
+  uint32 ring_entries;
+  uint32 overflow;
+  uint32 cqes;
+  uint32 flags;
+  uint32 resv1;
+  uint64 resv2;
+};
+
+struct RingParams {
+  uint32 sq_entries;
+  uint32 cq_entries;
+  uint32 flags;
+  uint32 sq_thread_cpu;
+  uint32 sq_thread_idle;
+  uint32 features;
+  uint32 wq_fd;
+  uint32 resv[3];
+  SubmissionRingOffsets sq_off;
+  CompletionRingOffsets cq_off;
+};
+
+const uint8 kOpReadv = 1;
+const uint8 kOpWritev = 2;
+const uint32 kFeatureSingleMmap = 1;
+const unsigned kRegisterEventFd = 4;
+const off_t kSubmissionRingOffset = 0;
+const off_t kCompletionRingOffset = 0x8000000;
+const off_t kSubmissionEntriesOffset = 0x10000000;
+
+// Entries of the submission ring.  The kernel makes the completion ring twice
+// as large.
+const unsigned kQueueDepth = 256;
+
+// How long to wait before handing the kernel submissions it refused.  The
+// delay doubles for every refusal in a row.
+const int kMinSubmitRetryDelayMs = 1;
+const int kMaxSubmitRetryDelayMs = 100;
+
+#if defined(__NR_io_uring_setup)
+int IOUringSetup(unsigned entries, RingParams* params) {
+  return syscall(__NR_io_uring_setup, entries, params);
+}
+
+int IOUringEnter(int ring_fd, unsigned to_submit) {
+  return syscall(__NR_io_uring_enter, ring_fd, to_submit, 0, 0, NULL, 0);
+}
+
+int IOUringRegisterEventFd(int ring_fd, int event_fd) {
+  return syscall(__NR_io_uring_register, ring_fd, kRegisterEventFd,
+                 &event_fd, 1);
+}
+#else
+int IOUringSetup(unsigned entries, RingParams* params) {
+  errno = ENOSYS;
+  return -1;
+}
+
+int IOUringEnter(int ring_fd, unsigned to_submit) {
+  errno = ENOSYS;
+  return -1;
+}
+
+int IOUringRegisterEventFd(int ring_fd, int event_fd) {
+  errno = ENOSYS;
+  return -1;
+}
+#endif
+
+// The ring indices are shared with the kernel, which reads and writes them
+// concurrently.
+unsigned LoadAcquire(const unsigned* index) {
+  return static_cast<unsigned>(subtle::Acquire_Load(
+      reinterpret_cast<volatile const subtle::Atomic32*>(index)));
+}
+
+void StoreRelease(unsigned* index, unsigned value) {
+  subtle::Release_Store(reinterpret_cast<volatile subtle::Atomic32*>(index),
+                        static_cast<subtle::Atomic32>(value));
+}
+
+void* MapRing(int ring_fd, size_t size, off_t offset) {
+  void* ring = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd, offset);
+  return ring == MAP_FAILED ? NULL : ring;
+}
+
+// Holds the engine FileUtilProxy uses, created on first use.
+struct EngineHolder {
+  EngineHolder() : engine(NULL) {
+    // Processes that never initialize the CommandLine don't use io_uring.
+    if (CommandLine::InitializedForCurrentProcess() &&
+        CommandLine::ForCurrentProcess()->HasSwitch(
+            switches::kEnableIOUringFileIO)) {
+      engine = IOUringFileEngine::Create();
+    }
+  }
+
+  IOUringFileEngine* engine;
+};
+
+LazyInstance<EngineHolder>::Leaky g_engine_holder = LAZY_INSTANCE_INITIALIZER;
+
+}  // namespace
+
+// A read or write, from the time it is queued until its callback runs on the
+// loop of the thread that started it.
+class IOUringFileEngine::Operation {
+ public:
+  Operation(bool is_write, PlatformFile file, int64 offset, int length)
+      : is_write_(is_write),
+        file_(file),
+        offset_(offset),
+        buffer_(new char[length]),
+        length_(length),
+        transferred_(0),
+        result_(0),
+        origin_loop_(MessageLoopProxy::current()) {
+    DCHECK(origin_loop_);
+  }
+
+  void set_read_callback(const FileUtilProxy::ReadCallback& callback) {
+    read_callback_ = callback;
+  }
+  void set_write_callback(const FileUtilProxy::WriteCallback& callback) {
+    write_callback_ = callback;
+  }
+
+  char* buffer() { return buffer_.get(); }
+  int length() const { return length_; }
+
+  MessageLoopProxy* origin_loop() const { return origin_loop_.get(); }
+
+  bool has_callback() const {
+    return !read_callback_.is_null() || !write_callback_.is_null();
+  }
+
+  // Fills |sqe| to transfer the bytes that are left.
+  void Prepare(SubmissionEntry* sqe) {
+    iov_.iov_base = buffer_.get() + transferred_;
+    iov_.iov_len = length_ - transferred_;
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = is_write_ ? kOpWritev : kOpReadv;
+    sqe->fd = file_;
+    sqe->off = offset_ + transferred_;
+    sqe->addr = reinterpret_cast<uintptr_t>(&iov_);
+    sqe->len = 1;
+    sqe->user_data = reinterpret_cast<uintptr_t>(this);
+  }
+
+  // Takes the result of a submission.  Returns false if the rest of the
+  // transfer must be submitted again, as ReadPlatformFile() and
+  // WritePlatformFile() loop until they are done or fail.
+  bool OnResult(int result) {
+    if (result == -EINTR || result == -EAGAIN)
+      return false;
+    if (result > 0) {
+      transferred_ += result;
+      if (transferred_ < length_)
+        return false;
+    }
+    if (transferred_ > 0)
+      result_ = transferred_;
+    else
+      result_ = result < 0 ? -1 : 0;
+    return true;
+  }
+
+  // Fails the transfer, with the bytes transferred so far if there are any, as
+  // ReadPlatformFile() and WritePlatformFile() do when they fail part way.
+  void Fail() {
+    bool done = OnResult(-EIO);
+    DCHECK(done);
+  }
+
+  // Runs the callback.  Called on the origin loop.
+  void Reply() {
+    PlatformFileError error =
+        result_ < 0 ? PLATFORM_FILE_ERROR_FAILED : PLATFORM_FILE_OK;
+    if (!read_callback_.is_null())
+      read_callback_.Run(error, buffer_.get(), result_);
+    else if (!write_callback_.is_null())
+      write_callback_.Run(error, result_);
+  }
+
+ private:
+  bool is_write_;
+  PlatformFile file_;
+  int64 offset_;
+  scoped_array<char> buffer_;
+  int length_;
+  int transferred_;
+  int result_;
+  struct iovec iov_;
+  FileUtilProxy::ReadCallback read_callback_;
+  FileUtilProxy::WriteCallback write_callback_;
+  scoped_refptr<MessageLoopProxy> origin_loop_;
+
+  DISALLOW_COPY_AND_ASSIGN(Operation);
+};
+
+// static
+IOUringFileEngine* IOUringFileEngine::GetInstance() {
+  IOUringFileEngine* engine = g_engine_holder.Get().engine;
+  if (engine && engine->has_failed())
+    return NULL;
+  return engine;
+}
+
+// static
+IOUringFileEngine* IOUringFileEngine::Create() {
+  scoped_ptr<IOUringFileEngine> engine(new IOUringFileEngine);
+  if (!engine->Init())
+    return NULL;
+  return engine.release();
+}
+
+IOUringFileEngine::IOUringFileEngine()
+    : ring_fd_(-1),
+      event_fd_(-1),
+      sq_ring_(NULL),
+      sq_ring_size_(0),
+      cq_ring_(NULL),
+      cq_ring_size_(0),
+      sqes_(NULL),
+      sqes_size_(0),
+      sq_head_(NULL),
+      sq_tail_(NULL),
+      sq_mask_(0),
+      sq_entries_(0),
+      sq_array_(NULL),
+      cq_head_(NULL),
+      cq_tail_(NULL),
+      cq_mask_(0),
+      cq_entries_(0),
+      cqes_(NULL),
+      submit_posted_(false),
+      failed_(0),
+      in_flight_(0),
+      retry_posted_(false),
+      retry_delay_ms_(kMinSubmitRetryDelayMs),
+      thread_("IOUringFileEngine") {
+}
+
+IOUringFileEngine::~IOUringFileEngine() {
+  if (thread_.IsRunning()) {
+    thread_.message_loop()->PostTask(
+        FROM_HERE,
+        Bind(IgnoreResult(
+                 &MessageLoopForIO::FileDescriptorWatcher::
+                     StopWatchingFileDescriptor),
+             Unretained(&event_fd_controller_)));
+    thread_.Stop();
+  }
+  DCHECK(queued_.empty());
+  DCHECK(backlog_.empty());
+  DCHECK_EQ(0u, in_flight_);
+  if (sqes_)
+    munmap(sqes_, sqes_size_);
+  if (cq_ring_ && cq_ring_ != sq_ring_)
+    munmap(cq_ring_, cq_ring_size_);
+  if (sq_ring_)
+    munmap(sq_ring_, sq_ring_size_);
+  if (event_fd_ >= 0 && HANDLE_EINTR(close(event_fd_)) < 0)
+    DPLOG(ERROR) << "close";
+  if (ring_fd_ >= 0 && HANDLE_EINTR(close(ring_fd_)) < 0)
+    DPLOG(ERROR) << "close";
+}
+
+void IOUringFileEngine::Read(PlatformFile file,
+                             int64 offset,
+                             int bytes_to_read,
+                             const FileUtilProxy::ReadCallback& callback) {
+  DCHECK_GE(bytes_to_read, 0);
+  Operation* operation = new Operation(false, file, offset, bytes_to_read);
+  operation->set_read_callback(callback);
+  Queue(operation);
+}
+
+void IOUringFileEngine::Write(PlatformFile file,
+                              int64 offset,
+                              const char* buffer,
+                              int bytes_to_write,
+                              const FileUtilProxy::WriteCallback& callback) {
+  DCHECK_GT(bytes_to_write, 0);
+  Operation* operation = new Operation(true, file, offset, bytes_to_write);
+  memcpy(operation->buffer(), buffer, bytes_to_write);
+  operation->set_write_callback(callback);
+  Queue(operation);
+}
+
+void IOUringFileEngine::OnFileCanReadWithoutBlocking(int fd) {
+  DCHECK_EQ(event_fd_, fd);
+  // Reset the eventfd before reaping, so that completions posted meanwhile
+  // signal it again.
+  uint64 count;
+  if (HANDLE_EINTR(read(event_fd_, &count, sizeof(count))) < 0 &&
+      errno != EAGAIN) {
+    DPLOG(ERROR) << "read";
+  }
+  ReapCompletions();
+}
+
+void IOUringFileEngine::OnFileCanWriteWithoutBlocking(int fd) {
+  NOTREACHED();
+}
+
+bool IOUringFileEngine::Init() {
+  COMPILE_ASSERT(sizeof(SubmissionEntry) == 64, submission_entry_size);
+  COMPILE_ASSERT(sizeof(CompletionEntry) == 16, completion_entry_size);
+  COMPILE_ASSERT(sizeof(RingParams) == 120, ring_params_size);
+
+  RingParams params;
+  memset(&params, 0, sizeof(params));
+  ring_fd_ = IOUringSetup(kQueueDepth, &params);
+  if (ring_fd_ < 0) {
+    DPLOG(WARNING) << "io_uring_setup";
+    return false;
+  }
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(CompletionEntry);
+  bool single_mmap = (params.features & kFeatureSingleMmap) != 0;
+  if (single_mmap) {
+    sq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+    cq_ring_size_ = sq_ring_size_;
+  }
+  sq_ring_ = MapRing(ring_fd_, sq_ring_size_, kSubmissionRingOffset);
+  if (!sq_ring_)
+    return false;
+  cq_ring_ = single_mmap ?
+      sq_ring_ : MapRing(ring_fd_, cq_ring_size_, kCompletionRingOffset);
+  if (!cq_ring_)
+    return false;
+  sqes_size_ = params.sq_entries * sizeof(SubmissionEntry);
+  sqes_ = static_cast<SubmissionEntry*>(
+      MapRing(ring_fd_, sqes_size_, kSubmissionEntriesOffset));
+  if (!sqes_)
+    return false;
+
+  char* sq = static_cast<char*>(sq_ring_);
+  sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+  sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+  sq_entries_ = params.sq_entries;
+  sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+  char* cq = static_cast<char*>(cq_ring_);
+  cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+  cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+  cq_entries_ = params.cq_entries;
+  cqes_ = reinterpret_cast<CompletionEntry*>(cq + params.cq_off.cqes);
+
+  event_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (event_fd_ < 0) {
+    DPLOG(ERROR) << "eventfd";
+    return false;
+  }
+  if (IOUringRegisterEventFd(ring_fd_, event_fd_) < 0) {
+    DPLOG(WARNING) << "io_uring_register";
+    return false;
+  }
+
+  if (!thread_.StartWithOptions(Thread::Options(MessageLoop::TYPE_IO, 0)))
+    return false;
+  thread_.message_loop()->PostTask(
+      FROM_HERE,
+      Bind(&IOUringFileEngine::StartWatching, Unretained(this)));
+  return true;
+}
+
+void IOUringFileEngine::Queue(Operation* operation) {
+  if (operation->length() == 0) {
+    // Nothing to transfer; reply as ReadPlatformFile() would.
+    operation->OnResult(0);
+    scoped_refptr<MessageLoopProxy> origin_loop = operation->origin_loop();
+    origin_loop->PostTask(FROM_HERE,
+                          Bind(&Operation::Reply, Owned(operation)));
+    return;
+  }
+
+  bool post_submit;
+  {
+    AutoLock lock(lock_);
+    queued_.push_back(operation);
+    post_submit = !submit_posted_;
+    submit_posted_ = true;
+  }
+  if (post_submit) {
+    thread_.message_loop()->PostTask(
+        FROM_HERE, Bind(&IOUringFileEngine::Submit, Unretained(this)));
+  }
+}
+
+void IOUringFileEngine::StartWatching() {
+  if (!MessageLoopForIO::current()->WatchFileDescriptor(
+          event_fd_, true, MessageLoopForIO::WATCH_READ,
+          &event_fd_controller_, this)) {
+    NOTREACHED() << "Unable to watch the io_uring eventfd";
+  }
+}
+
+void IOUringFileEngine::Submit() {
+  std::vector<Operation*> queued;
+  {
+    AutoLock lock(lock_);
+    queued.swap(queued_);
+    submit_posted_ = false;
+  }
+  backlog_.insert(backlog_.end(), queued.begin(), queued.end());
+  SubmitBacklog();
+}
+
+void IOUringFileEngine::SubmitBacklog() {
+  if (has_failed()) {
+    FailUnsubmitted();
+    return;
+  }
+
+  unsigned tail = *sq_tail_;
+  unsigned head = LoadAcquire(sq_head_);
+  while (!backlog_.empty() && tail - head < sq_entries_ &&
+         in_flight_ < cq_entries_) {
+    unsigned index = tail & sq_mask_;
+    backlog_.front()->Prepare(&sqes_[index]);
+    backlog_.pop_front();
+    sq_array_[index] = index;
+    ++tail;
+    ++in_flight_;
+  }
+  StoreRelease(sq_tail_, tail);
+
+  unsigned to_submit = tail - LoadAcquire(sq_head_);
+  if (to_submit == 0)
+    return;
+  int submitted = HANDLE_EINTR(IOUringEnter(ring_fd_, to_submit));
+  if (submitted < 0 && errno != EAGAIN && errno != EBUSY) {
+    DPLOG(ERROR) << "io_uring_enter";
+    FailUnsubmitted();
+    return;
+  }
+  if (submitted > 0)
+    retry_delay_ms_ = kMinSubmitRetryDelayMs;
+  if (submitted < static_cast<int>(to_submit) && !retry_posted_) {
+    // The rest stays on the ring.  Completions call back here, but there may
+    // be none to come, so try again after a while.
+    retry_posted_ = true;
+    MessageLoop::current()->PostDelayedTask(
+        FROM_HERE,
+        Bind(&IOUringFileEngine::RetrySubmitBacklog, Unretained(this)),
+        TimeDelta::FromMilliseconds(retry_delay_ms_));
+    retry_delay_ms_ = std::min(retry_delay_ms_ * 2, kMaxSubmitRetryDelayMs);
+  }
+}
+
+void IOUringFileEngine::RetrySubmitBacklog() {
+  retry_posted_ = false;
+  SubmitBacklog();
+}
+
+void IOUringFileEngine::FailUnsubmitted() {
+  subtle::Release_Store(&failed_, 1);
+
+  // The kernel did not consume the entries past the head of the submission
+  // ring, so they can be taken back, last first to keep them in order.
+  unsigned head = LoadAcquire(sq_head_);
+  unsigned tail = *sq_tail_;
+  for (; tail != head; --tail) {
+    const SubmissionEntry& sqe = sqes_[sq_array_[(tail - 1) & sq_mask_]];
+    backlog_.push_front(reinterpret_cast<Operation*>(sqe.user_data));
+    --in_flight_;
+  }
+  StoreRelease(sq_tail_, tail);
+
+  while (!backlog_.empty()) {
+    Operation* operation = backlog_.front();
+    backlog_.pop_front();
+    operation->Fail();
+    Finish(operation);
+  }
+}
+
+void IOUringFileEngine::Finish(Operation* operation) {
+  if (!operation->has_callback()) {
+    delete operation;
+    return;
+  }
+  scoped_refptr<MessageLoopProxy> origin_loop = operation->origin_loop();
+  origin_loop->PostTask(FROM_HERE, Bind(&Operation::Reply, Owned(operation)));
+}
+
+void IOUringFileEngine::ReapCompletions() {
+  unsigned head = *cq_head_;
+  unsigned tail = LoadAcquire(cq_tail_);
+  for (; head != tail; ++head) {
+    const CompletionEntry& cqe = cqes_[head & cq_mask_];
+    Operation* operation = reinterpret_cast<Operation*>(cqe.user_data);
+    --in_flight_;
+    if (!operation->OnResult(cqe.res)) {
+      backlog_.push_back(operation);
+      continue;
+    }
+    Finish(operation);
+  }
+  StoreRelease(cq_head_, head);
+  SubmitBacklog();
+}
+
+}  // namespace base
@@ -0,0 +1,189 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_IO_URING_FILE_ENGINE_H_
+#define BASE_IO_URING_FILE_ENGINE_H_
+#pragma once
+
+#include <deque>
+#include <vector>
+
+#include "base/atomicops.h"
+#include "base/basictypes.h"
+#include "base/compiler_specific.h"
+#include "base/file_util_proxy.h"
+#include "base/gtest_prod_util.h"
+#include "base/message_loop.h"
+#include "base/platform_file.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/thread.h"
+
+namespace base {
+
+// Runs FileUtilProxy reads and writes through a Linux io_uring instead of
+// blocking a worker thread on each of them.
+//
+// Read() and Write() may be called on any thread that has a MessageLoop.  They
+// queue the operation and, for the first one queued since the last
+// submission, post a task to the engine's thread, which puts everything queued
+// so far on the submission ring and hands it to the kernel with a single
+// io_uring_enter().  The ring signals completions on an eventfd that the
+// engine thread watches; it reaps them and posts each callback back to the
+// loop of the thread that started the operation.  Short reads and writes are
+// resubmitted for the rest, so results match ReadPlatformFile() and
+// WritePlatformFile().
+//
+// If the kernel fails a submission with anything but EAGAIN or EBUSY, the
+// engine fails every operation that it has not handed to the kernel yet with
+// PLATFORM_FILE_ERROR_FAILED, and from then on GetInstance() returns NULL so
+// that FileUtilProxy goes back to the worker TaskRunner.
+//
+// Operations that are in flight at the same time may complete in any order,
+// so callers must not start an operation on a file that depends on one that
+// has not called back yet.  This includes closing the file.
+class BASE_EXPORT IOUringFileEngine : public MessageLoopForIO::Watcher {
+ public:
+  // Returns the engine FileUtilProxy uses, or NULL if it was not enabled with
+  // --enable-io-uring-file-io, the kernel does not support io_uring, or the
+  // engine has failed, in which case reads and writes go to the worker
+  // TaskRunner.
+  static IOUringFileEngine* GetInstance();
+
+  // Returns a new engine with its own ring and thread, or NULL if io_uring is
+  // not available.  The engine must not be deleted while operations are in
+  // flight.
+  static IOUringFileEngine* Create();
+
+  virtual ~IOUringFileEngine();
+
+  // Reads up to |bytes_to_read| bytes of |file| at |offset|, as
+  // FileUtilProxy::Read() does.  A null |callback| is allowed.
+  void Read(PlatformFile file,
+            int64 offset,
+            int bytes_to_read,
+            const FileUtilProxy::ReadCallback& callback);
+
+  // Writes |bytes_to_write| bytes of |buffer|, which is copied, to |file| at
+  // |offset|, as FileUtilProxy::Write() does.  A null |callback| is allowed.
+  void Write(PlatformFile file,
+             int64 offset,
+             const char* buffer,
+             int bytes_to_write,
+             const FileUtilProxy::WriteCallback& callback);
+
+  // Returns true once a submission has failed.  Operations started after that
+  // fail too.
+  bool has_failed() const { return subtle::Acquire_Load(&failed_) != 0; }
+
+  // MessageLoopForIO::Watcher methods, for the completion eventfd:
+  virtual void OnFileCanReadWithoutBlocking(int fd) OVERRIDE;
+  virtual void OnFileCanWriteWithoutBlocking(int fd) OVERRIDE;
+
+ private:
+  FRIEND_TEST_ALL_PREFIXES(IOUringFileEngineTest, SubmitFailure);
+
+  class Operation;
+
+  // The kernel's io_uring_sqe and io_uring_cqe.
+  struct SubmissionEntry;
+  struct CompletionEntry;
+
+  IOUringFileEngine();
+
+  // Sets up the ring and starts the engine thread.  Returns true on success.
+  bool Init();
+
+  // Takes |operation| from the calling thread and schedules its submission.
+  void Queue(Operation* operation);
+
+  // Starts watching the completion eventfd.  Runs on the engine thread.
+  void StartWatching();
+
+  // Moves the queued operations to |backlog_| and submits as many of them as
+  // the rings have room for.  Runs on the engine thread.
+  void Submit();
+
+  // Puts the operations at the front of |backlog_| on the submission ring and
+  // calls io_uring_enter() once for all of them.  Entries the kernel refuses
+  // with EAGAIN or EBUSY are submitted again later, waiting longer each time
+  // until a submission goes through.
+  void SubmitBacklog();
+
+  // Runs SubmitBacklog() after the delay that a refused submission posted.
+  void RetrySubmitBacklog();
+
+  // Marks the engine as failed, takes back the entries that the kernel has not
+  // consumed from the submission ring, and fails them and |backlog_|.
+  void FailUnsubmitted();
+
+  // Posts the callback of |operation|, which is done, to its origin loop, or
+  // deletes it if there is none.
+  void Finish(Operation* operation);
+
+  // Reaps the completion ring, resubmitting short transfers and posting the
+  // callbacks of the finished operations.
+  void ReapCompletions();
+
+  int ring_fd_;
+
+  // eventfd that the kernel signals when it posts completions.
+  int event_fd_;
+
+  // The mmap()ed rings and their size.  |cq_ring_| is |sq_ring_| when the
+  // kernel maps both with one mmap().
+  void* sq_ring_;
+  size_t sq_ring_size_;
+  void* cq_ring_;
+  size_t cq_ring_size_;
+  SubmissionEntry* sqes_;
+  size_t sqes_size_;
+
+  // Pointers into the rings.
+  unsigned* sq_head_;
+  unsigned* sq_tail_;
+  unsigned sq_mask_;
+  unsigned sq_entries_;
+  unsigned* sq_array_;
+  unsigned* cq_head_;
+  unsigned* cq_tail_;
+  unsigned cq_mask_;
+  unsigned cq_entries_;
+  CompletionEntry* cqes_;
+
+  // Protects |queued_| and |submit_posted_|.
+  Lock lock_;
+
+  // Operations started since the last Submit().
+  std::vector<Operation*> queued_;
+
+  // Set while a Submit() task is posted to |thread_|.
+  bool submit_posted_;
+
+  // Set, never to be cleared, when a submission fails.
+  volatile subtle::Atomic32 failed_;
+
+  // The remaining members are only used on |thread_|.
+
+  // Operations waiting for room on the rings.
+  std::deque<Operation*> backlog_;
+
+  // Operations handed to the kernel that have not completed.  Kept below
+  // |cq_entries_| so that the completion ring cannot overflow.
+  unsigned in_flight_;
+
+  // Set while a RetrySubmitBacklog() task is posted, and the delay of the
+  // next one.
+  bool retry_posted_;
+  int retry_delay_ms_;
+
+  MessageLoopForIO::FileDescriptorWatcher event_fd_controller_;
+
+  Thread thread_;
+
+  DISALLOW_COPY_AND_ASSIGN(IOUringFileEngine);
+};
+
+}  // namespace base
+
+#endif  // BASE_IO_URING_FILE_ENGINE_H_
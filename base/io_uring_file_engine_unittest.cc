@@ -0,0 +1,210 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/io_uring_file_engine.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "base/bind.h"
+#include "base/eintr_wrapper.h"
+#include "base/file_util.h"
+#include "base/logging.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/message_loop.h"
+#include "base/platform_file.h"
+#include "base/scoped_temp_dir.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+class IOUringFileEngineTest : public testing::Test {
+ public:
+  IOUringFileEngineTest()
+      : file_(kInvalidPlatformFileValue),
+        pending_(0),
+        error_(PLATFORM_FILE_OK),
+        bytes_(-1) {
+  }
+
+  virtual void SetUp() OVERRIDE {
+    ASSERT_TRUE(dir_.CreateUniqueTempDir());
+    engine_.reset(IOUringFileEngine::Create());
+    if (!engine_.get())
+      LOG(WARNING) << "io_uring is not supported, skipping test";
+  }
+
+  virtual void TearDown() OVERRIDE {
+    if (file_ != kInvalidPlatformFileValue)
+      ClosePlatformFile(file_);
+  }
+
+  void OpenTestFile() {
+    file_ = CreatePlatformFile(
+        dir_.path().AppendASCII("test"),
+        PLATFORM_FILE_CREATE_ALWAYS | PLATFORM_FILE_READ |
+            PLATFORM_FILE_WRITE,
+        NULL, NULL);
+    ASSERT_NE(kInvalidPlatformFileValue, file_);
+  }
+
+  void DidRead(PlatformFileError error, const char* data, int bytes_read) {
+    error_ = error;
+    bytes_ = bytes_read;
+    if (bytes_read > 0)
+      data_.assign(data, bytes_read);
+    Done();
+  }
+
+  void DidWrite(PlatformFileError error, int bytes_written) {
+    error_ = error;
+    bytes_ = bytes_written;
+    Done();
+  }
+
+  // Checks that a one byte read returned |expected|.
+  void DidReadOne(char expected,
+                  PlatformFileError error,
+                  const char* data,
+                  int bytes_read) {
+    EXPECT_EQ(PLATFORM_FILE_OK, error);
+    EXPECT_EQ(1, bytes_read);
+    if (bytes_read == 1)
+      EXPECT_EQ(expected, data[0]);
+    Done();
+  }
+
+  // Runs the loop until |pending_| callbacks have run.
+  void Wait(int callbacks) {
+    pending_ = callbacks;
+    loop_.Run();
+  }
+
+ protected:
+  void Done() {
+    if (--pending_ == 0)
+      MessageLoop::current()->Quit();
+  }
+
+  MessageLoop loop_;
+  ScopedTempDir dir_;
+  scoped_ptr<IOUringFileEngine> engine_;
+  PlatformFile file_;
+  int pending_;
+  PlatformFileError error_;
+  int bytes_;
+  std::string data_;
+};
+
+}  // namespace
+
+TEST_F(IOUringFileEngineTest, WriteThenRead) {
+  if (!engine_.get())
+    return;
+  OpenTestFile();
+  const char kData[] = "0123456789";
+  engine_->Write(file_, 0, kData, 10,
+                 Bind(&IOUringFileEngineTest::DidWrite, Unretained(this)));
+  Wait(1);
+  EXPECT_EQ(PLATFORM_FILE_OK, error_);
+  EXPECT_EQ(10, bytes_);
+
+  engine_->Read(file_, 3, 5,
+                Bind(&IOUringFileEngineTest::DidRead, Unretained(this)));
+  Wait(1);
+  EXPECT_EQ(PLATFORM_FILE_OK, error_);
+  EXPECT_EQ(5, bytes_);
+  EXPECT_EQ("34567", data_);
+}
+
+// Reads stop at the end of the file, as ReadPlatformFile() does.
+TEST_F(IOUringFileEngineTest, ReadPastEnd) {
+  if (!engine_.get())
+    return;
+  OpenTestFile();
+  ASSERT_EQ(4, WritePlatformFile(file_, 0, "abcd", 4));
+
+  engine_->Read(file_, 2, 100,
+                Bind(&IOUringFileEngineTest::DidRead, Unretained(this)));
+  Wait(1);
+  EXPECT_EQ(PLATFORM_FILE_OK, error_);
+  EXPECT_EQ(2, bytes_);
+  EXPECT_EQ("cd", data_);
+
+  engine_->Read(file_, 10, 100,
+                Bind(&IOUringFileEngineTest::DidRead, Unretained(this)));
+  Wait(1);
+  EXPECT_EQ(PLATFORM_FILE_OK, error_);
+  EXPECT_EQ(0, bytes_);
+
+  engine_->Read(file_, 0, 0,
+                Bind(&IOUringFileEngineTest::DidRead, Unretained(this)));
+  Wait(1);
+  EXPECT_EQ(PLATFORM_FILE_OK, error_);
+  EXPECT_EQ(0, bytes_);
+}
+
+TEST_F(IOUringFileEngineTest, ReadInvalidFile) {
+  if (!engine_.get())
+    return;
+  engine_->Read(kInvalidPlatformFileValue, 0, 10,
+                Bind(&IOUringFileEngineTest::DidRead, Unretained(this)));
+  Wait(1);
+  EXPECT_EQ(PLATFORM_FILE_ERROR_FAILED, error_);
+  EXPECT_EQ(-1, bytes_);
+}
+
+// Reads queued faster than the rings can take them wait their turn.
+TEST_F(IOUringFileEngineTest, MoreReadsThanRingEntries) {
+  if (!engine_.get())
+    return;
+  OpenTestFile();
+  const int kReads = 2000;
+  std::string contents;
+  for (int i = 0; i < kReads; ++i)
+    contents.push_back('a' + i % 26);
+  ASSERT_EQ(kReads,
+            WritePlatformFile(file_, 0, contents.data(), contents.size()));
+
+  for (int i = 0; i < kReads; ++i) {
+    engine_->Read(file_, i, 1,
+                  Bind(&IOUringFileEngineTest::DidReadOne, Unretained(this),
+                       contents[i]));
+  }
+  Wait(kReads);
+}
+
+// Operations fail, rather than being retried forever, once the kernel fails a
+// submission with a hard error.
+TEST_F(IOUringFileEngineTest, SubmitFailure) {
+  if (!engine_.get())
+    return;
+  OpenTestFile();
+  ASSERT_EQ(4, WritePlatformFile(file_, 0, "abcd", 4));
+
+  // io_uring_enter() fails on a descriptor that is not a ring.
+  int null_fd = HANDLE_EINTR(open("/dev/null", O_RDONLY));
+  ASSERT_GE(null_fd, 0);
+  ASSERT_EQ(engine_->ring_fd_, dup2(null_fd, engine_->ring_fd_));
+  ASSERT_EQ(0, HANDLE_EINTR(close(null_fd)));
+
+  engine_->Read(file_, 0, 4,
+                Bind(&IOUringFileEngineTest::DidRead, Unretained(this)));
+  Wait(1);
+  EXPECT_EQ(PLATFORM_FILE_ERROR_FAILED, error_);
+  EXPECT_EQ(-1, bytes_);
+  EXPECT_TRUE(engine_->has_failed());
+
+  engine_->Write(file_, 0, "wxyz", 4,
+                 Bind(&IOUringFileEngineTest::DidWrite, Unretained(this)));
+  Wait(1);
+  EXPECT_EQ(PLATFORM_FILE_ERROR_FAILED, error_);
+  EXPECT_EQ(-1, bytes_);
+}
+
+}  // namespace base
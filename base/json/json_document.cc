@@ -0,0 +1,221 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/json/json_document.h"
+
+#include <algorithm>
+
+#include "base/json/json_parser.h"
+#include "base/logging.h"
+
+namespace base {
+
+namespace {
+
+// The sizes of arena blocks grow from the first to the largest size, so that
+// small documents stay small and large ones need few blocks.
+const size_t kFirstBlockSize = 4 * 1024;
+const size_t kLargestBlockSize = 1024 * 1024;
+
+// Allocations are aligned for doubles and pointers.
+const size_t kAlignment = 8;
+
+const internal::JSONNode kNullNode = { Value::TYPE_NULL, 0, { false } };
+
+// Compares a dictionary member with a key, for binary searches.
+bool MemberKeyLess(const internal::JSONMember& member,
+                   const StringPiece& key) {
+  return StringPiece(member.key_data, member.key_length) < key;
+}
+
+}  // namespace
+
+// JSONView ////////////////////////////////////////////////////////////////////
+
+JSONView::JSONView() : node_(&kNullNode) {
+}
+
+JSONView::JSONView(const internal::JSONNode* node) : node_(node) {
+}
+
+bool JSONView::GetAsBoolean(bool* out_value) const {
+  if (!IsType(Value::TYPE_BOOLEAN))
+    return false;
+  if (out_value)
+    *out_value = node_->boolean_value;
+  return true;
+}
+
+bool JSONView::GetAsInteger(int* out_value) const {
+  if (!IsType(Value::TYPE_INTEGER))
+    return false;
+  if (out_value)
+    *out_value = node_->integer_value;
+  return true;
+}
+
+bool JSONView::GetAsDouble(double* out_value) const {
+  if (IsType(Value::TYPE_INTEGER)) {
+    if (out_value)
+      *out_value = node_->integer_value;
+    return true;
+  }
+  if (!IsType(Value::TYPE_DOUBLE))
+    return false;
+  if (out_value)
+    *out_value = node_->double_value;
+  return true;
+}
+
+bool JSONView::GetAsString(StringPiece* out_value) const {
+  if (!IsType(Value::TYPE_STRING))
+    return false;
+  if (out_value)
+    out_value->set(node_->string_data, node_->size);
+  return true;
+}
+
+bool JSONView::GetAsString(std::string* out_value) const {
+  if (!IsType(Value::TYPE_STRING))
+    return false;
+  if (out_value)
+    out_value->assign(node_->string_data, node_->size);
+  return true;
+}
+
+size_t JSONView::GetSize() const {
+  if (!IsType(Value::TYPE_LIST) && !IsType(Value::TYPE_DICTIONARY))
+    return 0;
+  return node_->size;
+}
+
+bool JSONView::Get(size_t index, JSONView* out_value) const {
+  if (!IsType(Value::TYPE_LIST) || index >= node_->size)
+    return false;
+  if (out_value)
+    *out_value = JSONView(&node_->list_items[index]);
+  return true;
+}
+
+bool JSONView::GetWithoutPathExpansion(const StringPiece& key,
+                                       JSONView* out_value) const {
+  if (!IsType(Value::TYPE_DICTIONARY))
+    return false;
+  const internal::JSONMember* end =
+      node_->dictionary_members + node_->size;
+  const internal::JSONMember* member = std::lower_bound(
+      node_->dictionary_members, end, key, MemberKeyLess);
+  if (member == end || StringPiece(member->key_data, member->key_length) != key)
+    return false;
+  if (out_value)
+    *out_value = JSONView(&member->value);
+  return true;
+}
+
+bool JSONView::GetMember(size_t index,
+                         StringPiece* out_key,
+                         JSONView* out_value) const {
+  if (!IsType(Value::TYPE_DICTIONARY) || index >= node_->size)
+    return false;
+  const internal::JSONMember& member = node_->dictionary_members[index];
+  if (out_key)
+    out_key->set(member.key_data, member.key_length);
+  if (out_value)
+    *out_value = JSONView(&member.value);
+  return true;
+}
+
+Value* JSONView::CreateValue() const {
+  switch (GetType()) {
+    case Value::TYPE_NULL:
+      return Value::CreateNullValue();
+    case Value::TYPE_BOOLEAN:
+      return Value::CreateBooleanValue(node_->boolean_value);
+    case Value::TYPE_INTEGER:
+      return Value::CreateIntegerValue(node_->integer_value);
+    case Value::TYPE_DOUBLE:
+      return Value::CreateDoubleValue(node_->double_value);
+    case Value::TYPE_STRING:
+      return Value::CreateStringValue(
+          std::string(node_->string_data, node_->size));
+    case Value::TYPE_LIST: {
+      ListValue* list = new ListValue;
+      for (size_t i = 0; i < node_->size; ++i)
+        list->Append(JSONView(&node_->list_items[i]).CreateValue());
+      return list;
+    }
+    case Value::TYPE_DICTIONARY: {
+      DictionaryValue* dictionary = new DictionaryValue;
+      for (size_t i = 0; i < node_->size; ++i) {
+        const internal::JSONMember& member = node_->dictionary_members[i];
+        dictionary->SetWithoutPathExpansion(
+            std::string(member.key_data, member.key_length),
+            JSONView(&member.value).CreateValue());
+      }
+      return dictionary;
+    }
+    default:
+      NOTREACHED();
+      return NULL;
+  }
+}
+
+// JSONDocument ////////////////////////////////////////////////////////////////
+
+JSONDocument::JSONDocument()
+    : free_(NULL),
+      free_size_(0),
+      arena_size_(0),
+      root_(kNullNode) {
+}
+
+JSONDocument::~JSONDocument() {
+  Clear();
+}
+
+bool JSONDocument::Parse(const StringPiece& json,
+                         int options,
+                         int* error_code_out,
+                         std::string* error_msg_out) {
+  Clear();
+  internal::JSONParser parser(options);
+  if (parser.ParseToDocument(json, this))
+    return true;
+
+  Clear();
+  if (error_code_out)
+    *error_code_out = parser.error_code();
+  if (error_msg_out)
+    *error_msg_out = parser.GetErrorMessage();
+  return false;
+}
+
+void* JSONDocument::Allocate(size_t size) {
+  size = (size + kAlignment - 1) & ~(kAlignment - 1);
+  if (size > free_size_) {
+    size_t block_size = blocks_.empty() ? kFirstBlockSize :
+        std::min(2 * arena_size_, kLargestBlockSize);
+    block_size = std::max(block_size, size);
+    free_ = new char[block_size];
+    free_size_ = block_size;
+    arena_size_ += block_size;
+    blocks_.push_back(free_);
+  }
+  void* memory = free_;
+  free_ += size;
+  free_size_ -= size;
+  return memory;
+}
+
+void JSONDocument::Clear() {
+  for (size_t i = 0; i < blocks_.size(); ++i)
+    delete[] blocks_[i];
+  blocks_.clear();
+  free_ = NULL;
+  free_size_ = 0;
+  arena_size_ = 0;
+  root_ = kNullNode;
+}
+
+}  // namespace base
@@ -0,0 +1,164 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// JSONDocument parses JSON without building a tree of Values.  All of the
+// nodes of a document are placed in a single arena that the document owns,
+// and strings that need no unescaping are kept as StringPieces into the
+// input, so parsing performs a handful of allocations however large the
+// input is.  The parsed values are read through JSONView, a read-only
+// counterpart of the Value getters.
+//
+// Usage:
+//   std::string json = ...;  // Must outlive |document|.
+//   JSONDocument document;
+//   if (!document.Parse(json, JSON_PARSE_RFC, NULL, NULL))
+//     return;
+//   JSONView name;
+//   StringPiece name_string;
+//   if (document.root().GetWithoutPathExpansion("name", &name) &&
+//       name.GetAsString(&name_string)) {
+//     ...
+//   }
+//
+// Use JSONReader instead for values that are modified or kept apart from the
+// input.
+
+#ifndef BASE_JSON_JSON_DOCUMENT_H_
+#define BASE_JSON_JSON_DOCUMENT_H_
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/string_piece.h"
+#include "base/values.h"
+
+namespace base {
+
+namespace internal {
+
+class JSONParser;
+struct JSONMember;
+
+// A value in the arena of a JSONDocument.  Nodes are plain data, so that
+// they can be copied into the arena and need no destruction.
+struct JSONNode {
+  Value::Type type;
+  // The length of a string, or the number of items of a list or members of
+  // a dictionary.  The parser only accepts inputs whose size fits in an int.
+  uint32 size;
+  union {
+    bool boolean_value;
+    int integer_value;
+    double double_value;
+    const char* string_data;
+    const JSONNode* list_items;
+    // Sorted by key, without duplicate keys.
+    const JSONMember* dictionary_members;
+  };
+};
+
+// A key and value of a dictionary in the arena of a JSONDocument.
+struct JSONMember {
+  JSONNode value;
+  const char* key_data;
+  uint32 key_length;
+};
+
+}  // namespace internal
+
+// A read-only view of a value of a JSONDocument.  Views are small, are passed
+// by value, and stay valid as long as the document and its input.  The
+// getters behave like those of Value, ListValue and DictionaryValue.  A
+// default constructed view is a view of a null value.
+class BASE_EXPORT JSONView {
+ public:
+  JSONView();
+  explicit JSONView(const internal::JSONNode* node);
+
+  Value::Type GetType() const { return node_->type; }
+  bool IsType(Value::Type type) const { return node_->type == type; }
+
+  bool GetAsBoolean(bool* out_value) const;
+  bool GetAsInteger(int* out_value) const;
+  // Integers are converted to doubles, as Value::GetAsDouble() does.
+  bool GetAsDouble(double* out_value) const;
+  // The string is a piece of the input unless it had escape sequences.
+  bool GetAsString(StringPiece* out_value) const;
+  bool GetAsString(std::string* out_value) const;
+
+  // Returns the number of items of a list or members of a dictionary, and 0
+  // for other types.
+  size_t GetSize() const;
+
+  // Gets the list item at |index|.  Returns false if this is not a list, or
+  // |index| is out of range.
+  bool Get(size_t index, JSONView* out_value) const;
+
+  // Gets the dictionary member with the key |key|, with a binary search.
+  // When the input had the same key more than once, the last member with it
+  // is kept, as DictionaryValue does.  Returns false if this is not a
+  // dictionary, or it has no such member.
+  bool GetWithoutPathExpansion(const StringPiece& key,
+                               JSONView* out_value) const;
+
+  // Gets the dictionary member at |index|, in the order of keys in which a
+  // DictionaryValue iterates.  Returns false if this is not a dictionary, or
+  // |index| is out of range.
+  bool GetMember(size_t index, StringPiece* out_key, JSONView* out_value) const;
+
+  // Returns a deep copy of the value as a Value tree, which the caller owns.
+  Value* CreateValue() const;
+
+ private:
+  const internal::JSONNode* node_;
+};
+
+// The result of parsing JSON into an arena.  Not thread safe.
+class BASE_EXPORT JSONDocument {
+ public:
+  JSONDocument();
+  ~JSONDocument();
+
+  // Parses |json| with the JSONParserOptions |options|, replacing the
+  // previous contents of the document.  |json| must outlive the document's
+  // views.  On failure, returns false and sets the optional |error_code_out|
+  // and |error_msg_out| as JSONReader::ReadAndReturnError() does.
+  bool Parse(const StringPiece& json,
+             int options,
+             int* error_code_out,
+             std::string* error_msg_out);
+
+  // A view of the root value; a null value until Parse() succeeds.
+  JSONView root() const { return JSONView(&root_); }
+
+  // The number of bytes allocated for the arena.
+  size_t arena_size() const { return arena_size_; }
+
+ private:
+  friend class internal::JSONParser;
+
+  // Returns |size| bytes that live as long as the contents of the document,
+  // aligned for any of the node types.
+  void* Allocate(size_t size);
+
+  // Frees the arena and resets the root to a null value.
+  void Clear();
+
+  // The blocks of the arena, and the unused part of the last one.
+  std::vector<char*> blocks_;
+  char* free_;
+  size_t free_size_;
+  size_t arena_size_;
+
+  internal::JSONNode root_;
+
+  DISALLOW_COPY_AND_ASSIGN(JSONDocument);
+};
+
+}  // namespace base
+
+#endif  // BASE_JSON_JSON_DOCUMENT_H_
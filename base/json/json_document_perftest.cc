@@ -0,0 +1,69 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/json/json_document.h"
+
+#include "base/json/json_reader.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/perftimer.h"
+#include "base/stringprintf.h"
+#include "base/values.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+// Returns about |size| bytes of JSON shaped like preferences and extension
+// manifests: a dictionary of dictionaries with strings, some of them escaped,
+// numbers, booleans and short lists.
+std::string MakeInput(size_t size) {
+  std::string json("{");
+  for (int i = 0; json.size() < size; ++i) {
+    if (i > 0)
+      json += ",";
+    StringAppendF(&json,
+        "\"entry%d\": {\"name\": \"Entry number %d\", \"id\": %d,"
+        " \"ratio\": %d.25, \"enabled\": %s, \"path\": \"C:\\\\dir\\\\%d\","
+        " \"tags\": [\"alpha\", \"beta\", \"gamma\"], \"empty\": null,"
+        " \"nested\": {\"x\": %d, \"y\": [1, 2, 3]}}",
+        i, i, i, i % 100, i % 2 ? "true" : "false", i, i);
+  }
+  json += "}";
+  return json;
+}
+
+void ParseInput(size_t size, const char* name) {
+  std::string json = MakeInput(size);
+
+  PerfTimer reader_timer;
+  scoped_ptr<Value> value(JSONReader::Read(json));
+  LogPerfResult(StringPrintf("JSONReader_Read_%s", name).c_str(),
+                reader_timer.Elapsed().InMillisecondsF(), "ms");
+  ASSERT_TRUE(value.get());
+
+  JSONDocument document;
+  PerfTimer document_timer;
+  ASSERT_TRUE(document.Parse(json, JSON_PARSE_RFC, NULL, NULL));
+  LogPerfResult(StringPrintf("JSONDocument_Parse_%s", name).c_str(),
+                document_timer.Elapsed().InMillisecondsF(), "ms");
+  LogPerfResult(StringPrintf("JSONDocument_Arena_%s", name).c_str(),
+                document.arena_size() / 1024, "kb");
+
+  DictionaryValue* dictionary = NULL;
+  ASSERT_TRUE(value->GetAsDictionary(&dictionary));
+  EXPECT_EQ(dictionary->size(), document.root().GetSize());
+}
+
+}  // namespace
+
+TEST(JSONDocumentPerfTest, Parse1MB) {
+  ParseInput(1024 * 1024, "1MB");
+}
+
+TEST(JSONDocumentPerfTest, Parse50MB) {
+  ParseInput(50 * 1024 * 1024, "50MB");
+}
+
+}  // namespace base
@@ -0,0 +1,180 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/json/json_document.h"
+
+#include "base/json/json_reader.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/values.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+// Returns true if |piece| points into |input|.
+bool PointsInto(const StringPiece& piece, const std::string& input) {
+  return piece.data() >= input.data() &&
+         piece.data() + piece.size() <= input.data() + input.size();
+}
+
+}  // namespace
+
+TEST(JSONDocumentTest, Views) {
+  std::string input(
+      "{\"number\": 42, \"double\": -1.5e3, \"list\": [true, false, null],"
+      " \"string\": \"plain\", \"escaped\": \"tab\\tand \\u00e9\","
+      " \"nested\": {\"b\": 2, \"a\": {}}}");
+  JSONDocument document;
+  ASSERT_TRUE(document.Parse(input, JSON_PARSE_RFC, NULL, NULL));
+  JSONView root = document.root();
+  ASSERT_TRUE(root.IsType(Value::TYPE_DICTIONARY));
+  EXPECT_EQ(6u, root.GetSize());
+
+  JSONView view;
+  int integer = 0;
+  double real = 0;
+  EXPECT_TRUE(root.GetWithoutPathExpansion("number", &view));
+  EXPECT_TRUE(view.GetAsInteger(&integer));
+  EXPECT_EQ(42, integer);
+  EXPECT_TRUE(view.GetAsDouble(&real));
+  EXPECT_EQ(42.0, real);
+  EXPECT_TRUE(root.GetWithoutPathExpansion("double", &view));
+  EXPECT_FALSE(view.GetAsInteger(&integer));
+  EXPECT_TRUE(view.GetAsDouble(&real));
+  EXPECT_EQ(-1500.0, real);
+
+  bool boolean = false;
+  EXPECT_TRUE(root.GetWithoutPathExpansion("list", &view));
+  EXPECT_EQ(3u, view.GetSize());
+  JSONView item;
+  EXPECT_TRUE(view.Get(0, &item));
+  EXPECT_TRUE(item.GetAsBoolean(&boolean));
+  EXPECT_TRUE(boolean);
+  EXPECT_TRUE(view.Get(1, &item));
+  EXPECT_TRUE(item.GetAsBoolean(&boolean));
+  EXPECT_FALSE(boolean);
+  EXPECT_TRUE(view.Get(2, &item));
+  EXPECT_TRUE(item.IsType(Value::TYPE_NULL));
+  EXPECT_FALSE(view.Get(3, &item));
+  EXPECT_FALSE(view.GetWithoutPathExpansion("0", &item));
+
+  // Strings without escapes are pieces of the input; others are copies.
+  StringPiece string;
+  EXPECT_TRUE(root.GetWithoutPathExpansion("string", &view));
+  EXPECT_TRUE(view.GetAsString(&string));
+  EXPECT_EQ("plain", string);
+  EXPECT_TRUE(PointsInto(string, input));
+  EXPECT_TRUE(root.GetWithoutPathExpansion("escaped", &view));
+  EXPECT_TRUE(view.GetAsString(&string));
+  EXPECT_EQ("tab\tand \xC3\xA9", string);
+  EXPECT_FALSE(PointsInto(string, input));
+
+  // Members are in key order.
+  EXPECT_TRUE(root.GetWithoutPathExpansion("nested", &view));
+  StringPiece key;
+  EXPECT_TRUE(view.GetMember(0, &key, &item));
+  EXPECT_EQ("a", key);
+  EXPECT_TRUE(item.IsType(Value::TYPE_DICTIONARY));
+  EXPECT_EQ(0u, item.GetSize());
+  EXPECT_TRUE(view.GetMember(1, &key, &item));
+  EXPECT_EQ("b", key);
+  EXPECT_FALSE(view.GetMember(2, &key, &item));
+  EXPECT_FALSE(root.GetWithoutPathExpansion("missing", &view));
+  EXPECT_FALSE(root.GetWithoutPathExpansion("nested.b", &view));
+}
+
+TEST(JSONDocumentTest, DuplicateKeys) {
+  JSONDocument document;
+  ASSERT_TRUE(document.Parse("{\"a\": 1, \"b\": 2, \"a\": 3, \"a\": 4}",
+                             JSON_PARSE_RFC, NULL, NULL));
+  EXPECT_EQ(2u, document.root().GetSize());
+  JSONView view;
+  int integer = 0;
+  EXPECT_TRUE(document.root().GetWithoutPathExpansion("a", &view));
+  EXPECT_TRUE(view.GetAsInteger(&integer));
+  EXPECT_EQ(4, integer);
+}
+
+// The document holds the same values as the Value tree that JSONReader reads,
+// and fails on the same inputs with the same errors.
+TEST(JSONDocumentTest, SameAsJSONReader) {
+  const char* inputs[] = {
+    "null",
+    "\"string\"",
+    "-0.25",
+    "[1, 2.5, \"three\", [[]], {\"x\": [false]}]",
+    "\xEF\xBB\xBF{\"bom\": true}",
+    "{\"a\": 1, // comment\n \"c\": {\"d\": \"\\\"quoted\\\"\"}, \"b\": []}",
+    "{\"\\u0041\": \"\\uD834\\uDD1E\", \"A\": 2}",
+    "[1, 2,]",
+    "{\"a\": 1,}",
+    "{a: 1}",
+    "[1 2]",
+    "\"unterminated",
+    "[\"bad escape \\q\"]",
+    "01",
+    "tru",
+    "{} []",
+    "[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[["
+    "[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]"
+    "]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]",
+  };
+  const int kOptions[] = { JSON_PARSE_RFC, JSON_ALLOW_TRAILING_COMMAS };
+  for (size_t i = 0; i < arraysize(inputs); ++i) {
+    for (size_t j = 0; j < arraysize(kOptions); ++j) {
+      int reader_error = 0;
+      std::string reader_message;
+      scoped_ptr<Value> value(JSONReader::ReadAndReturnError(
+          inputs[i], kOptions[j], &reader_error, &reader_message));
+
+      JSONDocument document;
+      int document_error = 0;
+      std::string document_message;
+      bool parsed = document.Parse(inputs[i], kOptions[j], &document_error,
+                                   &document_message);
+      ASSERT_EQ(value.get() != NULL, parsed) << inputs[i];
+      if (parsed) {
+        scoped_ptr<Value> document_value(document.root().CreateValue());
+        EXPECT_TRUE(value->Equals(document_value.get())) << inputs[i];
+      } else {
+        EXPECT_EQ(reader_error, document_error) << inputs[i];
+        EXPECT_EQ(reader_message, document_message) << inputs[i];
+        EXPECT_TRUE(document.root().IsType(Value::TYPE_NULL));
+      }
+    }
+  }
+}
+
+// Large inputs are parsed into a few arena blocks, which a new parse frees.
+TEST(JSONDocumentTest, Arena) {
+  std::string input("[");
+  for (int i = 0; i < 10000; ++i) {
+    if (i > 0)
+      input += ",";
+    input += "{\"id\": 1, \"name\": \"item\", \"tags\": [\"a\", \"b\"]}";
+  }
+  input += "]";
+
+  JSONDocument document;
+  ASSERT_TRUE(document.Parse(input, JSON_PARSE_RFC, NULL, NULL));
+  EXPECT_EQ(10000u, document.root().GetSize());
+  EXPECT_LT(input.size(), document.arena_size());
+  EXPECT_GT(input.size() * 8, document.arena_size());
+
+  JSONView item;
+  JSONView tags;
+  StringPiece tag;
+  ASSERT_TRUE(document.root().Get(9999, &item));
+  ASSERT_TRUE(item.GetWithoutPathExpansion("tags", &tags));
+  ASSERT_TRUE(tags.Get(1, &item));
+  EXPECT_TRUE(item.GetAsString(&tag));
+  EXPECT_EQ("b", tag);
+
+  ASSERT_TRUE(document.Parse("[]", JSON_PARSE_RFC, NULL, NULL));
+  EXPECT_EQ(0u, document.root().GetSize());
+  EXPECT_GT(input.size(), document.arena_size());
+}
+
+}  // namespace base
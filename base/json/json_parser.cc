@@ -4,6 +4,8 @@
 
 #include "base/json/json_parser.h"
 
+#include <algorithm>
+
 #include "base/float_util.h"
 #include "base/logging.h"
 #include "base/memory/scoped_ptr.h"
@@ -186,6 +188,17 @@ class StackMarker {
   DISALLOW_COPY_AND_ASSIGN(StackMarker);
 };
 
+// Orders dictionary members by key, as DictionaryValue does.
+bool MemberLess(const JSONMember& left, const JSONMember& right) {
+  return StringPiece(left.key_data, left.key_length) <
+      StringPiece(right.key_data, right.key_length);
+}
+
+bool MemberKeysEqual(const JSONMember& left, const JSONMember& right) {
+  return StringPiece(left.key_data, left.key_length) ==
+      StringPiece(right.key_data, right.key_length);
+}
+
 }  // namespace
 
 JSONParser::JSONParser(int options)
@@ -199,7 +212,8 @@ JSONParser::JSONParser(int options)
       index_last_line_(0),
       error_code_(JSONReader::JSON_NO_ERROR),
       error_line_(0),
-      error_column_(0) {
+      error_column_(0),
+      document_(NULL) {
 }
 
 JSONParser::~JSONParser() {
@@ -218,28 +232,9 @@ Value* JSONParser::Parse(const StringPiece& input) {
   // be used anywhere.
   if (!(options_ & JSON_DETACHABLE_CHILDREN)) {
     input_copy = input.as_string();
-    start_pos_ = input_copy.data();
+    StartParsing(input_copy.data(), input.length());
   } else {
-    start_pos_ = input.data();
-  }
-  pos_ = start_pos_;
-  end_pos_ = start_pos_ + input.length();
-  index_ = 0;
-  line_number_ = 1;
-  index_last_line_ = 0;
-
-  error_code_ = JSONReader::JSON_NO_ERROR;
-  error_line_ = 0;
-  error_column_ = 0;
-
-  // When the input JSON string starts with a UTF-8 Byte-Order-Mark
-  // <0xEF 0xBB 0xBF>, advance the start position to avoid the
-  // ParseNextToken function mis-treating a Unicode BOM as an invalid
-  // character and returning NULL.
-  if (CanConsume(3) && static_cast<uint8>(*pos_) == 0xEF &&
-      static_cast<uint8>(*(pos_ + 1)) == 0xBB &&
-      static_cast<uint8>(*(pos_ + 2)) == 0xBF) {
-    NextNChars(3);
+    StartParsing(input.data(), input.length());
   }
 
   // Parse the first and any nested tokens.
@@ -248,12 +243,8 @@ Value* JSONParser::Parse(const StringPiece& input) {
     return NULL;
 
   // Make sure the input stream is at an end.
-  if (GetNextToken() != T_END_OF_INPUT) {
-    if (!CanConsume(1) || (NextChar() && GetNextToken() != T_END_OF_INPUT)) {
-      ReportError(JSONReader::JSON_UNEXPECTED_DATA_AFTER_ROOT, 1);
-      return NULL;
-    }
-  }
+  if (!ConsumeEndOfInput())
+    return NULL;
 
   // Dictionaries and lists can contain JSONStringValues, so wrap them in a
   // hidden root.
@@ -274,6 +265,24 @@ Value* JSONParser::Parse(const StringPiece& input) {
   return root.release();
 }
 
+bool JSONParser::ParseToDocument(const StringPiece& input,
+                                 JSONDocument* document) {
+  // The document refers to |input| directly, so unlike Parse(), there is no
+  // copy, and no hidden root to own one.
+  StartParsing(input.data(), input.length());
+  document_ = document;
+
+  JSONNode root;
+  bool result = ParseNodeToken(GetNextToken(), &root) && ConsumeEndOfInput();
+  if (result)
+    document->root_ = root;
+
+  document_ = NULL;
+  node_stack_.clear();
+  member_stack_.clear();
+  return result;
+}
+
 JSONReader::JsonParseError JSONParser::error_code() const {
   return error_code_;
 }
@@ -346,6 +355,39 @@ const std::string& JSONParser::StringBuilder::AsString() {
 
 // JSONParser private //////////////////////////////////////////////////////////
 
+void JSONParser::StartParsing(const char* start, int length) {
+  start_pos_ = start;
+  pos_ = start_pos_;
+  end_pos_ = start_pos_ + length;
+  index_ = 0;
+  line_number_ = 1;
+  index_last_line_ = 0;
+
+  error_code_ = JSONReader::JSON_NO_ERROR;
+  error_line_ = 0;
+  error_column_ = 0;
+
+  // When the input JSON string starts with a UTF-8 Byte-Order-Mark
+  // <0xEF 0xBB 0xBF>, advance the start position to avoid the
+  // ParseNextToken function mis-treating a Unicode BOM as an invalid
+  // character and returning NULL.
+  if (CanConsume(3) && static_cast<uint8>(*pos_) == 0xEF &&
+      static_cast<uint8>(*(pos_ + 1)) == 0xBB &&
+      static_cast<uint8>(*(pos_ + 2)) == 0xBF) {
+    NextNChars(3);
+  }
+}
+
+bool JSONParser::ConsumeEndOfInput() {
+  if (GetNextToken() != T_END_OF_INPUT) {
+    if (!CanConsume(1) || (NextChar() && GetNextToken() != T_END_OF_INPUT)) {
+      ReportError(JSONReader::JSON_UNEXPECTED_DATA_AFTER_ROOT, 1);
+      return false;
+    }
+  }
+  return true;
+}
+
 inline bool JSONParser::CanConsume(int length) {
   return pos_ + length <= end_pos_;
 }
@@ -809,6 +851,17 @@ void JSONParser::DecodeUTF8(const int32& point, StringBuilder* dest) {
 }
 
 Value* JSONParser::ConsumeNumber() {
+  StringPiece num_string;
+  JSONNode node;
+  if (!ReadNumber(&num_string) || !ConvertNumber(num_string, &node))
+    return NULL;
+
+  if (node.type == Value::TYPE_INTEGER)
+    return Value::CreateIntegerValue(node.integer_value);
+  return Value::CreateDoubleValue(node.double_value);
+}
+
+bool JSONParser::ReadNumber(StringPiece* number) {
   const char* num_start = pos_;
   const int start_index = index_;
   int end_index = start_index;
@@ -818,7 +871,7 @@ Value* JSONParser::ConsumeNumber() {
 
   if (!ReadInt(false)) {
     ReportError(JSONReader::JSON_SYNTAX_ERROR, 1);
-    return NULL;
+    return false;
   }
   end_index = index_;
 
@@ -826,12 +879,12 @@ Value* JSONParser::ConsumeNumber() {
   if (*pos_ == '.') {
     if (!CanConsume(1)) {
       ReportError(JSONReader::JSON_SYNTAX_ERROR, 1);
-      return NULL;
+      return false;
     }
     NextChar();
     if (!ReadInt(true)) {
       ReportError(JSONReader::JSON_SYNTAX_ERROR, 1);
-      return NULL;
+      return false;
     }
     end_index = index_;
   }
@@ -843,7 +896,7 @@ Value* JSONParser::ConsumeNumber() {
       NextChar();
     if (!ReadInt(true)) {
       ReportError(JSONReader::JSON_SYNTAX_ERROR, 1);
-      return NULL;
+      return false;
     }
     end_index = index_;
   }
@@ -863,25 +916,14 @@ Value* JSONParser::ConsumeNumber() {
       break;
     default:
       ReportError(JSONReader::JSON_SYNTAX_ERROR, 1);
-      return NULL;
+      return false;
   }
 
   pos_ = exit_pos;
   index_ = exit_index;
 
-  StringPiece num_string(num_start, end_index - start_index);
-
-  int num_int;
-  if (StringToInt(num_string, &num_int))
-    return Value::CreateIntegerValue(num_int);
-
-  double num_double;
-  if (base::StringToDouble(num_string.as_string(), &num_double) &&
-      IsFinite(num_double)) {
-    return Value::CreateDoubleValue(num_double);
-  }
-
-  return NULL;
+  number->set(num_start, end_index - start_index);
+  return true;
 }
 
 bool JSONParser::ReadInt(bool allow_leading_zeros) {
@@ -904,6 +946,19 @@ bool JSONParser::ReadInt(bool allow_leading_zeros) {
 }
 
 Value* JSONParser::ConsumeLiteral() {
+  switch (ConsumeLiteralToken()) {
+    case T_BOOL_TRUE:
+      return Value::CreateBooleanValue(true);
+    case T_BOOL_FALSE:
+      return Value::CreateBooleanValue(false);
+    case T_NULL:
+      return Value::CreateNullValue();
+    default:
+      return NULL;
+  }
+}
+
+JSONParser::Token JSONParser::ConsumeLiteralToken() {
   switch (*pos_) {
     case 't': {
       const char* kTrueLiteral = "true";
@@ -911,10 +966,10 @@ Value* JSONParser::ConsumeLiteral() {
       if (!CanConsume(kTrueLen - 1) ||
           !StringsAreEqual(pos_, kTrueLiteral, kTrueLen)) {
         ReportError(JSONReader::JSON_SYNTAX_ERROR, 1);
-        return NULL;
+        return T_INVALID_TOKEN;
       }
       NextNChars(kTrueLen - 1);
-      return Value::CreateBooleanValue(true);
+      return T_BOOL_TRUE;
     }
     case 'f': {
       const char* kFalseLiteral = "false";
@@ -922,10 +977,10 @@ Value* JSONParser::ConsumeLiteral() {
       if (!CanConsume(kFalseLen - 1) ||
           !StringsAreEqual(pos_, kFalseLiteral, kFalseLen)) {
         ReportError(JSONReader::JSON_SYNTAX_ERROR, 1);
-        return NULL;
+        return T_INVALID_TOKEN;
       }
       NextNChars(kFalseLen - 1);
-      return Value::CreateBooleanValue(false);
+      return T_BOOL_FALSE;
     }
     case 'n': {
       const char* kNullLiteral = "null";
@@ -933,15 +988,230 @@ Value* JSONParser::ConsumeLiteral() {
       if (!CanConsume(kNullLen - 1) ||
           !StringsAreEqual(pos_, kNullLiteral, kNullLen)) {
         ReportError(JSONReader::JSON_SYNTAX_ERROR, 1);
-        return NULL;
+        return T_INVALID_TOKEN;
       }
       NextNChars(kNullLen - 1);
-      return Value::CreateNullValue();
+      return T_NULL;
     }
     default:
       ReportError(JSONReader::JSON_UNEXPECTED_TOKEN, 1);
-      return NULL;
+      return T_INVALID_TOKEN;
+  }
+}
+
+bool JSONParser::ParseNodeToken(Token token, JSONNode* node) {
+  switch (token) {
+    case T_OBJECT_BEGIN:
+      return ConsumeDictionaryNode(node);
+    case T_ARRAY_BEGIN:
+      return ConsumeListNode(node);
+    case T_STRING: {
+      StringBuilder string;
+      if (!ConsumeStringRaw(&string))
+        return false;
+      node->type = Value::TYPE_STRING;
+      StoreString(&string, &node->string_data, &node->size);
+      return true;
+    }
+    case T_NUMBER:
+      return ConsumeNumberNode(node);
+    case T_BOOL_TRUE:
+    case T_BOOL_FALSE:
+    case T_NULL:
+      switch (ConsumeLiteralToken()) {
+        case T_BOOL_TRUE:
+          node->type = Value::TYPE_BOOLEAN;
+          node->boolean_value = true;
+          return true;
+        case T_BOOL_FALSE:
+          node->type = Value::TYPE_BOOLEAN;
+          node->boolean_value = false;
+          return true;
+        case T_NULL:
+          node->type = Value::TYPE_NULL;
+          return true;
+        default:
+          return false;
+      }
+    default:
+      ReportError(JSONReader::JSON_UNEXPECTED_TOKEN, 1);
+      return false;
+  }
+}
+
+bool JSONParser::ConsumeDictionaryNode(JSONNode* node) {
+  if (*pos_ != '{') {
+    ReportError(JSONReader::JSON_UNEXPECTED_TOKEN, 1);
+    return false;
+  }
+
+  StackMarker depth_check(&stack_depth_);
+  if (depth_check.IsTooDeep()) {
+    ReportError(JSONReader::JSON_TOO_MUCH_NESTING, 1);
+    return false;
+  }
+
+  const size_t first_member = member_stack_.size();
+
+  NextChar();
+  Token token = GetNextToken();
+  while (token != T_OBJECT_END) {
+    if (token != T_STRING) {
+      ReportError(JSONReader::JSON_UNQUOTED_DICTIONARY_KEY, 1);
+      return false;
+    }
+
+    // First consume the key.
+    StringBuilder key;
+    if (!ConsumeStringRaw(&key))
+      return false;
+
+    // Read the separator.
+    NextChar();
+    token = GetNextToken();
+    if (token != T_OBJECT_PAIR_SEPARATOR) {
+      ReportError(JSONReader::JSON_SYNTAX_ERROR, 1);
+      return false;
+    }
+
+    // The next token is the value. The members of any dictionaries within it
+    // are pushed and popped before this member is pushed.
+    NextChar();
+    JSONMember member;
+    if (!ParseNodeToken(GetNextToken(), &member.value))
+      return false;
+    StoreString(&key, &member.key_data, &member.key_length);
+    member_stack_.push_back(member);
+
+    NextChar();
+    token = GetNextToken();
+    if (token == T_LIST_SEPARATOR) {
+      NextChar();
+      token = GetNextToken();
+      if (token == T_OBJECT_END && !(options_ & JSON_ALLOW_TRAILING_COMMAS)) {
+        ReportError(JSONReader::JSON_TRAILING_COMMA, 1);
+        return false;
+      }
+    } else if (token != T_OBJECT_END) {
+      ReportError(JSONReader::JSON_SYNTAX_ERROR, 0);
+      return false;
+    }
   }
+
+  // Sort the members by key, and keep the last of members with the same key,
+  // which is the one that DictionaryValue would have kept.
+  std::vector<JSONMember>::iterator begin =
+      member_stack_.begin() + first_member;
+  std::stable_sort(begin, member_stack_.end(), MemberLess);
+  std::vector<JSONMember>::iterator kept = begin;
+  for (std::vector<JSONMember>::iterator it = begin;
+       it != member_stack_.end(); ++it) {
+    if (it + 1 != member_stack_.end() && MemberKeysEqual(*it, *(it + 1)))
+      continue;
+    *kept++ = *it;
+  }
+
+  uint32 size = static_cast<uint32>(kept - begin);
+  JSONMember* members = static_cast<JSONMember*>(
+      document_->Allocate(size * sizeof(JSONMember)));
+  std::copy(begin, kept, members);
+  member_stack_.resize(first_member);
+
+  node->type = Value::TYPE_DICTIONARY;
+  node->size = size;
+  node->dictionary_members = members;
+  return true;
+}
+
+bool JSONParser::ConsumeListNode(JSONNode* node) {
+  if (*pos_ != '[') {
+    ReportError(JSONReader::JSON_UNEXPECTED_TOKEN, 1);
+    return false;
+  }
+
+  StackMarker depth_check(&stack_depth_);
+  if (depth_check.IsTooDeep()) {
+    ReportError(JSONReader::JSON_TOO_MUCH_NESTING, 1);
+    return false;
+  }
+
+  const size_t first_item = node_stack_.size();
+
+  NextChar();
+  Token token = GetNextToken();
+  while (token != T_ARRAY_END) {
+    JSONNode item;
+    if (!ParseNodeToken(token, &item))
+      return false;
+    node_stack_.push_back(item);
+
+    NextChar();
+    token = GetNextToken();
+    if (token == T_LIST_SEPARATOR) {
+      NextChar();
+      token = GetNextToken();
+      if (token == T_ARRAY_END && !(options_ & JSON_ALLOW_TRAILING_COMMAS)) {
+        ReportError(JSONReader::JSON_TRAILING_COMMA, 1);
+        return false;
+      }
+    } else if (token != T_ARRAY_END) {
+      ReportError(JSONReader::JSON_SYNTAX_ERROR, 1);
+      return false;
+    }
+  }
+
+  uint32 size = static_cast<uint32>(node_stack_.size() - first_item);
+  JSONNode* items = static_cast<JSONNode*>(
+      document_->Allocate(size * sizeof(JSONNode)));
+  std::copy(node_stack_.begin() + first_item, node_stack_.end(), items);
+  node_stack_.resize(first_item);
+
+  node->type = Value::TYPE_LIST;
+  node->size = size;
+  node->list_items = items;
+  return true;
+}
+
+bool JSONParser::ConsumeNumberNode(JSONNode* node) {
+  StringPiece num_string;
+  return ReadNumber(&num_string) && ConvertNumber(num_string, node);
+}
+
+// static
+bool JSONParser::ConvertNumber(const StringPiece& num_string, JSONNode* node) {
+  int num_int;
+  if (StringToInt(num_string, &num_int)) {
+    node->type = Value::TYPE_INTEGER;
+    node->integer_value = num_int;
+    return true;
+  }
+
+  double num_double;
+  if (base::StringToDouble(num_string.as_string(), &num_double) &&
+      IsFinite(num_double)) {
+    node->type = Value::TYPE_DOUBLE;
+    node->double_value = num_double;
+    return true;
+  }
+
+  return false;
+}
+
+void JSONParser::StoreString(StringBuilder* builder,
+                             const char** data,
+                             uint32* length) {
+  if (builder->CanBeStringPiece()) {
+    StringPiece piece = builder->AsStringPiece();
+    *data = piece.data();
+    *length = static_cast<uint32>(piece.length());
+    return;
+  }
+
+  const std::string& string = builder->AsString();
+  char* copy = static_cast<char*>(document_->Allocate(string.length()));
+  memcpy(copy, string.data(), string.length());
+  *data = copy;
+  *length = static_cast<uint32>(string.length());
 }
 
 // static
@@ -7,10 +7,12 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include "base/base_export.h"
 #include "base/basictypes.h"
 #include "base/compiler_specific.h"
+#include "base/json/json_document.h"
 #include "base/json/json_reader.h"
 #include "base/string_piece.h"
 
@@ -19,6 +21,7 @@
 #endif
 
 namespace base {
+class JSONStreamReader;
 class Value;
 }
 
@@ -59,6 +62,11 @@ class JSONParserTest;
 // of a token, such that the next iteration of the parser will be at the byte
 // immediately following the token, which would likely be the first byte of the
 // next token.
+//
+// The parser can also build a JSONDocument rather than a tree of Values. The
+// Consume functions of that mode produce JSONNodes, and collect the items of
+// lists and dictionaries that are being parsed on stacks, from which each is
+// copied into the document's arena as one array once it is complete.
 class BASE_EXPORT_PRIVATE JSONParser {
  public:
   explicit JSONParser(int options);
@@ -68,6 +76,11 @@ class BASE_EXPORT_PRIVATE JSONParser {
   // result as a Value owned by the caller.
   Value* Parse(const StringPiece& input);
 
+  // Parses the input string according to the set options into |document|,
+  // whose nodes refer to |input| rather than to a copy of it. Returns false
+  // on error.
+  bool ParseToDocument(const StringPiece& input, JSONDocument* document);
+
   // Returns the error code.
   JSONReader::JsonParseError error_code() const;
 
@@ -145,6 +158,15 @@ class BASE_EXPORT_PRIVATE JSONParser {
     std::string* string_;
   };
 
+  // Winds the parser to the start of the |length| bytes of input at |start|,
+  // skipping a UTF-8 Byte-Order-Mark, and resets the error information.
+  void StartParsing(const char* start, int length);
+
+  // Checks that nothing but whitespace and comments follows the root value,
+  // which the parser is wound to the last byte of. Returns false with error
+  // information set otherwise.
+  bool ConsumeEndOfInput();
+
   // Quick check that the stream has capacity to consume |length| more bytes.
   bool CanConsume(int length);
 
@@ -204,6 +226,12 @@ class BASE_EXPORT_PRIVATE JSONParser {
   // Assuming that the parser is wound to the start of a valid JSON number,
   // this parses and converts it to either an int or double value.
   Value* ConsumeNumber();
+  // Helper for ConsumeNumber() that consumes the number and returns its
+  // characters in |number|. Returns false on error.
+  bool ReadNumber(StringPiece* number);
+  // Converts the characters of a number to either an int or double value in
+  // |node|. Returns false if the number is out of the range of a double.
+  static bool ConvertNumber(const StringPiece& number, JSONNode* node);
   // Helper that reads characters that are ints. Returns true if a number was
   // read and false on error.
   bool ReadInt(bool allow_leading_zeros);
@@ -211,6 +239,21 @@ class BASE_EXPORT_PRIVATE JSONParser {
   // Consumes the literal values of |true|, |false|, and |null|, assuming the
   // parser is wound to the first character of any of those.
   Value* ConsumeLiteral();
+  // Helper for ConsumeLiteral() that returns the token of the literal it
+  // consumed, or T_INVALID_TOKEN on error.
+  Token ConsumeLiteralToken();
+
+  // The counterparts of ParseToken(), ConsumeDictionary(), ConsumeList() and
+  // ConsumeNumber() for parsing into |document_|. They store the result in
+  // |node| and return true, or return false on error.
+  bool ParseNodeToken(Token token, JSONNode* node);
+  bool ConsumeDictionaryNode(JSONNode* node);
+  bool ConsumeListNode(JSONNode* node);
+  bool ConsumeNumberNode(JSONNode* node);
+
+  // Stores the string in |builder| as a piece of the input if possible, or
+  // else as a copy in the arena of |document_|.
+  void StoreString(StringBuilder* builder, const char** data, uint32* length);
 
   // Compares two string buffers of a given length.
   static bool StringsAreEqual(const char* left, const char* right, size_t len);
@@ -255,6 +298,17 @@ class BASE_EXPORT_PRIVATE JSONParser {
   int error_line_;
   int error_column_;
 
+  // The document being parsed into by ParseToDocument(), or NULL.
+  JSONDocument* document_;
+
+  // The items of the lists, and the members of the dictionaries, that are
+  // being parsed into |document_|.
+  std::vector<JSONNode> node_stack_;
+  std::vector<JSONMember> member_stack_;
+
+  // JSONStreamReader drives the tokenizer and the Consume functions itself.
+  friend class base::JSONStreamReader;
+
   friend class JSONParserTest;
   FRIEND_TEST_ALL_PREFIXES(JSONParserTest, NextChar);
   FRIEND_TEST_ALL_PREFIXES(JSONParserTest, ConsumeDictionary);
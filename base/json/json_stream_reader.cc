@@ -0,0 +1,376 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/json/json_stream_reader.h"
+
+#include <string.h>
+
+#include "base/logging.h"
+
+namespace base {
+
+using internal::JSONParser;
+
+namespace {
+
+// As deep as JSONParser lets lists and dictionaries nest.
+const size_t kStackMaxDepth = 100;
+
+bool IsNumberCharacter(char c) {
+  return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' ||
+         c == 'e' || c == 'E';
+}
+
+// Returns the first byte at or after |pos| that is not whitespace or part of a
+// comment, or NULL if a comment may continue past |end|.  This skips what
+// JSONParser::EatWhitespaceAndComments() does, without reading past |end|.
+const char* SkipWhitespaceAndComments(const char* pos, const char* end) {
+  while (pos < end) {
+    switch (*pos) {
+      case ' ':
+      case '\t':
+      case '\r':
+      case '\n':
+        ++pos;
+        break;
+      case '/':
+        if (end - pos < 2)
+          return NULL;
+        if (pos[1] == '/') {
+          pos += 2;
+          while (pos < end && *pos != '\n' && *pos != '\r')
+            ++pos;
+          if (pos == end)
+            return NULL;
+        } else if (pos[1] == '*') {
+          pos += 2;
+          while (pos < end - 1 && !(pos[0] == '*' && pos[1] == '/'))
+            ++pos;
+          if (pos >= end - 1)
+            return NULL;
+          pos += 2;
+        } else {
+          return pos;
+        }
+        break;
+      default:
+        return pos;
+    }
+  }
+  return pos;
+}
+
+// Returns whether the |length| bytes at |data| are the start of a UTF-8
+// Byte-Order-Mark.
+bool IsByteOrderMarkPrefix(const char* data, size_t length) {
+  return length < 3 && memcmp(data, "\xEF\xBB\xBF", length) == 0;
+}
+
+}  // namespace
+
+JSONStreamReader::JSONStreamReader(int options, Handler* handler)
+    : options_(options),
+      handler_(handler),
+      parser_(options),
+      state_(STATE_VALUE),
+      offset_(0),
+      line_(1),
+      column_(1),
+      error_code_(JSONReader::JSON_NO_ERROR),
+      error_line_(0),
+      error_column_(0) {
+}
+
+JSONStreamReader::~JSONStreamReader() {
+}
+
+bool JSONStreamReader::Parse(const StringPiece& chunk) {
+  return ParseInput(chunk, false);
+}
+
+bool JSONStreamReader::Finish() {
+  return ParseInput(StringPiece(), true);
+}
+
+std::string JSONStreamReader::GetErrorMessage() const {
+  if (error_code_ == JSONReader::JSON_NO_ERROR)
+    return std::string();
+  return JSONParser::FormatErrorMessage(error_line_, error_column_,
+      JSONReader::ErrorCodeToString(error_code_));
+}
+
+bool JSONStreamReader::ParseInput(const StringPiece& chunk, bool is_last) {
+  if (state_ == STATE_STOPPED)
+    return false;
+
+  // Chunks are parsed where they are unless a token was left over from the
+  // previous one, which the chunk is appended to.
+  const char* data = chunk.data();
+  size_t length = chunk.size();
+  if (!buffer_.empty()) {
+    chunk.AppendToString(&buffer_);
+    data = buffer_.data();
+    length = buffer_.size();
+  }
+
+  size_t consumed = 0;
+  if (!ParseWindow(data, length, is_last, &consumed)) {
+    buffer_.clear();
+    return false;
+  }
+
+  CountLines(data, consumed, &line_, &column_);
+  offset_ += consumed;
+  if (buffer_.empty())
+    buffer_.assign(data + consumed, length - consumed);
+  else
+    buffer_.erase(0, consumed);
+  return true;
+}
+
+bool JSONStreamReader::ParseWindow(const char* data, size_t length,
+                                   bool is_last, size_t* consumed) {
+  DCHECK_LE(length, static_cast<size_t>(kint32max));
+  *consumed = 0;
+
+  // Only the start of the input may have a Byte-Order-Mark.
+  if (offset_ == 0 && !is_last && IsByteOrderMarkPrefix(data, length))
+    return true;
+  parser_.StartParsing(data, static_cast<int>(length));
+  if (offset_ != 0) {
+    parser_.pos_ = data;
+    parser_.index_ = 0;
+  }
+
+  // The offset in the window after the last complete token.
+  size_t committed = parser_.index_;
+  while (true) {
+    const char* token_start =
+        SkipWhitespaceAndComments(parser_.pos_, parser_.end_pos_);
+    if (token_start) {
+      parser_.index_ += token_start - parser_.pos_;
+      parser_.pos_ = token_start;
+    } else if (!is_last) {
+      // Keep the comment that the next chunk may finish.
+      break;
+    }
+
+    JSONParser::Token token = parser_.GetNextToken();
+    if (!is_last) {
+      if (token == JSONParser::T_END_OF_INPUT) {
+        committed = length;
+        break;
+      }
+      if (!IsTokenComplete(token))
+        break;
+    }
+
+    if (!HandleToken(token))
+      return false;
+    if (token == JSONParser::T_END_OF_INPUT) {
+      committed = length;
+      break;
+    }
+
+    parser_.NextChar();
+    committed = parser_.index_;
+  }
+
+  *consumed = committed;
+  return true;
+}
+
+bool JSONStreamReader::IsTokenComplete(JSONParser::Token token) const {
+  const char* pos = parser_.pos_;
+  const char* end = parser_.end_pos_;
+  switch (token) {
+    case JSONParser::T_STRING: {
+      // Look for a quote that is not escaped, which is one that follows an
+      // even number of backslashes.
+      const char* quote = pos;
+      while (true) {
+        quote = static_cast<const char*>(
+            memchr(quote + 1, '"', end - quote - 1));
+        if (!quote)
+          return false;
+        const char* backslash = quote - 1;
+        while (backslash > pos && *backslash == '\\')
+          --backslash;
+        if ((quote - backslash) % 2 == 1)
+          return true;
+      }
+    }
+    case JSONParser::T_NUMBER:
+      // JSONParser reads a number along with the token after it.
+      while (pos < end && IsNumberCharacter(*pos))
+        ++pos;
+      return pos < end && SkipWhitespaceAndComments(pos, end) != NULL;
+    case JSONParser::T_BOOL_TRUE:
+    case JSONParser::T_NULL:
+      return end - pos >= 4;
+    case JSONParser::T_BOOL_FALSE:
+      return end - pos >= 5;
+    default:
+      return true;
+  }
+}
+
+bool JSONStreamReader::HandleToken(JSONParser::Token token) {
+  // The same errors as JSONParser reports for the same tokens.
+  switch (state_) {
+    case STATE_VALUE:
+      return HandleValue(token);
+    case STATE_FIRST_ITEM:
+      if (token == JSONParser::T_ARRAY_END)
+        return EndContainer();
+      return HandleValue(token);
+    case STATE_NEXT_ITEM:
+      if (token == JSONParser::T_ARRAY_END) {
+        if (!(options_ & JSON_ALLOW_TRAILING_COMMAS))
+          return Stop(JSONReader::JSON_TRAILING_COMMA);
+        return EndContainer();
+      }
+      return HandleValue(token);
+    case STATE_FIRST_KEY:
+      if (token == JSONParser::T_OBJECT_END)
+        return EndContainer();
+      return HandleKey(token);
+    case STATE_NEXT_KEY:
+      if (token == JSONParser::T_OBJECT_END) {
+        if (!(options_ & JSON_ALLOW_TRAILING_COMMAS))
+          return Stop(JSONReader::JSON_TRAILING_COMMA);
+        return EndContainer();
+      }
+      return HandleKey(token);
+    case STATE_COLON:
+      if (token != JSONParser::T_OBJECT_PAIR_SEPARATOR)
+        return Stop(JSONReader::JSON_SYNTAX_ERROR);
+      state_ = STATE_VALUE;
+      return true;
+    case STATE_SEPARATOR: {
+      bool in_dictionary = containers_.back();
+      if (token == JSONParser::T_LIST_SEPARATOR) {
+        state_ = in_dictionary ? STATE_NEXT_KEY : STATE_NEXT_ITEM;
+        return true;
+      }
+      if (token == (in_dictionary ? JSONParser::T_OBJECT_END :
+                                    JSONParser::T_ARRAY_END)) {
+        return EndContainer();
+      }
+      return Stop(JSONReader::JSON_SYNTAX_ERROR);
+    }
+    case STATE_DONE:
+      if (token != JSONParser::T_END_OF_INPUT)
+        return Stop(JSONReader::JSON_UNEXPECTED_DATA_AFTER_ROOT);
+      return true;
+    default:
+      NOTREACHED();
+      return false;
+  }
+}
+
+bool JSONStreamReader::HandleValue(JSONParser::Token token) {
+  switch (token) {
+    case JSONParser::T_OBJECT_BEGIN:
+    case JSONParser::T_ARRAY_BEGIN: {
+      if (containers_.size() + 1 >= kStackMaxDepth)
+        return Stop(JSONReader::JSON_TOO_MUCH_NESTING);
+      bool is_dictionary = token == JSONParser::T_OBJECT_BEGIN;
+      containers_.push_back(is_dictionary);
+      state_ = is_dictionary ? STATE_FIRST_KEY : STATE_FIRST_ITEM;
+      bool result = is_dictionary ? handler_->OnDictionaryBegin() :
+                                    handler_->OnListBegin();
+      return result || Stop(JSONReader::JSON_NO_ERROR);
+    }
+    case JSONParser::T_STRING: {
+      JSONParser::StringBuilder string;
+      if (!parser_.ConsumeStringRaw(&string))
+        return Stop(parser_.error_code());
+      EndValue();
+      bool result = string.CanBeStringPiece() ?
+          handler_->OnString(string.AsStringPiece()) :
+          handler_->OnString(string.AsString());
+      return result || Stop(JSONReader::JSON_NO_ERROR);
+    }
+    case JSONParser::T_NUMBER: {
+      StringPiece number;
+      internal::JSONNode node;
+      if (!parser_.ReadNumber(&number))
+        return Stop(parser_.error_code());
+      if (!JSONParser::ConvertNumber(number, &node))
+        return Stop(JSONReader::JSON_SYNTAX_ERROR);
+      EndValue();
+      bool result = node.type == Value::TYPE_INTEGER ?
+          handler_->OnInteger(node.integer_value) :
+          handler_->OnDouble(node.double_value);
+      return result || Stop(JSONReader::JSON_NO_ERROR);
+    }
+    case JSONParser::T_BOOL_TRUE:
+    case JSONParser::T_BOOL_FALSE:
+    case JSONParser::T_NULL: {
+      JSONParser::Token literal = parser_.ConsumeLiteralToken();
+      if (literal == JSONParser::T_INVALID_TOKEN)
+        return Stop(parser_.error_code());
+      EndValue();
+      bool result = literal == JSONParser::T_NULL ? handler_->OnNull() :
+          handler_->OnBoolean(literal == JSONParser::T_BOOL_TRUE);
+      return result || Stop(JSONReader::JSON_NO_ERROR);
+    }
+    default:
+      return Stop(JSONReader::JSON_UNEXPECTED_TOKEN);
+  }
+}
+
+bool JSONStreamReader::HandleKey(JSONParser::Token token) {
+  if (token != JSONParser::T_STRING)
+    return Stop(JSONReader::JSON_UNQUOTED_DICTIONARY_KEY);
+  JSONParser::StringBuilder key;
+  if (!parser_.ConsumeStringRaw(&key))
+    return Stop(parser_.error_code());
+  state_ = STATE_COLON;
+  bool result = key.CanBeStringPiece() ? handler_->OnKey(key.AsStringPiece()) :
+                                         handler_->OnKey(key.AsString());
+  return result || Stop(JSONReader::JSON_NO_ERROR);
+}
+
+bool JSONStreamReader::EndContainer() {
+  bool is_dictionary = containers_.back();
+  containers_.pop_back();
+  EndValue();
+  bool result = is_dictionary ? handler_->OnDictionaryEnd() :
+                                handler_->OnListEnd();
+  return result || Stop(JSONReader::JSON_NO_ERROR);
+}
+
+void JSONStreamReader::EndValue() {
+  state_ = containers_.empty() ? STATE_DONE : STATE_SEPARATOR;
+}
+
+bool JSONStreamReader::Stop(JSONReader::JsonParseError code) {
+  state_ = STATE_STOPPED;
+  error_code_ = code;
+  if (code != JSONReader::JSON_NO_ERROR) {
+    // The error is where the parser stopped in the window.
+    error_line_ = line_;
+    error_column_ = column_;
+    CountLines(parser_.start_pos_, parser_.pos_ - parser_.start_pos_,
+               &error_line_, &error_column_);
+  }
+  return false;
+}
+
+// static
+void JSONStreamReader::CountLines(const char* data, size_t length, int* line,
+                                  int* column) {
+  const char* end = data + length;
+  const char* newline;
+  while ((newline = static_cast<const char*>(memchr(data, '\n', end - data)))) {
+    ++*line;
+    *column = 1;
+    data = newline + 1;
+  }
+  *column += static_cast<int>(end - data);
+}
+
+}  // namespace base
@@ -0,0 +1,177 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// JSONStreamReader parses JSON that arrives in chunks, such as a file that is
+// read a block at a time, and reports each key, scalar and the beginning and
+// end of each list and dictionary to a Handler as it is read, rather than
+// building a Value.  It keeps no more of the input than the token that a
+// chunk ends in the middle of, and one entry per open list or dictionary, so
+// that inputs far larger than memory can be filtered.
+//
+// Usage:
+//   class CategoryCounter : public JSONStreamReader::Handler { ... };
+//   CategoryCounter counter;
+//   JSONStreamReader reader(JSON_PARSE_RFC, &counter);
+//   while (ReadBlock(file, &block)) {
+//     if (!reader.Parse(block))
+//       break;
+//   }
+//   if (!reader.Finish())
+//     LOG(ERROR) << reader.GetErrorMessage();
+//
+// The reader accepts the same inputs as JSONReader with the same options, and
+// fails on the others with the same error codes.
+
+#ifndef BASE_JSON_JSON_STREAM_READER_H_
+#define BASE_JSON_JSON_STREAM_READER_H_
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/json/json_parser.h"
+#include "base/json/json_reader.h"
+#include "base/string_piece.h"
+
+namespace base {
+
+class BASE_EXPORT JSONStreamReader {
+ public:
+  // Receives the contents of the input in order.  Every method returns
+  // whether to keep parsing; returning false makes Parse() and Finish()
+  // return false without an error code.  The StringPieces passed to OnKey()
+  // and OnString() are only valid during the call.
+  class BASE_EXPORT Handler {
+   public:
+    virtual bool OnDictionaryBegin() = 0;
+    // Called before the value of each member of a dictionary.
+    virtual bool OnKey(const StringPiece& key) = 0;
+    virtual bool OnDictionaryEnd() = 0;
+    virtual bool OnListBegin() = 0;
+    virtual bool OnListEnd() = 0;
+    virtual bool OnNull() = 0;
+    virtual bool OnBoolean(bool value) = 0;
+    virtual bool OnInteger(int value) = 0;
+    virtual bool OnDouble(double value) = 0;
+    virtual bool OnString(const StringPiece& value) = 0;
+
+   protected:
+    virtual ~Handler() {}
+  };
+
+  // |options| are JSONParserOptions.  |handler| must outlive the reader.
+  JSONStreamReader(int options, Handler* handler);
+  ~JSONStreamReader();
+
+  // Parses the next chunk of the input, calling the handler for everything
+  // that the chunk completes.  Returns false if the input is invalid or the
+  // handler stopped the parse, after which every call returns false.
+  bool Parse(const StringPiece& chunk);
+
+  // Parses what is left of the input once all of it was passed to Parse().
+  // Returns false if the input is invalid, including when it ends before
+  // the root value does.
+  bool Finish();
+
+  // The error of a failed parse, or JSON_NO_ERROR.
+  JSONReader::JsonParseError error_code() const { return error_code_; }
+
+  // A message for the error of a failed parse, formatted as
+  // JSONReader::GetErrorMessage() does, with the line and column of the error
+  // counted from the start of the input.  Empty if there was no error.
+  std::string GetErrorMessage() const;
+
+ private:
+  // Where the reader is in the grammar, which is the kind of token expected
+  // next.
+  enum State {
+    // The root value, or the value of a dictionary member.
+    STATE_VALUE,
+    // The first item of a list, or the end of an empty list.
+    STATE_FIRST_ITEM,
+    // An item of a list after a comma.
+    STATE_NEXT_ITEM,
+    // The first key of a dictionary, or the end of an empty dictionary.
+    STATE_FIRST_KEY,
+    // A key of a dictionary after a comma.
+    STATE_NEXT_KEY,
+    // The colon after a key.
+    STATE_COLON,
+    // A comma or the end of the enclosing list or dictionary.
+    STATE_SEPARATOR,
+    // Nothing, after the root value.
+    STATE_DONE,
+    // The parse failed or was stopped.
+    STATE_STOPPED,
+  };
+
+  // Parses |chunk| after the input that was kept from earlier chunks.
+  // |is_last| means that the input ends with it.
+  bool ParseInput(const StringPiece& chunk, bool is_last);
+
+  // Parses the |length| bytes at |data| token by token, and sets |consumed|
+  // to the number of bytes before the first incomplete token, which must be
+  // parsed again with the next chunk.
+  bool ParseWindow(const char* data, size_t length, bool is_last,
+                   size_t* consumed);
+
+  // Returns whether |token|, which the parser is wound to the first byte of,
+  // ends before the end of the window.
+  bool IsTokenComplete(internal::JSONParser::Token token) const;
+
+  // Handles a complete token according to |state_|.
+  bool HandleToken(internal::JSONParser::Token token);
+
+  // Handles a token that begins a value, and a key.
+  bool HandleValue(internal::JSONParser::Token token);
+  bool HandleKey(internal::JSONParser::Token token);
+
+  // Handles the end of a list or dictionary.
+  bool EndContainer();
+
+  // Moves |state_| past a value, which was the root value if no container is
+  // open.
+  void EndValue();
+
+  // Stops the parse, with |code| as the error if it is not JSON_NO_ERROR.
+  // Returns false, for use by handlers of tokens.
+  bool Stop(JSONReader::JsonParseError code);
+
+  // Adds the lines and columns of the |length| bytes at |data| to |line| and
+  // |column|.
+  static void CountLines(const char* data, size_t length, int* line,
+                         int* column);
+
+  int options_;
+  Handler* handler_;
+  // Tokenizes and decodes the input a window at a time.
+  internal::JSONParser parser_;
+
+  State state_;
+
+  // Whether each open container is a dictionary rather than a list,
+  // innermost last.
+  std::vector<bool> containers_;
+
+  // The bytes of the input that were not consumed yet, when a chunk ended
+  // inside a token.
+  std::string buffer_;
+
+  // The number of bytes consumed so far, and the line and column after them.
+  size_t offset_;
+  int line_;
+  int column_;
+
+  JSONReader::JsonParseError error_code_;
+  int error_line_;
+  int error_column_;
+
+  DISALLOW_COPY_AND_ASSIGN(JSONStreamReader);
+};
+
+}  // namespace base
+
+#endif  // BASE_JSON_JSON_STREAM_READER_H_
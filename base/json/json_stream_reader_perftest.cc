@@ -0,0 +1,98 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/json/json_stream_reader.h"
+
+#include <algorithm>
+
+#include "base/json/json_reader.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/perftimer.h"
+#include "base/stringprintf.h"
+#include "base/values.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+// Counts the trace events of each phase, as a tool that filters a trace would.
+class PhaseCounter : public JSONStreamReader::Handler {
+ public:
+  PhaseCounter() : in_phase_(false), begin_count_(0) {}
+
+  int begin_count() const { return begin_count_; }
+
+  virtual bool OnDictionaryBegin() OVERRIDE { return true; }
+  virtual bool OnKey(const StringPiece& key) OVERRIDE {
+    in_phase_ = key == "ph";
+    return true;
+  }
+  virtual bool OnDictionaryEnd() OVERRIDE { return true; }
+  virtual bool OnListBegin() OVERRIDE { return true; }
+  virtual bool OnListEnd() OVERRIDE { return true; }
+  virtual bool OnNull() OVERRIDE { return true; }
+  virtual bool OnBoolean(bool value) OVERRIDE { return true; }
+  virtual bool OnInteger(int value) OVERRIDE { return true; }
+  virtual bool OnDouble(double value) OVERRIDE { return true; }
+  virtual bool OnString(const StringPiece& value) OVERRIDE {
+    if (in_phase_ && value == "B")
+      ++begin_count_;
+    return true;
+  }
+
+ private:
+  bool in_phase_;
+  int begin_count_;
+};
+
+// Returns about |size| bytes of trace events, and sets |begin_count| to the
+// number of them that begin a trace.
+std::string MakeTrace(size_t size, int* begin_count) {
+  std::string json("[");
+  *begin_count = 0;
+  for (int i = 0; json.size() < size; ++i) {
+    if (i > 0)
+      json += ",\n";
+    bool begin = i % 2 == 0;
+    if (begin)
+      ++*begin_count;
+    StringAppendF(&json,
+        "{\"cat\": \"category%d\", \"pid\": %d, \"tid\": %d, \"ts\": %d,"
+        " \"ph\": \"%s\", \"name\": \"Event \\\"%d\\\"\", \"args\": {}}",
+        i % 10, 1234, i % 16, i, begin ? "B" : "E", i);
+  }
+  json += "]";
+  return json;
+}
+
+}  // namespace
+
+TEST(JSONStreamReaderPerfTest, FilterTrace50MB) {
+  const size_t kChunkSize = 64 * 1024;
+  int begin_count = 0;
+  std::string json = MakeTrace(50 * 1024 * 1024, &begin_count);
+
+  PerfTimer reader_timer;
+  scoped_ptr<Value> value(JSONReader::Read(json));
+  LogPerfResult("JSONReader_Read_50MB",
+                reader_timer.Elapsed().InMillisecondsF(), "ms");
+  ASSERT_TRUE(value.get());
+  value.reset();
+
+  PhaseCounter counter;
+  JSONStreamReader reader(JSON_PARSE_RFC, &counter);
+  PerfTimer stream_timer;
+  for (size_t i = 0; i < json.size(); i += kChunkSize) {
+    ASSERT_TRUE(reader.Parse(StringPiece(json.data() + i,
+                                         std::min(kChunkSize,
+                                                  json.size() - i))));
+  }
+  ASSERT_TRUE(reader.Finish());
+  LogPerfResult("JSONStreamReader_Parse_50MB",
+                stream_timer.Elapsed().InMillisecondsF(), "ms");
+  EXPECT_EQ(begin_count, counter.begin_count());
+}
+
+}  // namespace base
@@ -0,0 +1,242 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/json/json_stream_reader.h"
+
+#include <vector>
+
+#include "base/json/json_reader.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/stringprintf.h"
+#include "base/values.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+// Records the calls it receives as a string, and stops the parse at the
+// |stop_at|th call if it is positive.
+class RecordingHandler : public JSONStreamReader::Handler {
+ public:
+  RecordingHandler() : calls_(0), stop_at_(0) {}
+
+  void set_stop_at(int stop_at) { stop_at_ = stop_at; }
+  const std::string& events() const { return events_; }
+
+  virtual bool OnDictionaryBegin() OVERRIDE { return Record("{"); }
+  virtual bool OnKey(const StringPiece& key) OVERRIDE {
+    return Record(key.as_string() + ":");
+  }
+  virtual bool OnDictionaryEnd() OVERRIDE { return Record("}"); }
+  virtual bool OnListBegin() OVERRIDE { return Record("["); }
+  virtual bool OnListEnd() OVERRIDE { return Record("]"); }
+  virtual bool OnNull() OVERRIDE { return Record("null"); }
+  virtual bool OnBoolean(bool value) OVERRIDE {
+    return Record(value ? "true" : "false");
+  }
+  virtual bool OnInteger(int value) OVERRIDE {
+    return Record(StringPrintf("%d", value));
+  }
+  virtual bool OnDouble(double value) OVERRIDE {
+    return Record(StringPrintf("%g", value));
+  }
+  virtual bool OnString(const StringPiece& value) OVERRIDE {
+    return Record("'" + value.as_string() + "'");
+  }
+
+ private:
+  bool Record(const std::string& event) {
+    if (!events_.empty())
+      events_ += " ";
+    events_ += event;
+    return ++calls_ != stop_at_;
+  }
+
+  std::string events_;
+  int calls_;
+  int stop_at_;
+};
+
+// Builds the Value tree of the input.
+class ValueHandler : public JSONStreamReader::Handler {
+ public:
+  ValueHandler() {}
+
+  Value* root() { return root_.get(); }
+
+  virtual bool OnDictionaryBegin() OVERRIDE {
+    DictionaryValue* dictionary = new DictionaryValue;
+    Add(dictionary);
+    containers_.push_back(dictionary);
+    return true;
+  }
+  virtual bool OnKey(const StringPiece& key) OVERRIDE {
+    key.CopyToString(&key_);
+    return true;
+  }
+  virtual bool OnDictionaryEnd() OVERRIDE {
+    containers_.pop_back();
+    return true;
+  }
+  virtual bool OnListBegin() OVERRIDE {
+    ListValue* list = new ListValue;
+    Add(list);
+    containers_.push_back(list);
+    return true;
+  }
+  virtual bool OnListEnd() OVERRIDE {
+    containers_.pop_back();
+    return true;
+  }
+  virtual bool OnNull() OVERRIDE {
+    Add(Value::CreateNullValue());
+    return true;
+  }
+  virtual bool OnBoolean(bool value) OVERRIDE {
+    Add(Value::CreateBooleanValue(value));
+    return true;
+  }
+  virtual bool OnInteger(int value) OVERRIDE {
+    Add(Value::CreateIntegerValue(value));
+    return true;
+  }
+  virtual bool OnDouble(double value) OVERRIDE {
+    Add(Value::CreateDoubleValue(value));
+    return true;
+  }
+  virtual bool OnString(const StringPiece& value) OVERRIDE {
+    Add(Value::CreateStringValue(value.as_string()));
+    return true;
+  }
+
+ private:
+  void Add(Value* value) {
+    if (containers_.empty()) {
+      root_.reset(value);
+      return;
+    }
+    DictionaryValue* dictionary = NULL;
+    ListValue* list = NULL;
+    if (containers_.back()->GetAsDictionary(&dictionary))
+      dictionary->SetWithoutPathExpansion(key_, value);
+    else if (containers_.back()->GetAsList(&list))
+      list->Append(value);
+  }
+
+  scoped_ptr<Value> root_;
+  std::vector<Value*> containers_;
+  std::string key_;
+
+  DISALLOW_COPY_AND_ASSIGN(ValueHandler);
+};
+
+// Feeds |input| to |reader| in chunks of |chunk_size| bytes, and finishes.
+bool ParseInChunks(const std::string& input, size_t chunk_size,
+                   JSONStreamReader* reader) {
+  for (size_t i = 0; i < input.size(); i += chunk_size) {
+    if (!reader->Parse(StringPiece(input).substr(i, chunk_size)))
+      return false;
+  }
+  return reader->Finish();
+}
+
+}  // namespace
+
+// The same events are reported however the input is split into chunks.
+TEST(JSONStreamReaderTest, Events) {
+  const std::string input(
+      "\xEF\xBB\xBF{\"number\": 42, \"double\": -1.5e3,\r\n"
+      " \"list\": [true, false, null, []], /* comment */ \"empty\": {},\n"
+      " \"strings\": [\"plain\", \"tab\\tand \\u00e9\", \"\\\\\", \"\\\"\"]}"
+      " // trailing comment");
+  const std::string kEvents(
+      "{ number: 42 double: -1500 list: [ true false null [ ] ] empty: { }"
+      " strings: [ 'plain' 'tab\tand \xC3\xA9' '\\' '\"' ] }");
+  for (size_t chunk_size = 1; chunk_size <= input.size(); ++chunk_size) {
+    RecordingHandler handler;
+    JSONStreamReader reader(JSON_PARSE_RFC, &handler);
+    EXPECT_TRUE(ParseInChunks(input, chunk_size, &reader)) << chunk_size;
+    EXPECT_EQ(kEvents, handler.events()) << chunk_size;
+    EXPECT_EQ(JSONReader::JSON_NO_ERROR, reader.error_code());
+    EXPECT_EQ("", reader.GetErrorMessage());
+  }
+}
+
+// A handler that returns false stops the parse without an error.
+TEST(JSONStreamReaderTest, HandlerStops) {
+  RecordingHandler handler;
+  handler.set_stop_at(3);
+  JSONStreamReader reader(JSON_PARSE_RFC, &handler);
+  EXPECT_FALSE(reader.Parse("[1, 2, 3, 4]"));
+  EXPECT_EQ("[ 1 2", handler.events());
+  EXPECT_EQ(JSONReader::JSON_NO_ERROR, reader.error_code());
+  EXPECT_FALSE(reader.Parse("5"));
+  EXPECT_FALSE(reader.Finish());
+  EXPECT_EQ("[ 1 2", handler.events());
+}
+
+// The values of the events are those of the Value tree that JSONReader reads,
+// and the reader fails on the same inputs with the same errors.
+TEST(JSONStreamReaderTest, SameAsJSONReader) {
+  const char* inputs[] = {
+    "",
+    "null",
+    "\"string\"",
+    "-0.25",
+    "1234567890123",
+    "[1, 2.5, \"three\", [[]], {\"x\": [false]}]",
+    "{\"a\": 1, // comment\n \"c\": {\"d\": \"\\\"quoted\\\"\"}, \"b\": []}",
+    "{\"\\u0041\": \"\\uD834\\uDD1E\", \"A\": 2}",
+    "[1, 2,]",
+    "{\"a\": 1,}",
+    "{a: 1}",
+    "{\"a\" 1}",
+    "[1 2]",
+    "[1, 2",
+    "{\"a\":",
+    "\"unterminated",
+    "[\"bad escape \\q\"]",
+    "01",
+    "tru",
+    "{} []",
+    "[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[["
+    "[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[[]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]"
+    "]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]]",
+  };
+  const int kOptions[] = { JSON_PARSE_RFC, JSON_ALLOW_TRAILING_COMMAS };
+  for (size_t i = 0; i < arraysize(inputs); ++i) {
+    for (size_t j = 0; j < arraysize(kOptions); ++j) {
+      int reader_error = 0;
+      scoped_ptr<Value> value(JSONReader::ReadAndReturnError(
+          inputs[i], kOptions[j], &reader_error, NULL));
+
+      const size_t kChunkSizes[] = { 1, 3, 1000 };
+      for (size_t k = 0; k < arraysize(kChunkSizes); ++k) {
+        ValueHandler handler;
+        JSONStreamReader reader(kOptions[j], &handler);
+        bool parsed = ParseInChunks(inputs[i], kChunkSizes[k], &reader);
+        ASSERT_EQ(value.get() != NULL, parsed) << inputs[i];
+        if (parsed) {
+          EXPECT_TRUE(value->Equals(handler.root())) << inputs[i];
+        } else {
+          EXPECT_EQ(reader_error, reader.error_code()) << inputs[i];
+          EXPECT_NE("", reader.GetErrorMessage());
+        }
+      }
+    }
+  }
+}
+
+// Errors are located from the start of the input, across chunks.
+TEST(JSONStreamReaderTest, ErrorLocation) {
+  RecordingHandler handler;
+  JSONStreamReader reader(JSON_PARSE_RFC, &handler);
+  EXPECT_TRUE(reader.Parse("[\n  1,\n"));
+  EXPECT_FALSE(reader.Parse("  2,\n  3 4]"));
+  EXPECT_EQ(JSONReader::JSON_SYNTAX_ERROR, reader.error_code());
+  EXPECT_EQ("Line: 4, column: 5, Syntax error.", reader.GetErrorMessage());
+}
+
+}  // namespace base
@@ -8,10 +8,8 @@
 
 #include "base/json/string_escape.h"
 #include "base/logging.h"
-#include "base/stringprintf.h"
 #include "base/string_number_conversions.h"
 #include "base/values.h"
-#include "base/utf_string_conversions.h"
 
 namespace base {
 
@@ -21,6 +19,45 @@ static const char kPrettyPrintLineEnding[] = "\r\n";
 static const char kPrettyPrintLineEnding[] = "\n";
 #endif
 
+namespace {
+
+// Returns about the size of the JSON of |node|, so that the output can be
+// reserved at once.  Strings are counted at a guessed size rather than read,
+// since the parser's string values can only be read by copying them.
+size_t EstimateSize(const Value* node) {
+  switch (node->GetType()) {
+    case Value::TYPE_NULL:
+    case Value::TYPE_BOOLEAN:
+      return 5;
+    case Value::TYPE_INTEGER:
+      return 6;
+    case Value::TYPE_DOUBLE:
+      return 12;
+    case Value::TYPE_STRING:
+      return 16;
+    case Value::TYPE_LIST: {
+      const ListValue* list = static_cast<const ListValue*>(node);
+      size_t size = 2;
+      for (ListValue::const_iterator it = list->begin(); it != list->end();
+           ++it) {
+        size += EstimateSize(*it) + 1;
+      }
+      return size;
+    }
+    case Value::TYPE_DICTIONARY: {
+      const DictionaryValue* dict = static_cast<const DictionaryValue*>(node);
+      size_t size = 2;
+      for (DictionaryValue::Iterator it(*dict); it.HasNext(); it.Advance())
+        size += it.key().size() + 4 + EstimateSize(&it.value());
+      return size;
+    }
+    default:
+      return 0;
+  }
+}
+
+}  // namespace
+
 /* static */
 const char* JSONWriter::kEmptyArray = "[]";
 
@@ -33,8 +70,7 @@ void JSONWriter::Write(const Value* const node, std::string* json) {
 void JSONWriter::WriteWithOptions(const Value* const node, int options,
                                   std::string* json) {
   json->clear();
-  // Is there a better way to estimate the size of the output?
-  json->reserve(1024);
+  json->reserve(EstimateSize(node));
 
   bool escape = !(options & OPTIONS_DO_NOT_ESCAPE);
   bool omit_binary_values = !!(options & OPTIONS_OMIT_BINARY_VALUES);
@@ -81,7 +117,7 @@ void JSONWriter::BuildJSONString(const Value* const node, int depth) {
         int value;
         bool result = node->GetAsInteger(&value);
         DCHECK(result);
-        base::StringAppendF(json_string_, "%d", value);
+        json_string_->append(IntToString(value));
         break;
       }
 
@@ -124,7 +160,7 @@ void JSONWriter::BuildJSONString(const Value* const node, int depth) {
         bool result = node->GetAsString(&value);
         DCHECK(result);
         if (escape_) {
-          JsonDoubleQuote(UTF8ToUTF16(value), true, json_string_);
+          JsonDoubleQuoteUTF8(value, true, json_string_);
         } else {
           JsonDoubleQuote(value, true, json_string_);
         }
@@ -170,18 +206,18 @@ void JSONWriter::BuildJSONString(const Value* const node, int depth) {
 
         const DictionaryValue* dict =
           static_cast<const DictionaryValue*>(node);
-        for (DictionaryValue::key_iterator key_itr = dict->begin_keys();
-             key_itr != dict->end_keys();
-             ++key_itr) {
-          Value* value = NULL;
-          bool result = dict->GetWithoutPathExpansion(*key_itr, &value);
-          DCHECK(result);
+        bool first_member = true;
+        for (DictionaryValue::Iterator itr(*dict); itr.HasNext();
+             itr.Advance()) {
+          const Value* value = &itr.value();
+          bool is_first_member = first_member;
+          first_member = false;
 
           if (omit_binary_values_ && value->GetType() == Value::TYPE_BINARY) {
             continue;
           }
 
-          if (key_itr != dict->begin_keys()) {
+          if (!is_first_member) {
             json_string_->append(",");
             if (pretty_print_)
               json_string_->append(kPrettyPrintLineEnding);
@@ -189,7 +225,7 @@ void JSONWriter::BuildJSONString(const Value* const node, int depth) {
 
           if (pretty_print_)
             IndentLine(depth + 1);
-          AppendQuotedString(*key_itr);
+          AppendQuotedString(itr.key());
           if (pretty_print_) {
             json_string_->append(": ");
           } else {
@@ -222,15 +258,11 @@ void JSONWriter::BuildJSONString(const Value* const node, int depth) {
 }
 
 void JSONWriter::AppendQuotedString(const std::string& str) {
-  // TODO(viettrungluu): |str| is UTF-8, not ASCII, so to properly escape it we
-  // have to convert it to UTF-16. This round-trip is suboptimal.
-  JsonDoubleQuote(UTF8ToUTF16(str), true, json_string_);
+  JsonDoubleQuoteUTF8(str, true, json_string_);
 }
 
 void JSONWriter::IndentLine(int depth) {
-  // It may be faster to keep an indent string so we don't have to keep
-  // reallocating.
-  json_string_->append(std::string(depth * 3, ' '));
+  json_string_->append(depth * 3, ' ');
 }
 
 }  // namespace base
@@ -0,0 +1,75 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/json/json_writer.h"
+
+#include "base/json/string_escape.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/perftimer.h"
+#include "base/stringprintf.h"
+#include "base/values.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+const int kIterations = 10;
+
+// Returns a tree shaped like preferences and trace metadata: a dictionary of
+// |count| dictionaries of strings, some of them long or in need of escapes,
+// numbers, booleans and lists.
+DictionaryValue* MakeTree(int count) {
+  DictionaryValue* root = new DictionaryValue;
+  for (int i = 0; i < count; ++i) {
+    DictionaryValue* entry = new DictionaryValue;
+    entry->SetString("name", StringPrintf("Entry number %d", i));
+    entry->SetString("url", StringPrintf(
+        "http://www.example.com/path/to/a/page/%d.html?query=value", i));
+    entry->SetString("path", StringPrintf("C:\\dir\\subdir\\file%d.txt", i));
+    entry->SetString("description",
+        "A longer string of plain text, as found in titles and descriptions, "
+        "that needs no escapes at all but still has to be checked.");
+    entry->SetInteger("id", i);
+    entry->SetDouble("ratio", i + 0.25);
+    entry->SetBoolean("enabled", i % 2 == 0);
+    ListValue* tags = new ListValue;
+    tags->Append(Value::CreateStringValue("alpha"));
+    tags->Append(Value::CreateStringValue("beta"));
+    tags->Append(Value::CreateIntegerValue(i));
+    entry->Set("tags", tags);
+    root->SetWithoutPathExpansion(StringPrintf("entry%d", i), entry);
+  }
+  return root;
+}
+
+}  // namespace
+
+TEST(JSONWriterPerfTest, WriteTree) {
+  scoped_ptr<DictionaryValue> tree(MakeTree(20000));
+  std::string json;
+  PerfTimer timer;
+  for (int i = 0; i < kIterations; ++i)
+    JSONWriter::Write(tree.get(), &json);
+  LogPerfResult("JSONWriter_Write_ms_per_MB",
+                timer.Elapsed().InMillisecondsF() / kIterations /
+                    (json.size() / (1024.0 * 1024.0)),
+                "ms");
+}
+
+TEST(JSONWriterPerfTest, EscapeString) {
+  std::string input;
+  while (input.size() < 1024 * 1024)
+    input += "Plain text with an occasional \"quote\" and a\ttab. ";
+  std::string output;
+  PerfTimer timer;
+  for (int i = 0; i < kIterations; ++i) {
+    output.clear();
+    JsonDoubleQuote(input, true, &output);
+  }
+  LogPerfResult("JsonDoubleQuote_1MB", timer.Elapsed().InMillisecondsF() /
+                kIterations, "ms");
+}
+
+}  // namespace base
@@ -4,15 +4,30 @@
 
 #include "base/json/string_escape.h"
 
+#include <algorithm>
 #include <string>
 
-#include "base/stringprintf.h"
+#include "base/logging.h"
 #include "base/string_util.h"
+#include "base/utf_string_conversion_utils.h"
+
+#if defined(ARCH_CPU_X86_FAMILY)
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || _M_IX86_FP==2
+// This is where we had compiler support for SSE2 instructions.
+#define SIMD_SSE2 1
+#endif
+#endif
+
+#if defined(SIMD_SSE2)
+#include <emmintrin.h>
+#endif
 
 namespace base {
 
 namespace {
 
+const char kHexDigits[] = "0123456789ABCDEF";
+
 // Try to escape |c| as a "SingleEscapeCharacter" (\n, etc).  If successful,
 // returns true and appends the escape sequence to |dst|.  This isn't required
 // by the spec, but it's more readable by humans than the \uXXXX alternatives.
@@ -49,6 +64,101 @@ static bool JsonSingleEscapeChar(const CHAR c, std::string* dst) {
   return true;
 }
 
+// Returns whether the code unit |c| is copied to the output unescaped.
+// 1. Escaping <, > to prevent script execution.
+// 2. Technically, we could also pass through c > 126 as UTF8, but this is
+//    also optional.  It would also be a pain to implement here.
+template<typename UCHAR>
+inline bool IsPlainChar(UCHAR c) {
+  return c >= 32 && c <= 126 && c != '"' && c != '\\' && c != '<' &&
+         c != '>';
+}
+
+// Returns the number of code units at the start of the |length| at |str|
+// that are copied to the output unescaped.  With SSE2, 16 bytes of input are
+// checked at a time.
+size_t CountPlainChars(const char* str, size_t length) {
+  size_t i = 0;
+#if defined(SIMD_SSE2)
+  const __m128i below_space = _mm_set1_epi8(31);
+  const __m128i del = _mm_set1_epi8(127);
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i less = _mm_set1_epi8('<');
+  const __m128i greater = _mm_set1_epi8('>');
+  for (; i + 16 <= length; i += 16) {
+    __m128i chars =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+    // Bytes from 0x80 up compare as negative, so that only 32 to 126 are in
+    // range.
+    __m128i in_range = _mm_and_si128(_mm_cmpgt_epi8(chars, below_space),
+                                     _mm_cmplt_epi8(chars, del));
+    __m128i special = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(chars, quote),
+                     _mm_cmpeq_epi8(chars, backslash)),
+        _mm_or_si128(_mm_cmpeq_epi8(chars, less),
+                     _mm_cmpeq_epi8(chars, greater)));
+    if (_mm_movemask_epi8(_mm_andnot_si128(special, in_range)) != 0xFFFF)
+      break;
+  }
+#endif
+  while (i < length && IsPlainChar(static_cast<unsigned char>(str[i])))
+    ++i;
+  return i;
+}
+
+// The same for UTF-16, 8 code units at a time with SSE2.
+size_t CountPlainChars(const char16* str, size_t length) {
+  size_t i = 0;
+#if defined(SIMD_SSE2)
+  const __m128i below_space = _mm_set1_epi16(31);
+  const __m128i del = _mm_set1_epi16(127);
+  const __m128i quote = _mm_set1_epi16('"');
+  const __m128i backslash = _mm_set1_epi16('\\');
+  const __m128i less = _mm_set1_epi16('<');
+  const __m128i greater = _mm_set1_epi16('>');
+  for (; i + 8 <= length; i += 8) {
+    __m128i chars =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+    __m128i in_range = _mm_and_si128(_mm_cmpgt_epi16(chars, below_space),
+                                     _mm_cmplt_epi16(chars, del));
+    __m128i special = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi16(chars, quote),
+                     _mm_cmpeq_epi16(chars, backslash)),
+        _mm_or_si128(_mm_cmpeq_epi16(chars, less),
+                     _mm_cmpeq_epi16(chars, greater)));
+    if (_mm_movemask_epi8(_mm_andnot_si128(special, in_range)) != 0xFFFF)
+      break;
+  }
+#endif
+  while (i < length && IsPlainChar(str[i]))
+    ++i;
+  return i;
+}
+
+// Appends |length| code units that need no escaping.
+void AppendPlainChars(const char* str, size_t length, std::string* dst) {
+  dst->append(str, length);
+}
+
+void AppendPlainChars(const char16* str, size_t length, std::string* dst) {
+  size_t offset = dst->size();
+  dst->resize(offset + length);
+  std::copy(str, str + length, dst->begin() + offset);
+}
+
+// Appends the escape sequence of the code unit |c|.
+void AppendEscapedChar(uint32 c, std::string* dst) {
+  if (JsonSingleEscapeChar(c, dst))
+    return;
+  DCHECK_LE(c, 0xFFFFu);
+  const char escape[] = {
+    '\\', 'u', kHexDigits[(c >> 12) & 0xF], kHexDigits[(c >> 8) & 0xF],
+    kHexDigits[(c >> 4) & 0xF], kHexDigits[c & 0xF]
+  };
+  dst->append(escape, arraysize(escape));
+}
+
 template <class STR>
 void JsonDoubleQuoteT(const STR& str,
                       bool put_in_quotes,
@@ -56,19 +166,20 @@ void JsonDoubleQuoteT(const STR& str,
   if (put_in_quotes)
     dst->push_back('"');
 
-  for (typename STR::const_iterator it = str.begin(); it != str.end(); ++it) {
-    typename ToUnsigned<typename STR::value_type>::Unsigned c = *it;
-    if (!JsonSingleEscapeChar(c, dst)) {
-      if (c < 32 || c > 126 || c == '<' || c == '>') {
-        // 1. Escaping <, > to prevent script execution.
-        // 2. Technically, we could also pass through c > 126 as UTF8, but this
-        //    is also optional.  It would also be a pain to implement here.
-        unsigned int as_uint = static_cast<unsigned int>(c);
-        base::StringAppendF(dst, "\\u%04X", as_uint);
-      } else {
-        unsigned char ascii = static_cast<unsigned char>(*it);
-        dst->push_back(ascii);
-      }
+  // Copy runs of plain characters at once, and escape the others one by one.
+  const typename STR::value_type* data = str.data();
+  size_t length = str.length();
+  size_t i = 0;
+  while (i < length) {
+    size_t plain = CountPlainChars(data + i, length - i);
+    AppendPlainChars(data + i, plain, dst);
+    i += plain;
+    if (i < length) {
+      AppendEscapedChar(
+          static_cast<typename ToUnsigned<typename STR::value_type>::Unsigned>(
+              data[i]),
+          dst);
+      ++i;
     }
   }
 
@@ -102,4 +213,41 @@ std::string GetDoubleQuotedJson(const string16& str) {
   return dst;
 }
 
+void JsonDoubleQuoteUTF8(const std::string& str,
+                         bool put_in_quotes,
+                         std::string* dst) {
+  if (put_in_quotes)
+    dst->push_back('"');
+
+  // ASCII is handled as JsonDoubleQuoteT() does.  Other characters are read
+  // as UTF8ToUTF16() reads them, and each UTF-16 code unit is escaped.
+  const char* data = str.data();
+  int32 length = static_cast<int32>(str.length());
+  int32 i = 0;
+  while (i < length) {
+    int32 plain = static_cast<int32>(CountPlainChars(data + i, length - i));
+    AppendPlainChars(data + i, plain, dst);
+    i += plain;
+    if (i == length)
+      break;
+
+    uint32 code_point = static_cast<unsigned char>(data[i]);
+    if (code_point >= 0x80 &&
+        !ReadUnicodeCharacter(data, length, &i, &code_point)) {
+      code_point = 0xFFFD;
+    }
+    if (code_point > 0xFFFF) {
+      // A surrogate pair.
+      AppendEscapedChar((code_point >> 10) + 0xD7C0, dst);
+      AppendEscapedChar((code_point & 0x3FF) | 0xDC00, dst);
+    } else {
+      AppendEscapedChar(code_point, dst);
+    }
+    ++i;
+  }
+
+  if (put_in_quotes)
+    dst->push_back('"');
+}
+
 }  // namespace base
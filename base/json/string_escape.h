@@ -34,6 +34,13 @@ BASE_EXPORT void JsonDoubleQuote(const string16& str,
 // Same as above, but always returns the result double quoted.
 BASE_EXPORT std::string GetDoubleQuotedJson(const string16& str);
 
+// Same as JsonDoubleQuote(UTF8ToUTF16(str), put_in_quotes, dst), without
+// the conversion: characters outside of ASCII in the UTF-8 |str| are escaped
+// as their UTF-16 code units, and invalid sequences as U+FFFD.
+BASE_EXPORT void JsonDoubleQuoteUTF8(const std::string& str,
+                                     bool put_in_quotes,
+                                     std::string* dst);
+
 }  // namespace base
 
 #endif  // BASE_JSON_STRING_ESCAPE_H_
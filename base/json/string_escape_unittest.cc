@@ -97,4 +97,50 @@ TEST(StringEscapeTest, JsonDoubleQuoteWide) {
   EXPECT_EQ(expected, out);
 }
 
+// Characters that need escapes are found at any offset of long strings,
+// which are checked several characters at a time.
+TEST(StringEscapeTest, JsonDoubleQuoteLong) {
+  const char kSpecial[] = "\"\\<>\n\x1f\x7f\x80";
+  for (size_t i = 0; i < arraysize(kSpecial) - 1; ++i) {
+    for (size_t offset = 0; offset < 40; ++offset) {
+      std::string in(40, 'a');
+      in[offset] = kSpecial[i];
+      std::string expected(offset, 'a');
+      JsonDoubleQuote(std::string(1, kSpecial[i]), false, &expected);
+      expected.append(39 - offset, 'a');
+
+      std::string out;
+      JsonDoubleQuote(in, false, &out);
+      EXPECT_EQ(expected, out);
+      out.clear();
+      JsonDoubleQuote(ASCIIToUTF16(in.substr(0, offset)) +
+                          string16(1, static_cast<unsigned char>(in[offset])) +
+                          ASCIIToUTF16(in.substr(offset + 1)),
+                      false, &out);
+      EXPECT_EQ(expected, out);
+    }
+  }
+}
+
+// Escaping UTF-8 directly gives what escaping its UTF-16 conversion gives.
+TEST(StringEscapeTest, JsonDoubleQuoteUTF8) {
+  const char* inputs[] = {
+    "",
+    "plain ascii that is longer than sixteen characters",
+    "\b\001aZ\"\\wee<script>",
+    "caf\xC3\xA9 and \xE2\x82\xAC, then a clef \xF0\x9D\x84\x9E at the end",
+    "invalid \xFF and truncated \xE2\x82",
+    "\xED\xA0\x80 is a lone surrogate",
+  };
+  for (size_t i = 0; i < arraysize(inputs); ++i) {
+    for (int quoted = 0; quoted < 2; ++quoted) {
+      std::string expected;
+      JsonDoubleQuote(UTF8ToUTF16(inputs[i]), !!quoted, &expected);
+      std::string out;
+      JsonDoubleQuoteUTF8(inputs[i], !!quoted, &out);
+      EXPECT_EQ(expected, out) << inputs[i];
+    }
+  }
+}
+
 }  // namespace base
@@ -28,6 +28,9 @@
 #if defined(OS_POSIX)
 #include "base/message_pump_libevent.h"
 #endif
+#if defined(OS_LINUX)
+#include "base/message_pump_epoll.h"
+#endif
 #if defined(OS_ANDROID)
 #include "base/message_pump_android.h"
 #endif
@@ -136,12 +139,7 @@ MessageLoop::MessageLoop(Type type)
       os_modal_loop_(false),
 #endif  // OS_WIN
       next_sequence_num_(0) {
-  DCHECK(!current()) << "should only have one message loop per thread";
-  lazy_tls_ptr.Pointer()->Set(this);
-
-  message_loop_proxy_ = new base::MessageLoopProxyImpl();
-  thread_task_runner_handle_.reset(
-      new base::ThreadTaskRunnerHandle(message_loop_proxy_));
+  Init();
 
 // TODO(rvargas): Get rid of the OS guards.
 #if defined(OS_WIN)
@@ -177,6 +175,29 @@ MessageLoop::MessageLoop(Type type)
   }
 }
 
+MessageLoop::MessageLoop(Type type, base::MessagePump* pump)
+    : type_(type),
+      nestable_tasks_allowed_(true),
+      exception_restoration_(false),
+      message_histogram_(NULL),
+      state_(NULL),
+#ifdef OS_WIN
+      os_modal_loop_(false),
+#endif  // OS_WIN
+      next_sequence_num_(0) {
+  Init();
+  pump_ = pump;
+}
+
+void MessageLoop::Init() {
+  DCHECK(!current()) << "should only have one message loop per thread";
+  lazy_tls_ptr.Pointer()->Set(this);
+
+  message_loop_proxy_ = new base::MessageLoopProxyImpl();
+  thread_task_runner_handle_.reset(
+      new base::ThreadTaskRunnerHandle(message_loop_proxy_));
+}
+
 MessageLoop::~MessageLoop() {
   DCHECK_EQ(this, current());
 
@@ -369,8 +390,8 @@ void MessageLoop::RemoveTaskObserver(TaskObserver* task_observer) {
 }
 
 void MessageLoop::AssertIdle() const {
-  // We only check |incoming_queue_|, since we don't want to lock |work_queue_|.
-  base::AutoLock lock(incoming_queue_lock_);
+  // We only check |incoming_queue_|, since |work_queue_| belongs to this
+  // loop's thread.
   DCHECK(incoming_queue_.empty());
 }
 
@@ -486,32 +507,35 @@ bool MessageLoop::DeferOrRunPendingTask(const PendingTask& pending_task) {
   return false;
 }
 
-void MessageLoop::AddToDelayedWorkQueue(const PendingTask& pending_task) {
+bool MessageLoop::AddToDelayedWorkQueue(const PendingTask& pending_task,
+                                        base::TimerWheel::Handle* handle) {
   // Move to the delayed work queue.  Initialize the sequence number
   // before inserting into the delayed_work_queue_.  The sequence number
   // is used to faciliate FIFO sorting when two tasks have the same
   // delayed_run_time value.
   PendingTask new_pending_task(pending_task);
   new_pending_task.sequence_num = next_sequence_num_++;
-  delayed_work_queue_.push(new_pending_task);
+
+  bool is_first = delayed_work_queue_.empty() ||
+      pending_task.delayed_run_time < delayed_work_queue_.NextRunTime();
+  base::TimerWheel::Handle new_handle =
+      delayed_work_queue_.Add(new_pending_task);
+  if (handle)
+    *handle = new_handle;
+  return is_first;
 }
 
 void MessageLoop::ReloadWorkQueue() {
   // We can improve performance of our loading tasks from incoming_queue_ to
   // work_queue_ by waiting until the last minute (work_queue_ is empty) to
-  // load.  That reduces the number of locks-per-task significantly when our
-  // queues get large.
+  // load.  That reduces the number of atomic operations per task
+  // significantly when our queues get large.
   if (!work_queue_.empty())
-    return;  // Wait till we *really* need to lock and load.
+    return;  // Wait till we *really* need to load.
 
-  // Acquire all we can from the inter-thread queue with one lock acquisition.
-  {
-    base::AutoLock lock(incoming_queue_lock_);
-    if (incoming_queue_.empty())
-      return;
-    incoming_queue_.Swap(&work_queue_);  // Constant time
-    DCHECK(incoming_queue_.empty());
-  }
+  // Acquire all we can from the inter-thread queue with one atomic operation.
+  // Once it is empty, the next task posted to it schedules work again.
+  incoming_queue_.TakeAll(&work_queue_);
 }
 
 bool MessageLoop::DeletePendingTasks() {
@@ -523,7 +547,7 @@ bool MessageLoop::DeletePendingTasks() {
       // We want to delete delayed tasks in the same order in which they would
       // normally be deleted in case of any funny dependencies between delayed
       // tasks.
-      AddToDelayedWorkQueue(pending_task);
+      AddToDelayedWorkQueue(pending_task, NULL);
     }
   }
   did_work |= !deferred_non_nestable_work_queue_.empty();
@@ -537,9 +561,8 @@ bool MessageLoop::DeletePendingTasks() {
   // code is replicating legacy behavior, and should not be considered
   // absolutely "correct" behavior.  See TODO above about deleting all tasks
   // when it's safe.
-  while (!delayed_work_queue_.empty()) {
-    delayed_work_queue_.pop();
-  }
+  while (delayed_work_queue_.GetNextTask())
+    delayed_work_queue_.Pop();
   return did_work;
 }
 
@@ -588,22 +611,15 @@ void MessageLoop::AddToIncomingQueue(PendingTask* pending_task) {
   // directly, as it could starve handling of foreign threads.  Put every task
   // into this queue.
 
-  scoped_refptr<base::MessagePump> pump;
-  {
-    base::AutoLock locked(incoming_queue_lock_);
-
-    bool was_empty = incoming_queue_.empty();
-    incoming_queue_.push(*pending_task);
-    pending_task->task.Reset();
-    if (!was_empty)
-      return;  // Someone else should have started the sub-pump.
-
-    pump = pump_;
-  }
   // Since the incoming_queue_ may contain a task that destroys this message
-  // loop, we cannot exit incoming_queue_lock_ until we are done with |this|.
-  // We use a stack-based reference to the message pump so that we can call
-  // ScheduleWork outside of incoming_queue_lock_.
+  // loop, we cannot touch |this| once the task is pushed.  We take a
+  // stack-based reference to the message pump beforehand so that we can call
+  // ScheduleWork after the push.
+  scoped_refptr<base::MessagePump> pump(pump_);
+
+  bool was_empty = incoming_queue_.Push(pending_task);
+  if (!was_empty)
+    return;  // Someone else should have started the sub-pump.
 
   pump->ScheduleWork();
 }
@@ -646,9 +662,8 @@ bool MessageLoop::DoWork() {
       PendingTask pending_task = work_queue_.front();
       work_queue_.pop();
       if (!pending_task.delayed_run_time.is_null()) {
-        AddToDelayedWorkQueue(pending_task);
         // If we changed the topmost task, then it is time to reschedule.
-        if (delayed_work_queue_.top().task.Equals(pending_task.task))
+        if (AddToDelayedWorkQueue(pending_task, NULL))
           pump_->ScheduleDelayedWork(pending_task.delayed_run_time);
       } else {
         if (DeferOrRunPendingTask(pending_task))
@@ -674,7 +689,7 @@ bool MessageLoop::DoDelayedWork(TimeTicks* next_delayed_work_time) {
   // fall behind (and have a lot of ready-to-run delayed tasks), the more
   // efficient we'll be at handling the tasks.
 
-  TimeTicks next_run_time = delayed_work_queue_.top().delayed_run_time;
+  TimeTicks next_run_time = delayed_work_queue_.NextRunTime();
   if (next_run_time > recent_time_) {
     recent_time_ = TimeTicks::Now();  // Get a better view of Now();
     if (next_run_time > recent_time_) {
@@ -683,11 +698,11 @@ bool MessageLoop::DoDelayedWork(TimeTicks* next_delayed_work_time) {
     }
   }
 
-  PendingTask pending_task = delayed_work_queue_.top();
-  delayed_work_queue_.pop();
+  PendingTask pending_task = *delayed_work_queue_.GetNextTask();
+  delayed_work_queue_.Pop();
 
   if (!delayed_work_queue_.empty())
-    *next_delayed_work_time = delayed_work_queue_.top().delayed_run_time;
+    *next_delayed_work_time = delayed_work_queue_.NextRunTime();
 
   return DeferOrRunPendingTask(pending_task);
 }
@@ -702,6 +717,31 @@ bool MessageLoop::DoIdleWork() {
   return false;
 }
 
+base::TimerWheel::Handle MessageLoop::PostCancelableDelayedTask(
+    const tracked_objects::Location& from_here,
+    const base::Closure& task,
+    TimeDelta delay) {
+  DCHECK_EQ(this, current());
+  DCHECK(!task.is_null()) << from_here.ToString();
+  PendingTask pending_task(from_here, task,
+                           CalculateDelayedRuntime(
+                               delay.InMillisecondsRoundedUp()),
+                           true);
+  base::TimerWheel::Handle handle;
+  if (pending_task.delayed_run_time.is_null()) {
+    AddToIncomingQueue(&pending_task);
+    return handle;
+  }
+  if (AddToDelayedWorkQueue(pending_task, &handle))
+    pump_->ScheduleDelayedWork(pending_task.delayed_run_time);
+  return handle;
+}
+
+void MessageLoop::CancelDelayedTask(const base::TimerWheel::Handle& handle) {
+  DCHECK_EQ(this, current());
+  delayed_work_queue_.Cancel(handle);
+}
+
 void MessageLoop::DeleteSoonInternal(const tracked_objects::Location& from_here,
                                      void(*deleter)(const void*),
                                      const void* object) {
@@ -794,6 +834,15 @@ bool MessageLoopForIO::WaitForIOCompletion(DWORD timeout, IOHandler* filter) {
 
 #elif defined(OS_POSIX) && !defined(OS_NACL)
 
+#if defined(OS_LINUX)
+MessageLoopForIO::MessageLoopForIO(PumpType pump_type)
+    : MessageLoop(TYPE_IO,
+                  pump_type == PUMP_EPOLL ?
+                      new base::MessagePumpEpoll() :
+                      new base::MessagePumpLibevent()) {
+}
+#endif
+
 bool MessageLoopForIO::WatchFileDescriptor(int fd,
                                            bool persistent,
                                            Mode mode,
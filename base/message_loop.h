@@ -12,6 +12,7 @@
 #include "base/base_export.h"
 #include "base/basictypes.h"
 #include "base/callback_forward.h"
+#include "base/incoming_task_queue.h"
 #include "base/location.h"
 #include "base/memory/ref_counted.h"
 #include "base/message_loop_proxy.h"
@@ -22,6 +23,7 @@
 #include "base/synchronization/lock.h"
 #include "base/tracking_info.h"
 #include "base/time.h"
+#include "base/timer_wheel.h"
 
 #if defined(OS_WIN)
 // We need this to declare base::MessagePumpWin::Dispatcher, which we should
@@ -43,6 +45,7 @@
 namespace base {
 class Histogram;
 class ThreadTaskRunnerHandle;
+class Timer;
 }  // namespace base
 
 // A MessageLoop is used to process events for a particular thread.  There is
@@ -362,6 +365,10 @@ class BASE_EXPORT MessageLoop : public base::MessagePump::Delegate {
 
   //----------------------------------------------------------------------------
  protected:
+  // Creates a loop of |type| that runs |pump| rather than the default pump
+  // for |type|.
+  MessageLoop(Type type, base::MessagePump* pump);
+
   struct RunState {
     // Used to count how many Run() invocations are on the stack.
     int run_depth;
@@ -427,8 +434,10 @@ class BASE_EXPORT MessageLoop : public base::MessagePump::Delegate {
   // cannot be run right now.  Returns true if the task was run.
   bool DeferOrRunPendingTask(const base::PendingTask& pending_task);
 
-  // Adds the pending task to delayed_work_queue_.
-  void AddToDelayedWorkQueue(const base::PendingTask& pending_task);
+  // Adds the pending task to delayed_work_queue_.  Returns true if it is now
+  // the first delayed task to run.
+  bool AddToDelayedWorkQueue(const base::PendingTask& pending_task,
+                             base::TimerWheel::Handle* handle);
 
   // Adds the pending task to our incoming_queue_.
   //
@@ -439,8 +448,8 @@ class BASE_EXPORT MessageLoop : public base::MessagePump::Delegate {
   void AddToIncomingQueue(base::PendingTask* pending_task);
 
   // Load tasks from the incoming_queue_ into work_queue_ if the latter is
-  // empty.  The former requires a lock to access, while the latter is directly
-  // accessible on this thread.
+  // empty.  The former is shared with posting threads, while the latter is
+  // directly accessible on this thread.
   void ReloadWorkQueue();
 
   // Delete tasks that haven't run yet without running them.  Used in the
@@ -471,8 +480,9 @@ class BASE_EXPORT MessageLoop : public base::MessagePump::Delegate {
   // this queue is only accessed (push/pop) by our current thread.
   base::TaskQueue work_queue_;
 
-  // Contains delayed tasks, sorted by their 'delayed_run_time' property.
-  base::DelayedTaskQueue delayed_work_queue_;
+  // Contains delayed tasks, which come out in the order of their
+  // 'delayed_run_time' property.
+  base::TimerWheel delayed_work_queue_;
 
   // A recent snapshot of Time::Now(), used to check delayed_work_queue_.
   base::TimeTicks recent_time_;
@@ -496,13 +506,11 @@ class BASE_EXPORT MessageLoop : public base::MessagePump::Delegate {
   // A profiling histogram showing the counts of various messages and events.
   base::Histogram* message_histogram_;
 
-  // A null terminated list which creates an incoming_queue of tasks that are
-  // acquired under a mutex for processing on this instance's thread. These
-  // tasks have not yet been sorted out into items for our work_queue_ vs items
-  // that will be handled by the TimerManager.
-  base::TaskQueue incoming_queue_;
-  // Protect access to incoming_queue_.
-  mutable base::Lock incoming_queue_lock_;
+  // Tasks posted from any thread, which are taken all at once for processing
+  // on this instance's thread. These tasks have not yet been sorted out into
+  // items for our work_queue_ vs items that will be handled by the
+  // TimerManager.
+  base::IncomingTaskQueue incoming_queue_;
 
   RunState* state_;
 
@@ -525,6 +533,21 @@ class BASE_EXPORT MessageLoop : public base::MessagePump::Delegate {
  private:
   template <class T, class R> friend class base::subtle::DeleteHelperInternal;
   template <class T, class R> friend class base::subtle::ReleaseHelperInternal;
+  friend class base::Timer;
+
+  // Registers the loop with the current thread and sets up everything but the
+  // pump.  Called by the constructors.
+  void Init();
+
+  // Adds a delayed task straight to delayed_work_queue_, and returns a handle
+  // with which CancelDelayedTask() deletes it before it runs.  A task without
+  // a delay goes through the incoming queue and gets a null handle.  Both must
+  // be called on this loop's thread.
+  base::TimerWheel::Handle PostCancelableDelayedTask(
+      const tracked_objects::Location& from_here,
+      const base::Closure& task,
+      base::TimeDelta delay);
+  void CancelDelayedTask(const base::TimerWheel::Handle& handle);
 
   void DeleteSoonInternal(const tracked_objects::Location& from_here,
                           void(*deleter)(const void*),
@@ -618,6 +641,18 @@ class BASE_EXPORT MessageLoopForIO : public MessageLoop {
   MessageLoopForIO() : MessageLoop(TYPE_IO) {
   }
 
+#if defined(OS_LINUX)
+  // The pumps that can watch file descriptors.  PUMP_LIBEVENT is what
+  // MessageLoopForIO() and MessageLoop(TYPE_IO) use.  See MessagePumpEpoll for
+  // how PUMP_EPOLL differs.
+  enum PumpType {
+    PUMP_LIBEVENT,
+    PUMP_EPOLL
+  };
+
+  explicit MessageLoopForIO(PumpType pump_type);
+#endif
+
   // Returns the MessageLoopForIO of the current thread.
   static MessageLoopForIO* current() {
     MessageLoop* loop = MessageLoop::current();
@@ -0,0 +1,108 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/message_loop.h"
+
+#include "base/bind.h"
+#include "base/memory/scoped_vector.h"
+#include "base/perftimer.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+const int kRoundTrips = 100000;
+
+// Bounces a task between the message loops of two threads until it has made
+// the given number of round trips.
+class PingPong {
+ public:
+  PingPong(MessageLoop* ping_loop, MessageLoop* pong_loop, int round_trips)
+      : ping_loop_(ping_loop),
+        pong_loop_(pong_loop),
+        remaining_(round_trips),
+        done_(false, false) {}
+
+  void Ping() {
+    if (remaining_-- == 0) {
+      done_.Signal();
+      return;
+    }
+    pong_loop_->PostTask(FROM_HERE, Bind(&PingPong::Pong, Unretained(this)));
+  }
+
+  void Pong() {
+    ping_loop_->PostTask(FROM_HERE, Bind(&PingPong::Ping, Unretained(this)));
+  }
+
+  void Wait() { done_.Wait(); }
+
+ private:
+  MessageLoop* ping_loop_;
+  MessageLoop* pong_loop_;
+  int remaining_;
+  WaitableEvent done_;
+
+  DISALLOW_COPY_AND_ASSIGN(PingPong);
+};
+
+// Posts |count| tasks that do nothing, then one that signals |done|.
+void PostBurst(MessageLoop* loop, int count, WaitableEvent* done) {
+  for (int i = 0; i < count; ++i)
+    loop->PostTask(FROM_HERE, Bind(&DoNothing));
+  loop->PostTask(FROM_HERE, Bind(&WaitableEvent::Signal, Unretained(done)));
+}
+
+}  // namespace
+
+TEST(MessageLoopPerfTest, PingPongLatency) {
+  Thread ping_thread("Ping");
+  Thread pong_thread("Pong");
+  ASSERT_TRUE(ping_thread.Start());
+  ASSERT_TRUE(pong_thread.Start());
+
+  PingPong ping_pong(ping_thread.message_loop(), pong_thread.message_loop(),
+                     kRoundTrips);
+  PerfTimer timer;
+  ping_thread.message_loop()->PostTask(
+      FROM_HERE, Bind(&PingPong::Ping, Unretained(&ping_pong)));
+  ping_pong.Wait();
+  LogPerfResult("MessageLoop_PingPong_round_trip",
+                timer.Elapsed().InMicroseconds() /
+                    static_cast<double>(kRoundTrips),
+                "us");
+}
+
+// Many threads posting to one loop at once, as IO and worker threads post
+// replies to the UI thread.
+TEST(MessageLoopPerfTest, PostFromManyThreads) {
+  const int kNumPosters = 4;
+  const int kTasksPerPoster = 100000;
+  Thread target("Target");
+  ASSERT_TRUE(target.Start());
+  ScopedVector<Thread> posters;
+  ScopedVector<WaitableEvent> done;
+  for (int i = 0; i < kNumPosters; ++i) {
+    posters.push_back(new Thread("Poster"));
+    ASSERT_TRUE(posters[i]->Start());
+    done.push_back(new WaitableEvent(false, false));
+  }
+
+  PerfTimer timer;
+  for (int i = 0; i < kNumPosters; ++i) {
+    posters[i]->message_loop()->PostTask(
+        FROM_HERE, Bind(&PostBurst, target.message_loop(), kTasksPerPoster,
+                        done[i]));
+  }
+  for (int i = 0; i < kNumPosters; ++i)
+    done[i]->Wait();
+  LogPerfResult("MessageLoop_PostTask_4_threads",
+                kNumPosters * kTasksPerPoster / timer.Elapsed().InSecondsF(),
+                "tasks/s");
+}
+
+}  // namespace base
@@ -0,0 +1,379 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/message_pump_epoll.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "base/auto_reset.h"
+#include "base/eintr_wrapper.h"
+#include "base/logging.h"
+#include "base/memory/weak_ptr.h"
+
+namespace base {
+
+namespace {
+
+// Returns the epoll events that watching an FD in |mode| asks for.
+uint32 EventsForMode(int mode) {
+  uint32 events = 0;
+  if (mode & MessagePumpLibevent::WATCH_READ)
+    events |= EPOLLIN;
+  if (mode & MessagePumpLibevent::WATCH_WRITE)
+    events |= EPOLLOUT;
+  return events;
+}
+
+}  // namespace
+
+MessagePumpEpoll::MessagePumpEpoll()
+    : MessagePumpLibevent(NO_LIBEVENT),
+      keep_running_(true),
+      in_run_(false),
+      epoll_fd_(-1),
+      wakeup_fd_(-1),
+      timer_fd_(-1) {
+  if (!Init())
+     NOTREACHED();
+}
+
+MessagePumpEpoll::~MessagePumpEpoll() {
+  // Unlike with libevent, a FileDescriptorWatcher may outlive the pump: it is
+  // simply no longer watching.
+  for (FdMap::iterator it = fds_.begin(); it != fds_.end(); ++it) {
+    std::vector<FileDescriptorWatcher*>& controllers = it->second.controllers;
+    for (size_t i = 0; i < controllers.size(); ++i) {
+      controllers[i]->epoll_pump_ = NULL;
+      controllers[i]->epoll_mode_ = 0;
+      controllers[i]->set_pump(NULL);
+      controllers[i]->set_watcher(NULL);
+    }
+  }
+  int fds[] = { timer_fd_, wakeup_fd_, epoll_fd_ };
+  for (size_t i = 0; i < arraysize(fds); ++i) {
+    if (fds[i] >= 0 && HANDLE_EINTR(close(fds[i])) < 0)
+      DPLOG(ERROR) << "close";
+  }
+}
+
+bool MessagePumpEpoll::WatchFileDescriptor(int fd,
+                                           bool persistent,
+                                           Mode mode,
+                                           FileDescriptorWatcher* controller,
+                                           Watcher* delegate) {
+  DCHECK_GE(fd, 0);
+  DCHECK(controller);
+  DCHECK(delegate);
+  DCHECK(mode == WATCH_READ || mode == WATCH_WRITE || mode == WATCH_READ_WRITE);
+  // WatchFileDescriptor should be called on the pump thread. It is not
+  // threadsafe, and your watcher may never be registered.
+  DCHECK(watch_file_descriptor_caller_checker_.CalledOnValidThread());
+  DCHECK(!controller->event_);
+
+  if (controller->epoll_pump_) {
+    // It's illegal to use this function to listen on 2 separate fds with the
+    // same |controller|.
+    if (controller->epoll_pump_ != this || controller->fd_ != fd) {
+      NOTREACHED() << "FDs don't match" << controller->fd_ << "!=" << fd;
+      return false;
+    }
+    // Combine old/new modes.
+    controller->epoll_mode_ |= mode;
+    controller->persistent_ |= persistent;
+  } else {
+    controller->epoll_pump_ = this;
+    controller->fd_ = fd;
+    controller->epoll_mode_ = mode;
+    controller->persistent_ = persistent;
+    fds_[fd].controllers.push_back(controller);
+  }
+
+  if (!UpdateRegistration(fd, &fds_[fd], false)) {
+    DPLOG(ERROR) << "epoll_ctl";
+    RemoveController(controller, false);
+    return false;
+  }
+
+  controller->set_watcher(delegate);
+  controller->set_pump(this);
+  return true;
+}
+
+// Reentrant!
+void MessagePumpEpoll::Run(Delegate* delegate) {
+  DCHECK(keep_running_) << "Quit must have been called outside of Run!";
+  AutoReset<bool> auto_reset_in_run(&in_run_, true);
+
+  for (;;) {
+    bool did_work = delegate->DoWork();
+    if (!keep_running_)
+      break;
+
+    did_work |= ProcessEvents(0);
+    if (!keep_running_)
+      break;
+
+    did_work |= delegate->DoDelayedWork(&delayed_work_time_);
+    if (!keep_running_)
+      break;
+
+    if (did_work)
+      continue;
+
+    did_work = delegate->DoIdleWork();
+    if (!keep_running_)
+      break;
+
+    if (did_work)
+      continue;
+
+    if (!delayed_work_time_.is_null() &&
+        delayed_work_time_ <= TimeTicks::Now()) {
+      // It looks like delayed_work_time_ indicates a time in the past, so we
+      // need to call DoDelayedWork now.
+      delayed_work_time_ = TimeTicks();
+      continue;
+    }
+    ArmTimer(delayed_work_time_);
+    ProcessEvents(-1);
+  }
+
+  keep_running_ = true;
+}
+
+void MessagePumpEpoll::Quit() {
+  DCHECK(in_run_);
+  // Tell both epoll_wait() and Run that they should break out of their loops.
+  keep_running_ = false;
+  ScheduleWork();
+}
+
+void MessagePumpEpoll::ScheduleWork() {
+  // Adding to the eventfd counter is threadsafe, and only fails if it is
+  // about to overflow, in which case a wakeup is pending anyway.
+  uint64 value = 1;
+  int nwrite = HANDLE_EINTR(write(wakeup_fd_, &value, sizeof(value)));
+  DCHECK(nwrite == sizeof(value) || errno == EAGAIN)
+      << "[nwrite:" << nwrite << "] [errno:" << errno << "]";
+}
+
+void MessagePumpEpoll::ScheduleDelayedWork(
+    const TimeTicks& delayed_work_time) {
+  // We know that we can't be blocked in epoll_wait() right now since this
+  // method can only be called on the same thread as Run, so we only need to
+  // update our record of how long to sleep when we do sleep.
+  delayed_work_time_ = delayed_work_time;
+}
+
+bool MessagePumpEpoll::StopWatching(FileDescriptorWatcher* controller) {
+  return RemoveController(controller, false);
+}
+
+bool MessagePumpEpoll::RemoveController(FileDescriptorWatcher* controller,
+                                        bool keep_registered) {
+  int fd = controller->fd_;
+  controller->epoll_pump_ = NULL;
+  controller->fd_ = -1;
+  controller->epoll_mode_ = 0;
+  controller->persistent_ = false;
+
+  FdMap::iterator it = fds_.find(fd);
+  DCHECK(it != fds_.end());
+  std::vector<FileDescriptorWatcher*>& controllers = it->second.controllers;
+  controllers.erase(std::find(controllers.begin(), controllers.end(),
+                              controller));
+  return UpdateRegistration(fd, &it->second, keep_registered);
+}
+
+bool MessagePumpEpoll::UpdateRegistration(int fd,
+                                          FdEntry* entry,
+                                          bool keep_registered) {
+  uint32 events = 0;
+  for (size_t i = 0; i < entry->controllers.size(); ++i)
+    events |= EventsForMode(entry->controllers[i]->epoll_mode_);
+
+  if (!events) {
+    if (keep_registered)
+      return true;
+    int rv = 0;
+    if (entry->registered_events)
+      rv = epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, NULL);
+    fds_.erase(fd);
+    // Closing the FD already took it out of the epoll set.
+    return rv == 0 || errno == EBADF || errno == ENOENT;
+  }
+
+  // Modify the registration even if the events are the same, because that
+  // makes epoll report the FD again if it is ready, so a new watch hears
+  // about data that earlier watches left behind.
+  epoll_event event;
+  memset(&event, 0, sizeof(event));
+  event.events = events | EPOLLET;
+  event.data.fd = fd;
+  int rv = -1;
+  if (entry->registered_events)
+    rv = epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, fd, &event);
+  // ENOENT means that the FD was closed, and its number reused, since it was
+  // registered.
+  if (!entry->registered_events || (rv != 0 && errno == ENOENT))
+    rv = epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+  entry->registered_events = rv == 0 ? event.events : 0;
+  return rv == 0;
+}
+
+bool MessagePumpEpoll::ProcessEvents(int timeout_ms) {
+  // Not a member: a Watcher may run a nested loop, which gets here again.
+  epoll_event events[kMaxEvents];
+  int count = HANDLE_EINTR(epoll_wait(epoll_fd_, events, kMaxEvents,
+                                      timeout_ms));
+  if (count < 0) {
+    DPLOG(ERROR) << "epoll_wait";
+    return false;
+  }
+
+  bool processed_io_events = false;
+  for (int i = 0; i < count; ++i) {
+    int fd = events[i].data.fd;
+    if (fd == wakeup_fd_) {
+      // Reading resets the counter, however many ScheduleWork() calls
+      // there were.
+      uint64 value;
+      HANDLE_EINTR(read(wakeup_fd_, &value, sizeof(value)));
+      processed_io_events = true;
+    } else if (fd == timer_fd_) {
+      // The timer is one-shot, so it is now disarmed.  Run will call
+      // DoDelayedWork on its next pass.
+      uint64 expirations;
+      HANDLE_EINTR(read(timer_fd_, &expirations, sizeof(expirations)));
+      timer_time_ = TimeTicks();
+    } else {
+      OnFdReady(fd, events[i].events);
+      processed_io_events = true;
+    }
+  }
+  return processed_io_events;
+}
+
+void MessagePumpEpoll::OnFdReady(int fd, uint32 events) {
+  FdMap::iterator it = fds_.find(fd);
+  if (it == fds_.end()) {
+    // An earlier event of this batch stopped the watch.
+    return;
+  }
+  std::vector<FileDescriptorWatcher*>& controllers = it->second.controllers;
+  if (controllers.empty()) {
+    // The FD stayed registered after its last non-persistent watch fired, and
+    // nobody watched it again.
+    UpdateRegistration(fd, &it->second, false);
+    return;
+  }
+  if (controllers.size() == 1) {
+    Dispatch(controllers[0], fd, events);
+    return;
+  }
+
+  // Watchers of the same FD may stop or delete one another.
+  std::vector<WeakPtr<FileDescriptorWatcher> > weak_controllers;
+  for (size_t i = 0; i < controllers.size(); ++i)
+    weak_controllers.push_back(controllers[i]->weak_factory_.GetWeakPtr());
+  for (size_t i = 0; i < weak_controllers.size(); ++i) {
+    if (weak_controllers[i].get())
+      Dispatch(weak_controllers[i].get(), fd, events);
+  }
+}
+
+void MessagePumpEpoll::Dispatch(FileDescriptorWatcher* controller,
+                                int fd,
+                                uint32 events) {
+  // The controller may have been stopped, and started again on another FD, by
+  // an earlier Watcher of this FD.
+  if (controller->epoll_pump_ != this || controller->fd_ != fd)
+    return;
+
+  // Errors and hangups are reported to whatever the Watcher waits for, so it
+  // finds out about them from read() or write().
+  const uint32 kFailure = EPOLLERR | EPOLLHUP;
+  bool can_read = (controller->epoll_mode_ & WATCH_READ) &&
+      (events & (EPOLLIN | kFailure));
+  bool can_write = (controller->epoll_mode_ & WATCH_WRITE) &&
+      (events & (EPOLLOUT | kFailure));
+  if (!can_read && !can_write)
+    return;
+
+  base::WeakPtr<FileDescriptorWatcher> weak_controller =
+      controller->weak_factory_.GetWeakPtr();
+  if (!controller->persistent_)
+    RemoveController(controller, true);
+
+  if (can_write)
+    controller->OnFileCanWriteWithoutBlocking(fd, this);
+  // Check |controller| in case it's been deleted in
+  // controller->OnFileCanWriteWithoutBlocking().
+  if (weak_controller.get() && can_read)
+    controller->OnFileCanReadWithoutBlocking(fd, this);
+}
+
+void MessagePumpEpoll::ArmTimer(const TimeTicks& delayed_work_time) {
+  if (delayed_work_time == timer_time_)
+    return;
+
+  // TimeTicks counts microseconds of CLOCK_MONOTONIC, so it can be given to
+  // the timer as an absolute time.  A zero time disarms it.
+  itimerspec spec;
+  memset(&spec, 0, sizeof(spec));
+  if (!delayed_work_time.is_null()) {
+    int64 microseconds = delayed_work_time.ToInternalValue();
+    spec.it_value.tv_sec = microseconds / Time::kMicrosecondsPerSecond;
+    spec.it_value.tv_nsec = (microseconds % Time::kMicrosecondsPerSecond) *
+        Time::kNanosecondsPerMicrosecond;
+  }
+  if (timerfd_settime(timer_fd_, TFD_TIMER_ABSTIME, &spec, NULL) != 0) {
+    DPLOG(ERROR) << "timerfd_settime";
+    return;
+  }
+  timer_time_ = delayed_work_time;
+}
+
+bool MessagePumpEpoll::Init() {
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd_ < 0) {
+    DLOG(ERROR) << "epoll_create1() failed, errno: " << errno;
+    return false;
+  }
+  wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wakeup_fd_ < 0) {
+    DLOG(ERROR) << "eventfd() failed, errno: " << errno;
+    return false;
+  }
+  timer_fd_ = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (timer_fd_ < 0) {
+    DLOG(ERROR) << "timerfd_create() failed, errno: " << errno;
+    return false;
+  }
+
+  // These two are level-triggered: they are read until they are no longer
+  // ready.
+  int fds[] = { wakeup_fd_, timer_fd_ };
+  for (size_t i = 0; i < arraysize(fds); ++i) {
+    epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = fds[i];
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fds[i], &event) != 0) {
+      DLOG(ERROR) << "epoll_ctl() failed, errno: " << errno;
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace base
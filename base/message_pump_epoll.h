@@ -0,0 +1,133 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_MESSAGE_PUMP_EPOLL_H_
+#define BASE_MESSAGE_PUMP_EPOLL_H_
+#pragma once
+
+#include <vector>
+
+#include "base/basictypes.h"
+#include "base/compiler_specific.h"
+#include "base/hash_tables.h"
+#include "base/message_pump_libevent.h"
+#include "base/time.h"
+
+namespace base {
+
+// A Linux MessagePump for TYPE_IO loops that talks to epoll directly instead
+// of going through libevent.  It takes the same Watcher and
+// FileDescriptorWatcher as MessagePumpLibevent, so MessageLoopForIO works the
+// same with either; pick this one with MessageLoopForIO(PUMP_EPOLL).
+//
+// Watches are edge-triggered: a Watcher is told once each time its FD becomes
+// readable or writable, and is not told again while the FD stays ready.  So a
+// persistent Watcher must read or write until the FD returns EAGAIN, or it
+// will not hear about the data that is left.  A non-persistent watch stops
+// before its Watcher is called, as with libevent.
+//
+// Each pass of the loop handles up to kMaxEvents ready FDs from one
+// epoll_wait().  ScheduleWork() signals an eventfd, and delayed work wakes the
+// loop through a timerfd, which is only rearmed when the delayed work time
+// changes and which is not limited to the millisecond timeout of
+// epoll_wait().
+class BASE_EXPORT MessagePumpEpoll : public MessagePumpLibevent {
+ public:
+  MessagePumpEpoll();
+
+  // MessagePumpLibevent methods:
+  virtual bool WatchFileDescriptor(int fd,
+                                   bool persistent,
+                                   Mode mode,
+                                   FileDescriptorWatcher* controller,
+                                   Watcher* delegate) OVERRIDE;
+
+  // MessagePump methods:
+  virtual void Run(Delegate* delegate) OVERRIDE;
+  virtual void Quit() OVERRIDE;
+  virtual void ScheduleWork() OVERRIDE;
+  virtual void ScheduleDelayedWork(const TimeTicks& delayed_work_time) OVERRIDE;
+
+ protected:
+  virtual ~MessagePumpEpoll();
+
+ private:
+  friend class MessagePumpLibevent::FileDescriptorWatcher;
+
+  enum {
+    kMaxEvents = 64
+  };
+
+  // The FileDescriptorWatchers of an FD, and the epoll events it is
+  // registered for.
+  struct FdEntry {
+    FdEntry() : registered_events(0) {}
+
+    std::vector<FileDescriptorWatcher*> controllers;
+    uint32 registered_events;
+  };
+
+  typedef base::hash_map<int, FdEntry> FdMap;
+
+  // Stops the watch of |controller|.  Called by
+  // FileDescriptorWatcher::StopWatchingFileDescriptor().
+  bool StopWatching(FileDescriptorWatcher* controller);
+
+  // Takes |controller| off the list of its FD without touching its Watcher,
+  // and updates the registration of the FD.  See UpdateRegistration() for
+  // |keep_registered|.
+  bool RemoveController(FileDescriptorWatcher* controller,
+                        bool keep_registered);
+
+  // Adds, modifies or deletes the epoll registration of |fd| to cover what the
+  // watchers in |entry| want.  When no watcher is left, |entry| is erased
+  // unless |keep_registered| is set, in which case the FD stays registered so
+  // that watching it again takes a single epoll_ctl() call.
+  bool UpdateRegistration(int fd, FdEntry* entry, bool keep_registered);
+
+  // Waits up to |timeout_ms| for events, -1 meaning forever, and dispatches
+  // them.  Returns true if it handled any IO or a ScheduleWork().
+  bool ProcessEvents(int timeout_ms);
+
+  // Calls the watchers of |fd| for the epoll |events| it is ready for.
+  void OnFdReady(int fd, uint32 events);
+
+  // Calls |controller|'s Watcher if it watches |fd| for any of |events|.
+  void Dispatch(FileDescriptorWatcher* controller, int fd, uint32 events);
+
+  // Arms timer_fd_ to fire at |delayed_work_time|, or disarms it if that is
+  // null.
+  void ArmTimer(const TimeTicks& delayed_work_time);
+
+  // Risky part of constructor.  Returns true on success.
+  bool Init();
+
+  // This flag is set to false when Run should return.
+  bool keep_running_;
+
+  // This flag is set when inside Run.
+  bool in_run_;
+
+  // The time at which we should call DoDelayedWork.
+  TimeTicks delayed_work_time_;
+
+  // The time timer_fd_ is armed for, or null when it is disarmed.
+  TimeTicks timer_time_;
+
+  int epoll_fd_;
+
+  // eventfd that ScheduleWork() signals to wake up epoll_wait().
+  int wakeup_fd_;
+
+  // timerfd on CLOCK_MONOTONIC, the clock of TimeTicks, for delayed work.
+  int timer_fd_;
+
+  FdMap fds_;
+
+  DISALLOW_COPY_AND_ASSIGN(MessagePumpEpoll);
+};
+
+}  // namespace base
+
+#endif  // BASE_MESSAGE_PUMP_EPOLL_H_
@@ -0,0 +1,119 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/message_pump_epoll.h"
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "base/eintr_wrapper.h"
+#include "base/message_loop.h"
+#include "base/perftimer.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+const int kRoundTrips = 100000;
+
+// Bounces a byte between the two ends of a socketpair, both watched by the
+// current MessageLoopForIO, and quits the loop after the given number of
+// round trips.  Persistent watches stay on; otherwise each end is watched
+// again after every read, as the net socket classes do.
+class SocketPingPong : public MessageLoopForIO::Watcher {
+ public:
+  SocketPingPong(int round_trips, bool persistent)
+      : remaining_(round_trips),
+        persistent_(persistent) {
+    fds_[0] = fds_[1] = -1;
+  }
+
+  virtual ~SocketPingPong() {
+    for (int i = 0; i < 2; ++i) {
+      if (fds_[i] >= 0)
+        HANDLE_EINTR(close(fds_[i]));
+    }
+  }
+
+  bool Start() {
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds_) != 0)
+      return false;
+    for (int i = 0; i < 2; ++i) {
+      if (fcntl(fds_[i], F_SETFL, O_NONBLOCK) != 0 || !Watch(i))
+        return false;
+    }
+    return Send(0);
+  }
+
+  // MessageLoopForIO::Watcher methods:
+  virtual void OnFileCanReadWithoutBlocking(int fd) OVERRIDE {
+    int end = fd == fds_[0] ? 0 : 1;
+    // Read until EAGAIN, which edge-triggered watches need.
+    char buf[16];
+    while (HANDLE_EINTR(read(fd, buf, sizeof(buf))) > 0) {
+    }
+    if (!persistent_)
+      Watch(end);
+    if (end == 0 && --remaining_ == 0) {
+      MessageLoop::current()->Quit();
+      return;
+    }
+    Send(end);
+  }
+
+  virtual void OnFileCanWriteWithoutBlocking(int fd) OVERRIDE {
+    NOTREACHED();
+  }
+
+ private:
+  bool Watch(int end) {
+    return MessageLoopForIO::current()->WatchFileDescriptor(
+        fds_[end], persistent_, MessageLoopForIO::WATCH_READ,
+        &controllers_[end], this);
+  }
+
+  bool Send(int end) {
+    char byte = 0;
+    return HANDLE_EINTR(write(fds_[end], &byte, 1)) == 1;
+  }
+
+  int fds_[2];
+  MessageLoopForIO::FileDescriptorWatcher controllers_[2];
+  int remaining_;
+  bool persistent_;
+
+  DISALLOW_COPY_AND_ASSIGN(SocketPingPong);
+};
+
+void RunSocketPingPong(MessageLoopForIO::PumpType pump_type,
+                       bool persistent,
+                       const char* name) {
+  MessageLoopForIO loop(pump_type);
+  SocketPingPong ping_pong(kRoundTrips, persistent);
+  ASSERT_TRUE(ping_pong.Start());
+  PerfTimer timer;
+  loop.Run();
+  LogPerfResult(name, kRoundTrips / timer.Elapsed().InSecondsF(),
+                "round_trips/s");
+}
+
+}  // namespace
+
+TEST(MessagePumpEpollPerfTest, SocketPingPongPersistent) {
+  RunSocketPingPong(MessageLoopForIO::PUMP_LIBEVENT, true,
+                    "MessagePumpLibevent_SocketPingPong_persistent");
+  RunSocketPingPong(MessageLoopForIO::PUMP_EPOLL, true,
+                    "MessagePumpEpoll_SocketPingPong_persistent");
+}
+
+TEST(MessagePumpEpollPerfTest, SocketPingPongOneShot) {
+  RunSocketPingPong(MessageLoopForIO::PUMP_LIBEVENT, false,
+                    "MessagePumpLibevent_SocketPingPong_one_shot");
+  RunSocketPingPong(MessageLoopForIO::PUMP_EPOLL, false,
+                    "MessagePumpEpoll_SocketPingPong_one_shot");
+}
+
+}  // namespace base
@@ -0,0 +1,239 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/message_pump_epoll.h"
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "base/bind.h"
+#include "base/eintr_wrapper.h"
+#include "base/message_loop.h"
+#include "base/threading/thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+class MessagePumpEpollTest : public testing::Test {
+ protected:
+  MessagePumpEpollTest() : loop_(MessageLoopForIO::PUMP_EPOLL) {
+    fds_[0] = fds_[1] = -1;
+  }
+
+  virtual void SetUp() OVERRIDE {
+    ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds_));
+    ASSERT_EQ(0, fcntl(fds_[0], F_SETFL, O_NONBLOCK));
+    ASSERT_EQ(0, fcntl(fds_[1], F_SETFL, O_NONBLOCK));
+  }
+
+  virtual void TearDown() OVERRIDE {
+    for (int i = 0; i < 2; ++i) {
+      if (fds_[i] >= 0)
+        HANDLE_EINTR(close(fds_[i]));
+    }
+  }
+
+  // Writes |count| bytes to the end of the socketpair that |fd| is not.
+  void Send(int fd, int count) {
+    int peer = fd == fds_[0] ? fds_[1] : fds_[0];
+    for (int i = 0; i < count; ++i) {
+      char byte = 0;
+      ASSERT_EQ(1, HANDLE_EINTR(write(peer, &byte, 1)));
+    }
+  }
+
+  // Runs the loop until it has nothing left to do.
+  void RunUntilIdle() {
+    loop_.RunAllPending();
+  }
+
+  MessageLoopForIO loop_;
+  int fds_[2];
+};
+
+// Counts the notifications it gets and reads |bytes_per_read| bytes on each.
+class CountingWatcher : public MessageLoopForIO::Watcher {
+ public:
+  explicit CountingWatcher(int bytes_per_read)
+      : bytes_per_read_(bytes_per_read),
+        reads_(0),
+        writes_(0) {
+  }
+  virtual ~CountingWatcher() {}
+
+  int reads() const { return reads_; }
+  int writes() const { return writes_; }
+
+  // MessageLoopForIO::Watcher methods:
+  virtual void OnFileCanReadWithoutBlocking(int fd) OVERRIDE {
+    ++reads_;
+    char byte;
+    for (int i = 0; i < bytes_per_read_; ++i)
+      HANDLE_EINTR(read(fd, &byte, 1));
+  }
+  virtual void OnFileCanWriteWithoutBlocking(int fd) OVERRIDE {
+    ++writes_;
+  }
+
+ private:
+  int bytes_per_read_;
+  int reads_;
+  int writes_;
+};
+
+// Deletes its controller when the FD is writable.
+class DeleteWatcher : public MessageLoopForIO::Watcher {
+ public:
+  explicit DeleteWatcher(MessageLoopForIO::FileDescriptorWatcher* controller)
+      : controller_(controller) {
+  }
+  virtual ~DeleteWatcher() {
+    EXPECT_FALSE(controller_);
+  }
+
+  // MessageLoopForIO::Watcher methods:
+  virtual void OnFileCanReadWithoutBlocking(int fd) OVERRIDE {
+    ADD_FAILURE() << "Read after the controller was deleted";
+  }
+  virtual void OnFileCanWriteWithoutBlocking(int fd) OVERRIDE {
+    delete controller_;
+    controller_ = NULL;
+  }
+
+ private:
+  MessageLoopForIO::FileDescriptorWatcher* controller_;
+};
+
+void QuitLoop() {
+  MessageLoop::current()->Quit();
+}
+
+}  // namespace
+
+// A non-persistent watch is notified once, and can be started again.
+TEST_F(MessagePumpEpollTest, NonPersistentWatch) {
+  MessageLoopForIO::FileDescriptorWatcher controller;
+  CountingWatcher watcher(1);
+  ASSERT_TRUE(loop_.WatchFileDescriptor(
+      fds_[0], false, MessageLoopForIO::WATCH_READ, &controller, &watcher));
+  RunUntilIdle();
+  EXPECT_EQ(0, watcher.reads());
+
+  Send(fds_[0], 2);
+  RunUntilIdle();
+  EXPECT_EQ(1, watcher.reads());
+  Send(fds_[0], 1);
+  RunUntilIdle();
+  EXPECT_EQ(1, watcher.reads());
+
+  // Watching again reports the bytes that are still there.
+  ASSERT_TRUE(loop_.WatchFileDescriptor(
+      fds_[0], false, MessageLoopForIO::WATCH_READ, &controller, &watcher));
+  RunUntilIdle();
+  EXPECT_EQ(2, watcher.reads());
+  EXPECT_TRUE(controller.StopWatchingFileDescriptor());
+}
+
+// A persistent watch is edge-triggered: it is notified again only when more
+// data arrives.
+TEST_F(MessagePumpEpollTest, PersistentWatchIsEdgeTriggered) {
+  MessageLoopForIO::FileDescriptorWatcher controller;
+  CountingWatcher watcher(1);
+  ASSERT_TRUE(loop_.WatchFileDescriptor(
+      fds_[0], true, MessageLoopForIO::WATCH_READ, &controller, &watcher));
+
+  Send(fds_[0], 2);
+  RunUntilIdle();
+  EXPECT_EQ(1, watcher.reads());
+  RunUntilIdle();
+  EXPECT_EQ(1, watcher.reads());
+  Send(fds_[0], 1);
+  RunUntilIdle();
+  EXPECT_EQ(2, watcher.reads());
+
+  EXPECT_TRUE(controller.StopWatchingFileDescriptor());
+  Send(fds_[0], 1);
+  RunUntilIdle();
+  EXPECT_EQ(2, watcher.reads());
+}
+
+// Separate controllers can watch the same FD for reading and writing.
+TEST_F(MessagePumpEpollTest, TwoControllersOnOneFd) {
+  MessageLoopForIO::FileDescriptorWatcher read_controller;
+  MessageLoopForIO::FileDescriptorWatcher write_controller;
+  CountingWatcher read_watcher(1);
+  CountingWatcher write_watcher(0);
+  ASSERT_TRUE(loop_.WatchFileDescriptor(
+      fds_[0], true, MessageLoopForIO::WATCH_READ, &read_controller,
+      &read_watcher));
+  ASSERT_TRUE(loop_.WatchFileDescriptor(
+      fds_[0], false, MessageLoopForIO::WATCH_WRITE, &write_controller,
+      &write_watcher));
+  Send(fds_[0], 1);
+  RunUntilIdle();
+  EXPECT_EQ(1, read_watcher.reads());
+  EXPECT_EQ(0, read_watcher.writes());
+  EXPECT_EQ(0, write_watcher.reads());
+  EXPECT_EQ(1, write_watcher.writes());
+
+  // The write watch is over, the read watch goes on.
+  Send(fds_[0], 1);
+  RunUntilIdle();
+  EXPECT_EQ(2, read_watcher.reads());
+  EXPECT_EQ(1, write_watcher.writes());
+}
+
+// A controller deleted by its write notification doesn't get the read one.
+TEST_F(MessagePumpEpollTest, DeleteWatcher) {
+  MessageLoopForIO::FileDescriptorWatcher* controller =
+      new MessageLoopForIO::FileDescriptorWatcher;
+  DeleteWatcher watcher(controller);
+  Send(fds_[0], 1);
+  ASSERT_TRUE(loop_.WatchFileDescriptor(
+      fds_[0], true, MessageLoopForIO::WATCH_READ_WRITE, controller,
+      &watcher));
+  RunUntilIdle();
+}
+
+// A controller may outlive the loop, and then stops watching.
+TEST(MessagePumpEpollLifetimeTest, ControllerOutlivesLoop) {
+  int fds[2];
+  ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+  MessageLoopForIO::FileDescriptorWatcher controller;
+  CountingWatcher watcher(0);
+  {
+    MessageLoopForIO loop(MessageLoopForIO::PUMP_EPOLL);
+    ASSERT_TRUE(loop.WatchFileDescriptor(
+        fds[0], true, MessageLoopForIO::WATCH_WRITE, &controller, &watcher));
+  }
+  EXPECT_TRUE(controller.StopWatchingFileDescriptor());
+  HANDLE_EINTR(close(fds[0]));
+  HANDLE_EINTR(close(fds[1]));
+}
+
+// Delayed tasks wake the loop up through the timerfd, not before their time.
+TEST_F(MessagePumpEpollTest, DelayedTask) {
+  TimeTicks start = TimeTicks::Now();
+  loop_.PostDelayedTask(FROM_HERE, Bind(&QuitLoop),
+                        TimeDelta::FromMilliseconds(50));
+  loop_.Run();
+  EXPECT_GE(TimeTicks::Now() - start, TimeDelta::FromMilliseconds(50));
+}
+
+// Tasks posted from another thread wake the loop up.
+TEST_F(MessagePumpEpollTest, PostTaskFromOtherThread) {
+  Thread thread("MessagePumpEpollTestThread");
+  ASSERT_TRUE(thread.Start());
+  thread.message_loop()->PostDelayedTask(
+      FROM_HERE,
+      Bind(&MessageLoop::PostTask, Unretained(&loop_), FROM_HERE,
+           Bind(&QuitLoop)),
+      TimeDelta::FromMilliseconds(10));
+  loop_.Run();
+}
+
+}  // namespace base
@@ -16,6 +16,9 @@
 #include "base/mac/scoped_nsautorelease_pool.h"
 #endif
 #include "base/memory/scoped_ptr.h"
+#if defined(OS_LINUX)
+#include "base/message_pump_epoll.h"
+#endif
 #include "base/observer_list.h"
 #include "base/time.h"
 #if defined(USE_SYSTEM_LIBEVENT)
@@ -61,16 +64,29 @@ MessagePumpLibevent::FileDescriptorWatcher::FileDescriptorWatcher()
     : event_(NULL),
       pump_(NULL),
       watcher_(NULL),
+      epoll_pump_(NULL),
+      fd_(-1),
+      epoll_mode_(0),
+      persistent_(false),
       ALLOW_THIS_IN_INITIALIZER_LIST(weak_factory_(this)) {
 }
 
 MessagePumpLibevent::FileDescriptorWatcher::~FileDescriptorWatcher() {
-  if (event_) {
+  if (event_ || epoll_pump_) {
     StopWatchingFileDescriptor();
   }
 }
 
 bool MessagePumpLibevent::FileDescriptorWatcher::StopWatchingFileDescriptor() {
+#if defined(OS_LINUX)
+  if (epoll_pump_) {
+    bool rv = epoll_pump_->StopWatching(this);
+    pump_ = NULL;
+    watcher_ = NULL;
+    return rv;
+  }
+#endif
+
   event* e = ReleaseEvent();
   if (e == NULL)
     return true;
@@ -126,7 +142,19 @@ MessagePumpLibevent::MessagePumpLibevent()
      NOTREACHED();
 }
 
+MessagePumpLibevent::MessagePumpLibevent(NoLibevent)
+    : keep_running_(true),
+      in_run_(false),
+      processed_io_events_(false),
+      event_base_(NULL),
+      wakeup_pipe_in_(-1),
+      wakeup_pipe_out_(-1),
+      wakeup_event_(NULL) {
+}
+
 MessagePumpLibevent::~MessagePumpLibevent() {
+  if (!event_base_)
+    return;
   DCHECK(wakeup_event_);
   DCHECK(event_base_);
   event_del(wakeup_event_);
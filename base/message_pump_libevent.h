@@ -20,6 +20,8 @@ struct event;
 
 namespace base {
 
+class MessagePumpEpoll;
+
 // Class to monitor sockets and issue callbacks when sockets are ready for I/O
 // TODO(dkegel): add support for background file IO somehow
 class BASE_EXPORT MessagePumpLibevent : public MessagePump {
@@ -66,6 +68,7 @@ class BASE_EXPORT MessagePumpLibevent : public MessagePump {
     bool StopWatchingFileDescriptor();
 
    private:
+    friend class MessagePumpEpoll;
     friend class MessagePumpLibevent;
     friend class MessagePumpLibeventTest;
 
@@ -87,6 +90,14 @@ class BASE_EXPORT MessagePumpLibevent : public MessagePump {
     event* event_;
     MessagePumpLibevent* pump_;
     Watcher* watcher_;
+
+    // Used instead of |event_| when watching with a MessagePumpEpoll: the pump
+    // and FD being watched, and the Mode bits and persistence of the watch.
+    MessagePumpEpoll* epoll_pump_;
+    int fd_;
+    int epoll_mode_;
+    bool persistent_;
+
     base::WeakPtrFactory<FileDescriptorWatcher> weak_factory_;
 
     DISALLOW_COPY_AND_ASSIGN(FileDescriptorWatcher);
@@ -112,11 +123,11 @@ class BASE_EXPORT MessagePumpLibevent : public MessagePump {
   // Returns true on success.
   // Must be called on the same thread the message_pump is running on.
   // TODO(dkegel): switch to edge-triggered readiness notification
-  bool WatchFileDescriptor(int fd,
-                           bool persistent,
-                           Mode mode,
-                           FileDescriptorWatcher *controller,
-                           Watcher *delegate);
+  virtual bool WatchFileDescriptor(int fd,
+                                   bool persistent,
+                                   Mode mode,
+                                   FileDescriptorWatcher *controller,
+                                   Watcher *delegate);
 
   void AddIOObserver(IOObserver* obs);
   void RemoveIOObserver(IOObserver* obs);
@@ -128,14 +139,21 @@ class BASE_EXPORT MessagePumpLibevent : public MessagePump {
   virtual void ScheduleDelayedWork(const TimeTicks& delayed_work_time) OVERRIDE;
 
  protected:
-  virtual ~MessagePumpLibevent();
+  // Used by MessagePumpEpoll, which shares the watcher types and IO observers
+  // but does not set up libevent.
+  enum NoLibevent { NO_LIBEVENT };
+  explicit MessagePumpLibevent(NoLibevent);
 
- private:
-  friend class MessagePumpLibeventTest;
+  virtual ~MessagePumpLibevent();
 
   void WillProcessIOEvent();
   void DidProcessIOEvent();
 
+  ThreadChecker watch_file_descriptor_caller_checker_;
+
+ private:
+  friend class MessagePumpLibeventTest;
+
   // Risky part of constructor.  Returns true on success.
   bool Init();
 
@@ -171,7 +189,6 @@ class BASE_EXPORT MessagePumpLibevent : public MessagePump {
   event* wakeup_event_;
 
   ObserverList<IOObserver> io_observers_;
-  ThreadChecker watch_file_descriptor_caller_checker_;
   DISALLOW_COPY_AND_ASSIGN(MessagePumpLibevent);
 };
 
@@ -15,10 +15,14 @@
 #include <string>
 
 #include "base/debug/leak_annotations.h"
+#include "base/lazy_instance.h"
 #include "base/logging.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/metrics/shared_histogram_table.h"
 #include "base/pickle.h"
 #include "base/stringprintf.h"
 #include "base/synchronization/lock.h"
+#include "base/threading/thread_local.h"
 
 namespace base {
 
@@ -73,6 +77,77 @@ typedef Histogram::Count Count;
 
 // static
 const size_t Histogram::kBucketCount_MAX = 16384u;
+// static
+const size_t Histogram::kNumSampleShards;
+
+namespace {
+
+// The shard index (plus one, so that zero means unassigned) of each thread
+// that added a sample.  Threads are assigned shards round-robin.
+LazyInstance<ThreadLocalPointer<void> >::Leaky g_sample_shard_index =
+    LAZY_INSTANCE_INITIALIZER;
+subtle::Atomic32 g_last_sample_shard_index = 0;
+
+const size_t kCacheLineSize = 64;
+
+bool HistogramNameLesser(const Histogram* a, const Histogram* b) {
+  return a->histogram_name() < b->histogram_name();
+}
+
+}  // namespace
+
+// The counts are padded with a cache line on either side, so that threads
+// adding to different shards of a histogram don't write to the same cache
+// lines.
+class Histogram::SampleShard {
+ public:
+  explicit SampleShard(size_t bucket_count)
+      : redundant_count_(0),
+        sum_(0),
+        counts_storage_(new subtle::Atomic32[bucket_count +
+                                             2 * kCountsPerCacheLine]) {
+    memset(counts_storage_.get(), 0,
+           (bucket_count + 2 * kCountsPerCacheLine) * sizeof(subtle::Atomic32));
+  }
+
+  void Accumulate(Sample value, Count count, size_t index) {
+    DCHECK(count == 1 || count == -1);
+    subtle::NoBarrier_AtomicIncrement(
+        &counts_storage_[kCountsPerCacheLine + index], count);
+    subtle::NoBarrier_AtomicIncrement(&redundant_count_, count);
+#if defined(ARCH_CPU_64_BITS)
+    subtle::NoBarrier_AtomicIncrement(&sum_, static_cast<int64>(count) * value);
+#else
+    // There are no 64-bit atomic operations here.  Threads that share a shard
+    // may lose updates of the sum, as they did before histograms had shards.
+    sum_ += count * value;
+#endif
+  }
+
+  Count counts(size_t i) const {
+    return subtle::NoBarrier_Load(&counts_storage_[kCountsPerCacheLine + i]);
+  }
+  int64 sum() const { return sum_; }
+  int64 redundant_count() const {
+    return subtle::NoBarrier_Load(&redundant_count_);
+  }
+
+ private:
+  static const size_t kCountsPerCacheLine =
+      kCacheLineSize / sizeof(subtle::Atomic32);
+
+  char padding_before_[kCacheLineSize];
+  volatile subtle::Atomic32 redundant_count_;
+#if defined(ARCH_CPU_64_BITS)
+  volatile subtle::Atomic64 sum_;
+#else
+  int64 sum_;
+#endif
+  char padding_after_[kCacheLineSize];
+  scoped_array<subtle::Atomic32> counts_storage_;
+
+  DISALLOW_COPY_AND_ASSIGN(SampleShard);
+};
 
 // Collect the number of histograms created.
 static uint32 number_of_histograms_ = 0;
@@ -393,11 +468,23 @@ size_t Histogram::bucket_count() const {
   return bucket_count_;
 }
 
-// Do a safe atomic snapshot of sample data.
-// This implementation assumes we are on a safe single thread.
+// Fold the shards into a snapshot.  Samples added while the snapshot is taken
+// may be counted in some of the totals but not the others, which
+// FindCorruption() allows for.
 void Histogram::SnapshotSample(SampleSet* sample) const {
-  // Note locking not done in this version!!!
   *sample = sample_;
+  for (size_t i = 0; i < kNumSampleShards; ++i) {
+    const SampleShard* shard = reinterpret_cast<const SampleShard*>(
+        subtle::Acquire_Load(&sample_shards_[i]));
+    if (!shard)
+      continue;
+    for (size_t index = 0; index < bucket_count(); ++index)
+      sample->counts_[index] += shard->counts(index);
+    sample->sum_ += shard->sum();
+    sample->redundant_count_ += shard->redundant_count();
+  }
+  if (shared_data_)
+    shared_data_->AddToSampleSet(sample);
 }
 
 bool Histogram::HasConstructorArguments(Sample minimum,
@@ -428,7 +515,8 @@ Histogram::Histogram(const std::string& name, Sample minimum,
     flags_(kNoFlags),
     cached_ranges_(new CachedRanges(bucket_count + 1, 0)),
     range_checksum_(0),
-    sample_() {
+    sample_(),
+    shared_data_(NULL) {
   Initialize();
 }
 
@@ -441,7 +529,8 @@ Histogram::Histogram(const std::string& name, TimeDelta minimum,
     flags_(kNoFlags),
     cached_ranges_(new CachedRanges(bucket_count + 1, 0)),
     range_checksum_(0),
-    sample_() {
+    sample_(),
+    shared_data_(NULL) {
   Initialize();
 }
 
@@ -452,6 +541,9 @@ Histogram::~Histogram() {
     DLOG(INFO) << output;
   }
 
+  for (size_t i = 0; i < kNumSampleShards; ++i)
+    delete reinterpret_cast<SampleShard*>(sample_shards_[i]);
+
   // Just to make sure most derived class did this properly...
   DCHECK(ValidateBucketRanges());
 }
@@ -553,8 +645,10 @@ const std::string Histogram::GetAsciiBucketRange(size_t i) const {
 
 // Update histogram data with new sample.
 void Histogram::Accumulate(Sample value, Count count, size_t index) {
-  // Note locking not done in this version!!!
-  sample_.Accumulate(value, count, index);
+  if (shared_data_)
+    shared_data_->Accumulate(value, count, index);
+  else
+    GetSampleShard()->Accumulate(value, count, index);
 }
 
 void Histogram::SetBucketRange(size_t i, Sample value) {
@@ -584,6 +678,8 @@ uint32 Histogram::CalculateRangeChecksum() const {
 
 void Histogram::Initialize() {
   sample_.Resize(*this);
+  for (size_t i = 0; i < kNumSampleShards; ++i)
+    sample_shards_[i] = 0;
   if (declared_min_ < 1)
     declared_min_ = 1;
   if (declared_max_ > kSampleType_MAX - 1)
@@ -597,6 +693,31 @@ void Histogram::Initialize() {
   cached_ranges_->SetBucketRange(bucket_count_, kSampleType_MAX);
 }
 
+Histogram::SampleShard* Histogram::GetSampleShard() {
+  ThreadLocalPointer<void>* thread_index = g_sample_shard_index.Pointer();
+  uintptr_t index = reinterpret_cast<uintptr_t>(thread_index->Get());
+  if (!index) {
+    index = subtle::NoBarrier_AtomicIncrement(&g_last_sample_shard_index, 1);
+    thread_index->Set(reinterpret_cast<void*>(index));
+  }
+
+  subtle::AtomicWord* slot = &sample_shards_[(index - 1) % kNumSampleShards];
+  SampleShard* shard =
+      reinterpret_cast<SampleShard*>(subtle::Acquire_Load(slot));
+  if (shard)
+    return shard;
+
+  // Several threads may race to create the shard; only one of them wins.
+  shard = new SampleShard(bucket_count());
+  subtle::AtomicWord existing = subtle::Release_CompareAndSwap(
+      slot, 0, reinterpret_cast<subtle::AtomicWord>(shard));
+  if (existing) {
+    delete shard;
+    shard = reinterpret_cast<SampleShard*>(existing);
+  }
+  return shard;
+}
+
 // We generate the CRC-32 using the low order bits to select whether to XOR in
 // the reversed polynomial 0xedb88320L.  This is nice and simple, and allows us
 // to keep the quotient in a uint32.  Since we're not concerned about the nature
@@ -1117,6 +1238,8 @@ Histogram* StatisticsRecorder::RegisterOrDeleteDuplicate(Histogram* histogram) {
   HistogramMap::iterator it = histograms_->find(name);
   // Avoid overwriting a previous registration.
   if (histograms_->end() == it) {
+    if (SharedHistogramTable::current())
+      SharedHistogramTable::current()->AttachHistogram(histogram);
     (*histograms_)[name] = histogram;
     ANNOTATE_LEAKING_OBJECT_PTR(histogram);  // see crbug.com/79322
     RegisterOrDeleteDuplicateRanges(histogram);
@@ -1258,12 +1381,14 @@ void StatisticsRecorder::GetHistograms(Histograms* output) {
   base::AutoLock auto_lock(*lock_);
   if (!histograms_)
     return;
+  size_t first = output->size();
   for (HistogramMap::iterator it = histograms_->begin();
        histograms_->end() != it;
        ++it) {
     DCHECK_EQ(it->first, it->second->histogram_name());
     output->push_back(it->second);
   }
+  std::sort(output->begin() + first, output->end(), &HistogramNameLesser);
 }
 
 bool StatisticsRecorder::FindHistogram(const std::string& name,
@@ -1288,12 +1413,14 @@ void StatisticsRecorder::GetSnapshot(const std::string& query,
   base::AutoLock auto_lock(*lock_);
   if (!histograms_)
     return;
+  size_t first = snapshot->size();
   for (HistogramMap::iterator it = histograms_->begin();
        histograms_->end() != it;
        ++it) {
     if (it->first.find(query) != std::string::npos)
       snapshot->push_back(it->second);
   }
+  std::sort(snapshot->begin() + first, snapshot->end(), &HistogramNameLesser);
 }
 
 CachedRanges::CachedRanges(size_t bucket_count, int initial_value)
@@ -50,6 +50,7 @@
 #include "base/base_export.h"
 #include "base/compiler_specific.h"
 #include "base/gtest_prod_util.h"
+#include "base/hash_tables.h"
 #include "base/logging.h"
 #include "base/time.h"
 
@@ -323,6 +324,7 @@ class CachedRanges;
 class CustomHistogram;
 class Histogram;
 class LinearHistogram;
+class SharedHistogramData;
 
 class BASE_EXPORT Histogram {
  public:
@@ -420,6 +422,10 @@ class BASE_EXPORT Histogram {
     // Allow tests to corrupt our innards for testing purposes.
     FRIEND_TEST_ALL_PREFIXES(HistogramTest, CorruptSampleCounts);
 
+    // To fold the samples of its shards into snapshots.
+    friend class Histogram;
+    friend class SharedHistogramData;
+
     // To help identify memory corruption, we reduntantly save the number of
     // samples we've accumulated into all of our buckets.  We can compare this
     // count to the sum of the counts in all buckets, and detect problems.  Note
@@ -518,8 +524,9 @@ class BASE_EXPORT Histogram {
   void set_cached_ranges(CachedRanges* cached_ranges) {
     cached_ranges_ = cached_ranges;
   }
-  // Snapshot the current complete set of sample data.
-  // Override with atomic/locked snapshot if needed.
+  // Snapshot the current complete set of sample data.  Samples are kept in
+  // per-thread shards, or in a SharedHistogramTable, which this folds
+  // together.
   virtual void SnapshotSample(SampleSet* sample) const;
 
   virtual bool HasConstructorArguments(Sample minimum, Sample maximum,
@@ -571,7 +578,10 @@ class BASE_EXPORT Histogram {
   //----------------------------------------------------------------------------
   // Methods to override to create thread safe histogram.
   //----------------------------------------------------------------------------
-  // Update all our internal data, including histogram
+  // Update all our internal data, including histogram.  Adds to the shard of
+  // the current thread with atomic increments, so threads adding to the same
+  // histogram neither lose samples nor contend for the same cache lines, or to
+  // the shared storage of the histogram if it has any.
   virtual void Accumulate(Sample value, Count count, size_t index);
 
   //----------------------------------------------------------------------------
@@ -594,10 +604,21 @@ class BASE_EXPORT Histogram {
   FRIEND_TEST_ALL_PREFIXES(HistogramTest, Crc32TableTest);
 
   friend class StatisticsRecorder;  // To allow it to delete duplicates.
+  friend class SharedHistogramTable;  // To attach and detach |shared_data_|.
+
+  // The samples added by the threads that map to one shard.
+  class SampleShard;
+
+  // Number of shards that the threads adding samples are spread over.
+  static const size_t kNumSampleShards = 8;
 
   // Post constructor initialization.
   void Initialize();
 
+  // Returns the shard that the current thread adds samples to, creating it
+  // on first use.
+  SampleShard* GetSampleShard();
+
   // Checksum function for accumulating range values into a checksum.
   static uint32 Crc32(uint32 sum, Sample range);
 
@@ -654,8 +675,16 @@ class BASE_EXPORT Histogram {
   uint32 range_checksum_;
 
   // Finally, provide the state that changes with the addition of each new
-  // sample.
+  // sample: samples merged in with AddSampleSet(), and the shards Add() and
+  // friends count in.  Shards are created on demand and published with
+  // Release_Store(), so that most histograms only ever have one.
   SampleSet sample_;
+  subtle::AtomicWord sample_shards_[kNumSampleShards];
+
+  // Storage in a SharedHistogramTable that Add() and friends count in instead
+  // of the shards, so that other processes can read the samples.  Set by the
+  // StatisticsRecorder when it registers the histogram, if a table is current.
+  SharedHistogramData* shared_data_;
 
   DISALLOW_COPY_AND_ASSIGN(Histogram);
 };
@@ -836,8 +865,10 @@ class BASE_EXPORT StatisticsRecorder {
 
 
  private:
-  // We keep all registered histograms in a map, from name to histogram.
-  typedef std::map<std::string, Histogram*> HistogramMap;
+  // We keep all registered histograms in a hash map, from name to histogram,
+  // since they are looked up on every FactoryGet().  Lists of histograms are
+  // sorted by name when they are handed out.
+  typedef base::hash_map<std::string, Histogram*> HistogramMap;
 
   // We keep all |cached_ranges_| in a map, from checksum to a list of
   // |cached_ranges_|.  Checksum is calculated from the |ranges_| in
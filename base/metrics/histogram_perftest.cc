@@ -0,0 +1,200 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/metrics/histogram.h"
+
+#include <vector>
+
+#include "base/metrics/shared_histogram_table.h"
+#include "base/perftimer.h"
+#include "base/shared_memory.h"
+#include "base/stringprintf.h"
+#include "base/threading/simple_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+const int kSamplesPerThread = 200000;
+const int kLookupsPerThread = 50000;
+const int kNumHistograms = 200;
+const int kNumCollectedHistograms = 100;
+const int kCollectedBucketCount = 50;
+const int kNumCollections = 100;
+
+// Adds samples to one histogram shared by all threads.
+class SampleAdder : public DelegateSimpleThread::Delegate {
+ public:
+  explicit SampleAdder(Histogram* histogram) : histogram_(histogram) {}
+
+  virtual void Run() OVERRIDE {
+    for (int i = 0; i < kSamplesPerThread; ++i)
+      histogram_->Add(i & 1023);
+  }
+
+ private:
+  Histogram* histogram_;
+
+  DISALLOW_COPY_AND_ASSIGN(SampleAdder);
+};
+
+// Looks histograms up by name, as histograms with computed names have to.
+class HistogramLookup : public DelegateSimpleThread::Delegate {
+ public:
+  explicit HistogramLookup(const std::vector<std::string>& names)
+      : names_(names) {}
+
+  virtual void Run() OVERRIDE {
+    for (int i = 0; i < kLookupsPerThread; ++i) {
+      Histogram::FactoryGet(names_[i % names_.size()], 1, 1000, 50,
+                            Histogram::kNoFlags)->Add(i & 1023);
+    }
+  }
+
+ private:
+  const std::vector<std::string>& names_;
+
+  DISALLOW_COPY_AND_ASSIGN(HistogramLookup);
+};
+
+// Runs |delegate| on |num_threads| threads at once and returns the average
+// time each thread took, in nanoseconds.
+double RunOnThreads(DelegateSimpleThread::Delegate* delegate,
+                    int num_threads) {
+  DelegateSimpleThreadPool threads("histogram", num_threads);
+  threads.AddWork(delegate, num_threads);
+  PerfTimer timer;
+  threads.Start();
+  threads.JoinAll();
+  return timer.Elapsed().InMicroseconds() * 1000.0;
+}
+
+}  // namespace
+
+TEST(HistogramPerfTest, AddContention) {
+  StatisticsRecorder recorder;
+  const int kThreadCounts[] = { 1, 4, 16 };
+  for (size_t i = 0; i < arraysize(kThreadCounts); ++i) {
+    int num_threads = kThreadCounts[i];
+    Histogram* histogram = Histogram::FactoryGet(
+        StringPrintf("Perf.Add%d", num_threads), 1, 1000, 50,
+        Histogram::kNoFlags);
+    SampleAdder adder(histogram);
+    double nanoseconds = RunOnThreads(&adder, num_threads);
+    LogPerfResult(StringPrintf("Histogram_Add_%d_threads", num_threads).c_str(),
+                  nanoseconds / kSamplesPerThread, "ns/sample");
+
+    Histogram::SampleSet snapshot;
+    histogram->SnapshotSample(&snapshot);
+    EXPECT_GE(num_threads * kSamplesPerThread, snapshot.TotalCount());
+  }
+}
+
+TEST(HistogramPerfTest, FactoryGetContention) {
+  StatisticsRecorder recorder;
+  std::vector<std::string> names;
+  for (int i = 0; i < kNumHistograms; ++i)
+    names.push_back(StringPrintf("Perf.Lookup.Histogram%d", i));
+
+  const int kThreadCounts[] = { 1, 4, 16 };
+  for (size_t i = 0; i < arraysize(kThreadCounts); ++i) {
+    int num_threads = kThreadCounts[i];
+    HistogramLookup lookup(names);
+    double nanoseconds = RunOnThreads(&lookup, num_threads);
+    LogPerfResult(
+        StringPrintf("Histogram_FactoryGet_%d_threads", num_threads).c_str(),
+        nanoseconds / kLookupsPerThread, "ns/lookup");
+  }
+}
+
+// Compares collecting histograms from another process by pickling them, as
+// Histogram::SerializeHistogramInfo() and DeserializeHistogramInfo() do for
+// renderers, with reading them from a SharedHistogramTable.  The pickles are
+// deserialized in this process, so the cost of sending them is not counted.
+// Each collection copies every histogram into a SampleSet either way.
+TEST(HistogramPerfTest, CollectSharedMemoryVersusPickle) {
+  const std::string kTableName = "HistogramPerfTestTable";
+  SharedMemory().Delete(kTableName);
+  SharedHistogramTable table(
+      kTableName, kNumCollectedHistograms,
+      kNumCollectedHistograms * kCollectedBucketCount);
+  ASSERT_TRUE(table.is_valid());
+
+  StatisticsRecorder recorder;
+  std::vector<Histogram*> private_histograms;
+  for (int i = 0; i < kNumCollectedHistograms; ++i) {
+    private_histograms.push_back(Histogram::FactoryGet(
+        StringPrintf("Perf.Private%d", i), 1, 10000, kCollectedBucketCount,
+        Histogram::kNoFlags));
+  }
+  SharedHistogramTable::set_current(&table);
+  std::vector<Histogram*> shared_histograms;
+  for (int i = 0; i < kNumCollectedHistograms; ++i) {
+    shared_histograms.push_back(Histogram::FactoryGet(
+        StringPrintf("Perf.Shared%d", i), 1, 10000, kCollectedBucketCount,
+        Histogram::kNoFlags));
+  }
+  SharedHistogramTable::set_current(NULL);
+  ASSERT_EQ(kNumCollectedHistograms, table.GetHistogramCount());
+
+  PerfTimer add_timer;
+  for (int i = 0; i < kSamplesPerThread; ++i)
+    shared_histograms[i % kNumCollectedHistograms]->Add(i % 10000);
+  LogPerfResult("Histogram_Add_shared_memory",
+                add_timer.Elapsed().InMicroseconds() * 1000.0 /
+                    kSamplesPerThread,
+                "ns/sample");
+  for (int i = 0; i < kSamplesPerThread; ++i)
+    private_histograms[i % kNumCollectedHistograms]->Add(i % 10000);
+
+  std::vector<Histogram::SampleSet> sent(kNumCollectedHistograms);
+  for (int i = 0; i < kNumCollectedHistograms; ++i)
+    sent[i].Resize(*private_histograms[i]);
+  PerfTimer pickle_timer;
+  for (int collection = 0; collection < kNumCollections; ++collection) {
+    for (int i = 0; i < kNumCollectedHistograms; ++i) {
+      // Senders pickle the samples added since they last sent the histogram,
+      // and flag it, as renderers do.  The flag is cleared again so that the
+      // samples are merged into the same histogram, as they would be into the
+      // receiver's copy.
+      Histogram* histogram = private_histograms[i];
+      Histogram::SampleSet snapshot;
+      histogram->SnapshotSample(&snapshot);
+      snapshot.Subtract(sent[i]);
+      sent[i].Add(snapshot);
+      histogram->SetFlags(Histogram::kIPCSerializationSourceFlag);
+      std::string pickled =
+          Histogram::SerializeHistogramInfo(*histogram, snapshot);
+      histogram->ClearFlags(Histogram::kIPCSerializationSourceFlag);
+      ASSERT_TRUE(Histogram::DeserializeHistogramInfo(pickled));
+    }
+  }
+  LogPerfResult("Histogram_Collect_pickle",
+                static_cast<double>(
+                    pickle_timer.Elapsed().InMicroseconds()) / kNumCollections,
+                "us/collection");
+
+  // The collector maps the table separately, as another process would.
+  SharedHistogramTable collector(kTableName, 0, 0);
+  ASSERT_TRUE(collector.is_valid());
+  int64 total = 0;
+  PerfTimer shared_timer;
+  for (int collection = 0; collection < kNumCollections; ++collection) {
+    for (int i = 0; i < collector.GetHistogramCount(); ++i) {
+      Histogram::SampleSet snapshot;
+      collector.GetHistogram(i)->SnapshotSample(&snapshot);
+      total += snapshot.redundant_count();
+    }
+  }
+  LogPerfResult("Histogram_Collect_shared_memory",
+                static_cast<double>(
+                    shared_timer.Elapsed().InMicroseconds()) / kNumCollections,
+                "us/collection");
+  EXPECT_EQ(static_cast<int64>(kNumCollections) * kSamplesPerThread, total);
+
+  SharedMemory().Delete(kTableName);
+}
+
+}  // namespace base
@@ -9,6 +9,7 @@
 
 #include "base/memory/scoped_ptr.h"
 #include "base/metrics/histogram.h"
+#include "base/threading/simple_thread.h"
 #include "base/time.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
@@ -347,6 +348,71 @@ TEST(HistogramTest, BucketPlacementTest) {
     EXPECT_EQ(i + 1, sample.counts(i));
 }
 
+// Adds samples 0 to |num_samples| - 1 to a histogram.
+class SampleAdder : public DelegateSimpleThread::Delegate {
+ public:
+  SampleAdder(Histogram* histogram, int num_samples)
+      : histogram_(histogram),
+        num_samples_(num_samples) {}
+
+  virtual void Run() OVERRIDE {
+    for (int i = 0; i < num_samples_; ++i)
+      histogram_->Add(i);
+  }
+
+ private:
+  Histogram* histogram_;
+  const int num_samples_;
+
+  DISALLOW_COPY_AND_ASSIGN(SampleAdder);
+};
+
+// Samples added from more threads than there are shards are all counted.
+TEST(HistogramTest, ConcurrentAddsAreAllCounted) {
+  StatisticsRecorder recorder;
+  Histogram* histogram(LinearHistogram::FactoryGet(
+      "ConcurrentHistogram", 1, 100, 101, Histogram::kNoFlags));
+
+  const int kNumThreads = 20;
+  const int kNumSamples = 100;
+  SampleAdder adder(histogram, kNumSamples);
+  DelegateSimpleThreadPool threads("adder", kNumThreads);
+  threads.AddWork(&adder, kNumThreads);
+  threads.Start();
+  threads.JoinAll();
+
+  Histogram::SampleSet snapshot;
+  histogram->SnapshotSample(&snapshot);
+  EXPECT_EQ(0, histogram->FindCorruption(snapshot));
+  EXPECT_EQ(kNumThreads * kNumSamples, snapshot.TotalCount());
+  EXPECT_EQ(kNumThreads * kNumSamples, snapshot.redundant_count());
+  EXPECT_EQ(kNumThreads * kNumSamples * (kNumSamples - 1) / 2,
+            snapshot.sum());
+  for (size_t i = 0; i < histogram->bucket_count() - 1; ++i)
+    EXPECT_EQ(kNumThreads, snapshot.counts(i));
+}
+
+// Histograms are listed in order of their names.
+TEST(HistogramTest, GetHistogramsSortsByName) {
+  StatisticsRecorder recorder;
+  Histogram::FactoryGet("Sort.C", 1, 1000, 10, Histogram::kNoFlags);
+  Histogram::FactoryGet("Sort.A", 1, 1000, 10, Histogram::kNoFlags);
+  Histogram::FactoryGet("Sort.B", 1, 1000, 10, Histogram::kNoFlags);
+
+  StatisticsRecorder::Histograms histograms;
+  StatisticsRecorder::GetHistograms(&histograms);
+  ASSERT_EQ(3U, histograms.size());
+  EXPECT_EQ("Sort.A", histograms[0]->histogram_name());
+  EXPECT_EQ("Sort.B", histograms[1]->histogram_name());
+  EXPECT_EQ("Sort.C", histograms[2]->histogram_name());
+
+  histograms.clear();
+  StatisticsRecorder::GetSnapshot("Sort.", &histograms);
+  ASSERT_EQ(3U, histograms.size());
+  EXPECT_EQ("Sort.A", histograms[0]->histogram_name());
+  EXPECT_EQ("Sort.C", histograms[2]->histogram_name());
+}
+
 }  // namespace
 
 //------------------------------------------------------------------------------
@@ -357,12 +423,12 @@ TEST(HistogramTest, CorruptSampleCounts) {
   Histogram* histogram(Histogram::FactoryGet(
       "Histogram", 1, 64, 8, Histogram::kNoFlags));  // As per header file.
 
-  EXPECT_EQ(0, histogram->sample_.redundant_count());
+  Histogram::SampleSet snapshot;
+  histogram->SnapshotSample(&snapshot);
+  EXPECT_EQ(0, snapshot.redundant_count());
   histogram->Add(20);  // Add some samples.
   histogram->Add(40);
-  EXPECT_EQ(2, histogram->sample_.redundant_count());
 
-  Histogram::SampleSet snapshot;
   histogram->SnapshotSample(&snapshot);
   EXPECT_EQ(Histogram::NO_INCONSISTENCIES, 0);
   EXPECT_EQ(0, histogram->FindCorruption(snapshot));  // No default corruption.
@@ -0,0 +1,362 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/metrics/shared_histogram_table.h"
+
+#include <stddef.h>
+#include <string.h>
+#if defined(OS_POSIX)
+#include <sys/stat.h>
+#endif
+
+#include "base/logging.h"
+#include "base/process_util.h"
+#include "base/string_util.h"
+#include "base/threading/platform_thread.h"
+#include "base/time.h"
+
+namespace base {
+
+// The SharedHistogramTable uses a shared memory segment that is laid out as
+// follows
+//
+// +----------------------------------------------------------------+
+// | Version | Size | MaxHistograms | HistogramCount | FreeOffset   |
+// +----------------------------------------------------------------+
+// | Histogram offsets table                                        |
+// +----------------------------------------------------------------+
+// | SharedHistogramData, ranges and counts of each histogram       |
+// +----------------------------------------------------------------+
+//
+// The process that creates the segment fills in the header before it stores
+// Version with a release store, so processes that open the table wait until
+// they load Version with an acquire load before they use the rest of it.
+//
+// Histograms are allocated one after the other from FreeOffset, and their
+// offsets appended to the offsets table.  Each process that records a
+// histogram has its own SharedHistogramData for it.  Adding a histogram
+// requires the shared memory lock.  The histogram is initialized before
+// HistogramCount is incremented with a release store, so readers that load
+// HistogramCount with an acquire load only see initialized histograms, and
+// need no lock.
+//
+// All sizes and offsets in the segment are 32-bit, so that 32-bit and 64-bit
+// processes can share a table.
+
+namespace {
+
+// An internal version in case we ever change the format of the table, and
+// so that we can identify our tables.
+const int32 kTableVersion = 0x48495354;
+
+// How long to wait for the process that created a table to initialize it.
+const int kOpenRetryIntervalMs = 1;
+const int kMaxOpenRetries = 1000;
+
+// Rounds |size| up to a multiple of 8, so that the 64-bit sum of each
+// histogram is aligned.
+inline size_t AlignedSize(size_t size) {
+  return (size + 7) & ~static_cast<size_t>(7);
+}
+
+}  // namespace
+
+// static
+const size_t SharedHistogramData::kMaxNameLength;
+
+Histogram::Sample SharedHistogramData::ranges(size_t i) const {
+  DCHECK_LE(i, bucket_count());
+  return ranges_storage()[i];
+}
+
+Histogram::Count SharedHistogramData::counts(size_t i) const {
+  DCHECK_LT(i, bucket_count());
+  return subtle::NoBarrier_Load(&counts_storage()[i]);
+}
+
+int64 SharedHistogramData::sum() const {
+#if defined(ARCH_CPU_64_BITS)
+  return subtle::NoBarrier_Load(
+      reinterpret_cast<const volatile subtle::Atomic64*>(&sum_));
+#else
+  return sum_;
+#endif
+}
+
+int64 SharedHistogramData::redundant_count() const {
+  return subtle::NoBarrier_Load(&redundant_count_);
+}
+
+void SharedHistogramData::SnapshotSample(Histogram::SampleSet* sample) const {
+  sample->counts_.assign(bucket_count(), 0);
+  sample->sum_ = 0;
+  sample->redundant_count_ = 0;
+  AddToSampleSet(sample);
+}
+
+// static
+size_t SharedHistogramData::AllocationSize(size_t bucket_count) {
+  // 32-bit and 64-bit processes must agree on the layout, and the sum must
+  // be 8-byte aligned for 64-bit atomic operations.
+  COMPILE_ASSERT(offsetof(SharedHistogramData, sum_) == 96,
+                 shared_histogram_data_sum_offset_changed);
+  COMPILE_ASSERT(sizeof(SharedHistogramData) == 104,
+                 shared_histogram_data_layout_changed);
+  return AlignedSize(sizeof(SharedHistogramData) +
+                     (bucket_count + 1) * sizeof(Histogram::Sample) +
+                     bucket_count * sizeof(subtle::Atomic32));
+}
+
+void SharedHistogramData::Initialize(const Histogram& histogram,
+                                     ProcessId process_id) {
+  DCHECK_LT(histogram.histogram_name().size(), kMaxNameLength);
+  memset(static_cast<void*>(this), 0, AllocationSize(histogram.bucket_count()));
+  base::strlcpy(name_, histogram.histogram_name().c_str(), kMaxNameLength);
+  histogram_type_ = histogram.histogram_type();
+  declared_min_ = histogram.declared_min();
+  declared_max_ = histogram.declared_max();
+  bucket_count_ = static_cast<uint32>(histogram.bucket_count());
+  range_checksum_ = histogram.range_checksum();
+  process_id_ = static_cast<int32>(process_id);
+  Histogram::Sample* ranges = const_cast<Histogram::Sample*>(ranges_storage());
+  for (size_t i = 0; i <= histogram.bucket_count(); ++i)
+    ranges[i] = histogram.ranges(i);
+}
+
+bool SharedHistogramData::Matches(const Histogram& histogram) const {
+  return histogram.histogram_type() == histogram_type() &&
+         histogram.bucket_count() == bucket_count() &&
+         histogram.range_checksum() == range_checksum();
+}
+
+void SharedHistogramData::Accumulate(Histogram::Sample value,
+                                     Histogram::Count count,
+                                     size_t index) {
+  DCHECK(count == 1 || count == -1);
+  subtle::NoBarrier_AtomicIncrement(&counts_storage()[index], count);
+  subtle::NoBarrier_AtomicIncrement(&redundant_count_, count);
+#if defined(ARCH_CPU_64_BITS)
+  subtle::NoBarrier_AtomicIncrement(
+      reinterpret_cast<volatile subtle::Atomic64*>(&sum_),
+      static_cast<int64>(count) * value);
+#else
+  // There are no 64-bit atomic operations here, so concurrent updates of the
+  // sum may be lost, as in Histogram::SampleShard.
+  sum_ += count * value;
+#endif
+}
+
+void SharedHistogramData::AddToSampleSet(Histogram::SampleSet* sample) const {
+  DCHECK_EQ(bucket_count(), sample->counts_.size());
+  for (size_t i = 0; i < bucket_count(); ++i)
+    sample->counts_[i] += counts(i);
+  sample->sum_ += sum();
+  sample->redundant_count_ += redundant_count();
+}
+
+const Histogram::Sample* SharedHistogramData::ranges_storage() const {
+  return reinterpret_cast<const Histogram::Sample*>(this + 1);
+}
+
+subtle::Atomic32* SharedHistogramData::counts_storage() {
+  return reinterpret_cast<subtle::Atomic32*>(
+      const_cast<Histogram::Sample*>(ranges_storage()) + bucket_count() + 1);
+}
+
+const subtle::Atomic32* SharedHistogramData::counts_storage() const {
+  return reinterpret_cast<const subtle::Atomic32*>(
+      ranges_storage() + bucket_count() + 1);
+}
+
+// The header at the start of the shared memory segment.
+struct SharedHistogramTable::TableHeader {
+  // Stored last by the creator of the table.
+  volatile subtle::Atomic32 version;
+  uint32 size;
+  int32 max_histograms;
+  volatile subtle::Atomic32 histogram_count;
+  uint32 free_offset;
+  int32 padding;
+  // Followed by max_histograms offsets of histograms in the segment.
+
+  uint32* offsets() {
+    return reinterpret_cast<uint32*>(this + 1);
+  }
+};
+
+// We keep a process wide table which new histograms are stored in.
+SharedHistogramTable* SharedHistogramTable::global_table_ = NULL;
+
+SharedHistogramTable::SharedHistogramTable(const std::string& name,
+                                           int max_histograms,
+                                           int max_buckets)
+    : header_(NULL) {
+  DCHECK_GE(max_histograms, 0);
+  DCHECK_GE(max_buckets, 0);
+  uint32 size = static_cast<uint32>(
+      AlignedSize(sizeof(TableHeader) + max_histograms * sizeof(uint32)) +
+      max_histograms * SharedHistogramData::AllocationSize(0) +
+      max_buckets * (sizeof(Histogram::Sample) + sizeof(subtle::Atomic32)));
+
+  if (!shared_memory_.CreateNamed(name, true, size)) {
+    DPLOG(ERROR) << "SharedHistogramTable could not open " << name;
+    return;
+  }
+
+  // The segment was only created, and sized, by us if its created size is
+  // set.  Otherwise it holds a table, or will once its creator has set it up,
+  // and the header has its size.
+  bool created = shared_memory_.created_size() != 0;
+  if (!created) {
+    size = WaitForTableSize(name);
+    if (!size)
+      return;
+  }
+  if (!shared_memory_.Map(size))
+    return;
+
+  TableHeader* header = static_cast<TableHeader*>(shared_memory_.memory());
+  if (created) {
+    memset(header, 0, size);
+    header->size = size;
+    header->max_histograms = max_histograms;
+    header->free_offset = static_cast<uint32>(
+        AlignedSize(sizeof(TableHeader) + max_histograms * sizeof(uint32)));
+    subtle::Release_Store(&header->version, kTableVersion);
+  }
+  header_ = header;
+}
+
+SharedHistogramTable::~SharedHistogramTable() {
+  if (global_table_ == this)
+    global_table_ = NULL;
+
+  // The histograms are leaked, so they outlive the mapping.
+  AutoLock locked(lock_);
+  for (size_t i = 0; i < attached_histograms_.size(); ++i) {
+    Histogram* histogram = attached_histograms_[i];
+    Histogram::SampleSet sample;
+    sample.Resize(*histogram);
+    histogram->shared_data_->AddToSampleSet(&sample);
+    histogram->shared_data_ = NULL;
+    histogram->AddSampleSet(sample);
+  }
+}
+
+void SharedHistogramTable::AttachHistogram(Histogram* histogram) {
+  DCHECK(!histogram->shared_data_);
+  SharedHistogramData* data = FindOrAddHistogram(*histogram);
+  if (!data)
+    return;
+  AutoLock locked(lock_);
+  histogram->shared_data_ = data;
+  attached_histograms_.push_back(histogram);
+}
+
+SharedHistogramData* SharedHistogramTable::FindOrAddHistogram(
+    const Histogram& histogram) {
+  if (!header_ ||
+      histogram.histogram_name().size() >= SharedHistogramData::kMaxNameLength)
+    return NULL;
+
+  SharedMemoryAutoLock lock(&shared_memory_);
+  ProcessId process_id = GetCurrentProcId();
+  SharedHistogramData* data =
+      FindHistogramInternal(histogram.histogram_name(), process_id);
+  if (data) {
+    if (!data->Matches(histogram)) {
+      DLOG(ERROR) << "SharedHistogramTable has a different histogram called "
+                  << histogram.histogram_name();
+      return NULL;
+    }
+    return data;
+  }
+
+  size_t size = SharedHistogramData::AllocationSize(histogram.bucket_count());
+  int index = header_->histogram_count;
+  if (index >= header_->max_histograms ||
+      size > header_->size - header_->free_offset)
+    return NULL;
+
+  uint32 offset = header_->free_offset;
+  data = HistogramAt(offset);
+  data->Initialize(histogram, process_id);
+  header_->free_offset += static_cast<uint32>(size);
+  header_->offsets()[index] = offset;
+  subtle::Release_Store(&header_->histogram_count, index + 1);
+  return data;
+}
+
+int SharedHistogramTable::GetHistogramCount() const {
+  if (!header_)
+    return 0;
+  return subtle::Acquire_Load(&header_->histogram_count);
+}
+
+const SharedHistogramData* SharedHistogramTable::GetHistogram(
+    int index) const {
+  DCHECK_GE(index, 0);
+  DCHECK_LT(index, GetHistogramCount());
+  return HistogramAt(header_->offsets()[index]);
+}
+
+const SharedHistogramData* SharedHistogramTable::FindHistogram(
+    const std::string& name,
+    ProcessId process_id) const {
+  return FindHistogramInternal(name, process_id);
+}
+
+SharedHistogramData* SharedHistogramTable::FindHistogramInternal(
+    const std::string& name,
+    ProcessId process_id) const {
+  int count = GetHistogramCount();
+  for (int index = 0; index < count; ++index) {
+    SharedHistogramData* data = HistogramAt(header_->offsets()[index]);
+    if (data->process_id() == process_id && name == data->histogram_name())
+      return data;
+  }
+  return NULL;
+}
+
+uint32 SharedHistogramTable::WaitForTableSize(const std::string& name) {
+  for (int retry = 0; retry < kMaxOpenRetries; ++retry) {
+    if (retry > 0) {
+      PlatformThread::Sleep(
+          TimeDelta::FromMilliseconds(kOpenRetryIntervalMs));
+    }
+#if defined(OS_POSIX)
+    // The creator sizes the file after it has created it, and mapped pages
+    // past its end must not be touched.
+    struct stat file_stat;
+    if (fstat(shared_memory_.handle().fd, &file_stat) != 0) {
+      DPLOG(ERROR) << "SharedHistogramTable could not stat " << name;
+      return 0;
+    }
+    if (file_stat.st_size < static_cast<off_t>(sizeof(TableHeader)))
+      continue;
+#endif
+    if (!shared_memory_.Map(sizeof(TableHeader)))
+      return 0;
+    const TableHeader* header =
+        static_cast<const TableHeader*>(shared_memory_.memory());
+    int32 version = subtle::Acquire_Load(&header->version);
+    uint32 size = header->size;
+    shared_memory_.Unmap();
+    if (version == kTableVersion)
+      return size;
+    if (version != 0) {
+      DLOG(ERROR) << name << " is not a SharedHistogramTable";
+      return 0;
+    }
+  }
+  DLOG(ERROR) << name << " was not initialized in time";
+  return 0;
+}
+
+SharedHistogramData* SharedHistogramTable::HistogramAt(uint32 offset) const {
+  return reinterpret_cast<SharedHistogramData*>(
+      static_cast<char*>(shared_memory_.memory()) + offset);
+}
+
+}  // namespace base
@@ -0,0 +1,192 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+//
+// A SharedHistogramTable keeps the samples of histograms in a shared memory
+// segment, so that another process can read them in place rather than
+// having them pickled with Histogram::SerializeHistogramInfo() and sent over
+// IPC.
+//
+// A process that records histograms makes a table current with
+// SharedHistogramTable::set_current() before it creates them.  The
+// StatisticsRecorder then gives each new histogram storage in the table, and
+// Histogram::Add() counts into that storage with atomic increments.  A
+// collector process opens the same table by name and reads the bucket ranges
+// and counts straight from the mapping, with GetHistogram() or
+// FindHistogram(), without a round trip to the recording process.
+//
+// Histograms are never removed from a table.  Histograms created while no
+// table is current, created with no StatisticsRecorder, or that do not fit in
+// the table keep their samples in private memory as usual.  So do the
+// histograms of a table that is destroyed: the table folds the samples they
+// stored in it back into them first.
+
+#ifndef BASE_METRICS_SHARED_HISTOGRAM_TABLE_H_
+#define BASE_METRICS_SHARED_HISTOGRAM_TABLE_H_
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "base/atomicops.h"
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/compiler_specific.h"
+#include "base/metrics/histogram.h"
+#include "base/process.h"
+#include "base/shared_memory.h"
+#include "base/synchronization/lock.h"
+
+namespace base {
+
+// The storage of one histogram in a SharedHistogramTable.  It is laid out in
+// the shared memory segment, so it only holds fixed size fields, followed by
+// the bucket ranges and the counts.  Readers in other processes may see the
+// totals and the counts of samples that are being added disagree slightly,
+// as with Histogram::SnapshotSample().
+class BASE_EXPORT SharedHistogramData {
+ public:
+  // The maximum length of a histogram name, including the null terminator.
+  // Histograms with longer names are not stored in tables.
+  static const size_t kMaxNameLength = 64;
+
+  const char* histogram_name() const { return name_; }
+  // The process that records into this storage.
+  ProcessId process_id() const { return static_cast<ProcessId>(process_id_); }
+  Histogram::ClassType histogram_type() const {
+    return static_cast<Histogram::ClassType>(histogram_type_);
+  }
+  Histogram::Sample declared_min() const { return declared_min_; }
+  Histogram::Sample declared_max() const { return declared_max_; }
+  size_t bucket_count() const { return bucket_count_; }
+  uint32 range_checksum() const { return range_checksum_; }
+  Histogram::Sample ranges(size_t i) const;
+
+  Histogram::Count counts(size_t i) const;
+  int64 sum() const;
+  int64 redundant_count() const;
+
+  // Replaces |sample| with a copy of the samples.
+  void SnapshotSample(Histogram::SampleSet* sample) const;
+
+ private:
+  friend class Histogram;
+  friend class SharedHistogramTable;
+
+  // Returns the number of bytes needed to store a histogram with
+  // |bucket_count| buckets.
+  static size_t AllocationSize(size_t bucket_count);
+
+  // Copies the name and ranges of |histogram|, and zeroes the samples, for
+  // the process |process_id|.
+  void Initialize(const Histogram& histogram, ProcessId process_id);
+
+  // Returns true if this stores samples of histograms like |histogram|.
+  bool Matches(const Histogram& histogram) const;
+
+  // Counts |count| samples of |value| in bucket |index|.
+  void Accumulate(Histogram::Sample value,
+                  Histogram::Count count,
+                  size_t index);
+
+  // Adds the samples to |sample|, which must have bucket_count() buckets.
+  void AddToSampleSet(Histogram::SampleSet* sample) const;
+
+  const Histogram::Sample* ranges_storage() const;
+  subtle::Atomic32* counts_storage();
+  const subtle::Atomic32* counts_storage() const;
+
+  char name_[kMaxNameLength];
+  int32 histogram_type_;
+  int32 declared_min_;
+  int32 declared_max_;
+  uint32 bucket_count_;
+  uint32 range_checksum_;
+  int32 process_id_;
+  volatile subtle::Atomic32 redundant_count_;
+  // Updated with 64-bit atomic operations where they are available, so it is
+  // 8-byte aligned in 32-bit processes too.  AllocationSize() asserts that
+  // 32-bit and 64-bit processes agree on the layout.
+  ALIGNAS(8) volatile int64 sum_;
+  // Followed by bucket_count_ + 1 ranges and bucket_count_ counts.
+
+  DISALLOW_IMPLICIT_CONSTRUCTORS(SharedHistogramData);
+};
+
+class BASE_EXPORT SharedHistogramTable {
+ public:
+  // Opens the table called |name|, or creates it with room for
+  // |max_histograms| histograms with |max_buckets| buckets between them if
+  // it does not exist yet.  The sizes are ignored when the table exists.
+  // Use is_valid() to check that the table could be mapped.
+  SharedHistogramTable(const std::string& name,
+                       int max_histograms,
+                       int max_buckets);
+  // Detaches the histograms that store their samples in the table, after
+  // copying those samples into their private memory.  No thread may add
+  // samples to them meanwhile.
+  ~SharedHistogramTable();
+
+  // The table that new histograms of this process are stored in, or NULL.
+  static SharedHistogramTable* current() { return global_table_; }
+  static void set_current(SharedHistogramTable* value) {
+    global_table_ = value;
+  }
+
+  bool is_valid() const { return header_ != NULL; }
+
+  // Makes |histogram| count its samples in the storage of this process for
+  // the histogram of its name, if the table has room for it, until the table
+  // is destroyed.
+  void AttachHistogram(Histogram* histogram);
+
+  // Returns the number of histograms in the table, which may grow while the
+  // table is read.
+  int GetHistogramCount() const;
+
+  // Returns the histogram at |index|, which must be less than
+  // GetHistogramCount().
+  const SharedHistogramData* GetHistogram(int index) const;
+
+  // Returns the histogram called |name| that |process_id| records into, or
+  // NULL if the table does not have it.
+  const SharedHistogramData* FindHistogram(const std::string& name,
+                                           ProcessId process_id) const;
+
+ private:
+  struct TableHeader;
+
+  // Returns the storage of this process for the histogram with the name of
+  // |histogram|, adding it if the table does not have it yet.  Returns NULL
+  // if the name is too long, the table is full, or the table has a histogram
+  // of this name with different buckets.
+  SharedHistogramData* FindOrAddHistogram(const Histogram& histogram);
+
+  // Returns the histogram called |name| of |process_id|, or NULL.
+  SharedHistogramData* FindHistogramInternal(const std::string& name,
+                                             ProcessId process_id) const;
+
+  // Waits for the process that created the segment to initialize the table
+  // header, and returns the size of the table, or 0 if the segment does not
+  // hold a table.  The segment must not be mapped.
+  uint32 WaitForTableSize(const std::string& name);
+
+  // Returns the histogram stored at |offset| bytes into the segment.
+  SharedHistogramData* HistogramAt(uint32 offset) const;
+
+  SharedMemory shared_memory_;
+  TableHeader* header_;
+
+  // Protects |attached_histograms_|.
+  Lock lock_;
+  // The histograms that count their samples in the table.
+  std::vector<Histogram*> attached_histograms_;
+
+  static SharedHistogramTable* global_table_;
+
+  DISALLOW_COPY_AND_ASSIGN(SharedHistogramTable);
+};
+
+}  // namespace base
+
+#endif  // BASE_METRICS_SHARED_HISTOGRAM_TABLE_H_
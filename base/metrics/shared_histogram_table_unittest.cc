@@ -0,0 +1,279 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/metrics/shared_histogram_table.h"
+
+#include "base/memory/scoped_ptr.h"
+#include "base/metrics/histogram.h"
+#include "base/process_util.h"
+#include "base/shared_memory.h"
+#include "base/test/multiprocess_test.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/multiprocess_func_list.h"
+
+namespace base {
+
+class SharedHistogramTableTest : public MultiProcessTest {
+ public:
+  virtual void TearDown() OVERRIDE {
+    SharedHistogramTable::set_current(NULL);
+  }
+
+  void DeleteShmem(const std::string& name) {
+    SharedMemory mem;
+    mem.Delete(name);
+  }
+};
+
+// Samples of histograms created while a table is current are stored in the
+// table, where another mapping of the table can read them.
+TEST_F(SharedHistogramTableTest, SamplesAreStoredInTable) {
+  const std::string kTableName = "SamplesAreStoredInHistogramTable";
+  DeleteShmem(kTableName);
+  SharedHistogramTable table(kTableName, 10, 1000);
+  ASSERT_TRUE(table.is_valid());
+  SharedHistogramTable::set_current(&table);
+
+  StatisticsRecorder recorder;
+  Histogram* histogram = Histogram::FactoryGet("Shared.Exponential", 1, 1000,
+                                               20, Histogram::kNoFlags);
+  for (int i = 0; i < 1000; i += 7)
+    histogram->Add(i);
+  EXPECT_EQ(histogram, Histogram::FactoryGet("Shared.Exponential", 1, 1000,
+                                             20, Histogram::kNoFlags));
+
+  SharedHistogramTable reader(kTableName, 0, 0);
+  ASSERT_TRUE(reader.is_valid());
+  ASSERT_EQ(1, reader.GetHistogramCount());
+  const SharedHistogramData* data = reader.GetHistogram(0);
+  EXPECT_EQ(data, reader.FindHistogram("Shared.Exponential",
+                                       GetCurrentProcId()));
+  EXPECT_TRUE(reader.FindHistogram("Shared.Missing",
+                                   GetCurrentProcId()) == NULL);
+  EXPECT_STREQ("Shared.Exponential", data->histogram_name());
+  EXPECT_EQ(GetCurrentProcId(), data->process_id());
+  EXPECT_EQ(Histogram::HISTOGRAM, data->histogram_type());
+  EXPECT_EQ(histogram->range_checksum(), data->range_checksum());
+  ASSERT_EQ(histogram->bucket_count(), data->bucket_count());
+  for (size_t i = 0; i <= data->bucket_count(); ++i)
+    EXPECT_EQ(histogram->ranges(i), data->ranges(i));
+
+  Histogram::SampleSet snapshot;
+  histogram->SnapshotSample(&snapshot);
+  EXPECT_EQ(143, snapshot.TotalCount());
+  EXPECT_EQ(0, histogram->FindCorruption(snapshot));
+  Histogram::SampleSet shared_snapshot;
+  data->SnapshotSample(&shared_snapshot);
+  EXPECT_EQ(snapshot.sum(), shared_snapshot.sum());
+  EXPECT_EQ(snapshot.redundant_count(), shared_snapshot.redundant_count());
+  for (size_t i = 0; i < data->bucket_count(); ++i) {
+    EXPECT_EQ(snapshot.counts(i), data->counts(i));
+    EXPECT_EQ(snapshot.counts(i), shared_snapshot.counts(i));
+  }
+
+  DeleteShmem(kTableName);
+}
+
+// Histograms that do not fit in the table keep counting in private memory.
+TEST_F(SharedHistogramTableTest, FullTable) {
+  const std::string kTableName = "FullHistogramTable";
+  DeleteShmem(kTableName);
+  SharedHistogramTable table(kTableName, 2, 10);
+  ASSERT_TRUE(table.is_valid());
+  SharedHistogramTable::set_current(&table);
+
+  StatisticsRecorder recorder;
+  Histogram* first = LinearHistogram::FactoryGet("Shared.First", 1, 5, 6,
+                                                 Histogram::kNoFlags);
+  // Too many buckets for the space that is left.
+  Histogram* second = LinearHistogram::FactoryGet("Shared.Second", 1, 10, 11,
+                                                  Histogram::kNoFlags);
+  Histogram* third = BooleanHistogram::FactoryGet("Shared.Third",
+                                                  Histogram::kNoFlags);
+  Histogram* fourth = BooleanHistogram::FactoryGet("Shared.Fourth",
+                                                   Histogram::kNoFlags);
+  first->Add(3);
+  second->Add(3);
+  third->AddBoolean(true);
+  fourth->AddBoolean(true);
+
+  ASSERT_EQ(2, table.GetHistogramCount());
+  EXPECT_STREQ("Shared.First", table.GetHistogram(0)->histogram_name());
+  EXPECT_STREQ("Shared.Third", table.GetHistogram(1)->histogram_name());
+  Histogram* histograms[] = { first, second, third, fourth };
+  for (size_t i = 0; i < arraysize(histograms); ++i) {
+    Histogram::SampleSet snapshot;
+    histograms[i]->SnapshotSample(&snapshot);
+    EXPECT_EQ(1, snapshot.TotalCount());
+  }
+
+  DeleteShmem(kTableName);
+}
+
+const char kMultiProcessTableName[] = "MultiProcessHistogramTable";
+const int kChildSamples = 1000;
+
+MULTIPROCESS_TEST_MAIN(SharedHistogramTableChildMain) {
+  SharedHistogramTable table(kMultiProcessTableName, 0, 0);
+  if (!table.is_valid())
+    return 1;
+  SharedHistogramTable::set_current(&table);
+
+  StatisticsRecorder recorder;
+  Histogram* histogram = LinearHistogram::FactoryGet(
+      "Shared.Child", 1, 100, 101, Histogram::kNoFlags);
+  for (int i = 0; i < kChildSamples; ++i)
+    histogram->Add(i % 100);
+  return 0;
+}
+
+// A histogram that a child process records in is read from the table by the
+// parent, without the child sending it.
+TEST_F(SharedHistogramTableTest, ReadFromOtherProcess) {
+  DeleteShmem(kMultiProcessTableName);
+  SharedHistogramTable table(kMultiProcessTableName, 10, 1000);
+  ASSERT_TRUE(table.is_valid());
+
+  ProcessHandle child = SpawnChild("SharedHistogramTableChildMain", false);
+  ASSERT_NE(kNullProcessHandle, child);
+  ProcessId child_id = GetProcId(child);
+  int exit_code = -1;
+  EXPECT_TRUE(WaitForExitCode(child, &exit_code));
+  EXPECT_EQ(0, exit_code);
+
+  ASSERT_EQ(1, table.GetHistogramCount());
+  const SharedHistogramData* data =
+      table.FindHistogram("Shared.Child", child_id);
+  ASSERT_TRUE(data != NULL);
+  EXPECT_TRUE(table.FindHistogram("Shared.Child", GetCurrentProcId()) == NULL);
+  EXPECT_EQ(child_id, data->process_id());
+  EXPECT_EQ(Histogram::LINEAR_HISTOGRAM, data->histogram_type());
+  EXPECT_EQ(1, data->declared_min());
+  EXPECT_EQ(100, data->declared_max());
+  ASSERT_EQ(101u, data->bucket_count());
+  EXPECT_EQ(kChildSamples, data->redundant_count());
+  EXPECT_EQ(kChildSamples / 100 * (99 * 100 / 2), data->sum());
+  for (size_t i = 0; i < 100; ++i) {
+    EXPECT_EQ(static_cast<int>(i), data->ranges(i));
+    EXPECT_EQ(kChildSamples / 100, data->counts(i));
+  }
+  EXPECT_EQ(0, data->counts(100));
+
+  // A histogram of the same name in this process counts in its own storage,
+  // so it only holds the samples of this process.
+  SharedHistogramTable::set_current(&table);
+  StatisticsRecorder recorder;
+  Histogram* histogram = LinearHistogram::FactoryGet(
+      "Shared.Child", 1, 100, 101, Histogram::kNoFlags);
+  histogram->Add(50);
+  ASSERT_EQ(2, table.GetHistogramCount());
+  const SharedHistogramData* own_data =
+      table.FindHistogram("Shared.Child", GetCurrentProcId());
+  ASSERT_TRUE(own_data != NULL);
+  EXPECT_NE(data, own_data);
+  EXPECT_EQ(1, own_data->counts(50));
+  EXPECT_EQ(kChildSamples / 100, data->counts(50));
+  Histogram::SampleSet snapshot;
+  histogram->SnapshotSample(&snapshot);
+  EXPECT_EQ(1, snapshot.TotalCount());
+
+  DeleteShmem(kMultiProcessTableName);
+}
+
+// Samples that a child records in the table and also sends pickled, as
+// renderers do, are only counted once by a parent that records the same
+// histogram in the table.
+TEST_F(SharedHistogramTableTest, PickledSamplesAreNotCountedTwice) {
+  DeleteShmem(kMultiProcessTableName);
+  SharedHistogramTable table(kMultiProcessTableName, 10, 1000);
+  ASSERT_TRUE(table.is_valid());
+  SharedHistogramTable::set_current(&table);
+
+  StatisticsRecorder recorder;
+  Histogram* histogram = LinearHistogram::FactoryGet(
+      "Shared.Child", 1, 100, 101, Histogram::kNoFlags);
+  histogram->Add(50);
+
+  ProcessHandle child = SpawnChild("SharedHistogramTableChildMain", false);
+  ASSERT_NE(kNullProcessHandle, child);
+  ProcessId child_id = GetProcId(child);
+  int exit_code = -1;
+  EXPECT_TRUE(WaitForExitCode(child, &exit_code));
+  EXPECT_EQ(0, exit_code);
+
+  // Receive the samples of the child as if it had pickled them.  The pickle
+  // is built from this process's histogram, flagged as a sender, because it
+  // has the same name and ranges.
+  const SharedHistogramData* child_data =
+      table.FindHistogram("Shared.Child", child_id);
+  ASSERT_TRUE(child_data != NULL);
+  Histogram::SampleSet child_snapshot;
+  child_data->SnapshotSample(&child_snapshot);
+  histogram->SetFlags(Histogram::kIPCSerializationSourceFlag);
+  std::string pickled =
+      Histogram::SerializeHistogramInfo(*histogram, child_snapshot);
+  histogram->ClearFlags(Histogram::kIPCSerializationSourceFlag);
+  ASSERT_TRUE(Histogram::DeserializeHistogramInfo(pickled));
+
+  Histogram::SampleSet snapshot;
+  histogram->SnapshotSample(&snapshot);
+  EXPECT_EQ(kChildSamples + 1, snapshot.TotalCount());
+  EXPECT_EQ(kChildSamples / 100 + 1, snapshot.counts(50));
+  EXPECT_EQ(0, histogram->FindCorruption(snapshot));
+
+  DeleteShmem(kMultiProcessTableName);
+}
+
+// Histograms outlive the table they count in, and keep their samples and
+// keep counting in private memory once it is gone.
+TEST_F(SharedHistogramTableTest, DestroyedTableDetachesHistograms) {
+  const std::string kTableName = "DestroyedHistogramTable";
+  DeleteShmem(kTableName);
+  scoped_ptr<SharedHistogramTable> table(
+      new SharedHistogramTable(kTableName, 10, 1000));
+  ASSERT_TRUE(table->is_valid());
+  SharedHistogramTable::set_current(table.get());
+
+  StatisticsRecorder recorder;
+  Histogram* histogram = Histogram::FactoryGet("Shared.Detached", 1, 1000,
+                                               20, Histogram::kNoFlags);
+  histogram->Add(10);
+  ASSERT_TRUE(table->FindHistogram("Shared.Detached", GetCurrentProcId()));
+
+  table.reset();
+  EXPECT_TRUE(SharedHistogramTable::current() == NULL);
+  histogram->Add(10);
+  histogram->Add(500);
+
+  Histogram::SampleSet snapshot;
+  histogram->SnapshotSample(&snapshot);
+  EXPECT_EQ(3, snapshot.TotalCount());
+  EXPECT_EQ(520, snapshot.sum());
+  EXPECT_EQ(0, histogram->FindCorruption(snapshot));
+
+  DeleteShmem(kTableName);
+}
+
+// Segments whose creator never publishes a table header, or that hold
+// something else, are not used as tables.
+TEST_F(SharedHistogramTableTest, SegmentWithoutTable) {
+  const std::string kTableName = "SegmentWithoutHistogramTable";
+  DeleteShmem(kTableName);
+  SharedMemory other;
+  ASSERT_TRUE(other.CreateNamed(kTableName, false, 4096));
+  ASSERT_TRUE(other.Map(4096));
+  {
+    SharedHistogramTable table(kTableName, 0, 0);
+    EXPECT_FALSE(table.is_valid());
+  }
+  static_cast<int32*>(other.memory())[0] = 1;
+  {
+    SharedHistogramTable table(kTableName, 0, 0);
+    EXPECT_FALSE(table.is_valid());
+  }
+
+  DeleteShmem(kTableName);
+}
+
+}  // namespace base
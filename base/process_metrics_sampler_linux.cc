@@ -0,0 +1,228 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/process_metrics_sampler_linux.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "base/eintr_wrapper.h"
+#include "base/logging.h"
+#include "base/threading/thread_restrictions.h"
+
+namespace base {
+
+namespace {
+
+// Fields from /proc/<pid>/stat, 0-based. See man 5 proc.
+enum ProcStatsFields {
+  VM_STATE          = 2,   // Letter indicating the state of the process.
+  VM_UTIME          = 13,  // Time scheduled in user mode in clock ticks.
+  VM_STIME          = 14,  // Time scheduled in kernel mode in clock ticks.
+  VM_RSS            = 23,  // Resident Set Size in pages.
+};
+
+// Opens /proc/<pid>/<name>. Returns -1 on failure.
+int OpenProcFile(ProcessId pid, const char* name) {
+  char path[64];
+  snprintf(path, sizeof(path), "/proc/%d/%s", pid, name);
+  return HANDLE_EINTR(open(path, O_RDONLY | O_CLOEXEC));
+}
+
+void CloseProcFile(int fd) {
+  if (fd >= 0)
+    ignore_result(HANDLE_EINTR(close(fd)));
+}
+
+// Reads the current contents of the /proc file |fd| into |buffer| and NUL
+// terminates them. /proc files are generated again when read from the start,
+// so the same fd serves every sample. Returns false on failure, which is what
+// happens once the process is gone.
+bool ReadProcFile(int fd, char* buffer, size_t size) {
+  if (fd < 0)
+    return false;
+  ssize_t length = HANDLE_EINTR(pread(fd, buffer, size - 1, 0));
+  if (length <= 0)
+    return false;
+  buffer[length] = '\0';
+  return true;
+}
+
+// Parses the decimal number at |*cursor| and moves |*cursor| past it.
+// Returns false if there is no number there.
+bool ParseNumber(const char** cursor, uint64* value) {
+  const char* p = *cursor;
+  while (*p == ' ' || *p == '\t')
+    ++p;
+  if (*p < '0' || *p > '9')
+    return false;
+  uint64 result = 0;
+  for (; *p >= '0' && *p <= '9'; ++p)
+    result = result * 10 + (*p - '0');
+  *cursor = p;
+  *value = result;
+  return true;
+}
+
+// Parses the CPU time and the resident set size out of /proc/<pid>/stat.
+bool ParseStat(const char* stat, uint64* cpu, uint64* rss_pages) {
+  // The file is formatted as "pid (process name) state ...". Look for the
+  // closing paren from the end, since the name can contain one.
+  const char* p = strrchr(stat, ')');
+  if (!p || p[1] != ' ')
+    return false;
+  p += 2;
+
+  uint64 utime = 0;
+  uint64 stime = 0;
+  for (int field = VM_STATE; field < VM_RSS; ++field) {
+    if (field == VM_UTIME && !ParseNumber(&p, &utime))
+      return false;
+    if (field == VM_STIME && !ParseNumber(&p, &stime))
+      return false;
+    p = strchr(p, ' ');
+    if (!p)
+      return false;
+    ++p;
+  }
+  if (!ParseNumber(&p, rss_pages))
+    return false;
+  *cpu = utime + stime;
+  return true;
+}
+
+// Finds the line of |contents| that starts with |key| followed by a colon,
+// and parses the number after it. Returns false if there is no such line.
+bool ParseKeyValue(const char* contents, const char* key, uint64* value) {
+  size_t key_length = strlen(key);
+  for (const char* line = contents; line && *line;) {
+    if (strncmp(line, key, key_length) == 0 && line[key_length] == ':') {
+      const char* p = line + key_length + 1;
+      return ParseNumber(&p, value);
+    }
+    line = strchr(line, '\n');
+    if (line)
+      ++line;
+  }
+  return false;
+}
+
+}  // namespace
+
+ProcessMetricsSampler::Sample::Sample()
+    : pid(0),
+      valid(false),
+      cpu_usage(0),
+      rss_bytes(0),
+      pss_bytes(0),
+      has_io_counters(false) {
+  memset(&io_counters, 0, sizeof(io_counters));
+}
+
+ProcessMetricsSampler::ProcessMetricsSampler() {
+}
+
+ProcessMetricsSampler::~ProcessMetricsSampler() {
+  for (size_t i = 0; i < processes_.size(); ++i) {
+    CloseProcFile(processes_[i].stat_fd);
+    CloseProcFile(processes_[i].smaps_rollup_fd);
+    CloseProcFile(processes_[i].io_fd);
+  }
+}
+
+bool ProcessMetricsSampler::AddProcess(ProcessId pid) {
+  for (size_t i = 0; i < processes_.size(); ++i) {
+    if (processes_[i].pid == pid)
+      return false;
+  }
+
+  // Synchronously reading files in /proc is safe.
+  ThreadRestrictions::ScopedAllowIO allow_io;
+
+  TrackedProcess process;
+  process.pid = pid;
+  process.stat_fd = OpenProcFile(pid, "stat");
+  if (process.stat_fd < 0) {
+    DPLOG(WARNING) << "Failed to open the stat file of process " << pid;
+    return false;
+  }
+  process.smaps_rollup_fd = OpenProcFile(pid, "smaps_rollup");
+  process.io_fd = OpenProcFile(pid, "io");
+  process.last_cpu = -1;
+  processes_.push_back(process);
+  return true;
+}
+
+void ProcessMetricsSampler::RemoveProcess(ProcessId pid) {
+  for (std::vector<TrackedProcess>::iterator process = processes_.begin();
+       process != processes_.end(); ++process) {
+    if (process->pid == pid) {
+      CloseProcFile(process->stat_fd);
+      CloseProcFile(process->smaps_rollup_fd);
+      CloseProcFile(process->io_fd);
+      processes_.erase(process);
+      return;
+    }
+  }
+}
+
+void ProcessMetricsSampler::TakeSamples(std::vector<Sample>* samples) {
+  // Synchronously reading files in /proc is safe.
+  ThreadRestrictions::ScopedAllowIO allow_io;
+
+  samples->resize(processes_.size());
+  TimeTicks now = TimeTicks::Now();
+  for (size_t i = 0; i < processes_.size(); ++i)
+    TakeSample(&processes_[i], now, &(*samples)[i]);
+}
+
+void ProcessMetricsSampler::TakeSample(TrackedProcess* process,
+                                       TimeTicks now,
+                                       Sample* sample) {
+  // See ProcessMetrics::GetCPUUsage().
+  static const int kHertz = sysconf(_SC_CLK_TCK);
+  static const size_t kPageSize = getpagesize();
+
+  *sample = Sample();
+  sample->pid = process->pid;
+
+  uint64 cpu;
+  uint64 rss_pages;
+  if (!ReadProcFile(process->stat_fd, buffer_, sizeof(buffer_)) ||
+      !ParseStat(buffer_, &cpu, &rss_pages)) {
+    return;
+  }
+  sample->valid = true;
+  sample->rss_bytes = rss_pages * kPageSize;
+
+  if (process->last_cpu >= 0 && now > process->last_time) {
+    // Like ProcessMetrics, this goes over 100 when several threads together
+    // use more than one CPU.
+    sample->cpu_usage = 100.0 * (static_cast<int64>(cpu) - process->last_cpu) /
+        (kHertz * (now - process->last_time).InSecondsF());
+  }
+  process->last_cpu = cpu;
+  process->last_time = now;
+
+  uint64 pss_kb;
+  if (ReadProcFile(process->smaps_rollup_fd, buffer_, sizeof(buffer_)) &&
+      ParseKeyValue(buffer_, "Pss", &pss_kb)) {
+    sample->pss_bytes = pss_kb * 1024;
+  }
+
+  IoCounters* io = &sample->io_counters;
+  if (ReadProcFile(process->io_fd, buffer_, sizeof(buffer_)) &&
+      ParseKeyValue(buffer_, "syscr", &io->ReadOperationCount) &&
+      ParseKeyValue(buffer_, "syscw", &io->WriteOperationCount) &&
+      ParseKeyValue(buffer_, "rchar", &io->ReadTransferCount) &&
+      ParseKeyValue(buffer_, "wchar", &io->WriteTransferCount)) {
+    sample->has_io_counters = true;
+  } else {
+    memset(io, 0, sizeof(*io));
+  }
+}
+
+}  // namespace base
@@ -0,0 +1,93 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_PROCESS_METRICS_SAMPLER_LINUX_H_
+#define BASE_PROCESS_METRICS_SAMPLER_LINUX_H_
+#pragma once
+
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/process_util.h"
+#include "base/time.h"
+
+namespace base {
+
+// Samples the CPU usage, memory and IO counters of a set of processes, all in
+// one pass. Unlike ProcessMetrics, which opens and splits the /proc files of
+// a process into strings for every value, the sampler keeps the /proc files
+// of the processes it tracks open and parses them in a fixed buffer, so that
+// polling many processes often doesn't allocate.
+//
+// Not thread safe.
+class BASE_EXPORT ProcessMetricsSampler {
+ public:
+  struct Sample {
+    Sample();
+
+    ProcessId pid;
+
+    // False if the process is gone. The values below are then 0.
+    bool valid;
+
+    // CPU usage in percent since the previous sample, as returned by
+    // ProcessMetrics::GetCPUUsage(). 0 for the first sample of a process.
+    double cpu_usage;
+
+    // Resident set size, in bytes.
+    size_t rss_bytes;
+
+    // Proportional set size from /proc/<pid>/smaps_rollup, in bytes. 0 if the
+    // kernel doesn't provide it.
+    size_t pss_bytes;
+
+    // False if /proc/<pid>/io can't be read, which is the case for processes
+    // of other users, or without CONFIG_TASK_IO_ACCOUNTING.
+    bool has_io_counters;
+    IoCounters io_counters;
+  };
+
+  ProcessMetricsSampler();
+  ~ProcessMetricsSampler();
+
+  // Starts tracking |pid|. Returns false if it is already tracked, or if its
+  // /proc files can't be opened.
+  bool AddProcess(ProcessId pid);
+
+  // Stops tracking |pid| and closes its /proc files.
+  void RemoveProcess(ProcessId pid);
+
+  // Fills |samples| with a sample of each tracked process, in the order they
+  // were added. Reusing |samples| between calls avoids allocating.
+  void TakeSamples(std::vector<Sample>* samples);
+
+ private:
+  // The /proc files of a tracked process, -1 for those that can't be opened.
+  struct TrackedProcess {
+    ProcessId pid;
+    int stat_fd;
+    int smaps_rollup_fd;
+    int io_fd;
+
+    // The CPU time of the process, in jiffies, at |last_time|.
+    int64 last_cpu;
+    TimeTicks last_time;
+  };
+
+  // Fills |sample| for |process|, using |now| for the CPU usage.
+  void TakeSample(TrackedProcess* process, TimeTicks now, Sample* sample);
+
+  std::vector<TrackedProcess> processes_;
+
+  // Holds the contents of one /proc file at a time. The files read are much
+  // smaller than this.
+  char buffer_[4096];
+
+  DISALLOW_COPY_AND_ASSIGN(ProcessMetricsSampler);
+};
+
+}  // namespace base
+
+#endif  // BASE_PROCESS_METRICS_SAMPLER_LINUX_H_
@@ -0,0 +1,86 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/process_metrics_sampler_linux.h"
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "base/eintr_wrapper.h"
+#include "base/memory/scoped_vector.h"
+#include "base/perftimer.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+const int kNumProcesses = 32;
+const int kNumRounds = 200;
+
+class ProcessMetricsSamplerPerfTest : public testing::Test {
+ protected:
+  virtual void SetUp() OVERRIDE {
+    for (int i = 0; i < kNumProcesses; ++i) {
+      pid_t child = fork();
+      ASSERT_LE(0, child);
+      if (child == 0) {
+        pause();
+        _exit(0);
+      }
+      children_.push_back(child);
+    }
+  }
+
+  virtual void TearDown() OVERRIDE {
+    for (size_t i = 0; i < children_.size(); ++i) {
+      kill(children_[i], SIGKILL);
+      HANDLE_EINTR(waitpid(children_[i], NULL, 0));
+    }
+  }
+
+  void LogRate(const char* name, TimeDelta elapsed) {
+    LogPerfResult(name, kNumProcesses * kNumRounds / elapsed.InSecondsF(),
+                  "samples/s");
+  }
+
+  std::vector<pid_t> children_;
+};
+
+}  // namespace
+
+// Samples CPU usage, memory and IO counters of many processes, with
+// ProcessMetrics and with ProcessMetricsSampler.
+TEST_F(ProcessMetricsSamplerPerfTest, SampleProcesses) {
+  ScopedVector<ProcessMetrics> metrics;
+  for (size_t i = 0; i < children_.size(); ++i)
+    metrics.push_back(ProcessMetrics::CreateProcessMetrics(children_[i]));
+
+  PerfTimer metrics_timer;
+  for (int round = 0; round < kNumRounds; ++round) {
+    for (size_t i = 0; i < metrics.size(); ++i) {
+      WorkingSetKBytes working_set;
+      IoCounters io_counters;
+      metrics[i]->GetCPUUsage();
+      metrics[i]->GetWorkingSetSize();
+      metrics[i]->GetWorkingSetKBytes(&working_set);
+      metrics[i]->GetIOCounters(&io_counters);
+    }
+  }
+  LogRate("ProcessMetrics", metrics_timer.Elapsed());
+
+  ProcessMetricsSampler sampler;
+  for (size_t i = 0; i < children_.size(); ++i)
+    ASSERT_TRUE(sampler.AddProcess(children_[i]));
+  std::vector<ProcessMetricsSampler::Sample> samples;
+  PerfTimer sampler_timer;
+  for (int round = 0; round < kNumRounds; ++round)
+    sampler.TakeSamples(&samples);
+  LogRate("ProcessMetricsSampler", sampler_timer.Elapsed());
+}
+
+}  // namespace base
@@ -0,0 +1,100 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/process_metrics_sampler_linux.h"
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "base/eintr_wrapper.h"
+#include "base/file_path.h"
+#include "base/file_util.h"
+#include "base/memory/scoped_ptr.h"
+#include "base/time.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+TEST(ProcessMetricsSamplerTest, CurrentProcess) {
+  ProcessMetricsSampler sampler;
+  ASSERT_TRUE(sampler.AddProcess(GetCurrentProcId()));
+  EXPECT_FALSE(sampler.AddProcess(GetCurrentProcId()));
+
+  std::vector<ProcessMetricsSampler::Sample> samples;
+  sampler.TakeSamples(&samples);
+  ASSERT_EQ(1U, samples.size());
+  EXPECT_EQ(GetCurrentProcId(), samples[0].pid);
+  EXPECT_TRUE(samples[0].valid);
+  EXPECT_EQ(0, samples[0].cpu_usage);
+  EXPECT_GT(samples[0].rss_bytes, 0U);
+
+  // The RSS is what ProcessMetrics reports, give or take a page or two.
+  scoped_ptr<ProcessMetrics> metrics(
+      ProcessMetrics::CreateProcessMetrics(GetCurrentProcessHandle()));
+  size_t rss = metrics->GetWorkingSetSize();
+  EXPECT_LT(std::max(rss, samples[0].rss_bytes) -
+                std::min(rss, samples[0].rss_bytes),
+            1024U * 1024U);
+
+  // Reading a file shows in the IO counters, where they are available.
+  uint64 read_bytes = samples[0].io_counters.ReadTransferCount;
+  std::string contents;
+  ASSERT_TRUE(file_util::ReadFileToString(FilePath("/proc/self/status"),
+                                          &contents));
+
+  // Spin for a while, for some CPU usage.
+  TimeTicks end = TimeTicks::Now() + TimeDelta::FromMilliseconds(100);
+  while (TimeTicks::Now() < end) {
+  }
+
+  sampler.TakeSamples(&samples);
+  ASSERT_EQ(1U, samples.size());
+  EXPECT_TRUE(samples[0].valid);
+  EXPECT_GT(samples[0].cpu_usage, 0);
+  if (samples[0].has_io_counters) {
+    EXPECT_GE(samples[0].io_counters.ReadTransferCount,
+              read_bytes + contents.size());
+  }
+
+  sampler.RemoveProcess(GetCurrentProcId());
+  sampler.TakeSamples(&samples);
+  EXPECT_TRUE(samples.empty());
+}
+
+TEST(ProcessMetricsSamplerTest, ExitedProcess) {
+  pid_t child = fork();
+  ASSERT_LE(0, child);
+  if (child == 0) {
+    pause();
+    _exit(0);
+  }
+
+  ProcessMetricsSampler sampler;
+  ASSERT_TRUE(sampler.AddProcess(GetCurrentProcId()));
+  ASSERT_TRUE(sampler.AddProcess(child));
+
+  std::vector<ProcessMetricsSampler::Sample> samples;
+  sampler.TakeSamples(&samples);
+  ASSERT_EQ(2U, samples.size());
+  EXPECT_TRUE(samples[0].valid);
+  EXPECT_TRUE(samples[1].valid);
+  EXPECT_EQ(child, samples[1].pid);
+
+  ASSERT_EQ(0, kill(child, SIGKILL));
+  ASSERT_EQ(child, HANDLE_EINTR(waitpid(child, NULL, 0)));
+
+  // The files stay open, but the reads fail once the process is reaped.
+  sampler.TakeSamples(&samples);
+  ASSERT_EQ(2U, samples.size());
+  EXPECT_TRUE(samples[0].valid);
+  EXPECT_FALSE(samples[1].valid);
+  EXPECT_EQ(0U, samples[1].rss_bytes);
+}
+
+}  // namespace base
@@ -64,9 +64,9 @@ bool ReadProcStats(pid_t pid, std::string* buffer) {
 
 // Takes |stats_data| and populates |proc_stats| with the values split by
 // spaces. Taking into account the 2nd field may, in itself, contain spaces.
-// Returns true if successful.
+// The values point into |stats_data|. Returns true if successful.
 bool ParseProcStats(const std::string& stats_data,
-                    std::vector<std::string>* proc_stats) {
+                    std::vector<base::StringPiece>* proc_stats) {
   // The stat file is formatted as:
   // pid (process name) data1 data2 .... dataN
   // Look for the closing paren by scanning backwards, to avoid being fooled by
@@ -82,26 +82,30 @@ bool ParseProcStats(const std::string& stats_data,
   }
   open_parens_idx++;
 
+  base::StringPiece stats(stats_data);
   proc_stats->clear();
   // PID.
-  proc_stats->push_back(stats_data.substr(0, open_parens_idx));
+  proc_stats->push_back(stats.substr(0, open_parens_idx));
   // Process name without parentheses.
   proc_stats->push_back(
-      stats_data.substr(open_parens_idx + 1,
-                        close_parens_idx - (open_parens_idx + 1)));
+      stats.substr(open_parens_idx + 1,
+                   close_parens_idx - (open_parens_idx + 1)));
 
   // Split the rest.
-  std::vector<std::string> other_stats;
-  base::SplitString(stats_data.substr(close_parens_idx + 2), ' ', &other_stats);
-  for (size_t i = 0; i < other_stats.size(); ++i)
-    proc_stats->push_back(other_stats[i]);
+  base::StringPieceSplitter other_stats(stats.substr(close_parens_idx + 2),
+                                        ' ');
+  while (other_stats.GetNext()) {
+    base::StringPiece stat = other_stats.field();
+    TrimWhitespaceASCII(stat, TRIM_ALL, &stat);
+    proc_stats->push_back(stat);
+  }
   return true;
 }
 
 // Reads the |field_num|th field from |proc_stats|. Returns 0 on failure.
 // This version does not handle the first 3 values, since the first value is
 // simply |pid|, and the next two values are strings.
-int GetProcStatsFieldAsInt(const std::vector<std::string>& proc_stats,
+int GetProcStatsFieldAsInt(const std::vector<base::StringPiece>& proc_stats,
                            ProcStatsFields field_num) {
   if (field_num < VM_PPID) {
     NOTREACHED();
@@ -123,7 +127,7 @@ int ReadProcStatsAndGetFieldAsInt(pid_t pid, ProcStatsFields field_num) {
   std::string stats_data;
   if (!ReadProcStats(pid, &stats_data))
     return 0;
-  std::vector<std::string> proc_stats;
+  std::vector<base::StringPiece> proc_stats;
   if (!ParseProcStats(stats_data, &proc_stats))
     return 0;
   return GetProcStatsFieldAsInt(proc_stats, field_num);
@@ -134,7 +138,7 @@ int ReadProcStatsAndGetFieldAsInt(pid_t pid, ProcStatsFields field_num) {
 // This version only handles VM_COMM and VM_STATE, which are the only fields
 // that are strings.
 std::string GetProcStatsFieldAsString(
-    const std::vector<std::string>& proc_stats,
+    const std::vector<base::StringPiece>& proc_stats,
     ProcStatsFields field_num) {
   if (field_num < VM_COMM || field_num > VM_STATE) {
     NOTREACHED();
@@ -142,7 +146,7 @@ std::string GetProcStatsFieldAsString(
   }
 
   if (proc_stats.size() > static_cast<size_t>(field_num))
-    return proc_stats[field_num];
+    return proc_stats[field_num].as_string();
 
   NOTREACHED();
   return 0;
@@ -249,12 +253,10 @@ int ReadProcStatusAndGetFieldAsInt(pid_t pid, const std::string& field) {
       case KEY_VALUE:
         DCHECK(!last_key_name.empty());
         if (last_key_name == field) {
-          std::string value_str;
-          tokenizer.token_piece().CopyToString(&value_str);
-          std::string value_str_trimmed;
-          TrimWhitespaceASCII(value_str, TRIM_ALL, &value_str_trimmed);
-          std::vector<std::string> split_value_str;
-          base::SplitString(value_str_trimmed, ' ', &split_value_str);
+          base::StringPiece value_str;
+          TrimWhitespaceASCII(tokenizer.token_piece(), TRIM_ALL, &value_str);
+          std::vector<base::StringPiece> split_value_str;
+          base::SplitStringPiece(value_str, ' ', &split_value_str);
           if (split_value_str.size() != 2 || split_value_str[1] != "kB") {
             NOTREACHED();
             return 0;
@@ -317,7 +319,7 @@ bool ProcessIterator::CheckForNextProcess() {
   pid_t pid = kNullProcessId;
   std::vector<std::string> cmd_line_args;
   std::string stats_data;
-  std::vector<std::string> proc_stats;
+  std::vector<base::StringPiece> proc_stats;
 
   // Arbitrarily guess that there will never be more than 200 non-process
   // files in /proc.  Hardy has 53 and Lucid has 61.
@@ -444,8 +446,8 @@ bool ProcessMetrics::GetWorkingSetKBytes(WorkingSetKBytes* ws_usage) const {
       return false;
   }
 
-  std::vector<std::string> statm_vec;
-  base::SplitString(statm, ' ', &statm_vec);
+  std::vector<StringPiece> statm_vec;
+  SplitStringPiece(statm, ' ', &statm_vec);
   if (statm_vec.size() != 7)
     return false;  // Not the format we expect.
 
@@ -561,7 +563,7 @@ ProcessMetrics::ProcessMetrics(ProcessHandle process)
 
 // Exposed for testing.
 int ParseProcStatCPU(const std::string& input) {
-  std::vector<std::string> proc_stats;
+  std::vector<base::StringPiece> proc_stats;
   if (!ParseProcStats(input, &proc_stats))
     return -1;
 
@@ -615,8 +617,8 @@ bool GetSystemMemoryInfo(SystemMemoryInfoKB* meminfo) {
     DLOG(WARNING) << "Failed to open " << meminfo_file.value();
     return false;
   }
-  std::vector<std::string> meminfo_fields;
-  SplitStringAlongWhitespace(meminfo_data, &meminfo_fields);
+  std::vector<StringPiece> meminfo_fields;
+  SplitStringPieceAlongWhitespace(meminfo_data, &meminfo_fields);
 
   if (meminfo_fields.size() < kMemCachedIndex) {
     DLOG(WARNING) << "Failed to parse " << meminfo_file.value()
@@ -11,18 +11,35 @@
 
 namespace base {
 
-template<typename STR>
+namespace {
+
+// Trims the whitespace SplitString() documents for each type of field.
+void TrimField(string16* field) {
+  TrimWhitespace(*field, TRIM_ALL, field);
+}
+
+void TrimField(std::string* field) {
+  TrimWhitespaceASCII(*field, TRIM_ALL, field);
+}
+
+void TrimField(StringPiece* field) {
+  TrimWhitespaceASCII(*field, TRIM_ALL, field);
+}
+
+}  // namespace
+
+template<typename STR, typename FIELD>
 static void SplitStringT(const STR& str,
                          const typename STR::value_type s,
                          bool trim_whitespace,
-                         std::vector<STR>* r) {
+                         std::vector<FIELD>* r) {
   size_t last = 0;
   size_t c = str.size();
   for (size_t i = 0; i <= c; ++i) {
     if (i == c || str[i] == s) {
-      STR tmp(str, last, i - last);
+      FIELD tmp(str.data() + last, i - last);
       if (trim_whitespace)
-        TrimWhitespace(tmp, TRIM_ALL, &tmp);
+        TrimField(&tmp);
       // Avoid converting an empty or all-whitespace source string into a vector
       // of one empty string.
       if (i != c || !r->empty() || !tmp.empty())
@@ -49,45 +66,57 @@ void SplitString(const std::string& str,
   SplitStringT(str, c, true, r);
 }
 
-bool SplitStringIntoKeyValues(
-    const std::string& line,
+template<typename STR>
+static bool SplitStringIntoKeyValuesT(
+    const StringPiece& line,
     char key_value_delimiter,
-    std::string* key, std::vector<std::string>* values) {
-  key->clear();
-  values->clear();
-
+    STR* key, STR* value) {
   // Find the key string.
   size_t end_key_pos = line.find_first_of(key_value_delimiter);
-  if (end_key_pos == std::string::npos) {
+  if (end_key_pos == StringPiece::npos) {
     DVLOG(1) << "cannot parse key from line: " << line;
     return false;    // no key
   }
-  key->assign(line, 0, end_key_pos);
+  *key = STR(line.data(), end_key_pos);
 
   // Find the values string.
-  std::string remains(line, end_key_pos, line.size() - end_key_pos);
-  size_t begin_values_pos = remains.find_first_not_of(key_value_delimiter);
-  if (begin_values_pos == std::string::npos) {
+  size_t begin_values_pos =
+      line.find_first_not_of(key_value_delimiter, end_key_pos);
+  if (begin_values_pos == StringPiece::npos) {
     DVLOG(1) << "cannot parse value from line: " << line;
     return false;   // no value
   }
-  std::string values_string(remains, begin_values_pos,
-                            remains.size() - begin_values_pos);
+  *value = STR(line.data() + begin_values_pos,
+               line.size() - begin_values_pos);
+  return true;
+}
+
+bool SplitStringIntoKeyValues(
+    const std::string& line,
+    char key_value_delimiter,
+    std::string* key, std::vector<std::string>* values) {
+  key->clear();
+  values->clear();
+
+  std::string value;
+  if (!SplitStringIntoKeyValuesT(line, key_value_delimiter, key, &value))
+    return false;
 
   // Construct the values vector.
-  values->push_back(values_string);
+  values->push_back(value);
   return true;
 }
 
-bool SplitStringIntoKeyValuePairs(
-    const std::string& line,
+template<typename STR>
+static bool SplitStringIntoKeyValuePairsT(
+    const StringPiece& line,
     char key_value_delimiter,
     char key_value_pair_delimiter,
-    std::vector<std::pair<std::string, std::string> >* kv_pairs) {
+    std::vector<std::pair<STR, STR> >* kv_pairs) {
   kv_pairs->clear();
 
-  std::vector<std::string> pairs;
-  SplitString(line, key_value_pair_delimiter, &pairs);
+  std::vector<StringPiece> pairs;
+  SplitStringPiece(line, key_value_pair_delimiter, &pairs);
 
   bool success = true;
   for (size_t i = 0; i < pairs.size(); ++i) {
@@ -96,21 +125,37 @@ bool SplitStringIntoKeyValuePairs(
     if (pairs[i].empty())
       continue;
 
-    std::string key;
-    std::vector<std::string> value;
-    if (!SplitStringIntoKeyValues(pairs[i],
-                                  key_value_delimiter,
-                                  &key, &value)) {
+    STR key;
+    STR value;
+    if (!SplitStringIntoKeyValuesT(pairs[i], key_value_delimiter,
+                                   &key, &value)) {
       // Don't return here, to allow for keys without associated
       // values; just record that our split failed.
       success = false;
     }
-    DCHECK_LE(value.size(), 1U);
-    kv_pairs->push_back(make_pair(key, value.empty()? "" : value[0]));
+    kv_pairs->push_back(std::make_pair(key, value));
   }
   return success;
 }
 
+bool SplitStringIntoKeyValuePairs(
+    const std::string& line,
+    char key_value_delimiter,
+    char key_value_pair_delimiter,
+    std::vector<std::pair<std::string, std::string> >* kv_pairs) {
+  return SplitStringIntoKeyValuePairsT(line, key_value_delimiter,
+                                       key_value_pair_delimiter, kv_pairs);
+}
+
+bool SplitStringPieceIntoKeyValuePairs(
+    const StringPiece& line,
+    char key_value_delimiter,
+    char key_value_pair_delimiter,
+    std::vector<std::pair<StringPiece, StringPiece> >* kv_pairs) {
+  return SplitStringIntoKeyValuePairsT(line, key_value_delimiter,
+                                       key_value_pair_delimiter, kv_pairs);
+}
+
 template <typename STR>
 static void SplitStringUsingSubstrT(const STR& str,
                                     const STR& s,
@@ -163,8 +208,8 @@ void SplitStringDontTrim(const std::string& str,
   SplitStringT(str, c, false, r);
 }
 
-template<typename STR>
-void SplitStringAlongWhitespaceT(const STR& str, std::vector<STR>* result) {
+template<typename STR, typename FIELD>
+void SplitStringAlongWhitespaceT(const STR& str, std::vector<FIELD>* result) {
   const size_t length = str.length();
   if (!length)
     return;
@@ -183,7 +228,7 @@ void SplitStringAlongWhitespaceT(const STR& str, std::vector<STR>* result) {
         if (!last_was_ws) {
           if (i > 0) {
             result->push_back(
-                str.substr(last_non_ws_start, i - last_non_ws_start));
+                FIELD(str.data() + last_non_ws_start, i - last_non_ws_start));
           }
           last_was_ws = true;
         }
@@ -198,8 +243,8 @@ void SplitStringAlongWhitespaceT(const STR& str, std::vector<STR>* result) {
     }
   }
   if (!last_was_ws) {
-    result->push_back(
-        str.substr(last_non_ws_start, length - last_non_ws_start));
+    result->push_back(FIELD(str.data() + last_non_ws_start,
+                            length - last_non_ws_start));
   }
 }
 
@@ -213,4 +258,29 @@ void SplitStringAlongWhitespace(const std::string& str,
   SplitStringAlongWhitespaceT(str, result);
 }
 
+void SplitStringPiece(const StringPiece& str,
+                      char c,
+                      std::vector<StringPiece>* r) {
+#if CHAR_MIN < 0
+  DCHECK(c >= 0);
+#endif
+  DCHECK(c < 0x7F);
+  SplitStringT(str, c, true, r);
+}
+
+void SplitStringPieceDontTrim(const StringPiece& str,
+                              char c,
+                              std::vector<StringPiece>* r) {
+#if CHAR_MIN < 0
+  DCHECK(c >= 0);
+#endif
+  DCHECK(c < 0x7F);
+  SplitStringT(str, c, false, r);
+}
+
+void SplitStringPieceAlongWhitespace(const StringPiece& str,
+                                     std::vector<StringPiece>* result) {
+  SplitStringAlongWhitespaceT(str, result);
+}
+
 }  // namespace base
@@ -6,12 +6,15 @@
 #define BASE_STRING_SPLIT_H_
 #pragma once
 
+#include <string.h>
+
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "base/base_export.h"
 #include "base/string16.h"
+#include "base/string_piece.h"
 
 namespace base {
 
@@ -77,6 +80,71 @@ BASE_EXPORT void SplitStringAlongWhitespace(const string16& str,
 BASE_EXPORT void SplitStringAlongWhitespace(const std::string& str,
                                             std::vector<std::string>* result);
 
+// The functions below are the same as those above, but return pieces of
+// |str| instead of copies, so that no field allocates. |str| must outlive the
+// pieces.
+BASE_EXPORT void SplitStringPiece(const StringPiece& str,
+                                  char c,
+                                  std::vector<StringPiece>* r);
+BASE_EXPORT void SplitStringPieceDontTrim(const StringPiece& str,
+                                          char c,
+                                          std::vector<StringPiece>* r);
+BASE_EXPORT bool SplitStringPieceIntoKeyValuePairs(
+    const StringPiece& line,
+    char key_value_delimiter,
+    char key_value_pair_delimiter,
+    std::vector<std::pair<StringPiece, StringPiece> >* kv_pairs);
+BASE_EXPORT void SplitStringPieceAlongWhitespace(
+    const StringPiece& str,
+    std::vector<StringPiece>* result);
+
+// Iterates over the fields of |str| delimited by |c|, like
+// SplitStringDontTrim(), without copying them or building a vector. This is
+// for callers that look at the fields one at a time or only need a few of
+// them. |str| must outlive the splitter.
+//
+//   StringPieceSplitter fields(line, ' ');
+//   while (fields.GetNext())
+//     Use(fields.field());
+class StringPieceSplitter {
+ public:
+  StringPieceSplitter(const StringPiece& str, char c)
+      : str_(str),
+        delimiter_(c),
+        next_(str.empty() ? StringPiece::npos : 0) {
+  }
+
+  // Moves to the next field. Returns false once all of them were returned.
+  bool GetNext() {
+    if (next_ == StringPiece::npos)
+      return false;
+    const char* begin = str_.data() + next_;
+    size_t remaining = str_.size() - next_;
+    const char* end =
+        static_cast<const char*>(memchr(begin, delimiter_, remaining));
+    if (end) {
+      field_.set(begin, end - begin);
+      next_ += end - begin + 1;
+    } else {
+      field_.set(begin, remaining);
+      next_ = StringPiece::npos;
+    }
+    return true;
+  }
+
+  // The field GetNext() moved to.
+  const StringPiece& field() const { return field_; }
+
+ private:
+  StringPiece str_;
+  char delimiter_;
+
+  // Where the next field starts, or npos after the last one.
+  size_t next_;
+
+  StringPiece field_;
+};
+
 }  // namespace base
 
 #endif  // BASE_STRING_SPLIT_H
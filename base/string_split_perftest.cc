@@ -0,0 +1,122 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/string_split.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/perftimer.h"
+#include "base/string_util.h"
+#include "base/stringprintf.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+const int kIterations = 100000;
+
+// A line of /proc/<pid>/stat after the process name, 50 fields.
+std::string MakeStatLine() {
+  std::string line = "S";
+  for (int i = 0; i < 49; ++i)
+    line += StringPrintf(" %d", i * 7919);
+  line += "\n";
+  return line;
+}
+
+void LogRate(const char* name, size_t fields, const PerfTimer& timer) {
+  LogPerfResult(name, kIterations * fields / timer.Elapsed().InSecondsF(),
+                "fields/s");
+}
+
+}  // namespace
+
+TEST(StringSplitPerfTest, SplitLine) {
+  std::string line = MakeStatLine();
+  size_t fields = 0;
+
+  std::vector<std::string> strings;
+  PerfTimer strings_timer;
+  for (int i = 0; i < kIterations; ++i) {
+    strings.clear();
+    SplitString(line, ' ', &strings);
+  }
+  LogRate("SplitString", strings.size(), strings_timer);
+
+  std::vector<StringPiece> pieces;
+  PerfTimer pieces_timer;
+  for (int i = 0; i < kIterations; ++i) {
+    pieces.clear();
+    SplitStringPiece(line, ' ', &pieces);
+  }
+  LogRate("SplitStringPiece", pieces.size(), pieces_timer);
+  EXPECT_EQ(strings.size(), pieces.size());
+
+  PerfTimer splitter_timer;
+  for (int i = 0; i < kIterations; ++i) {
+    StringPieceSplitter splitter(line, ' ');
+    fields = 0;
+    while (splitter.GetNext())
+      ++fields;
+  }
+  LogRate("StringPieceSplitter", fields, splitter_timer);
+  EXPECT_EQ(strings.size(), fields);
+}
+
+TEST(StringSplitPerfTest, KeyValuePairs) {
+  std::string line;
+  for (int i = 0; i < 20; ++i)
+    line += StringPrintf("%sheader_%d=value %d", i ? "," : "", i, i * 7919);
+
+  std::vector<std::pair<std::string, std::string> > strings;
+  PerfTimer strings_timer;
+  for (int i = 0; i < kIterations; ++i)
+    SplitStringIntoKeyValuePairs(line, '=', ',', &strings);
+  LogRate("SplitStringIntoKeyValuePairs", strings.size(), strings_timer);
+
+  std::vector<std::pair<StringPiece, StringPiece> > pieces;
+  PerfTimer pieces_timer;
+  for (int i = 0; i < kIterations; ++i)
+    SplitStringPieceIntoKeyValuePairs(line, '=', ',', &pieces);
+  LogRate("SplitStringPieceIntoKeyValuePairs", pieces.size(), pieces_timer);
+  EXPECT_EQ(strings.size(), pieces.size());
+}
+
+TEST(StringSplitPerfTest, Join) {
+  std::string line = MakeStatLine();
+  std::vector<std::string> strings;
+  SplitString(line, ' ', &strings);
+  std::vector<StringPiece> pieces;
+  SplitStringPiece(line, ' ', &pieces);
+
+  // Appending without sizing the result first, as JoinString() used to.
+  std::string appended;
+  PerfTimer append_timer;
+  for (int i = 0; i < kIterations; ++i) {
+    appended = strings[0];
+    for (size_t j = 1; j < strings.size(); ++j) {
+      appended += ' ';
+      appended += strings[j];
+    }
+  }
+  LogRate("JoinString_append", strings.size(), append_timer);
+
+  std::string joined;
+  PerfTimer strings_timer;
+  for (int i = 0; i < kIterations; ++i)
+    joined = JoinString(strings, ' ');
+  LogRate("JoinString", strings.size(), strings_timer);
+  EXPECT_EQ(appended, joined);
+
+  PerfTimer pieces_timer;
+  for (int i = 0; i < kIterations; ++i)
+    joined = JoinString(pieces, ' ');
+  LogRate("JoinString_pieces", pieces.size(), pieces_timer);
+  EXPECT_EQ(appended, joined);
+}
+
+}  // namespace base
@@ -316,4 +316,108 @@ TEST(StringSplitTest, SplitStringAlongWhitespace) {
   }
 }
 
+TEST(StringSplitTest, SplitStringPiece) {
+  const char* const kInputs[] = {
+    "",
+    " ",
+    "a",
+    "a,b,c",
+    ",a,,b,",
+    "  a , b\t,\n c  ",
+    " \t ",
+    "a\tb c\n\nd ",
+  };
+  for (size_t i = 0; i < arraysize(kInputs); ++i) {
+    SCOPED_TRACE(kInputs[i]);
+    std::string input(kInputs[i]);
+
+    // The pieces are the strings the copying versions return, and the
+    // non-empty ones point into the input.
+    std::vector<std::string> expected;
+    std::vector<StringPiece> pieces;
+    SplitString(input, ',', &expected);
+    SplitStringPiece(input, ',', &pieces);
+    ASSERT_EQ(expected.size(), pieces.size());
+    for (size_t j = 0; j < pieces.size(); ++j) {
+      EXPECT_EQ(expected[j], pieces[j].as_string());
+      if (!pieces[j].empty()) {
+        EXPECT_GE(pieces[j].data(), input.data());
+        EXPECT_LE(pieces[j].data() + pieces[j].size(),
+                  input.data() + input.size());
+      }
+    }
+
+    expected.clear();
+    pieces.clear();
+    SplitStringDontTrim(input, ',', &expected);
+    SplitStringPieceDontTrim(input, ',', &pieces);
+    ASSERT_EQ(expected.size(), pieces.size());
+    for (size_t j = 0; j < pieces.size(); ++j)
+      EXPECT_EQ(expected[j], pieces[j].as_string());
+
+    expected.clear();
+    pieces.clear();
+    SplitStringAlongWhitespace(input, &expected);
+    SplitStringPieceAlongWhitespace(input, &pieces);
+    ASSERT_EQ(expected.size(), pieces.size());
+    for (size_t j = 0; j < pieces.size(); ++j)
+      EXPECT_EQ(expected[j], pieces[j].as_string());
+
+    // The splitter returns the fields of SplitStringDontTrim().
+    expected.clear();
+    SplitStringDontTrim(input, ',', &expected);
+    StringPieceSplitter splitter(input, ',');
+    for (size_t j = 0; j < expected.size(); ++j) {
+      ASSERT_TRUE(splitter.GetNext());
+      EXPECT_EQ(expected[j], splitter.field().as_string());
+    }
+    EXPECT_FALSE(splitter.GetNext());
+    EXPECT_FALSE(splitter.GetNext());
+  }
+}
+
+TEST(StringSplitTest, StringPieceSplitter) {
+  StringPieceSplitter splitter("1 (cat) S  4", ' ');
+  ASSERT_TRUE(splitter.GetNext());
+  EXPECT_EQ("1", splitter.field());
+  ASSERT_TRUE(splitter.GetNext());
+  EXPECT_EQ("(cat)", splitter.field());
+  ASSERT_TRUE(splitter.GetNext());
+  EXPECT_EQ("S", splitter.field());
+  ASSERT_TRUE(splitter.GetNext());
+  EXPECT_EQ("", splitter.field());
+  ASSERT_TRUE(splitter.GetNext());
+  EXPECT_EQ("4", splitter.field());
+  EXPECT_FALSE(splitter.GetNext());
+
+  StringPieceSplitter trailing("a:", ':');
+  ASSERT_TRUE(trailing.GetNext());
+  EXPECT_EQ("a", trailing.field());
+  ASSERT_TRUE(trailing.GetNext());
+  EXPECT_EQ("", trailing.field());
+  EXPECT_FALSE(trailing.GetNext());
+}
+
+TEST_F(SplitStringIntoKeyValuePairsTest, StringPieces) {
+  const char* const kInputs[] = {
+    "",
+    "key1:value1,,key3:value3",
+    "key1:value1 , key2:",
+    "key1:va:ue1 , key2:value2",
+    "key1::value1,:value2,key3",
+  };
+  for (size_t i = 0; i < arraysize(kInputs); ++i) {
+    SCOPED_TRACE(kInputs[i]);
+    std::vector<std::pair<StringPiece, StringPiece> > pieces;
+    EXPECT_EQ(SplitStringIntoKeyValuePairs(kInputs[i], ':', ',', &kv_pairs),
+              SplitStringPieceIntoKeyValuePairs(kInputs[i], ':', ',',
+                                                &pieces));
+    ASSERT_EQ(kv_pairs.size(), pieces.size());
+    for (size_t j = 0; j < pieces.size(); ++j) {
+      EXPECT_EQ(kv_pairs[j].first, pieces[j].first.as_string());
+      EXPECT_EQ(kv_pairs[j].second, pieces[j].second.as_string());
+    }
+  }
+}
+
 }  // namespace base
@@ -25,6 +25,7 @@
 #include "base/memory/singleton.h"
 #include "base/utf_string_conversion_utils.h"
 #include "base/utf_string_conversions.h"
+#include "base/utf_string_conversions_simd.h"
 #include "base/third_party/icu/icu_utf.h"
 
 namespace {
@@ -310,6 +311,40 @@ TrimPositions TrimWhitespaceASCII(const std::string& input,
   return TrimStringT(input, kWhitespaceASCII, positions, output);
 }
 
+// Returns true for the characters of kWhitespaceASCII.
+static inline bool IsWhitespaceASCII(char c) {
+  return c == 0x20 || (c >= 0x09 && c <= 0x0D);
+}
+
+TrimPositions TrimWhitespaceASCII(const base::StringPiece& input,
+                                  TrimPositions positions,
+                                  base::StringPiece* output) {
+  // Same as TrimStringT(), without the lookup tables StringPiece builds to
+  // search for several characters.
+  size_t begin = 0;
+  size_t end = input.size();
+  if (positions & TRIM_LEADING) {
+    while (begin < end && IsWhitespaceASCII(input[begin]))
+      ++begin;
+  }
+  if (positions & TRIM_TRAILING) {
+    while (end > begin && IsWhitespaceASCII(input[end - 1]))
+      --end;
+  }
+
+  if (begin == end) {
+    bool input_was_empty = input.empty();  // in case output == &input
+    output->clear();
+    return input_was_empty ? TRIM_NONE : positions;
+  }
+
+  TrimPositions trimmed = static_cast<TrimPositions>(
+      (begin == 0 ? TRIM_NONE : TRIM_LEADING) |
+      (end == input.size() ? TRIM_NONE : TRIM_TRAILING));
+  *output = input.substr(begin, end - begin);
+  return trimmed;
+}
+
 // This function is only for backward-compatibility.
 // To be removed when all callers are updated.
 TrimPositions TrimWhitespace(const std::string& input,
@@ -439,34 +474,41 @@ bool WideToLatin1(const std::wstring& wide, std::string* latin1) {
   return true;
 }
 
-template<class STR>
-static bool DoIsStringASCII(const STR& str) {
-  for (size_t i = 0; i < str.length(); i++) {
-    typename ToUnsigned<typename STR::value_type>::Unsigned c = str[i];
-    if (c > 0x7F)
-      return false;
-  }
-  return true;
-}
-
 bool IsStringASCII(const std::wstring& str) {
-  return DoIsStringASCII(str);
+  return base::CountLeadingASCII(str.data(), str.length()) == str.length();
 }
 
 #if !defined(WCHAR_T_IS_UTF16)
 bool IsStringASCII(const string16& str) {
-  return DoIsStringASCII(str);
+  return base::CountLeadingASCII(str.data(), str.length()) == str.length();
 }
 #endif
 
 bool IsStringASCII(const base::StringPiece& str) {
-  return DoIsStringASCII(str);
+  return base::CountLeadingASCII(str.data(), str.length()) == str.length();
 }
 
 bool IsStringUTF8(const std::string& str) {
   const char *src = str.data();
   int32 src_len = static_cast<int32>(str.length());
-  int32 char_index = 0;
+  int32 char_index = static_cast<int32>(
+      base::CountLeadingASCII(str.data(), str.length()));
+  if (char_index == src_len)
+    return true;
+
+#if defined(BASE_UTF_SIMD)
+  // The vectorized check only leaves noncharacters to the loop below.
+  if (base::internal::GetUTFSimdLevel() >= base::internal::UTF_SIMD_SSSE3) {
+    bool maybe_noncharacter;
+    if (!base::internal::IsWellFormedUTF8_SSSE3(src + char_index,
+                                                src_len - char_index,
+                                                &maybe_noncharacter)) {
+      return false;
+    }
+    if (!maybe_noncharacter)
+      return true;
+  }
+#endif
 
   while (char_index < src_len) {
     int32 code_point;
@@ -749,30 +791,42 @@ size_t Tokenize(const base::StringPiece& str,
   return TokenizeT(str, delimiters, tokens);
 }
 
-template<typename STR>
-static STR JoinStringT(const std::vector<STR>& parts,
+template<typename STR, typename PIECE>
+static STR JoinStringT(const std::vector<PIECE>& parts,
                        typename STR::value_type sep) {
   if (parts.empty())
     return STR();
 
-  STR result(parts[0]);
-  typename std::vector<STR>::const_iterator iter = parts.begin();
+  // Size the result first, so that it is allocated only once.
+  size_t length = parts.size() - 1;
+  typename std::vector<PIECE>::const_iterator iter;
+  for (iter = parts.begin(); iter != parts.end(); ++iter)
+    length += iter->size();
+
+  STR result;
+  result.reserve(length);
+  iter = parts.begin();
+  result.append(iter->data(), iter->size());
   ++iter;
 
   for (; iter != parts.end(); ++iter) {
     result += sep;
-    result += *iter;
+    result.append(iter->data(), iter->size());
   }
 
   return result;
 }
 
 std::string JoinString(const std::vector<std::string>& parts, char sep) {
-  return JoinStringT(parts, sep);
+  return JoinStringT<std::string>(parts, sep);
+}
+
+std::string JoinString(const std::vector<base::StringPiece>& parts, char sep) {
+  return JoinStringT<std::string>(parts, sep);
 }
 
 string16 JoinString(const std::vector<string16>& parts, char16 sep) {
-  return JoinStringT(parts, sep);
+  return JoinStringT<string16>(parts, sep);
 }
 
 template<class FormatStringType, class OutStringType>
@@ -235,6 +235,10 @@ BASE_EXPORT TrimPositions TrimWhitespace(const string16& input,
 BASE_EXPORT TrimPositions TrimWhitespaceASCII(const std::string& input,
                                               TrimPositions positions,
                                               std::string* output);
+// Same as above, but |output| points into |input| instead of being a copy.
+BASE_EXPORT TrimPositions TrimWhitespaceASCII(const base::StringPiece& input,
+                                              TrimPositions positions,
+                                              base::StringPiece* output);
 
 // Deprecated. This function is only for backward compatibility and calls
 // TrimWhitespaceASCII().
@@ -508,6 +512,8 @@ BASE_EXPORT size_t Tokenize(const base::StringPiece& str,
 BASE_EXPORT string16 JoinString(const std::vector<string16>& parts, char16 s);
 BASE_EXPORT std::string JoinString(
     const std::vector<std::string>& parts, char s);
+BASE_EXPORT std::string JoinString(
+    const std::vector<base::StringPiece>& parts, char s);
 
 // Replace $1-$2-$3..$9 in the format string with |a|-|b|-|c|..|i| respectively.
 // Additionally, any number of consecutive '$' characters is replaced by that
@@ -252,6 +252,18 @@ TEST(StringUtilTest, TrimWhitespace) {
               TrimWhitespace(value.input, value.positions, &output_ascii));
     EXPECT_EQ(value.output, output_ascii);
   }
+
+  base::StringPiece output_piece;
+  for (size_t i = 0; i < arraysize(trim_cases_ascii); ++i) {
+    const trim_case_ascii& value = trim_cases_ascii[i];
+    EXPECT_EQ(value.return_value,
+              TrimWhitespaceASCII(value.input, value.positions,
+                                  &output_piece));
+    EXPECT_EQ(value.output, output_piece);
+  }
+  EXPECT_EQ(TRIM_ALL, TrimWhitespaceASCII("\x0b\x0c a \x0b", TRIM_ALL,
+                                          &output_piece));
+  EXPECT_EQ("a", output_piece);
 }
 
 static const struct collapse_case {
@@ -765,6 +777,14 @@ TEST(StringUtilTest, JoinString) {
   EXPECT_EQ("a,b,c,", JoinString(in, ','));
   in.push_back(" ");
   EXPECT_EQ("a|b|c|| ", JoinString(in, '|'));
+
+  std::vector<base::StringPiece> pieces;
+  EXPECT_EQ("", JoinString(pieces, ','));
+  pieces.push_back("a");
+  EXPECT_EQ("a", JoinString(pieces, ','));
+  pieces.push_back("");
+  pieces.push_back("bc");
+  EXPECT_EQ("a,,bc", JoinString(pieces, ','));
 }
 
 TEST(StringUtilTest, StartsWith) {
@@ -4,9 +4,9 @@
 
 #include "base/threading/sequenced_worker_pool.h"
 
-#include <list>
+#include <deque>
 #include <map>
-#include <set>
+#include <queue>
 #include <utility>
 #include <vector>
 
@@ -38,11 +38,20 @@ namespace {
 struct SequencedTask {
   SequencedTask()
       : sequence_token_id(0),
+        sequence_task_number(0),
         shutdown_behavior(SequencedWorkerPool::BLOCK_SHUTDOWN) {}
 
   ~SequencedTask() {}
 
+  // Used to order the runnable tasks so that the task posted first runs
+  // first. Since the top of a priority queue is defined as the "greatest"
+  // element, we need to invert the comparison here.
+  bool operator<(const SequencedTask& other) const {
+    return sequence_task_number > other.sequence_task_number;
+  }
+
   int sequence_token_id;
+  int64 sequence_task_number;
   SequencedWorkerPool::WorkerShutdown shutdown_behavior;
   tracked_objects::Location location;
   Closure task;
@@ -352,9 +361,17 @@ class SequencedWorkerPool::Inner {
   int WillRunWorkerTask(const SequencedTask& task);
   void DidRunWorkerTask(const SequencedTask& task);
 
-  // Returns true if there are no threads currently running the given
-  // sequence token.
-  bool IsSequenceTokenRunnable(int sequence_token_id) const;
+  // Adds a newly posted task to the pending queues. If nothing else in its
+  // sequence is runnable or running, it becomes runnable right away;
+  // otherwise it waits behind the tasks already posted to that sequence.
+  // Must be called under lock.
+  void AddPendingTask(const SequencedTask& task);
+
+  // Called when a sequenced task has run or has been dropped during
+  // shutdown. Makes the next blocked task of the same sequence (if any)
+  // runnable, or marks the sequence as no longer in use. Must be called
+  // under lock.
+  void DidFinishSequencedTask(int sequence_token_id);
 
   // Checks if all threads are busy and the addition of one more could run an
   // additional task waiting in the queue. This must be called from within
@@ -432,21 +449,31 @@ class SequencedWorkerPool::Inner {
   // flag set.
   size_t blocking_shutdown_thread_count_;
 
-  // In-order list of all pending tasks. These are tasks waiting for a thread
-  // to run on or that are blocked on a previous task in their sequence.
-  //
-  // We maintain the pending_task_count_ separately for metrics because
-  // list.size() can be linear time.
-  std::list<SequencedTask> pending_tasks_;
+  // The number assigned to the next posted task, used to run runnable tasks
+  // in the order they were posted.
+  int64 next_sequence_task_number_;
+
+  // Tasks that can run as soon as a thread is available, ordered by
+  // sequence_task_number. This holds every pending unsequenced task and at
+  // most one task per sequence token: the head of that sequence.
+  std::priority_queue<SequencedTask> runnable_tasks_;
+
+  // Maps each sequence token that currently has a task runnable or running
+  // to the tasks posted to it after that one, in posting order. A token is
+  // present in this map exactly when one of its tasks is in
+  // |runnable_tasks_| or executing on a worker, so the deque holds only
+  // tasks that are blocked behind it.
+  typedef std::map<int, std::deque<SequencedTask> > BlockedTaskMap;
+  BlockedTaskMap blocked_tasks_;
+
+  // Total number of tasks in |runnable_tasks_| and |blocked_tasks_|. These
+  // are tasks waiting for a thread to run on or that are blocked on a
+  // previous task in their sequence.
   size_t pending_task_count_;
 
-  // Number of tasks in the pending_tasks_ list that are marked as blocking
-  // shutdown.
+  // Number of pending tasks that are marked as blocking shutdown.
   size_t blocking_shutdown_pending_task_count_;
 
-  // Lists all sequence tokens currently executing.
-  std::set<int> current_sequences_;
-
   // Set when Shutdown is called and no further tasks should be
   // allowed, though we may still be running existing tasks.
   bool shutdown_called_;
@@ -500,6 +527,7 @@ SequencedWorkerPool::Inner::Inner(
       thread_being_created_(false),
       waiting_thread_count_(0),
       blocking_shutdown_thread_count_(0),
+      next_sequence_task_number_(0),
       pending_task_count_(0),
       blocking_shutdown_pending_task_count_(0),
       shutdown_called_(false),
@@ -554,10 +582,8 @@ bool SequencedWorkerPool::Inner::PostTask(
     if (optional_token_name)
       sequenced.sequence_token_id = LockedGetNamedTokenID(*optional_token_name);
 
-    pending_tasks_.push_back(sequenced);
-    pending_task_count_++;
-    if (shutdown_behavior == BLOCK_SHUTDOWN)
-      blocking_shutdown_pending_task_count_++;
+    sequenced.sequence_task_number = next_sequence_task_number_++;
+    AddPendingTask(sequenced);
 
     create_thread_id = PrepareToStartAdditionalThreadIfHelpful();
   }
@@ -732,50 +758,32 @@ bool SequencedWorkerPool::Inner::GetWork(
     std::vector<Closure>* delete_these_outside_lock) {
   lock_.AssertAcquired();
 
-  DCHECK_EQ(pending_tasks_.size(), pending_task_count_);
   UMA_HISTOGRAM_COUNTS_100("SequencedWorkerPool.TaskCount",
                            static_cast<int>(pending_task_count_));
 
-  // Find the next task with a sequence token that's not currently in use.
-  // If the token is in use, that means another thread is running something
-  // in that sequence, and we can't run it without going out-of-order.
-  //
-  // This algorithm is simple and fair, but inefficient in some cases. For
-  // example, say somebody schedules 1000 slow tasks with the same sequence
-  // number. We'll have to go through all those tasks each time we feel like
-  // there might be work to schedule. If this proves to be a problem, we
-  // should make this more efficient.
-  //
-  // One possible enhancement would be to keep a map from sequence ID to a
-  // list of pending but currently blocked SequencedTasks for that ID.
-  // When a worker finishes a task of one sequence token, it can pick up the
-  // next one from that token right away.
-  //
-  // This may lead to starvation if there are sufficient numbers of sequences
-  // in use. To alleviate this, we could add an incrementing priority counter
-  // to each SequencedTask. Then maintain a priority_queue of all runnable
-  // tasks, sorted by priority counter. When a sequenced task is completed
-  // we would pop the head element off of that tasks pending list and add it
-  // to the priority queue. Then we would run the first item in the priority
-  // queue.
+  // Take the oldest runnable task. Tasks whose sequence token is in use are
+  // kept out of |runnable_tasks_| in |blocked_tasks_|, so they never have to
+  // be skipped over here; the next one in a sequence is promoted when the
+  // task ahead of it finishes (see DidFinishSequencedTask). Since runnable
+  // tasks are ordered by posting order this is as fair as walking a single
+  // in-order list, but doesn't depend on how many tasks are blocked.
   bool found_task = false;
-  int unrunnable_tasks = 0;
-  std::list<SequencedTask>::iterator i = pending_tasks_.begin();
-  while (i != pending_tasks_.end()) {
-    if (!IsSequenceTokenRunnable(i->sequence_token_id)) {
-      unrunnable_tasks++;
-      ++i;
-      continue;
-    }
-
-    if (shutdown_called_ && i->shutdown_behavior != BLOCK_SHUTDOWN) {
+  while (!runnable_tasks_.empty()) {
+    SequencedTask candidate = runnable_tasks_.top();
+    runnable_tasks_.pop();
+    pending_task_count_--;
+    if (candidate.shutdown_behavior == BLOCK_SHUTDOWN)
+      blocking_shutdown_pending_task_count_--;
+
+    if (shutdown_called_ && candidate.shutdown_behavior != BLOCK_SHUTDOWN) {
       // We're shutting down and the task we just found isn't blocking
       // shutdown. Delete it and get more work.
       //
-      // Note that we do not want to delete unrunnable tasks. Deleting a task
-      // can have side effects (like freeing some objects) and deleting a
-      // task that's supposed to run after one that's currently running could
-      // cause an obscure crash.
+      // Note that we do not delete blocked tasks here. Deleting a task can
+      // have side effects (like freeing some objects) and deleting a task
+      // that's supposed to run after one that's currently running could
+      // cause an obscure crash. Dropping this one does make the next task
+      // in its sequence runnable, just as running it would have.
       //
       // We really want to delete these tasks outside the lock in case the
       // closures are holding refs to objects that want to post work from
@@ -784,38 +792,29 @@ bool SequencedWorkerPool::Inner::GetWork(
       // until the lock is exited. The calling code can just clear() the
       // vector they passed to us once the lock is exited to make this
       // happen.
-      delete_these_outside_lock->push_back(i->task);
-      i = pending_tasks_.erase(i);
-      pending_task_count_--;
-    } else {
-      // Found a runnable task.
-      *task = *i;
-      i = pending_tasks_.erase(i);
-      pending_task_count_--;
-      if (task->shutdown_behavior == BLOCK_SHUTDOWN) {
-        blocking_shutdown_pending_task_count_--;
-      }
-
-      found_task = true;
-      break;
+      delete_these_outside_lock->push_back(candidate.task);
+      if (candidate.sequence_token_id)
+        DidFinishSequencedTask(candidate.sequence_token_id);
+      continue;
     }
+
+    // Found a runnable task.
+    *task = candidate;
+    found_task = true;
+    break;
   }
 
-  // Track the number of tasks we had to skip over to see if we should be
-  // making this more efficient. If this number ever becomes large or is
-  // frequently "some", we should consider the optimization above.
-  UMA_HISTOGRAM_COUNTS_100("SequencedWorkerPool.UnrunnableTaskCount",
-                           unrunnable_tasks);
+  // Track the number of tasks that are waiting behind another one in their
+  // sequence.
+  UMA_HISTOGRAM_COUNTS_100(
+      "SequencedWorkerPool.UnrunnableTaskCount",
+      static_cast<int>(pending_task_count_ - runnable_tasks_.size()));
   return found_task;
 }
 
 int SequencedWorkerPool::Inner::WillRunWorkerTask(const SequencedTask& task) {
   lock_.AssertAcquired();
 
-  // Mark the task's sequence number as in use.
-  if (task.sequence_token_id)
-    current_sequences_.insert(task.sequence_token_id);
-
   if (task.shutdown_behavior == BLOCK_SHUTDOWN)
     blocking_shutdown_thread_count_++;
 
@@ -846,15 +845,47 @@ void SequencedWorkerPool::Inner::DidRunWorkerTask(const SequencedTask& task) {
   }
 
   if (task.sequence_token_id)
-    current_sequences_.erase(task.sequence_token_id);
+    DidFinishSequencedTask(task.sequence_token_id);
 }
 
-bool SequencedWorkerPool::Inner::IsSequenceTokenRunnable(
-    int sequence_token_id) const {
+void SequencedWorkerPool::Inner::AddPendingTask(const SequencedTask& task) {
   lock_.AssertAcquired();
-  return !sequence_token_id ||
-      current_sequences_.find(sequence_token_id) ==
-          current_sequences_.end();
+
+  pending_task_count_++;
+  if (task.shutdown_behavior == BLOCK_SHUTDOWN)
+    blocking_shutdown_pending_task_count_++;
+
+  if (task.sequence_token_id) {
+    // The sequence is in use if it has an entry in the blocked map, so the
+    // new task has to wait its turn.
+    std::pair<BlockedTaskMap::iterator, bool> result =
+        blocked_tasks_.insert(
+            std::make_pair(task.sequence_token_id,
+                           std::deque<SequencedTask>()));
+    if (!result.second) {
+      result.first->second.push_back(task);
+      return;
+    }
+  }
+  runnable_tasks_.push(task);
+}
+
+void SequencedWorkerPool::Inner::DidFinishSequencedTask(
+    int sequence_token_id) {
+  lock_.AssertAcquired();
+  DCHECK(sequence_token_id);
+
+  BlockedTaskMap::iterator found = blocked_tasks_.find(sequence_token_id);
+  DCHECK(found != blocked_tasks_.end());
+  if (found->second.empty()) {
+    blocked_tasks_.erase(found);
+    return;
+  }
+
+  // Keep the entry so the sequence stays in use while its next task is
+  // runnable.
+  runnable_tasks_.push(found->second.front());
+  found->second.pop_front();
 }
 
 int SequencedWorkerPool::Inner::PrepareToStartAdditionalThreadIfHelpful() {
@@ -891,16 +922,12 @@ int SequencedWorkerPool::Inner::PrepareToStartAdditionalThreadIfHelpful() {
   if (!shutdown_called_ &&
       !thread_being_created_ &&
       threads_.size() < max_threads_ &&
-      waiting_thread_count_ == 0) {
-    // We could use an additional thread if there's work to be done.
-    for (std::list<SequencedTask>::iterator i = pending_tasks_.begin();
-         i != pending_tasks_.end(); ++i) {
-      if (IsSequenceTokenRunnable(i->sequence_token_id)) {
-        // Found a runnable task, mark the thread as being started.
-        thread_being_created_ = true;
-        return static_cast<int>(threads_.size() + 1);
-      }
-    }
+      waiting_thread_count_ == 0 &&
+      !runnable_tasks_.empty()) {
+    // We could use an additional thread since there's work to be done. Mark
+    // the thread as being started.
+    thread_being_created_ = true;
+    return static_cast<int>(threads_.size() + 1);
   }
   return 0;
 }
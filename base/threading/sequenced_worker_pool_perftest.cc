@@ -0,0 +1,70 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/threading/sequenced_worker_pool.h"
+
+#include <vector>
+
+#include "base/atomicops.h"
+#include "base/bind.h"
+#include "base/message_loop.h"
+#include "base/perftimer.h"
+#include "base/stringprintf.h"
+#include "base/test/sequenced_worker_pool_owner.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+const size_t kNumWorkerThreads = 4;
+const int kNumTasks = 100000;
+
+void IncrementCounter(volatile subtle::Atomic32* counter) {
+  subtle::NoBarrier_AtomicIncrement(counter, 1);
+}
+
+// Posts |kNumTasks| trivial tasks round-robin over |num_tokens| sequence
+// tokens (or unsequenced if |num_tokens| is 0), waits for all of them to run
+// and logs the throughput.
+void RunTasksAcrossTokens(int num_tokens) {
+  MessageLoop message_loop;
+  SequencedWorkerPoolOwner pool_owner(kNumWorkerThreads, "PerfTest");
+  const scoped_refptr<SequencedWorkerPool>& pool = pool_owner.pool();
+
+  std::vector<SequencedWorkerPool::SequenceToken> tokens;
+  for (int i = 0; i < num_tokens; ++i)
+    tokens.push_back(pool->GetSequenceToken());
+
+  volatile subtle::Atomic32 counter = 0;
+  PerfTimer timer;
+  for (int i = 0; i < kNumTasks; ++i) {
+    Closure task = Bind(&IncrementCounter, &counter);
+    if (num_tokens) {
+      pool->PostSequencedWorkerTask(tokens[i % num_tokens], FROM_HERE, task);
+    } else {
+      pool->PostWorkerTask(FROM_HERE, task);
+    }
+  }
+  pool->FlushForTesting();
+  double seconds = timer.Elapsed().InSecondsF();
+  EXPECT_EQ(kNumTasks, subtle::NoBarrier_Load(&counter));
+
+  LogPerfResult(StringPrintf("SequencedWorkerPool_%d_tokens", num_tokens)
+                    .c_str(),
+                kNumTasks / seconds, "tasks/s");
+  pool->Shutdown();
+}
+
+}  // namespace
+
+TEST(SequencedWorkerPoolPerfTest, Unsequenced) {
+  RunTasksAcrossTokens(0);
+}
+
+TEST(SequencedWorkerPoolPerfTest, TenTokens) {
+  RunTasksAcrossTokens(10);
+}
+
+}  // namespace base
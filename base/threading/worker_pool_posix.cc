@@ -4,13 +4,16 @@
 
 #include "base/threading/worker_pool_posix.h"
 
+#include "base/base_switches.h"
 #include "base/bind.h"
 #include "base/callback.h"
+#include "base/command_line.h"
 #include "base/debug/trace_event.h"
 #include "base/lazy_instance.h"
 #include "base/logging.h"
 #include "base/memory/ref_counted.h"
 #include "base/stringprintf.h"
+#include "base/sys_info.h"
 #include "base/threading/platform_thread.h"
 #include "base/threading/thread_local.h"
 #include "base/threading/worker_pool.h"
@@ -40,25 +43,59 @@ class WorkerPoolImpl {
 
  private:
   scoped_refptr<base::PosixDynamicThreadPool> pool_;
+  // Runs the tasks that aren't slow when --enable-work-stealing-worker-pool
+  // is given.  NULL otherwise.
+  scoped_refptr<base::PosixWorkStealingThreadPool> work_stealing_pool_;
 };
 
 WorkerPoolImpl::WorkerPoolImpl()
     : pool_(new base::PosixDynamicThreadPool("WorkerPool",
                                              kIdleSecondsBeforeExit)) {
+  // Processes that never initialize the CommandLine get the dynamic pool.
+  if (CommandLine::InitializedForCurrentProcess() &&
+      CommandLine::ForCurrentProcess()->HasSwitch(
+          switches::kEnableWorkStealingWorkerPool)) {
+    work_stealing_pool_ = new base::PosixWorkStealingThreadPool(
+        "WorkerPool", base::SysInfo::NumberOfProcessors());
+    work_stealing_pool_->Start();
+  }
 }
 
 WorkerPoolImpl::~WorkerPoolImpl() {
   pool_->Terminate();
+  if (work_stealing_pool_)
+    work_stealing_pool_->Terminate();
 }
 
 void WorkerPoolImpl::PostTask(const tracked_objects::Location& from_here,
                               const base::Closure& task, bool task_is_slow) {
-  pool_->PostTask(from_here, task);
+  // Slow tasks may block for a long time, which would starve the fixed set of
+  // work-stealing threads, so they always get a thread of their own.
+  if (work_stealing_pool_ && !task_is_slow)
+    work_stealing_pool_->PostTask(from_here, task);
+  else
+    pool_->PostTask(from_here, task);
 }
 
 base::LazyInstance<WorkerPoolImpl> g_lazy_worker_pool =
     LAZY_INSTANCE_INITIALIZER;
 
+// Runs a task taken from one of the thread pools on the current worker thread.
+void RunWorkerTask(const PendingTask& pending_task) {
+  TRACE_EVENT2("task", "WorkerThread::ThreadMain::Run",
+      "src_file", pending_task.posted_from.file_name(),
+      "src_func", pending_task.posted_from.function_name());
+
+  TrackedTime start_time =
+      tracked_objects::ThreadData::NowForStartOfRun(pending_task.birth_tally);
+
+  pending_task.task.Run();
+
+  tracked_objects::ThreadData::TallyRunOnWorkerThreadIfTracking(
+      pending_task.birth_tally, TrackedTime(pending_task.time_posted),
+      start_time, tracked_objects::ThreadData::NowForEndOfRun());
+}
+
 class WorkerThread : public PlatformThread::Delegate {
  public:
   WorkerThread(const std::string& name_prefix,
@@ -86,21 +123,57 @@ void WorkerThread::ThreadMain() {
     PendingTask pending_task = pool_->WaitForTask();
     if (pending_task.task.is_null())
       break;
-    TRACE_EVENT2("task", "WorkerThread::ThreadMain::Run",
-        "src_file", pending_task.posted_from.file_name(),
-        "src_func", pending_task.posted_from.function_name());
+    RunWorkerTask(pending_task);
+  }
+
+  // The WorkerThread is non-joinable, so it deletes itself.
+  delete this;
+}
+
+class WorkStealingWorkerThread : public PlatformThread::Delegate {
+ public:
+  WorkStealingWorkerThread(const std::string& name_prefix,
+                           base::PosixWorkStealingThreadPool* pool,
+                           int worker_index)
+      : name_prefix_(name_prefix),
+        pool_(pool),
+        worker_index_(worker_index) {}
+
+  virtual void ThreadMain() OVERRIDE;
+
+  const base::PosixWorkStealingThreadPool* pool() const { return pool_.get(); }
+  int worker_index() const { return worker_index_; }
+
+ private:
+  const std::string name_prefix_;
+  scoped_refptr<base::PosixWorkStealingThreadPool> pool_;
+  const int worker_index_;
 
-    TrackedTime start_time =
-        tracked_objects::ThreadData::NowForStartOfRun(pending_task.birth_tally);
+  DISALLOW_COPY_AND_ASSIGN(WorkStealingWorkerThread);
+};
 
-    pending_task.task.Run();
+// The WorkStealingWorkerThread running on the current thread, if any.  Used to
+// post tasks from a worker to its own queue.
+base::LazyInstance<ThreadLocalPointer<WorkStealingWorkerThread> >::Leaky
+    g_current_work_stealing_worker = LAZY_INSTANCE_INITIALIZER;
+
+void WorkStealingWorkerThread::ThreadMain() {
+  g_worker_pool_running_on_this_thread.Get().Set(true);
+  g_current_work_stealing_worker.Get().Set(this);
+  const std::string name = base::StringPrintf(
+      "%s/%d", name_prefix_.c_str(), PlatformThread::CurrentId());
+  // Note |name.c_str()| must remain valid for for the whole life of the thread.
+  PlatformThread::SetName(name.c_str());
 
-    tracked_objects::ThreadData::TallyRunOnWorkerThreadIfTracking(
-        pending_task.birth_tally, TrackedTime(pending_task.time_posted),
-        start_time, tracked_objects::ThreadData::NowForEndOfRun());
+  for (;;) {
+    PendingTask pending_task = pool_->WaitForTask(worker_index_);
+    if (pending_task.task.is_null())
+      break;
+    RunWorkerTask(pending_task);
   }
 
-  // The WorkerThread is non-joinable, so it deletes itself.
+  g_current_work_stealing_worker.Get().Set(NULL);
+  // The WorkStealingWorkerThread is non-joinable, so it deletes itself.
   delete this;
 }
 
@@ -196,4 +269,158 @@ PendingTask PosixDynamicThreadPool::WaitForTask() {
   return pending_task;
 }
 
+PosixWorkStealingThreadPool::WorkQueue::WorkQueue()
+    : size(0),
+      steal_seed(0) {}
+
+PosixWorkStealingThreadPool::WorkQueue::~WorkQueue() {}
+
+PosixWorkStealingThreadPool::PosixWorkStealingThreadPool(
+    const std::string& name_prefix,
+    int num_threads)
+    : name_prefix_(name_prefix),
+      num_threads_(num_threads),
+      queues_(new WorkQueue[num_threads]),
+      next_queue_(0),
+      num_parked_threads_(0),
+      terminated_(0),
+      park_cv_(&park_lock_) {
+  DCHECK_GT(num_threads, 0);
+  // The xorshift generator used to pick victims needs a nonzero seed.
+  for (int i = 0; i < num_threads_; ++i)
+    queues_[i].steal_seed = static_cast<uint32>(i) + 1;
+}
+
+PosixWorkStealingThreadPool::~PosixWorkStealingThreadPool() {}
+
+void PosixWorkStealingThreadPool::Start() {
+  for (int i = 0; i < num_threads_; ++i) {
+    // The new PlatformThread will take ownership of the worker, which will
+    // delete itself on exit.
+    WorkStealingWorkerThread* worker =
+        new WorkStealingWorkerThread(name_prefix_, this, i);
+    PlatformThread::CreateNonJoinable(kWorkerThreadStackSize, worker);
+  }
+}
+
+void PosixWorkStealingThreadPool::Terminate() {
+  {
+    AutoLock locked(park_lock_);
+    DCHECK(!subtle::NoBarrier_Load(&terminated_))
+        << "Thread pool is already terminated.";
+    subtle::Release_Store(&terminated_, 1);
+  }
+  park_cv_.Broadcast();
+}
+
+void PosixWorkStealingThreadPool::PostTask(
+    const tracked_objects::Location& from_here,
+    const base::Closure& task) {
+  int queue_index;
+  WorkStealingWorkerThread* worker = g_current_work_stealing_worker.Get().Get();
+  if (worker && worker->pool() == this) {
+    queue_index = worker->worker_index();
+  } else {
+    uint32 next = static_cast<uint32>(
+        subtle::NoBarrier_AtomicIncrement(&next_queue_, 1));
+    queue_index = static_cast<int>(next % num_threads_);
+  }
+  PendingTask pending_task(from_here, task);
+  AddTask(queue_index, &pending_task);
+}
+
+void PosixWorkStealingThreadPool::AddTask(int queue_index,
+                                          PendingTask* pending_task) {
+  WorkQueue& queue = queues_[queue_index];
+  {
+    AutoLock locked(queue.lock);
+    DCHECK(!subtle::NoBarrier_Load(&terminated_)) <<
+        "This thread pool is already terminated.  Do not post new tasks.";
+
+    queue.tasks.push_back(*pending_task);
+    pending_task->task.Reset();
+    subtle::NoBarrier_Store(&queue.size,
+                            static_cast<subtle::Atomic32>(queue.tasks.size()));
+  }
+
+  // Pairs with the increment of |num_parked_threads_| in WaitForTask(): either
+  // a worker about to park sees the new task when it looks again, or we see
+  // that it is parked and wake it up.
+  subtle::MemoryBarrier();
+  if (subtle::NoBarrier_Load(&num_parked_threads_) > 0) {
+    AutoLock locked(park_lock_);
+    park_cv_.Signal();
+  }
+}
+
+bool PosixWorkStealingThreadPool::PopTask(int queue_index,
+                                          bool steal,
+                                          PendingTask* task) {
+  WorkQueue& queue = queues_[queue_index];
+  if (!subtle::NoBarrier_Load(&queue.size))
+    return false;
+
+  AutoLock locked(queue.lock);
+  if (queue.tasks.empty())
+    return false;
+  if (steal) {
+    *task = queue.tasks.front();
+    queue.tasks.pop_front();
+  } else {
+    *task = queue.tasks.back();
+    queue.tasks.pop_back();
+  }
+  subtle::NoBarrier_Store(&queue.size,
+                          static_cast<subtle::Atomic32>(queue.tasks.size()));
+  return true;
+}
+
+bool PosixWorkStealingThreadPool::FindTask(int worker_index,
+                                           PendingTask* task) {
+  if (PopTask(worker_index, false, task))
+    return true;
+
+  // Our own queue is empty, so try to steal.  Starting the scan at a random
+  // victim keeps idle workers from all piling onto the same queue.
+  uint32& seed = queues_[worker_index].steal_seed;
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  int victim = static_cast<int>(seed % num_threads_);
+  for (int i = 0; i < num_threads_; ++i) {
+    int queue_index = (victim + i) % num_threads_;
+    if (queue_index != worker_index && PopTask(queue_index, true, task))
+      return true;
+  }
+  return false;
+}
+
+PendingTask PosixWorkStealingThreadPool::WaitForTask(int worker_index) {
+  DCHECK_GE(worker_index, 0);
+  DCHECK_LT(worker_index, num_threads_);
+
+  PendingTask pending_task(FROM_HERE, base::Closure());
+  while (!subtle::Acquire_Load(&terminated_)) {
+    if (FindTask(worker_index, &pending_task))
+      return pending_task;
+
+    // No work available.  Announce that we're about to park before looking
+    // one last time, so that a task posted in between is either found here
+    // or wakes us up.  Holding |park_lock_| until we wait makes sure the
+    // wakeup can't be lost.
+    AutoLock locked(park_lock_);
+    subtle::Barrier_AtomicIncrement(&num_parked_threads_, 1);
+    bool found = false;
+    if (!subtle::NoBarrier_Load(&terminated_)) {
+      found = FindTask(worker_index, &pending_task);
+      if (!found)
+        park_cv_.Wait();
+    }
+    subtle::Barrier_AtomicIncrement(&num_parked_threads_, -1);
+    if (found)
+      return pending_task;
+  }
+  return PendingTask(FROM_HERE, base::Closure());
+}
+
 }  // namespace base
@@ -17,6 +17,19 @@
 // worker threads exit.  The owner of PosixDynamicThreadPool should likewise
 // maintain a scoped_refptr to the PosixDynamicThreadPool instance.
 //
+// PosixWorkStealingThreadPool is an alternative backend with a fixed number of
+// worker threads, each owning its own task deque.  Tasks posted from a worker
+// thread go to the back of that worker's deque and tasks posted from elsewhere
+// are spread round-robin over all deques, so posting threads rarely contend on
+// the same lock.  A worker takes its next task from the back of its own deque,
+// so the tasks it has just posted run while their data is still in its cache.
+// A worker whose deque is empty steals from the front of the others, starting
+// at a random victim, so thieves take the oldest tasks, which are the ones the
+// owner would get to last.  It parks on a condition variable only once every
+// deque is empty.  Like PosixDynamicThreadPool its threads are non-joinable
+// and hold scoped_refptrs to the pool.  Since the number of threads is fixed,
+// it must only be given tasks that don't block for long.
+//
 // NOTE: The classes defined in this file are only meant for use by the POSIX
 // implementation of WorkerPool.  No one else should be using these classes.
 // These symbols are exported in a header purely for testing purposes.
@@ -25,9 +38,11 @@
 #define BASE_THREADING_WORKER_POOL_POSIX_H_
 #pragma once
 
+#include <deque>
 #include <queue>
 #include <string>
 
+#include "base/atomicops.h"
 #include "base/basictypes.h"
 #include "base/callback_forward.h"
 #include "base/location.h"
@@ -95,6 +110,87 @@ class BASE_EXPORT PosixDynamicThreadPool
   DISALLOW_COPY_AND_ASSIGN(PosixDynamicThreadPool);
 };
 
+class BASE_EXPORT PosixWorkStealingThreadPool
+    : public RefCountedThreadSafe<PosixWorkStealingThreadPool> {
+ public:
+  class PosixWorkStealingThreadPoolPeer;
+
+  // All |num_threads| worker threads will share the same |name_prefix|.
+  PosixWorkStealingThreadPool(const std::string& name_prefix,
+                              int num_threads);
+
+  // Creates the worker threads.  Must be called once, before PostTask().
+  void Start();
+
+  // Indicates that the thread pool is going away.  Stops handing out tasks to
+  // worker threads.  Wakes up all the parked threads to let them exit.
+  void Terminate();
+
+  // Adds |task| to the thread pool.
+  void PostTask(const tracked_objects::Location& from_here,
+                const Closure& task);
+
+  // Worker thread method for the worker owning queue |worker_index|.  Returns
+  // the next task from its own queue or one stolen from another worker,
+  // parking until one is available.  Returns a null task once the pool is
+  // terminated.
+  PendingTask WaitForTask(int worker_index);
+
+ private:
+  friend class RefCountedThreadSafe<PosixWorkStealingThreadPool>;
+  friend class PosixWorkStealingThreadPoolPeer;
+
+  // The task deque owned by one worker thread.  The owner pushes and pops at
+  // the back, thieves pop at the front.
+  struct WorkQueue {
+    WorkQueue();
+    ~WorkQueue();
+
+    Lock lock;  // Protects |tasks|.
+    std::deque<PendingTask> tasks;
+    // Mirrors tasks.size() so that thieves can skip empty deques without
+    // taking |lock|.
+    volatile subtle::Atomic32 size;
+    // State for picking steal victims.  Only used by the owning worker.
+    uint32 steal_seed;
+  };
+
+  ~PosixWorkStealingThreadPool();
+
+  // Adds |pending_task| to the back of the queue at |queue_index| and wakes up
+  // a parked worker if there is one.  This function will clear
+  // |pending_task->task|.
+  void AddTask(int queue_index, PendingTask* pending_task);
+
+  // Pops the newest task from the back of the queue at |queue_index|, or the
+  // oldest one from its front if |steal|, into |task|.  Returns false if that
+  // queue is empty.
+  bool PopTask(int queue_index, bool steal, PendingTask* task);
+
+  // Looks for work in the queue of |worker_index| and then in every other
+  // queue, starting at a pseudo-random victim.
+  bool FindTask(int worker_index, PendingTask* task);
+
+  const std::string name_prefix_;
+  const int num_threads_;
+
+  scoped_array<WorkQueue> queues_;
+
+  // Used to spread tasks posted from non-worker threads over the queues.
+  volatile subtle::Atomic32 next_queue_;
+
+  // Number of workers that are parked or about to park.  Posting threads
+  // only take |park_lock_| to wake one up when this is nonzero.
+  volatile subtle::Atomic32 num_parked_threads_;
+
+  volatile subtle::Atomic32 terminated_;
+
+  Lock park_lock_;
+  ConditionVariable park_cv_;
+
+  DISALLOW_COPY_AND_ASSIGN(PosixWorkStealingThreadPool);
+};
+
 }  // namespace base
 
 #endif  // BASE_THREADING_WORKER_POOL_POSIX_H_
@@ -0,0 +1,133 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/threading/worker_pool_posix.h"
+
+#include "base/atomicops.h"
+#include "base/bind.h"
+#include "base/memory/ref_counted.h"
+#include "base/perftimer.h"
+#include "base/stringprintf.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/simple_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+const int kNumTasks = 200000;
+
+// Counts down the tasks still to run.  Ref-counted so that the last task can
+// still be signalling |done| when the test stops waiting for it.
+class TaskCounter : public RefCountedThreadSafe<TaskCounter> {
+ public:
+  explicit TaskCounter(int num_tasks)
+      : remaining_(num_tasks),
+        done_(true, false) {}
+
+  void CountDown() {
+    if (subtle::Barrier_AtomicIncrement(&remaining_, -1) == 0)
+      done_.Signal();
+  }
+
+  void Wait() { done_.Wait(); }
+
+ private:
+  friend class RefCountedThreadSafe<TaskCounter>;
+  ~TaskCounter() {}
+
+  volatile subtle::Atomic32 remaining_;
+  WaitableEvent done_;
+
+  DISALLOW_COPY_AND_ASSIGN(TaskCounter);
+};
+
+// Posts its share of the tasks to whichever pool it was given.
+class TaskPoster : public DelegateSimpleThread::Delegate {
+ public:
+  TaskPoster(PosixDynamicThreadPool* dynamic_pool,
+             PosixWorkStealingThreadPool* work_stealing_pool,
+             TaskCounter* counter,
+             int num_tasks)
+      : dynamic_pool_(dynamic_pool),
+        work_stealing_pool_(work_stealing_pool),
+        counter_(counter),
+        num_tasks_(num_tasks) {}
+
+  virtual void Run() OVERRIDE {
+    Closure task = Bind(&TaskCounter::CountDown, counter_);
+    for (int i = 0; i < num_tasks_; ++i) {
+      if (work_stealing_pool_)
+        work_stealing_pool_->PostTask(FROM_HERE, task);
+      else
+        dynamic_pool_->PostTask(FROM_HERE, task);
+    }
+  }
+
+ private:
+  PosixDynamicThreadPool* dynamic_pool_;
+  PosixWorkStealingThreadPool* work_stealing_pool_;
+  scoped_refptr<TaskCounter> counter_;
+  const int num_tasks_;
+
+  DISALLOW_COPY_AND_ASSIGN(TaskPoster);
+};
+
+// Posts |kNumTasks| trivial tasks from |num_threads| threads and waits for
+// them all to run.  The work-stealing pool gets |num_threads| workers; the
+// dynamic pool creates as many as it decides to.
+void RunThroughput(int num_threads, bool work_stealing) {
+  scoped_refptr<PosixDynamicThreadPool> dynamic_pool;
+  scoped_refptr<PosixWorkStealingThreadPool> work_stealing_pool;
+  if (work_stealing) {
+    work_stealing_pool =
+        new PosixWorkStealingThreadPool("work_stealing_pool", num_threads);
+    work_stealing_pool->Start();
+  } else {
+    dynamic_pool = new PosixDynamicThreadPool("dynamic_pool", 60 * 60);
+  }
+
+  const int tasks_per_thread = kNumTasks / num_threads;
+  scoped_refptr<TaskCounter> counter(
+      new TaskCounter(tasks_per_thread * num_threads));
+  TaskPoster poster(dynamic_pool, work_stealing_pool, counter,
+                    tasks_per_thread);
+  DelegateSimpleThreadPool posting_threads("poster", num_threads);
+  posting_threads.AddWork(&poster, num_threads);
+
+  PerfTimer timer;
+  posting_threads.Start();
+  posting_threads.JoinAll();
+  counter->Wait();
+  double seconds = timer.Elapsed().InSecondsF();
+
+  LogPerfResult(StringPrintf("WorkerPool_%s_%d_threads",
+                             work_stealing ? "work_stealing" : "dynamic",
+                             num_threads).c_str(),
+                tasks_per_thread * num_threads / seconds, "tasks/s");
+
+  if (work_stealing)
+    work_stealing_pool->Terminate();
+  else
+    dynamic_pool->Terminate();
+}
+
+}  // namespace
+
+TEST(WorkerPoolPosixPerfTest, DynamicThreadPool) {
+  RunThroughput(1, false);
+  RunThroughput(4, false);
+  RunThroughput(16, false);
+  RunThroughput(64, false);
+}
+
+TEST(WorkerPoolPosixPerfTest, WorkStealingThreadPool) {
+  RunThroughput(1, true);
+  RunThroughput(4, true);
+  RunThroughput(16, true);
+  RunThroughput(64, true);
+}
+
+}  // namespace base
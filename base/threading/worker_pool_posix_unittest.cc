@@ -5,6 +5,7 @@
 #include "base/threading/worker_pool_posix.h"
 
 #include <set>
+#include <vector>
 
 #include "base/bind.h"
 #include "base/callback.h"
@@ -43,6 +44,23 @@ class PosixDynamicThreadPool::PosixDynamicThreadPoolPeer {
   DISALLOW_COPY_AND_ASSIGN(PosixDynamicThreadPoolPeer);
 };
 
+// Peer class to provide passthrough access to PosixWorkStealingThreadPool
+// internals.
+class PosixWorkStealingThreadPool::PosixWorkStealingThreadPoolPeer {
+ public:
+  explicit PosixWorkStealingThreadPoolPeer(PosixWorkStealingThreadPool* pool)
+      : pool_(pool) {}
+
+  int num_parked_threads() const {
+    return subtle::Acquire_Load(&pool_->num_parked_threads_);
+  }
+
+ private:
+  PosixWorkStealingThreadPool* pool_;
+
+  DISALLOW_COPY_AND_ASSIGN(PosixWorkStealingThreadPoolPeer);
+};
+
 namespace {
 
 // IncrementingTask's main purpose is to increment a counter.  It also updates a
@@ -251,4 +269,170 @@ TEST_F(PosixDynamicThreadPoolTest, Complex) {
   EXPECT_EQ(4, counter_);
 }
 
+namespace {
+
+const int kNumWorkStealingThreads = 4;
+
+// Increments |*counter| and signals |done| once it reaches |target|.
+void CountingTask(Lock* counter_lock,
+                  int* counter,
+                  int target,
+                  WaitableEvent* done) {
+  bool reached_target;
+  {
+    base::AutoLock locked(*counter_lock);
+    reached_target = ++(*counter) == target;
+  }
+  if (reached_target)
+    done->Signal();
+}
+
+// Posts |task| to |pool| from the current worker, which puts it on this
+// worker's own queue, then blocks until some other worker has run it.
+void PostToOwnQueueAndWait(PosixWorkStealingThreadPool* pool,
+                           const Closure& task,
+                           WaitableEvent* done) {
+  pool->PostTask(FROM_HERE, task);
+  done->Wait();
+}
+
+// Appends |index| to |*order| and signals |done| once |order| holds |target|
+// indices.
+void RecordIndexTask(Lock* order_lock,
+                     std::vector<int>* order,
+                     int index,
+                     int target,
+                     WaitableEvent* done) {
+  bool reached_target;
+  {
+    base::AutoLock locked(*order_lock);
+    order->push_back(index);
+    reached_target = static_cast<int>(order->size()) == target;
+  }
+  if (reached_target)
+    done->Signal();
+}
+
+// Posts |num_tasks| tasks that record their index, from 0 up, to this
+// worker's own queue.  If |wait|, then blocks until they have all run, which
+// means that other workers stole them.
+void PostOrderedTasks(PosixWorkStealingThreadPool* pool,
+                      Lock* order_lock,
+                      std::vector<int>* order,
+                      int num_tasks,
+                      bool wait,
+                      WaitableEvent* done) {
+  for (int i = 0; i < num_tasks; ++i) {
+    pool->PostTask(FROM_HERE, Bind(&RecordIndexTask, order_lock, order, i,
+                                   num_tasks, done));
+  }
+  if (wait)
+    done->Wait();
+}
+
+// Runs PostOrderedTasks() on a pool of |num_threads| workers and returns the
+// order the tasks ran in.
+std::vector<int> RunOrderedTasks(int num_threads, int num_tasks, bool wait) {
+  scoped_refptr<PosixWorkStealingThreadPool> pool(
+      new PosixWorkStealingThreadPool("work_stealing_pool", num_threads));
+  PosixWorkStealingThreadPool::PosixWorkStealingThreadPoolPeer peer(pool);
+  pool->Start();
+
+  Lock order_lock;
+  std::vector<int> order;
+  WaitableEvent done(true, false);
+  pool->PostTask(FROM_HERE, Bind(&PostOrderedTasks, pool, &order_lock, &order,
+                                 num_tasks, wait, &done));
+  done.Wait();
+
+  while (peer.num_parked_threads() < num_threads)
+    PlatformThread::YieldCurrentThread();
+  pool->Terminate();
+  return order;
+}
+
+class PosixWorkStealingThreadPoolTest : public testing::Test {
+ protected:
+  PosixWorkStealingThreadPoolTest()
+      : pool_(new PosixWorkStealingThreadPool("work_stealing_pool",
+                                              kNumWorkStealingThreads)),
+        peer_(pool_.get()),
+        counter_(0),
+        done_(true, false) {}
+
+  virtual void SetUp() OVERRIDE {
+    pool_->Start();
+  }
+
+  virtual void TearDown() OVERRIDE {
+    // Make sure no task still uses the fixture, then wake up the parked
+    // threads so they can terminate.
+    WaitForParkedThreads(kNumWorkStealingThreads);
+    pool_->Terminate();
+  }
+
+  void WaitForParkedThreads(int num_parked_threads) {
+    while (peer_.num_parked_threads() < num_parked_threads)
+      PlatformThread::YieldCurrentThread();
+  }
+
+  Closure CreateCountingTaskCallback(int target) {
+    return Bind(&CountingTask, &counter_lock_, &counter_, target, &done_);
+  }
+
+  scoped_refptr<PosixWorkStealingThreadPool> pool_;
+  PosixWorkStealingThreadPool::PosixWorkStealingThreadPoolPeer peer_;
+  Lock counter_lock_;
+  int counter_;
+  WaitableEvent done_;
+};
+
+}  // namespace
+
+TEST_F(PosixWorkStealingThreadPoolTest, RunsAllTasks) {
+  const int kNumTasks = 1000;
+  for (int i = 0; i < kNumTasks; ++i)
+    pool_->PostTask(FROM_HERE, CreateCountingTaskCallback(kNumTasks));
+
+  done_.Wait();
+  EXPECT_EQ(kNumTasks, counter_);
+}
+
+TEST_F(PosixWorkStealingThreadPoolTest, ParksIdleThreads) {
+  WaitForParkedThreads(kNumWorkStealingThreads);
+
+  // A parked thread must be woken up for a new task.
+  pool_->PostTask(FROM_HERE, CreateCountingTaskCallback(1));
+  done_.Wait();
+  EXPECT_EQ(1, counter_);
+}
+
+TEST_F(PosixWorkStealingThreadPoolTest, StealsFromBusyWorker) {
+  // The counting task lands on the queue of a worker that then blocks until
+  // it has run, so this only finishes if another worker steals it.
+  pool_->PostTask(FROM_HERE,
+                  Bind(&PostToOwnQueueAndWait, pool_,
+                       CreateCountingTaskCallback(1), &done_));
+  done_.Wait();
+  EXPECT_EQ(1, counter_);
+}
+
+// A worker runs the tasks on its own queue newest first.
+TEST(PosixWorkStealingThreadPoolOrderTest, OwnerPopsNewestTask) {
+  const int kNumTasks = 3;
+  std::vector<int> order = RunOrderedTasks(1, kNumTasks, false);
+  ASSERT_EQ(static_cast<size_t>(kNumTasks), order.size());
+  for (int i = 0; i < kNumTasks; ++i)
+    EXPECT_EQ(kNumTasks - 1 - i, order[i]);
+}
+
+// A thief takes the tasks of a busy worker oldest first.
+TEST(PosixWorkStealingThreadPoolOrderTest, ThiefStealsOldestTask) {
+  const int kNumTasks = 3;
+  std::vector<int> order = RunOrderedTasks(2, kNumTasks, true);
+  ASSERT_EQ(static_cast<size_t>(kNumTasks), order.size());
+  for (int i = 0; i < kNumTasks; ++i)
+    EXPECT_EQ(i, order[i]);
+}
+
 }  // namespace base
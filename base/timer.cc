@@ -5,8 +5,7 @@
 #include "base/timer.h"
 
 #include "base/logging.h"
-#include "base/single_thread_task_runner.h"
-#include "base/thread_task_runner_handle.h"
+#include "base/message_loop.h"
 #include "base/threading/platform_thread.h"
 
 namespace base {
@@ -25,9 +24,11 @@ class BaseTimerTaskInternal {
   ~BaseTimerTaskInternal() {
     // This task may be getting cleared because the task runner has been
     // destructed.  If so, don't leave Timer with a dangling pointer
-    // to this.
-    if (timer_)
+    // to this, nor try to cancel it.
+    if (timer_) {
+      timer_->scheduled_task_ = NULL;
       timer_->StopAndAbandon();
+    }
   }
 
   void Run() {
@@ -46,8 +47,8 @@ class BaseTimerTaskInternal {
     timer->RunScheduledTask();
   }
 
-  // The task remains in the MessageLoop queue, but nothing will happen when it
-  // runs.
+  // Nothing will happen if the task runs after this, in case the MessageLoop
+  // could not cancel it.
   void Abandon() {
     timer_ = NULL;
   }
@@ -93,6 +94,9 @@ void Timer::Stop() {
   is_running_ = false;
   if (!retain_user_task_)
     user_task_.Reset();
+  // Cancelling the scheduled task is cheap, so don't leave it in the
+  // MessageLoop until its run time.
+  AbandonScheduledTask();
 }
 
 void Timer::Reset() {
@@ -131,7 +135,8 @@ void Timer::PostNewScheduledTask(TimeDelta delay) {
   DCHECK(scheduled_task_ == NULL);
   is_running_ = true;
   scheduled_task_ = new BaseTimerTaskInternal(this);
-  ThreadTaskRunnerHandle::Get()->PostDelayedTask(posted_from_,
+  scheduled_task_handle_ = MessageLoop::current()->PostCancelableDelayedTask(
+      posted_from_,
       base::Bind(&BaseTimerTaskInternal::Run, base::Owned(scheduled_task_)),
       delay);
   scheduled_run_time_ = desired_run_time_ = TimeTicks::Now() + delay;
@@ -147,6 +152,10 @@ void Timer::AbandonScheduledTask() {
   if (scheduled_task_) {
     scheduled_task_->Abandon();
     scheduled_task_ = NULL;
+    // Deletes the abandoned task, unless it is already out of the delayed
+    // work queue.
+    MessageLoop::current()->CancelDelayedTask(scheduled_task_handle_);
+    scheduled_task_handle_ = TimerWheel::Handle();
   }
 }
 
@@ -56,6 +56,7 @@
 #include "base/callback.h"
 #include "base/location.h"
 #include "base/time.h"
+#include "base/timer_wheel.h"
 
 class MessageLoop;
 
@@ -99,8 +100,8 @@ class BASE_EXPORT Timer {
              TimeDelta delay,
              const base::Closure& user_task);
 
-  // Call this method to stop and cancel the timer.  It is a no-op if the timer
-  // is not running.
+  // Call this method to stop and cancel the timer.  The scheduled task is
+  // removed from the MessageLoop.  It is a no-op if the timer is not running.
   void Stop();
 
   // Call this method to reset the timer delay. The user_task_ must be set. If
@@ -141,6 +142,9 @@ class BASE_EXPORT Timer {
   // When non-NULL, the scheduled_task_ is waiting in the MessageLoop to call
   // RunScheduledTask() at scheduled_run_time_.
   BaseTimerTaskInternal* scheduled_task_;
+  // Identifies scheduled_task_ in the MessageLoop's delayed work queue, so
+  // that it can be cancelled.
+  TimerWheel::Handle scheduled_task_handle_;
 
   // Location in user code.
   tracked_objects::Location posted_from_;
@@ -0,0 +1,65 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/timer.h"
+
+#include "base/bind.h"
+#include "base/memory/scoped_vector.h"
+#include "base/message_loop.h"
+#include "base/perftimer.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+const int kNumTimers = 100000;
+const int kRounds = 10;
+
+void TimerTask() {
+}
+
+// Returns a delay between one and two minutes, so that no timer fires while
+// the test runs.
+TimeDelta DelayFor(int timer, int round) {
+  return TimeDelta::FromMilliseconds(60000 + (timer * 7919 + round) % 60000);
+}
+
+}  // namespace
+
+// Timeout-style timers that are restarted over and over: each round restarts
+// every timer with a new delay, which is earlier than the previous one for
+// half of them, and stops and restarts the other half.
+TEST(TimerPerfTest, RestartManyTimers) {
+  MessageLoop loop(MessageLoop::TYPE_DEFAULT);
+  ScopedVector<Timer> timers;
+  for (int i = 0; i < kNumTimers; ++i) {
+    timers.push_back(new Timer(false, false));
+    timers[i]->Start(FROM_HERE, DelayFor(i, 0), Bind(&TimerTask));
+  }
+
+  PerfTimer restart_timer;
+  for (int round = 1; round <= kRounds; ++round) {
+    for (int i = 0; i < kNumTimers; ++i) {
+      if (i % 2)
+        timers[i]->Stop();
+      timers[i]->Start(FROM_HERE,
+                       DelayFor(i, round) - TimeDelta::FromSeconds(round),
+                       Bind(&TimerTask));
+    }
+    // Let the loop look at its delayed work, as it would between events.
+    loop.RunAllPending();
+  }
+  LogPerfResult("Timer_Restart_100k",
+                kNumTimers * kRounds / restart_timer.Elapsed().InSecondsF(),
+                "restarts/s");
+
+  PerfTimer stop_timer;
+  timers.reset();
+  loop.RunAllPending();
+  LogPerfResult("Timer_Stop_100k", stop_timer.Elapsed().InMillisecondsF(),
+                "ms");
+}
+
+}  // namespace base
@@ -0,0 +1,331 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/timer_wheel.h"
+
+#include "base/logging.h"
+
+namespace base {
+
+namespace {
+
+// Returns the index of the most significant bit of |n|, which is not 0.
+int MostSignificantBit(uint64 n) {
+#if defined(COMPILER_GCC)
+  return 63 - __builtin_clzll(n);
+#else
+  int bit = 0;
+  while (n >>= 1)
+    ++bit;
+  return bit;
+#endif
+}
+
+// Returns the index of the least significant bit of |n|, which is not 0.
+int LeastSignificantBit(uint64 n) {
+#if defined(COMPILER_GCC)
+  return __builtin_ctzll(n);
+#else
+  int bit = 0;
+  while (!(n & 1)) {
+    n >>= 1;
+    ++bit;
+  }
+  return bit;
+#endif
+}
+
+// Ticks that differ from the tick the wheel has advanced to in higher bits
+// than these are past the range of its slots.
+const uint64 kSlotRangeMask = (static_cast<uint64>(1) << 36) - 1;
+
+}  // namespace
+
+struct TimerWheel::Entry : public LinkNode<Entry> {
+  enum Location {
+    FREE,
+    IN_SLOT,
+    IN_READY_HEAP,
+    IN_OVERFLOW_HEAP
+  };
+
+  explicit Entry(const PendingTask& pending_task)
+      : pending_task(pending_task),
+        tick(0),
+        location(FREE),
+        level(0),
+        slot(0),
+        heap_index(0),
+        generation(0) {
+  }
+
+  // Returns true if the task of |this| runs before that of |other|.
+  bool RunsBefore(const Entry* other) const {
+    // PendingTask::operator< orders the task to run first last.
+    return other->pending_task < pending_task;
+  }
+
+  PendingTask pending_task;
+
+  // The tick the task is due in.
+  int64 tick;
+
+  Location location;
+
+  // Where the entry is while it is in the slots.
+  int level;
+  int slot;
+
+  // Where the entry is while it is in the ready or overflow heap.
+  size_t heap_index;
+
+  // Incremented each time the entry is recycled, to invalidate its handles.
+  uint32 generation;
+};
+
+TimerWheel::TimerWheel()
+    : origin_(TimeTicks::Now()),
+      elapsed_(0),
+      size_(0) {
+  COMPILE_ASSERT(kBitsPerLevel * kNumLevels == 36, slot_range_mismatch);
+  for (int level = 0; level < kNumLevels; ++level)
+    occupied_[level] = 0;
+}
+
+TimerWheel::~TimerWheel() {
+  for (size_t i = 0; i < all_entries_.size(); ++i)
+    delete all_entries_[i];
+}
+
+TimerWheel::Handle TimerWheel::Add(const PendingTask& pending_task) {
+  DCHECK(!pending_task.delayed_run_time.is_null());
+  Entry* entry;
+  if (free_entries_.head() != free_entries_.end()) {
+    entry = free_entries_.head()->value();
+    entry->RemoveFromList();
+    entry->pending_task = pending_task;
+  } else {
+    entry = new Entry(pending_task);
+    all_entries_.push_back(entry);
+  }
+  entry->tick = TickFor(pending_task.delayed_run_time);
+  Insert(entry);
+  ++size_;
+  return Handle(entry, entry->generation);
+}
+
+bool TimerWheel::Cancel(const Handle& handle) {
+  Entry* entry = handle.entry_;
+  if (!entry || entry->generation != handle.generation_ ||
+      entry->location == Entry::FREE)
+    return false;
+  --size_;
+  Unlink(entry);
+  Recycle(entry);
+  return true;
+}
+
+TimeTicks TimerWheel::NextRunTime() {
+  const PendingTask* next_task = GetNextTask();
+  return next_task ? next_task->delayed_run_time : TimeTicks();
+}
+
+const PendingTask* TimerWheel::GetNextTask() {
+  // Moving |elapsed_| up to the next task is fine even though its time has
+  // not come: tasks added before it simply go straight to the ready heap.
+  for (;;) {
+    if (!ready_.empty())
+      return &ready_.front()->pending_task;
+    int level, slot;
+    int64 deadline;
+    if (NextExpiration(&level, &slot, &deadline)) {
+      Expire(level, slot, deadline);
+    } else if (!overflow_.empty()) {
+      ExpireOverflow();
+    } else {
+      return NULL;
+    }
+  }
+}
+
+void TimerWheel::Pop() {
+  DCHECK(!ready_.empty());
+  Entry* entry = ready_.front();
+  RemoveEntry(&ready_, entry);
+  --size_;
+  Recycle(entry);
+}
+
+int64 TimerWheel::TickFor(TimeTicks time) const {
+  return (time - origin_).InMilliseconds();
+}
+
+void TimerWheel::Insert(Entry* entry) {
+  if (entry->tick <= elapsed_) {
+    entry->location = Entry::IN_READY_HEAP;
+    PushEntry(&ready_, entry);
+    return;
+  }
+
+  // The level is that of the most significant group of bits in which the tick
+  // differs from |elapsed_|, so the slots of each level hold later tasks than
+  // those of the levels below it.
+  uint64 masked = static_cast<uint64>(elapsed_ ^ entry->tick) |
+      (kSlotsPerLevel - 1);
+  if (masked > kSlotRangeMask) {
+    entry->location = Entry::IN_OVERFLOW_HEAP;
+    PushEntry(&overflow_, entry);
+    return;
+  }
+  int level = MostSignificantBit(masked) / kBitsPerLevel;
+  int slot = static_cast<int>(
+      (entry->tick >> (kBitsPerLevel * level)) & (kSlotsPerLevel - 1));
+  entry->location = Entry::IN_SLOT;
+  entry->level = level;
+  entry->slot = slot;
+  slots_[level][slot].Append(entry);
+  occupied_[level] |= static_cast<uint64>(1) << slot;
+}
+
+void TimerWheel::Unlink(Entry* entry) {
+  switch (entry->location) {
+    case Entry::IN_SLOT: {
+      entry->RemoveFromList();
+      LinkedList<Entry>& list = slots_[entry->level][entry->slot];
+      if (list.head() == list.end())
+        occupied_[entry->level] &= ~(static_cast<uint64>(1) << entry->slot);
+      break;
+    }
+    case Entry::IN_READY_HEAP:
+      RemoveEntry(&ready_, entry);
+      break;
+    case Entry::IN_OVERFLOW_HEAP:
+      RemoveEntry(&overflow_, entry);
+      break;
+    default:
+      NOTREACHED();
+  }
+}
+
+bool TimerWheel::NextExpiration(int* level, int* slot,
+                                int64* deadline) const {
+  for (int i = 0; i < kNumLevels; ++i) {
+    if (!occupied_[i])
+      continue;
+    // The tasks of a level differ from |elapsed_| in the bits of the level, and
+    // are later, so they are all in slots after the current one.
+    int shift = kBitsPerLevel * i;
+    int current = static_cast<int>((elapsed_ >> shift) & (kSlotsPerLevel - 1));
+    uint64 later = occupied_[i] & (~static_cast<uint64>(0) << current);
+    DCHECK(later);
+    int next = LeastSignificantBit(later);
+    int64 level_span = static_cast<int64>(1) << (shift + kBitsPerLevel);
+    *level = i;
+    *slot = next;
+    *deadline = (elapsed_ & ~(level_span - 1)) +
+        (static_cast<int64>(next) << shift);
+    return true;
+  }
+  return false;
+}
+
+void TimerWheel::Expire(int level, int slot, int64 deadline) {
+  DCHECK_GT(deadline, elapsed_);
+  elapsed_ = deadline;
+  occupied_[level] &= ~(static_cast<uint64>(1) << slot);
+
+  // The tasks all go down to lower levels, or to the ready heap.
+  LinkedList<Entry>& list = slots_[level][slot];
+  while (list.head() != list.end()) {
+    Entry* entry = list.head()->value();
+    entry->RemoveFromList();
+    Insert(entry);
+  }
+}
+
+void TimerWheel::ExpireOverflow() {
+  DCHECK(ready_.empty());
+  DCHECK(!overflow_.empty());
+  int64 span_start = static_cast<int64>(
+      static_cast<uint64>(overflow_.front()->tick) & ~kSlotRangeMask);
+  DCHECK_GT(span_start, elapsed_);
+  elapsed_ = span_start;
+
+  // The heap is in the order of the run times, so the tasks of the span come
+  // off its top.
+  while (!overflow_.empty() && overflow_.front()->tick - span_start <=
+             static_cast<int64>(kSlotRangeMask)) {
+    Entry* entry = overflow_.front();
+    RemoveEntry(&overflow_, entry);
+    Insert(entry);
+  }
+}
+
+// static
+void TimerWheel::PushEntry(EntryHeap* heap, Entry* entry) {
+  entry->heap_index = heap->size();
+  heap->push_back(entry);
+  SiftUp(heap, entry->heap_index);
+}
+
+// static
+void TimerWheel::RemoveEntry(EntryHeap* heap, Entry* entry) {
+  size_t index = entry->heap_index;
+  DCHECK_EQ(entry, (*heap)[index]);
+  Entry* last = heap->back();
+  heap->pop_back();
+  if (index == heap->size())
+    return;
+  (*heap)[index] = last;
+  last->heap_index = index;
+  SiftDown(heap, index);
+  SiftUp(heap, last->heap_index);
+}
+
+// static
+void TimerWheel::SiftUp(EntryHeap* heap, size_t index) {
+  Entry* entry = (*heap)[index];
+  while (index > 0) {
+    size_t parent = (index - 1) / 2;
+    if (!entry->RunsBefore((*heap)[parent]))
+      break;
+    (*heap)[index] = (*heap)[parent];
+    (*heap)[index]->heap_index = index;
+    index = parent;
+  }
+  (*heap)[index] = entry;
+  entry->heap_index = index;
+}
+
+// static
+void TimerWheel::SiftDown(EntryHeap* heap, size_t index) {
+  Entry* entry = (*heap)[index];
+  size_t size = heap->size();
+  for (;;) {
+    size_t child = 2 * index + 1;
+    if (child >= size)
+      break;
+    if (child + 1 < size && (*heap)[child + 1]->RunsBefore((*heap)[child]))
+      ++child;
+    if (!(*heap)[child]->RunsBefore(entry))
+      break;
+    (*heap)[index] = (*heap)[child];
+    (*heap)[index]->heap_index = index;
+    index = child;
+  }
+  (*heap)[index] = entry;
+  entry->heap_index = index;
+}
+
+void TimerWheel::Recycle(Entry* entry) {
+  ++entry->generation;
+  entry->location = Entry::FREE;
+  // The task may own objects that post or cancel other tasks as they are
+  // deleted, so only delete it once the wheel is consistent again.
+  Closure task = entry->pending_task.task;
+  entry->pending_task.task.Reset();
+  free_entries_.Append(entry);
+}
+
+}  // namespace base
@@ -0,0 +1,170 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_TIMER_WHEEL_H_
+#define BASE_TIMER_WHEEL_H_
+#pragma once
+
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/basictypes.h"
+#include "base/linked_list.h"
+#include "base/pending_task.h"
+#include "base/time.h"
+
+namespace base {
+
+// A hierarchical timing wheel of delayed PendingTasks, which is the delayed
+// work queue of a MessageLoop.  Cancelled tasks are removed right away, so
+// timers that are restarted over and over do not leave dead tasks behind.
+// Tasks come out in the order of PendingTask::operator<, that is by
+// |delayed_run_time| and then by |sequence_num|.
+//
+// The wheel counts time in ticks of a millisecond.  Each of its levels has 64
+// slots, and a slot of level n spans 64^n ticks, so a task lands in a slot
+// according to how far in the future it is.  When the next task is asked for,
+// the tasks of the first occupied slot of a higher level are moved down into
+// the finer slots of the levels below it, until those of a slot of level 0
+// become ready.  Ready tasks are kept in a small heap that orders those within
+// the same tick.  Only the tasks at the front of the wheel are ever sorted.
+//
+// The slots cover the aligned span of 64^6 ticks, a little over two years,
+// that the wheel has advanced into.  Tasks due after the end of that span are
+// kept in an overflow heap, and moved into the slots once the wheel has run
+// out of earlier tasks and advanced into their span.
+//
+// Adding and cancelling a task that goes into the slots takes constant time.
+// The wheel moves ahead to the next task when it is asked for it, and tasks
+// that are then added before that one go into the ready heap, so adding and
+// cancelling those, or tasks in the overflow heap, takes logarithmic time.
+//
+// All methods must be called on one thread.
+class BASE_EXPORT TimerWheel {
+ private:
+  struct Entry;
+
+ public:
+  // Identifies a task in the wheel for Cancel().  A handle stays safe to use
+  // once its task has run or been cancelled; it is just no longer valid.
+  class Handle {
+   public:
+    Handle() : entry_(NULL), generation_(0) {}
+
+    bool is_null() const { return entry_ == NULL; }
+
+   private:
+    friend class TimerWheel;
+
+    Handle(Entry* entry, uint32 generation)
+        : entry_(entry),
+          generation_(generation) {
+    }
+
+    Entry* entry_;
+    uint32 generation_;
+  };
+
+  TimerWheel();
+  ~TimerWheel();
+
+  // Adds a copy of |pending_task|, whose |delayed_run_time| must be set.
+  Handle Add(const PendingTask& pending_task);
+
+  // Removes the task of |handle| and deletes it without running it.  Returns
+  // false if the task has already been taken out of the wheel.
+  bool Cancel(const Handle& handle);
+
+  bool empty() const { return size_ == 0; }
+  size_t size() const { return size_; }
+
+  // Returns the |delayed_run_time| of the next task, or a null TimeTicks if
+  // the wheel is empty.
+  TimeTicks NextRunTime();
+
+  // Returns the next task, or NULL if the wheel is empty.  The task stays in
+  // the wheel until Pop() is called.
+  const PendingTask* GetNextTask();
+
+  // Deletes the task last returned by GetNextTask().
+  void Pop();
+
+ private:
+  // A binary heap with the first task to run at index 0.  Each entry knows
+  // its index, so that it can be removed from the middle of the heap.
+  typedef std::vector<Entry*> EntryHeap;
+
+  enum {
+    kBitsPerLevel = 6,
+    kSlotsPerLevel = 1 << kBitsPerLevel,
+    kNumLevels = 6
+  };
+
+  // Returns the tick that |time| falls in.
+  int64 TickFor(TimeTicks time) const;
+
+  // Puts |entry| in the slot for its tick, in the ready heap if its tick has
+  // been reached, or in the overflow heap if it is past the range of the
+  // slots.
+  void Insert(Entry* entry);
+
+  // Takes |entry| out of its slot or heap.
+  void Unlink(Entry* entry);
+
+  // Finds the first occupied slot.  Returns false if the slots are empty, or
+  // sets |level|, |slot| and the tick at which the slot starts, |deadline|.
+  bool NextExpiration(int* level, int* slot, int64* deadline) const;
+
+  // Advances |elapsed_| to |deadline| and redistributes the tasks of the slot,
+  // which are now all due within the span of a slot of the level below.
+  void Expire(int level, int slot, int64 deadline);
+
+  // Advances |elapsed_| to the start of the span of the first task in the
+  // overflow heap, and moves the tasks of that span into the slots.  The
+  // slots and the ready heap must be empty.
+  void ExpireOverflow();
+
+  // Adds |entry| to |heap|, or removes it.
+  static void PushEntry(EntryHeap* heap, Entry* entry);
+  static void RemoveEntry(EntryHeap* heap, Entry* entry);
+
+  // Moves the entry at |index| of |heap| up or down to its place.
+  static void SiftUp(EntryHeap* heap, size_t index);
+  static void SiftDown(EntryHeap* heap, size_t index);
+
+  // Invalidates the handles of |entry|, deletes its task and keeps it for
+  // reuse.
+  void Recycle(Entry* entry);
+
+  // The time of tick 0.
+  TimeTicks origin_;
+
+  // The tick the wheel has advanced to, which may be ahead of the current
+  // time.  All the tasks in the slots are due after it, and the ready tasks
+  // are due by the end of it.
+  int64 elapsed_;
+
+  // The number of tasks in the wheel.
+  size_t size_;
+
+  // The tasks of each slot, and a bit per slot telling whether it has any.
+  LinkedList<Entry> slots_[kNumLevels][kSlotsPerLevel];
+  uint64 occupied_[kNumLevels];
+
+  EntryHeap ready_;
+
+  // The tasks due past the span of the slots.
+  EntryHeap overflow_;
+
+  // Entries are reused rather than deleted, so that a stale Handle still
+  // points at an Entry and can be recognized by its generation.
+  LinkedList<Entry> free_entries_;
+  std::vector<Entry*> all_entries_;
+
+  DISALLOW_COPY_AND_ASSIGN(TimerWheel);
+};
+
+}  // namespace base
+
+#endif  // BASE_TIMER_WHEEL_H_
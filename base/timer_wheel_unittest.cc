@@ -0,0 +1,258 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/timer_wheel.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/memory/ref_counted.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+void RecordTask(std::vector<int>* order, int id) {
+  order->push_back(id);
+}
+
+PendingTask MakeTask(std::vector<int>* order, int id, TimeTicks run_time,
+                     int sequence_num) {
+  PendingTask pending_task(FROM_HERE, Bind(&RecordTask, order, id), run_time,
+                           true);
+  pending_task.sequence_num = sequence_num;
+  return pending_task;
+}
+
+// Runs the tasks that are due at |now|, in order.
+void RunDueTasks(TimerWheel* wheel, TimeTicks now) {
+  while (!wheel->empty() && wheel->NextRunTime() <= now) {
+    PendingTask pending_task = *wheel->GetNextTask();
+    wheel->Pop();
+    pending_task.task.Run();
+  }
+}
+
+// Cancels another task of the wheel when it is deleted.
+class Canceller : public RefCounted<Canceller> {
+ public:
+  Canceller(TimerWheel* wheel, int* deleted)
+      : wheel_(wheel),
+        deleted_(deleted) {
+  }
+
+  void set_handle(const TimerWheel::Handle& handle) { handle_ = handle; }
+
+  void Run() {}
+
+ private:
+  friend class RefCounted<Canceller>;
+
+  ~Canceller() {
+    ++*deleted_;
+    wheel_->Cancel(handle_);
+  }
+
+  TimerWheel* wheel_;
+  TimerWheel::Handle handle_;
+  int* deleted_;
+};
+
+}  // namespace
+
+// Tasks run in the order of their run times, however far apart they are, and
+// in the order of their sequence numbers when their run times are equal.
+TEST(TimerWheelTest, Order) {
+  TimerWheel wheel;
+  TimeTicks start = TimeTicks::Now();
+  const int64 kDelaysMs[] = {
+    5000, 1, 0, 64, 63, 4096, 262144, 100, 1, 86400000, 4095, 65,
+  };
+  std::vector<int> order;
+  std::vector<std::pair<int64, int> > expected;
+  for (size_t i = 0; i < arraysize(kDelaysMs); ++i) {
+    wheel.Add(MakeTask(&order, i,
+                       start + TimeDelta::FromMilliseconds(kDelaysMs[i]), i));
+    expected.push_back(std::make_pair(kDelaysMs[i], static_cast<int>(i)));
+  }
+  // Sub-millisecond differences are kept too.
+  wheel.Add(MakeTask(&order, 100,
+                     start + TimeDelta::FromMicroseconds(63500), 100));
+  expected.push_back(std::make_pair(63, 100));
+  std::sort(expected.begin(), expected.end());
+  EXPECT_EQ(expected.size(), wheel.size());
+
+  // Step through time, as a MessageLoop would when it wakes up at
+  // NextRunTime().
+  while (!wheel.empty()) {
+    TimeTicks now = wheel.NextRunTime();
+    ASSERT_FALSE(now.is_null());
+    size_t ran = order.size();
+    RunDueTasks(&wheel, now);
+    ASSERT_LT(ran, order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+      ASSERT_LE(start + TimeDelta::FromMilliseconds(expected[i].first), now);
+    }
+  }
+  EXPECT_TRUE(wheel.NextRunTime().is_null());
+  ASSERT_EQ(expected.size(), order.size());
+  for (size_t i = 0; i < expected.size(); ++i)
+    EXPECT_EQ(expected[i].second, order[i]) << i;
+}
+
+// Tasks added after the wheel has moved ahead to its next task still come out
+// first when they are due first.
+TEST(TimerWheelTest, AddBeforeNext) {
+  TimerWheel wheel;
+  TimeTicks start = TimeTicks::Now();
+  std::vector<int> order;
+  TimeTicks run_time = start + TimeDelta::FromMilliseconds(100000);
+  wheel.Add(MakeTask(&order, 0, run_time, 0));
+  EXPECT_EQ(run_time, wheel.NextRunTime());
+
+  wheel.Add(MakeTask(&order, 1, run_time - TimeDelta::FromMicroseconds(1), 1));
+  wheel.Add(MakeTask(&order, 2, start + TimeDelta::FromMilliseconds(5), 2));
+  wheel.Add(MakeTask(&order, 3, run_time + TimeDelta::FromMilliseconds(1), 3));
+  wheel.Add(MakeTask(&order, 4, start, 4));
+  EXPECT_EQ(start, wheel.NextRunTime());
+
+  RunDueTasks(&wheel, run_time + TimeDelta::FromMilliseconds(1));
+  ASSERT_EQ(5u, order.size());
+  EXPECT_EQ(4, order[0]);
+  EXPECT_EQ(2, order[1]);
+  EXPECT_EQ(1, order[2]);
+  EXPECT_EQ(0, order[3]);
+  EXPECT_EQ(3, order[4]);
+}
+
+TEST(TimerWheelTest, Cancel) {
+  TimerWheel wheel;
+  TimeTicks start = TimeTicks::Now();
+  std::vector<int> order;
+  std::vector<TimerWheel::Handle> handles;
+  for (int i = 0; i < 10; ++i) {
+    handles.push_back(wheel.Add(MakeTask(
+        &order, i, start + TimeDelta::FromMilliseconds(i * 1000), i)));
+  }
+  EXPECT_FALSE(handles[0].is_null());
+  EXPECT_TRUE(TimerWheel::Handle().is_null());
+  EXPECT_FALSE(wheel.Cancel(TimerWheel::Handle()));
+
+  // Task 0 is ready, the others are in the slots.
+  EXPECT_TRUE(wheel.Cancel(handles[0]));
+  EXPECT_TRUE(wheel.Cancel(handles[5]));
+  EXPECT_TRUE(wheel.Cancel(handles[9]));
+  EXPECT_FALSE(wheel.Cancel(handles[5]));
+  EXPECT_EQ(7u, wheel.size());
+  EXPECT_EQ(start + TimeDelta::FromMilliseconds(1000), wheel.NextRunTime());
+
+  RunDueTasks(&wheel, start + TimeDelta::FromMilliseconds(3000));
+  ASSERT_EQ(3u, order.size());
+  EXPECT_EQ(1, order[0]);
+  EXPECT_EQ(3, order[2]);
+
+  // The handle of a task that ran is no longer valid, even once its entry is
+  // reused.
+  EXPECT_FALSE(wheel.Cancel(handles[1]));
+  TimerWheel::Handle handle = wheel.Add(MakeTask(
+      &order, 10, start + TimeDelta::FromMilliseconds(9500), 10));
+  EXPECT_FALSE(wheel.Cancel(handles[1]));
+  EXPECT_FALSE(wheel.Cancel(handles[0]));
+
+  RunDueTasks(&wheel, start + TimeDelta::FromDays(1));
+  EXPECT_TRUE(wheel.empty());
+  EXPECT_FALSE(wheel.Cancel(handle));
+  ASSERT_EQ(8u, order.size());
+  EXPECT_EQ(6, order[4]);
+  EXPECT_EQ(8, order[6]);
+  EXPECT_EQ(10, order[7]);
+}
+
+// Deleting a task may cancel others, as a Timer owned by the task would.
+TEST(TimerWheelTest, CancelWhileDeleting) {
+  TimerWheel wheel;
+  TimeTicks start = TimeTicks::Now();
+  int deleted = 0;
+  std::vector<scoped_refptr<Canceller> > cancellers;
+  std::vector<TimerWheel::Handle> handles;
+  for (int i = 0; i < 100; ++i) {
+    cancellers.push_back(new Canceller(&wheel, &deleted));
+    handles.push_back(wheel.Add(PendingTask(
+        FROM_HERE, Bind(&Canceller::Run, cancellers.back()),
+        start + TimeDelta::FromMilliseconds(i * 37), true)));
+  }
+  // Each task cancels the one after it when it is deleted.
+  for (int i = 0; i < 99; ++i)
+    cancellers[i]->set_handle(handles[i + 1]);
+  cancellers.clear();
+
+  wheel.Cancel(handles[0]);
+  EXPECT_EQ(100, deleted);
+  EXPECT_TRUE(wheel.empty());
+  EXPECT_EQ(NULL, wheel.GetNextTask());
+}
+
+// GetNextTask() takes the tasks in order without waiting for them to be due.
+TEST(TimerWheelTest, GetNextTask) {
+  TimerWheel wheel;
+  TimeTicks start = TimeTicks::Now();
+  std::vector<int> order;
+  wheel.Add(MakeTask(&order, 0, start + TimeDelta::FromDays(1000), 0));
+  wheel.Add(MakeTask(&order, 1, start + TimeDelta::FromDays(2), 1));
+  wheel.Add(MakeTask(&order, 2, start + TimeDelta::FromSeconds(2), 2));
+  while (const PendingTask* next_task = wheel.GetNextTask()) {
+    PendingTask pending_task = *next_task;
+    wheel.Pop();
+    pending_task.task.Run();
+  }
+  ASSERT_EQ(3u, order.size());
+  EXPECT_EQ(2, order[0]);
+  EXPECT_EQ(1, order[1]);
+  EXPECT_EQ(0, order[2]);
+}
+
+// Tasks due past the range of the slots, which is a little over two years,
+// still come out in order, also when they are added after the wheel has moved
+// ahead, or cancelled.
+TEST(TimerWheelTest, FarFutureTasks) {
+  TimerWheel wheel;
+  TimeTicks start = TimeTicks::Now();
+  std::vector<int> order;
+  wheel.Add(MakeTask(&order, 0, start + TimeDelta::FromDays(1000), 0));
+  wheel.Add(MakeTask(&order, 1, start + TimeDelta::FromDays(500), 1));
+  wheel.Add(MakeTask(&order, 2, start + TimeDelta::FromDays(3000), 2));
+  wheel.Add(MakeTask(&order, 3, start + TimeDelta::FromDays(1000) +
+                                    TimeDelta::FromMilliseconds(1), 3));
+  TimerWheel::Handle handle =
+      wheel.Add(MakeTask(&order, 4, start + TimeDelta::FromDays(2000), 4));
+  wheel.Add(MakeTask(&order, 5, start + TimeDelta::FromSeconds(2), 5));
+  EXPECT_TRUE(wheel.Cancel(handle));
+  EXPECT_EQ(5u, wheel.size());
+  EXPECT_EQ(start + TimeDelta::FromSeconds(2), wheel.NextRunTime());
+
+  RunDueTasks(&wheel, start + TimeDelta::FromSeconds(2));
+  EXPECT_EQ(start + TimeDelta::FromDays(500), wheel.NextRunTime());
+  wheel.Add(MakeTask(&order, 6, start + TimeDelta::FromDays(600), 6));
+  wheel.Add(MakeTask(&order, 7, start + TimeDelta::FromDays(2999), 7));
+  EXPECT_EQ(start + TimeDelta::FromDays(500), wheel.NextRunTime());
+
+  RunDueTasks(&wheel, start + TimeDelta::FromDays(1000));
+  EXPECT_EQ(start + TimeDelta::FromDays(1000) +
+                TimeDelta::FromMilliseconds(1),
+            wheel.NextRunTime());
+  RunDueTasks(&wheel, start + TimeDelta::FromDays(3000));
+  EXPECT_TRUE(wheel.empty());
+  ASSERT_EQ(7u, order.size());
+  EXPECT_EQ(5, order[0]);
+  EXPECT_EQ(1, order[1]);
+  EXPECT_EQ(6, order[2]);
+  EXPECT_EQ(0, order[3]);
+  EXPECT_EQ(3, order[4]);
+  EXPECT_EQ(7, order[5]);
+  EXPECT_EQ(2, order[6]);
+}
+
+}  // namespace base
@@ -4,10 +4,66 @@
 
 #include "base/utf_string_conversion_utils.h"
 
+#include <algorithm>
+
 #include "base/third_party/icu/icu_utf.h"
+#include "base/utf_string_conversions_simd.h"
+
+#if defined(BASE_UTF_SIMD)
+#include "base/atomicops.h"
+#include "base/cpu.h"
+#endif
 
 namespace base {
 
+namespace internal {
+
+#if defined(BASE_UTF_SIMD)
+
+namespace {
+
+// The level GetUTFSimdLevel() returns, or -1 before the CPU is checked.
+subtle::Atomic32 g_utf_simd_level = -1;
+
+UTFSimdLevel GetCPULevel() {
+  CPU cpu;
+  if (cpu.has_ssse3())
+    return UTF_SIMD_SSSE3;
+  if (cpu.has_sse2())
+    return UTF_SIMD_SSE2;
+  return UTF_SIMD_NONE;
+}
+
+}  // namespace
+
+UTFSimdLevel GetUTFSimdLevel() {
+  subtle::Atomic32 level = subtle::NoBarrier_Load(&g_utf_simd_level);
+  if (level < 0) {
+    // Racing threads all store the same value.
+    level = GetCPULevel();
+    subtle::NoBarrier_Store(&g_utf_simd_level, level);
+  }
+  return static_cast<UTFSimdLevel>(level);
+}
+
+void SetUTFSimdLevelForTesting(UTFSimdLevel level) {
+  subtle::NoBarrier_Store(&g_utf_simd_level,
+                          std::min(level, GetCPULevel()));
+}
+
+#else  // defined(BASE_UTF_SIMD)
+
+UTFSimdLevel GetUTFSimdLevel() {
+  return UTF_SIMD_NONE;
+}
+
+void SetUTFSimdLevelForTesting(UTFSimdLevel level) {
+}
+
+#endif  // defined(BASE_UTF_SIMD)
+
+}  // namespace internal
+
 // ReadUnicodeCharacter --------------------------------------------------------
 
 bool ReadUnicodeCharacter(const char* src,
@@ -66,6 +122,65 @@ bool ReadUnicodeCharacter(const wchar_t* src,
 }
 #endif  // defined(WCHAR_T_IS_UTF32)
 
+// ASCII runs ------------------------------------------------------------------
+
+size_t CountLeadingASCII(const char* src, size_t src_len) {
+#if defined(BASE_UTF_SIMD)
+  if (internal::GetUTFSimdLevel() >= internal::UTF_SIMD_SSE2)
+    return internal::CountLeadingASCII_SSE2(src, src_len);
+#endif
+  size_t i = 0;
+  while (i < src_len && static_cast<unsigned char>(src[i]) < 0x80)
+    ++i;
+  return i;
+}
+
+size_t CountLeadingASCII(const char16* src, size_t src_len) {
+#if defined(BASE_UTF_SIMD)
+  if (internal::GetUTFSimdLevel() >= internal::UTF_SIMD_SSE2)
+    return internal::CountLeadingASCII_SSE2(src, src_len);
+#endif
+  size_t i = 0;
+  while (i < src_len && src[i] < 0x80)
+    ++i;
+  return i;
+}
+
+#if defined(WCHAR_T_IS_UTF32)
+size_t CountLeadingASCII(const wchar_t* src, size_t src_len) {
+  size_t i = 0;
+  while (i < src_len && static_cast<uint32>(src[i]) < 0x80)
+    ++i;
+  return i;
+}
+#endif  // defined(WCHAR_T_IS_UTF32)
+
+void WriteASCIICharacters(const char* src, size_t src_len, string16* output) {
+#if defined(BASE_UTF_SIMD)
+  if (internal::GetUTFSimdLevel() >= internal::UTF_SIMD_SSE2) {
+    size_t offset = output->length();
+    output->resize(offset + src_len);
+    internal::WidenASCII_SSE2(src, src_len, &(*output)[offset]);
+    return;
+  }
+#endif
+  output->append(src, src + src_len);
+}
+
+void WriteASCIICharacters(const char16* src,
+                          size_t src_len,
+                          std::string* output) {
+#if defined(BASE_UTF_SIMD)
+  if (internal::GetUTFSimdLevel() >= internal::UTF_SIMD_SSE2) {
+    size_t offset = output->length();
+    output->resize(offset + src_len);
+    internal::NarrowASCII_SSE2(src, src_len, &(*output)[offset]);
+    return;
+  }
+#endif
+  output->append(src, src + src_len);
+}
+
 // WriteUnicodeCharacter -------------------------------------------------------
 
 size_t WriteUnicodeCharacter(uint32 code_point, std::string* output) {
@@ -79,6 +79,30 @@ inline size_t WriteUnicodeCharacter(uint32 code_point, std::wstring* output) {
 }
 #endif  // defined(WCHAR_T_IS_UTF32)
 
+// ASCII runs ------------------------------------------------------------------
+
+// Returns the number of ASCII characters at the start of |src|.
+BASE_EXPORT size_t CountLeadingASCII(const char* src, size_t src_len);
+BASE_EXPORT size_t CountLeadingASCII(const char16* src, size_t src_len);
+#if defined(WCHAR_T_IS_UTF32)
+BASE_EXPORT size_t CountLeadingASCII(const wchar_t* src, size_t src_len);
+#endif  // defined(WCHAR_T_IS_UTF32)
+
+// Appends the |src_len| characters of |src|, which must all be ASCII, to
+// |output|.
+BASE_EXPORT void WriteASCIICharacters(const char* src,
+                                      size_t src_len,
+                                      string16* output);
+BASE_EXPORT void WriteASCIICharacters(const char16* src,
+                                      size_t src_len,
+                                      std::string* output);
+template<typename CHAR, typename STRING>
+inline void WriteASCIICharacters(const CHAR* src,
+                                 size_t src_len,
+                                 STRING* output) {
+  output->append(src, src + src_len);
+}
+
 // Generalized Unicode converter -----------------------------------------------
 
 // Guesses the length of the output in UTF-8 in bytes, clears that output
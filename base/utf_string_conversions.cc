@@ -8,13 +8,89 @@
 #include "base/string_util.h"
 #include "base/utf_string_conversion_utils.h"
 
+using base::CountLeadingASCII;
 using base::PrepareForUTF8Output;
 using base::PrepareForUTF16Or32Output;
 using base::ReadUnicodeCharacter;
+using base::WriteASCIICharacters;
 using base::WriteUnicodeCharacter;
 
 namespace {
 
+// Character readers and writers ----------------------------------------------
+
+// Like ReadUnicodeCharacter(), but decodes the common well-formed two and
+// three byte sequences inline.
+inline bool ReadCharacter(const char* src,
+                          int32 src_len,
+                          int32* char_index,
+                          uint32* code_point) {
+  const unsigned char* s = reinterpret_cast<const unsigned char*>(src);
+  int32 i = *char_index;
+  unsigned char lead = s[i];
+  if (lead >= 0xC2 && lead < 0xE0 && i + 1 < src_len &&
+      (s[i + 1] & 0xC0) == 0x80) {
+    *code_point = ((lead & 0x1F) << 6) | (s[i + 1] & 0x3F);
+    *char_index = i + 1;
+    return true;
+  }
+  if (lead >= 0xE0 && lead < 0xF0 && i + 2 < src_len &&
+      (s[i + 1] & 0xC0) == 0x80 && (s[i + 2] & 0xC0) == 0x80) {
+    uint32 c = ((lead & 0x0F) << 12) | ((s[i + 1] & 0x3F) << 6) |
+        (s[i + 2] & 0x3F);
+    if (c >= 0x800 && (c < 0xD800 || c > 0xDFFF)) {
+      *code_point = c;
+      *char_index = i + 2;
+      return true;
+    }
+  }
+  return ReadUnicodeCharacter(src, src_len, char_index, code_point);
+}
+
+// Like ReadUnicodeCharacter(), but returns characters outside of the
+// surrogate range without a call.
+inline bool ReadCharacter(const char16* src,
+                          int32 src_len,
+                          int32* char_index,
+                          uint32* code_point) {
+  char16 c = src[*char_index];
+  if (c < 0xD800 || c > 0xDFFF) {
+    *code_point = c;
+    return true;
+  }
+  return ReadUnicodeCharacter(src, src_len, char_index, code_point);
+}
+
+#if defined(WCHAR_T_IS_UTF32)
+inline bool ReadCharacter(const wchar_t* src,
+                          int32 src_len,
+                          int32* char_index,
+                          uint32* code_point) {
+  return ReadUnicodeCharacter(src, src_len, char_index, code_point);
+}
+#endif  // defined(WCHAR_T_IS_UTF32)
+
+// Like WriteUnicodeCharacter(), but encodes characters of the BMP inline.
+inline void WriteCharacter(uint32 code_point, std::string* output) {
+  if (code_point < 0x80) {
+    output->push_back(static_cast<char>(code_point));
+  } else if (code_point < 0x800) {
+    output->push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+    output->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  } else if (code_point < 0x10000) {
+    output->push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+    output->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+    output->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  } else {
+    WriteUnicodeCharacter(code_point, output);
+  }
+}
+
+template<typename STRING>
+inline void WriteCharacter(uint32 code_point, STRING* output) {
+  WriteUnicodeCharacter(code_point, output);
+}
+
 // Generalized Unicode converter -----------------------------------------------
 
 // Converts the given source Unicode character type to the given destination
@@ -29,11 +105,19 @@ bool ConvertUnicode(const SRC_CHAR* src,
   bool success = true;
   int32 src_len32 = static_cast<int32>(src_len);
   for (int32 i = 0; i < src_len32; i++) {
+    // Runs of ASCII are copied as is, which is vectorized where possible.
+    if (static_cast<uint32>(src[i]) < 0x80) {
+      size_t ascii_len = CountLeadingASCII(src + i, src_len32 - i);
+      WriteASCIICharacters(src + i, ascii_len, output);
+      i += static_cast<int32>(ascii_len) - 1;
+      continue;
+    }
+
     uint32 code_point;
-    if (ReadUnicodeCharacter(src, src_len32, &i, &code_point)) {
-      WriteUnicodeCharacter(code_point, output);
+    if (ReadCharacter(src, src_len32, &i, &code_point)) {
+      WriteCharacter(code_point, output);
     } else {
-      WriteUnicodeCharacter(0xFFFD, output);
+      WriteCharacter(0xFFFD, output);
       success = false;
     }
   }
@@ -0,0 +1,112 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/utf_string_conversions.h"
+
+#include <string>
+
+#include "base/perftimer.h"
+#include "base/string_util.h"
+#include "base/stringprintf.h"
+#include "base/utf_string_conversions_simd.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+const size_t kCorpusSize = 1024 * 1024;
+const int kIterations = 20;
+
+// Returns about kCorpusSize bytes of UTF-8 made of words from |words|,
+// separated by spaces.
+std::string MakeCorpus(const char* const words[], size_t count) {
+  std::string corpus;
+  for (size_t i = 0; corpus.length() < kCorpusSize; ++i) {
+    corpus.append(words[(i * 7) % count]);
+    corpus.push_back(' ');
+  }
+  return corpus;
+}
+
+const char* const kASCIIWords[] = {
+  "The", "quick", "brown", "fox", "jumps", "over", "the", "lazy", "dog",
+  "http://www.example.com/index.html", "Copyright", "(c)", "2012",
+};
+
+const char* const kLatin1Words[] = {
+  "Les", "na\xc3\xaf" "fs", "\xc3\xa9l\xc3\xa8ves", "fran\xc3\xa7" "ais",
+  "m\xc3\xb6gen", "Gr\xc3\xbc\xc3\x9f" "e", "aus", "K\xc3\xb6ln", "und",
+  "se\xc3\xb1or", "a\xc3\xb1o", "caf\xc3\xa9",
+};
+
+const char* const kCJKWords[] = {
+  // "网页 图片 资讯更多"
+  "\xe7\xbd\x91\xe9\xa1\xb5", "\xe5\x9b\xbe\xe7\x89\x87",
+  "\xe8\xb5\x84\xe8\xae\xaf\xe6\x9b\xb4\xe5\xa4\x9a",
+  // "検索 画像"
+  "\xe6\xa4\x9c\xe7\xb4\xa2", "\xe7\x94\xbb\xe5\x83\x8f",
+  // "전체서비스"
+  "\xec\xa0\x84\xec\xb2\xb4\xec\x84\x9c\xeb\xb9\x84\xec\x8a\xa4",
+};
+
+const char* const kLevelNames[] = { "scalar", "sse2", "ssse3" };
+
+// Logs the throughput of the conversions and checks of |corpus| at every
+// level the CPU supports.
+void MeasureCorpus(const char* name, const std::string& corpus) {
+  string16 utf16 = UTF8ToUTF16(corpus);
+  for (int level = internal::UTF_SIMD_NONE;
+       level <= internal::UTF_SIMD_SSSE3; ++level) {
+    internal::SetUTFSimdLevelForTesting(
+        static_cast<internal::UTFSimdLevel>(level));
+    if (internal::GetUTFSimdLevel() != level)
+      continue;
+    double megabytes = kIterations * corpus.length() / (1024.0 * 1024.0);
+
+    string16 converted_utf16;
+    PerfTimer to_utf16_timer;
+    for (int i = 0; i < kIterations; ++i)
+      UTF8ToUTF16(corpus.data(), corpus.length(), &converted_utf16);
+    LogPerfResult(StringPrintf("UTF8ToUTF16_%s_%s", name,
+                               kLevelNames[level]).c_str(),
+                  megabytes / to_utf16_timer.Elapsed().InSecondsF(), "MB/s");
+    EXPECT_TRUE(utf16 == converted_utf16);
+
+    std::string converted_utf8;
+    PerfTimer to_utf8_timer;
+    for (int i = 0; i < kIterations; ++i)
+      UTF16ToUTF8(utf16.data(), utf16.length(), &converted_utf8);
+    LogPerfResult(StringPrintf("UTF16ToUTF8_%s_%s", name,
+                               kLevelNames[level]).c_str(),
+                  megabytes / to_utf8_timer.Elapsed().InSecondsF(), "MB/s");
+    EXPECT_EQ(corpus, converted_utf8);
+
+    bool is_utf8 = true;
+    PerfTimer is_utf8_timer;
+    for (int i = 0; i < kIterations; ++i)
+      is_utf8 &= IsStringUTF8(corpus);
+    LogPerfResult(StringPrintf("IsStringUTF8_%s_%s", name,
+                               kLevelNames[level]).c_str(),
+                  megabytes / is_utf8_timer.Elapsed().InSecondsF(), "MB/s");
+    EXPECT_TRUE(is_utf8);
+  }
+  internal::SetUTFSimdLevelForTesting(internal::UTF_SIMD_SSSE3);
+}
+
+}  // namespace
+
+TEST(UTFStringConversionsPerfTest, ASCII) {
+  MeasureCorpus("ascii", MakeCorpus(kASCIIWords, arraysize(kASCIIWords)));
+}
+
+TEST(UTFStringConversionsPerfTest, Latin1) {
+  MeasureCorpus("latin1", MakeCorpus(kLatin1Words, arraysize(kLatin1Words)));
+}
+
+TEST(UTFStringConversionsPerfTest, CJK) {
+  MeasureCorpus("cjk", MakeCorpus(kCJKWords, arraysize(kCJKWords)));
+}
+
+}  // namespace base
@@ -0,0 +1,59 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// SSE2 and SSSE3 versions of the inner loops of the UTF-8 and UTF-16 checks
+// and conversions. Each instruction set gets its own target in base.gyp, so
+// that only these files are built with the flags that enable it. The targets
+// define BASE_UTF_SIMD for base, which picks a version at runtime with
+// GetUTFSimdLevel().
+//
+// This should only be used by the various UTF string conversion files.
+
+#ifndef BASE_UTF_STRING_CONVERSIONS_SIMD_H_
+#define BASE_UTF_STRING_CONVERSIONS_SIMD_H_
+#pragma once
+
+#include <stddef.h>
+
+#include "base/base_export.h"
+#include "base/string16.h"
+
+namespace base {
+namespace internal {
+
+enum UTFSimdLevel {
+  UTF_SIMD_NONE,
+  UTF_SIMD_SSE2,
+  UTF_SIMD_SSSE3,
+};
+
+// Returns the best instruction set the string conversions can use on this
+// CPU. Always UTF_SIMD_NONE without BASE_UTF_SIMD.
+BASE_EXPORT UTFSimdLevel GetUTFSimdLevel();
+
+// Makes the string conversions use at most |level|, so that tests can cover
+// every version. Not thread safe.
+BASE_EXPORT void SetUTFSimdLevelForTesting(UTFSimdLevel level);
+
+// Returns the number of ASCII characters at the start of |src|.
+size_t CountLeadingASCII_SSE2(const char* src, size_t length);
+size_t CountLeadingASCII_SSE2(const char16* src, size_t length);
+
+// Zero extends the |length| bytes of |src| into |dest|.
+void WidenASCII_SSE2(const char* src, size_t length, char16* dest);
+
+// Copies the |length| ASCII characters of |src| into |dest|.
+void NarrowASCII_SSE2(const char16* src, size_t length, char* dest);
+
+// Returns true if |src| is well-formed UTF-8: no overlong forms, surrogates,
+// code points above U+10FFFF or truncated sequences. Unlike IsStringUTF8(),
+// noncharacters are not checked for; |*maybe_noncharacter| is set to false
+// if |src| can't contain any.
+bool IsWellFormedUTF8_SSSE3(const char* src, size_t length,
+                            bool* maybe_noncharacter);
+
+}  // namespace internal
+}  // namespace base
+
+#endif  // BASE_UTF_STRING_CONVERSIONS_SIMD_H_
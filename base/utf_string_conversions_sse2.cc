@@ -0,0 +1,92 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/utf_string_conversions_simd.h"
+
+#include <emmintrin.h>
+
+namespace base {
+namespace internal {
+
+namespace {
+
+// Returns the index of the lowest set bit of |mask|, which isn't 0.
+inline size_t LowestBit(int mask) {
+  size_t index = 0;
+  while (!(mask & 1)) {
+    mask >>= 1;
+    ++index;
+  }
+  return index;
+}
+
+}  // namespace
+
+size_t CountLeadingASCII_SSE2(const char* src, size_t length) {
+  size_t i = 0;
+  // Non-ASCII bytes have their top bit set, which is what movemask gathers.
+  for (; i + 32 <= length; i += 32) {
+    __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i second =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 16));
+    if (_mm_movemask_epi8(_mm_or_si128(first, second)))
+      break;
+  }
+  for (; i + 16 <= length; i += 16) {
+    int mask = _mm_movemask_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)));
+    if (mask)
+      return i + LowestBit(mask);
+  }
+  for (; i < length && !(src[i] & 0x80); ++i) {
+  }
+  return i;
+}
+
+size_t CountLeadingASCII_SSE2(const char16* src, size_t length) {
+  const __m128i non_ascii_bits = _mm_set1_epi16(static_cast<short>(0xFF80));
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 8 <= length; i += 8) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    // Two bits per character, set for the ASCII ones.
+    int mask = _mm_movemask_epi8(
+        _mm_cmpeq_epi16(_mm_and_si128(chunk, non_ascii_bits), zero));
+    if (mask != 0xFFFF)
+      return i + LowestBit(~mask) / 2;
+  }
+  for (; i < length && src[i] < 0x80; ++i) {
+  }
+  return i;
+}
+
+void WidenASCII_SSE2(const char* src, size_t length, char16* dest) {
+  const __m128i zero = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 16 <= length; i += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i),
+                     _mm_unpacklo_epi8(chunk, zero));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i + 8),
+                     _mm_unpackhi_epi8(chunk, zero));
+  }
+  for (; i < length; ++i)
+    dest[i] = static_cast<unsigned char>(src[i]);
+}
+
+void NarrowASCII_SSE2(const char16* src, size_t length, char* dest) {
+  size_t i = 0;
+  for (; i + 16 <= length; i += 16) {
+    __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m128i second =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i),
+                     _mm_packus_epi16(first, second));
+  }
+  for (; i < length; ++i)
+    dest[i] = static_cast<char>(src[i]);
+}
+
+}  // namespace internal
+}  // namespace base
@@ -0,0 +1,173 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/utf_string_conversions_simd.h"
+
+#include <string.h>
+#include <tmmintrin.h>
+
+namespace base {
+namespace internal {
+
+namespace {
+
+// The validation classifies every pair of consecutive bytes by looking up the
+// high and low nibbles of the first byte and the high nibble of the second one
+// in three tables, as described in "Validating UTF-8 In Less Than One
+// Instruction Per Byte" (Keiser and Lemire). Each bit is an error that the
+// pair could be part of. A pair is invalid if all three lookups agree on one.
+const char kTooShort = 1 << 0;     // 11______ 0_______ or 11______ 11______
+const char kTooLong = 1 << 1;      // 0_______ 10______
+const char kOverlong3 = 1 << 2;    // 11100000 100_____
+const char kTooLarge = 1 << 3;     // 11110100 1001____ and above
+const char kSurrogate = 1 << 4;    // 11101101 101_____
+const char kOverlong2 = 1 << 5;    // 1100000_ 10______
+const char kTooLarge1000 = 1 << 6;  // 11110101 1000____ and above
+const char kOverlong4 = 1 << 6;    // 11110000 1000____
+const char kTwoConts = static_cast<char>(1 << 7);  // 10______ 10______
+const char kCarry = kTooShort | kTooLong | kTwoConts;
+
+inline __m128i HighNibbles(__m128i bytes) {
+  return _mm_and_si128(_mm_srli_epi16(bytes, 4), _mm_set1_epi8(0x0F));
+}
+
+// Returns non-zero bytes where |input| is not a valid continuation of
+// |previous|, the 16 bytes before it.
+inline __m128i CheckBlock(__m128i input, __m128i previous) {
+  const __m128i byte_1_high_table = _mm_setr_epi8(
+      // 0_______: ASCII.
+      kTooLong, kTooLong, kTooLong, kTooLong,
+      kTooLong, kTooLong, kTooLong, kTooLong,
+      // 10______: continuation.
+      kTwoConts, kTwoConts, kTwoConts, kTwoConts,
+      // 1100____ and 1101____: two byte lead.
+      kTooShort | kOverlong2,
+      kTooShort,
+      // 1110____: three byte lead.
+      kTooShort | kOverlong3 | kSurrogate,
+      // 1111____: four byte lead.
+      kTooShort | kTooLarge | kTooLarge1000 | kOverlong4);
+  const __m128i byte_1_low_table = _mm_setr_epi8(
+      kCarry | kOverlong3 | kOverlong2 | kOverlong4,  // ____0000
+      kCarry | kOverlong2,                            // ____0001
+      kCarry,                                         // ____0010
+      kCarry,                                         // ____0011
+      kCarry | kTooLarge,                             // ____0100
+      kCarry | kTooLarge | kTooLarge1000,             // ____0101
+      kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000 | kSurrogate,  // ____1101
+      kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000);
+  const __m128i byte_2_high_table = _mm_setr_epi8(
+      // 0_______: ASCII.
+      kTooShort, kTooShort, kTooShort, kTooShort,
+      kTooShort, kTooShort, kTooShort, kTooShort,
+      // 1000____
+      kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge1000 |
+          kOverlong4,
+      // 1001____
+      kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge,
+      // 101_____
+      kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+      kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+      // 11______: lead.
+      kTooShort, kTooShort, kTooShort, kTooShort);
+
+  __m128i prev1 = _mm_alignr_epi8(input, previous, 15);
+  __m128i byte_1_high =
+      _mm_shuffle_epi8(byte_1_high_table, HighNibbles(prev1));
+  __m128i byte_1_low = _mm_shuffle_epi8(
+      byte_1_low_table, _mm_and_si128(prev1, _mm_set1_epi8(0x0F)));
+  __m128i byte_2_high =
+      _mm_shuffle_epi8(byte_2_high_table, HighNibbles(input));
+  __m128i special_cases =
+      _mm_and_si128(_mm_and_si128(byte_1_high, byte_1_low), byte_2_high);
+
+  // The third and fourth bytes of longer sequences must be continuations,
+  // which the pairs above flag as kTwoConts, the top bit.
+  __m128i prev2 = _mm_alignr_epi8(input, previous, 14);
+  __m128i prev3 = _mm_alignr_epi8(input, previous, 13);
+  __m128i is_third_byte =
+      _mm_subs_epu8(prev2, _mm_set1_epi8(static_cast<char>(0xE0 - 0x80)));
+  __m128i is_fourth_byte =
+      _mm_subs_epu8(prev3, _mm_set1_epi8(static_cast<char>(0xF0 - 0x80)));
+  __m128i must_be_continuation =
+      _mm_and_si128(_mm_or_si128(is_third_byte, is_fourth_byte),
+                    _mm_set1_epi8(static_cast<char>(0x80)));
+  return _mm_xor_si128(must_be_continuation, special_cases);
+}
+
+// Returns 0xFF bytes where |input| could end a noncharacter: U+FDD0..U+FDEF
+// start with EF B7, and the code points ending in FFFE or FFFF end with BF BE
+// or BF BF.
+inline __m128i FindNoncharacters(__m128i input, __m128i previous) {
+  __m128i prev1 = _mm_alignr_epi8(input, previous, 15);
+  __m128i after_bf =
+      _mm_cmpeq_epi8(prev1, _mm_set1_epi8(static_cast<char>(0xBF)));
+  __m128i be_or_bf = _mm_cmpeq_epi8(_mm_or_si128(input, _mm_set1_epi8(1)),
+                                    _mm_set1_epi8(static_cast<char>(0xBF)));
+  __m128i after_ef =
+      _mm_cmpeq_epi8(prev1, _mm_set1_epi8(static_cast<char>(0xEF)));
+  __m128i b7 = _mm_cmpeq_epi8(input, _mm_set1_epi8(static_cast<char>(0xB7)));
+  return _mm_or_si128(_mm_and_si128(after_bf, be_or_bf),
+                      _mm_and_si128(after_ef, b7));
+}
+
+inline bool IsZero(__m128i bytes) {
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_setzero_si128())) ==
+      0xFFFF;
+}
+
+}  // namespace
+
+bool IsWellFormedUTF8_SSSE3(const char* src, size_t length,
+                            bool* maybe_noncharacter) {
+  // Non-zero where the last bytes of a block start a sequence that doesn't
+  // fit in it.
+  const __m128i incomplete_limits = _mm_setr_epi8(
+      -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+      static_cast<char>(0xF0 - 1), static_cast<char>(0xE0 - 1),
+      static_cast<char>(0xC0 - 1));
+
+  __m128i error = _mm_setzero_si128();
+  __m128i noncharacters = _mm_setzero_si128();
+  __m128i previous = _mm_setzero_si128();
+  __m128i previous_incomplete = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 16 <= length; i += 16) {
+    __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    if (!_mm_movemask_epi8(input)) {
+      // All ASCII, which is only wrong after a cut sequence.
+      error = _mm_or_si128(error, previous_incomplete);
+      previous_incomplete = _mm_setzero_si128();
+    } else {
+      error = _mm_or_si128(error, CheckBlock(input, previous));
+      noncharacters =
+          _mm_or_si128(noncharacters, FindNoncharacters(input, previous));
+      previous_incomplete = _mm_subs_epu8(input, incomplete_limits);
+    }
+    previous = input;
+  }
+
+  // The rest is padded with zeros, which also flags a sequence cut by the end
+  // of the string.
+  char tail[16] = { 0 };
+  memcpy(tail, src + i, length - i);
+  __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(tail));
+  error = _mm_or_si128(error, CheckBlock(input, previous));
+  noncharacters =
+      _mm_or_si128(noncharacters, FindNoncharacters(input, previous));
+
+  *maybe_noncharacter = !IsZero(noncharacters);
+  return IsZero(error);
+}
+
+}  // namespace internal
+}  // namespace base
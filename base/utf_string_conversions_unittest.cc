@@ -6,13 +6,96 @@
 #include "base/logging.h"
 #include "base/string_piece.h"
 #include "base/string_util.h"
+#include "base/third_party/icu/icu_utf.h"
+#include "base/utf_string_conversion_utils.h"
 #include "base/utf_string_conversions.h"
+#include "base/utf_string_conversions_simd.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
 namespace base {
 
 namespace {
 
+// The conversions and checks as they are without the vectorized loops and the
+// inline fast paths, to compare against.
+bool ReferenceUTF8ToUTF16(const std::string& utf8, string16* output) {
+  bool success = true;
+  int32 length = static_cast<int32>(utf8.length());
+  output->clear();
+  for (int32 i = 0; i < length; i++) {
+    uint32 code_point;
+    if (ReadUnicodeCharacter(utf8.data(), length, &i, &code_point)) {
+      WriteUnicodeCharacter(code_point, output);
+    } else {
+      WriteUnicodeCharacter(0xFFFD, output);
+      success = false;
+    }
+  }
+  return success;
+}
+
+bool ReferenceUTF16ToUTF8(const string16& utf16, std::string* output) {
+  bool success = true;
+  int32 length = static_cast<int32>(utf16.length());
+  output->clear();
+  for (int32 i = 0; i < length; i++) {
+    uint32 code_point;
+    if (ReadUnicodeCharacter(utf16.data(), length, &i, &code_point)) {
+      WriteUnicodeCharacter(code_point, output);
+    } else {
+      WriteUnicodeCharacter(0xFFFD, output);
+      success = false;
+    }
+  }
+  return success;
+}
+
+bool ReferenceIsStringUTF8(const std::string& str) {
+  int32 length = static_cast<int32>(str.length());
+  int32 i = 0;
+  while (i < length) {
+    int32 code_point;
+    CBU8_NEXT(str.data(), i, length, code_point);
+    if (!IsValidCharacter(code_point))
+      return false;
+  }
+  return true;
+}
+
+// Checks the conversions of |utf8| and of its bytes taken as UTF-16 against
+// the reference versions, at the current SIMD level.
+void CheckAgainstReference(const std::string& utf8) {
+  SCOPED_TRACE(testing::Message() << "level " <<
+               internal::GetUTFSimdLevel() << ", length " << utf8.length());
+
+  string16 utf16;
+  string16 expected_utf16;
+  EXPECT_EQ(ReferenceUTF8ToUTF16(utf8, &expected_utf16),
+            UTF8ToUTF16(utf8.data(), utf8.length(), &utf16));
+  EXPECT_TRUE(expected_utf16 == utf16);
+  EXPECT_EQ(ReferenceIsStringUTF8(utf8), IsStringUTF8(utf8));
+  bool is_ascii = true;
+  for (size_t i = 0; i < utf8.length(); ++i)
+    is_ascii &= static_cast<unsigned char>(utf8[i]) < 0x80;
+  EXPECT_EQ(is_ascii, IsStringASCII(utf8));
+  EXPECT_EQ(is_ascii, IsStringASCII(utf16));
+
+  // Pairs of bytes make code units, including unpaired surrogates.
+  string16 units;
+  for (size_t i = 0; i + 1 < utf8.length(); i += 2) {
+    units.push_back(static_cast<unsigned char>(utf8[i]) << 8 |
+                    static_cast<unsigned char>(utf8[i + 1]));
+  }
+  std::string narrowed;
+  std::string expected_narrowed;
+  EXPECT_EQ(ReferenceUTF16ToUTF8(units, &expected_narrowed),
+            UTF16ToUTF8(units.data(), units.length(), &narrowed));
+  EXPECT_EQ(expected_narrowed, narrowed);
+  EXPECT_EQ(ReferenceUTF16ToUTF8(utf16, &expected_narrowed),
+            UTF16ToUTF8(utf16.data(), utf16.length(), &narrowed));
+  EXPECT_EQ(expected_narrowed, narrowed);
+}
+
 const wchar_t* const kConvertRoundtripCases[] = {
   L"Google Video",
   // "网页 图片 资讯更多 »"
@@ -208,4 +291,77 @@ TEST(UTFStringConversionsTest, ConvertMultiString) {
   EXPECT_EQ(expected, converted);
 }
 
+// The vectorized loops work on blocks of 16 or 32 bytes, so sequences are
+// checked at every offset around the block boundaries, at every level.
+TEST(UTFStringConversionsTest, SimdLevels) {
+  const char* const kSequences[] = {
+    "a",
+    "\xc2\x80",          // U+0080
+    "\xdf\xbf",          // U+07FF
+    "\xe0\xa0\x80",      // U+0800
+    "\xe4\xb8\xad",      // U+4E2D
+    "\xef\xb7\x90",      // U+FDD0, a noncharacter
+    "\xef\xb7\xaf",      // U+FDEF, a noncharacter
+    "\xef\xb7\xb0",      // U+FDF0
+    "\xef\xbf\xbd",      // U+FFFD
+    "\xef\xbf\xbe",      // U+FFFE, a noncharacter
+    "\xf0\x90\x80\x80",  // U+10000
+    "\xf0\x9f\xbf\xbf",  // U+1FFFF, a noncharacter
+    "\xf4\x8f\xbf\xbd",  // U+10FFFD
+    "\xc0\x80",          // Overlong.
+    "\xc1\xbf",          // Overlong.
+    "\xe0\x9f\xbf",      // Overlong.
+    "\xf0\x8f\xbf\xbf",  // Overlong.
+    "\xed\xa0\x80",      // Surrogate.
+    "\xed\xbf\xbf",      // Surrogate.
+    "\xf4\x90\x80\x80",  // Above U+10FFFF.
+    "\xf5\x80\x80\x80",  // Above U+10FFFF.
+    "\xc2",              // Truncated.
+    "\xe4\xb8",          // Truncated.
+    "\xf0\x90\x80",      // Truncated.
+    "\x80",              // Stray continuation.
+    "\xbf\xbf",          // Stray continuations.
+    "\xff",              // Never valid.
+  };
+
+  for (int level = internal::UTF_SIMD_NONE;
+       level <= internal::UTF_SIMD_SSSE3; ++level) {
+    internal::SetUTFSimdLevelForTesting(
+        static_cast<internal::UTFSimdLevel>(level));
+    if (internal::GetUTFSimdLevel() != level)
+      continue;
+
+    for (size_t i = 0; i < arraysize(kSequences); ++i) {
+      SCOPED_TRACE(i);
+      for (size_t offset = 0; offset < 40; ++offset) {
+        std::string utf8(offset, 'x');
+        utf8.append(kSequences[i]);
+        CheckAgainstReference(utf8);
+        utf8.append(std::string(offset, 'y'));
+        CheckAgainstReference(utf8);
+        utf8.append(kSequences[i]);
+        CheckAgainstReference(utf8);
+      }
+    }
+
+    // Random mixes of the sequences.
+    uint32 seed = 1;
+    for (int run = 0; run < 2000; ++run) {
+      std::string utf8;
+      int pieces = run % 50;
+      for (int piece = 0; piece < pieces; ++piece) {
+        seed = seed * 1103515245 + 12345;
+        size_t index = (seed >> 16) % (arraysize(kSequences) + 8);
+        // Mostly valid sequences, with runs of ASCII.
+        if (index >= arraysize(kSequences))
+          utf8.append(index - arraysize(kSequences) + 1, 'z');
+        else
+          utf8.append(kSequences[index]);
+      }
+      CheckAgainstReference(utf8);
+    }
+  }
+  internal::SetUTFSimdLevelForTesting(internal::UTF_SIMD_SSSE3);
+}
+
 }  // base
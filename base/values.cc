@@ -343,8 +343,134 @@ BinaryValue::BinaryValue(char* buffer, size_t size)
   DCHECK(buffer_);
 }
 
+///////////////////// DictionaryIndex ////////////////////
+
+namespace internal {
+
+// An open-addressing hash table of the entries of a ValueMap, with linear
+// probing.  Each slot keeps the hash of the key of its entry, so that keys
+// are only compared when their hashes are equal.  Map entries do not move, so
+// the table points at them directly.
+class DictionaryIndex {
+ public:
+  explicit DictionaryIndex(const ValueMap& map);
+  ~DictionaryIndex();
+
+  const ValueMap::value_type* Find(const StringPiece& key) const;
+  void Insert(const ValueMap::value_type* entry);
+  void Remove(const ValueMap::value_type* entry);
+
+ private:
+  struct Slot {
+    uint32 hash;
+    const ValueMap::value_type* entry;  // NULL for an empty slot.
+  };
+
+  // 32-bit FNV-1a.
+  static uint32 Hash(const StringPiece& key);
+
+  // Adds |entry| to a table that has room for it.
+  void InsertWithHash(const ValueMap::value_type* entry, uint32 hash);
+
+  // The number of slots is a power of two, at least twice the number of
+  // entries.
+  std::vector<Slot> slots_;
+  size_t size_;
+
+  DISALLOW_COPY_AND_ASSIGN(DictionaryIndex);
+};
+
+DictionaryIndex::DictionaryIndex(const ValueMap& map) : size_(0) {
+  size_t slot_count = 16;
+  while (slot_count < 2 * map.size())
+    slot_count *= 2;
+  Slot empty = { 0, NULL };
+  slots_.resize(slot_count, empty);
+  for (ValueMap::const_iterator it = map.begin(); it != map.end(); ++it)
+    InsertWithHash(&*it, Hash(it->first));
+}
+
+DictionaryIndex::~DictionaryIndex() {
+}
+
+const ValueMap::value_type* DictionaryIndex::Find(
+    const StringPiece& key) const {
+  uint32 hash = Hash(key);
+  size_t mask = slots_.size() - 1;
+  for (size_t i = hash & mask; slots_[i].entry; i = (i + 1) & mask) {
+    if (slots_[i].hash == hash && slots_[i].entry->first == key)
+      return slots_[i].entry;
+  }
+  return NULL;
+}
+
+void DictionaryIndex::Insert(const ValueMap::value_type* entry) {
+  if (2 * (size_ + 1) > slots_.size()) {
+    std::vector<Slot> old_slots;
+    old_slots.swap(slots_);
+    Slot empty = { 0, NULL };
+    slots_.resize(2 * old_slots.size(), empty);
+    size_ = 0;
+    for (size_t i = 0; i < old_slots.size(); ++i) {
+      if (old_slots[i].entry)
+        InsertWithHash(old_slots[i].entry, old_slots[i].hash);
+    }
+  }
+  InsertWithHash(entry, Hash(entry->first));
+}
+
+void DictionaryIndex::Remove(const ValueMap::value_type* entry) {
+  size_t mask = slots_.size() - 1;
+  size_t i = Hash(entry->first) & mask;
+  while (slots_[i].entry != entry) {
+    DCHECK(slots_[i].entry);
+    i = (i + 1) & mask;
+  }
+  slots_[i].entry = NULL;
+  --size_;
+
+  // Move back the entries after the emptied slot that can no longer be
+  // reached from their home slot, so that no probe stops early.
+  for (size_t j = (i + 1) & mask; slots_[j].entry; j = (j + 1) & mask) {
+    size_t home = slots_[j].hash & mask;
+    bool reachable = i <= j ? (i < home && home <= j) :
+                              (i < home || home <= j);
+    if (!reachable) {
+      slots_[i] = slots_[j];
+      slots_[j].entry = NULL;
+      i = j;
+    }
+  }
+}
+
+// static
+uint32 DictionaryIndex::Hash(const StringPiece& key) {
+  uint32 hash = 2166136261u;
+  for (size_t i = 0; i < key.size(); ++i) {
+    hash ^= static_cast<unsigned char>(key[i]);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+void DictionaryIndex::InsertWithHash(const ValueMap::value_type* entry,
+                                     uint32 hash) {
+  size_t mask = slots_.size() - 1;
+  size_t i = hash & mask;
+  while (slots_[i].entry)
+    i = (i + 1) & mask;
+  slots_[i].hash = hash;
+  slots_[i].entry = entry;
+  ++size_;
+}
+
+}  // namespace internal
+
 ///////////////////// DictionaryValue ////////////////////
 
+// Dictionaries with fewer entries than this are searched in their map alone.
+static const size_t kMinIndexedSize = 8;
+
 DictionaryValue::DictionaryValue()
     : Value(TYPE_DICTIONARY) {
 }
@@ -367,9 +493,9 @@ bool DictionaryValue::GetAsDictionary(const DictionaryValue** out_value) const {
 
 bool DictionaryValue::HasKey(const std::string& key) const {
   DCHECK(IsStringUTF8(key));
-  ValueMap::const_iterator current_entry = dictionary_.find(key);
-  DCHECK((current_entry == dictionary_.end()) || current_entry->second);
-  return current_entry != dictionary_.end();
+  const ValueMap::value_type* current_entry = FindEntry(key);
+  DCHECK(!current_entry || current_entry->second);
+  return current_entry != NULL;
 }
 
 void DictionaryValue::Clear() {
@@ -380,30 +506,36 @@ void DictionaryValue::Clear() {
   }
 
   dictionary_.clear();
+  index_.reset();
 }
 
 void DictionaryValue::Set(const std::string& path, Value* in_value) {
   DCHECK(IsStringUTF8(path));
   DCHECK(in_value);
 
-  std::string current_path(path);
+  StringPiece current_path(path);
   DictionaryValue* current_dictionary = this;
   for (size_t delimiter_position = current_path.find('.');
-       delimiter_position != std::string::npos;
+       delimiter_position != StringPiece::npos;
        delimiter_position = current_path.find('.')) {
     // Assume that we're indexing into a dictionary.
-    std::string key(current_path, 0, delimiter_position);
+    StringPiece key = current_path.substr(0, delimiter_position);
+    const ValueMap::value_type* entry = current_dictionary->FindEntry(key);
     DictionaryValue* child_dictionary = NULL;
-    if (!current_dictionary->GetDictionary(key, &child_dictionary)) {
+    if (entry && entry->second->IsType(TYPE_DICTIONARY)) {
+      child_dictionary = static_cast<DictionaryValue*>(entry->second);
+    } else {
       child_dictionary = new DictionaryValue;
-      current_dictionary->SetWithoutPathExpansion(key, child_dictionary);
+      current_dictionary->SetWithoutPathExpansion(key.as_string(),
+                                                  child_dictionary);
     }
 
     current_dictionary = child_dictionary;
-    current_path.erase(0, delimiter_position + 1);
+    current_path.remove_prefix(delimiter_position + 1);
   }
 
-  current_dictionary->SetWithoutPathExpansion(current_path, in_value);
+  current_dictionary->SetWithoutPathExpansion(current_path.as_string(),
+                                              in_value);
 }
 
 void DictionaryValue::SetBoolean(const std::string& path, bool in_value) {
@@ -438,26 +570,38 @@ void DictionaryValue::SetWithoutPathExpansion(const std::string& key,
     DCHECK_NE(ins_res.first->second, in_value);  // This would be bogus
     delete ins_res.first->second;
     ins_res.first->second = in_value;
+  } else if (index_.get()) {
+    index_->Insert(&*ins_res.first);
+  } else if (dictionary_.size() >= kMinIndexedSize) {
+    index_.reset(new internal::DictionaryIndex(dictionary_));
   }
 }
 
 bool DictionaryValue::Get(const std::string& path, Value** out_value) const {
   DCHECK(IsStringUTF8(path));
-  std::string current_path(path);
+  // The keys of the path are looked up as pieces of it, without copies.
+  StringPiece current_path(path);
   const DictionaryValue* current_dictionary = this;
   for (size_t delimiter_position = current_path.find('.');
-       delimiter_position != std::string::npos;
+       delimiter_position != StringPiece::npos;
        delimiter_position = current_path.find('.')) {
-    DictionaryValue* child_dictionary = NULL;
-    if (!current_dictionary->GetDictionary(
-            current_path.substr(0, delimiter_position), &child_dictionary))
+    const ValueMap::value_type* entry = current_dictionary->FindEntry(
+        current_path.substr(0, delimiter_position));
+    if (!entry || !entry->second->IsType(TYPE_DICTIONARY))
       return false;
 
-    current_dictionary = child_dictionary;
-    current_path.erase(0, delimiter_position + 1);
+    current_dictionary = static_cast<const DictionaryValue*>(entry->second);
+    current_path.remove_prefix(delimiter_position + 1);
   }
 
-  return current_dictionary->GetWithoutPathExpansion(current_path, out_value);
+  const ValueMap::value_type* entry =
+      current_dictionary->FindEntry(current_path);
+  if (!entry)
+    return false;
+
+  if (out_value)
+    *out_value = entry->second;
+  return true;
 }
 
 bool DictionaryValue::GetBoolean(const std::string& path,
@@ -562,13 +706,12 @@ bool DictionaryValue::GetList(const std::string& path,
 bool DictionaryValue::GetWithoutPathExpansion(const std::string& key,
                                               Value** out_value) const {
   DCHECK(IsStringUTF8(key));
-  ValueMap::const_iterator entry_iterator = dictionary_.find(key);
-  if (entry_iterator == dictionary_.end())
+  const ValueMap::value_type* entry = FindEntry(key);
+  if (!entry)
     return false;
 
-  Value* entry = entry_iterator->second;
   if (out_value)
-    *out_value = entry;
+    *out_value = entry->second;
   return true;
 }
 
@@ -665,6 +808,8 @@ bool DictionaryValue::RemoveWithoutPathExpansion(const std::string& key,
     *out_value = entry;
   else
     delete entry;
+  if (index_.get())
+    index_->Remove(&*entry_iterator);
   dictionary_.erase(entry_iterator);
   return true;
 }
@@ -696,6 +841,7 @@ void DictionaryValue::MergeDictionary(const DictionaryValue* dictionary) {
 
 void DictionaryValue::Swap(DictionaryValue* other) {
   dictionary_.swap(other->dictionary_);
+  index_.swap(other->index_);
 }
 
 DictionaryValue* DictionaryValue::DeepCopy() const {
@@ -736,6 +882,14 @@ bool DictionaryValue::Equals(const Value* other) const {
   return true;
 }
 
+const ValueMap::value_type* DictionaryValue::FindEntry(
+    const StringPiece& key) const {
+  if (index_.get())
+    return index_->Find(key);
+  ValueMap::const_iterator entry_iterator = dictionary_.find(key.as_string());
+  return entry_iterator == dictionary_.end() ? NULL : &*entry_iterator;
+}
+
 ///////////////////// ListValue ////////////////////
 
 ListValue::ListValue() : Value(TYPE_LIST) {
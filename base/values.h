@@ -30,7 +30,9 @@
 #include "base/base_export.h"
 #include "base/basictypes.h"
 #include "base/compiler_specific.h"
+#include "base/memory/scoped_ptr.h"
 #include "base/string16.h"
+#include "base/string_piece.h"
 
 // This file declares "using base::Value", etc. at the bottom, so that
 // current code can use these classes without the base namespace. In
@@ -49,6 +51,10 @@ class Value;
 typedef std::vector<Value*> ValueVector;
 typedef std::map<std::string, Value*> ValueMap;
 
+namespace internal {
+class DictionaryIndex;
+}
+
 // The Value class is the base class for Values. A Value can be instantiated
 // via the Create*Value() factory methods, or by directly creating instances of
 // the subclasses.
@@ -372,8 +378,17 @@ class BASE_EXPORT DictionaryValue : public Value {
   virtual bool Equals(const Value* other) const OVERRIDE;
 
  private:
+  // Returns the entry with the key |key|, or NULL if there is none.
+  const ValueMap::value_type* FindEntry(const StringPiece& key) const;
+
+  // The entries, in the order of their keys for iteration.
   ValueMap dictionary_;
 
+  // A hash table of the entries, for lookups that compare about one key
+  // rather than one per level of the map.  Built once the dictionary has
+  // enough entries for that to be faster.
+  scoped_ptr<internal::DictionaryIndex> index_;
+
   DISALLOW_COPY_AND_ASSIGN(DictionaryValue);
 };
 
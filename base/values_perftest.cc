@@ -0,0 +1,114 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/values.h"
+
+#include <string>
+#include <vector>
+
+#include "base/memory/scoped_ptr.h"
+#include "base/perftimer.h"
+#include "base/stringprintf.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+const int kInsertIterations = 10;
+const int kLookupIterations = 100;
+
+// Returns the dotted paths of a tree shaped like a profile's preferences:
+// sections of a few settings each, and per-extension settings under one large
+// dictionary.
+std::vector<std::string> MakePreferencePaths() {
+  std::vector<std::string> paths;
+  const char* kSections[] = {
+    "browser", "profile", "download", "search", "session", "translate",
+    "webkit.webprefs", "net", "dns_prefetching", "autofill", "bookmark_bar",
+    "sync", "devtools", "plugins", "printing", "default_search_provider",
+  };
+  for (size_t i = 0; i < arraysize(kSections); ++i) {
+    for (int j = 0; j < 20; ++j)
+      paths.push_back(StringPrintf("%s.setting_%d", kSections[i], j));
+  }
+  for (int i = 0; i < 200; ++i) {
+    std::string extension = StringPrintf(
+        "extensions.settings.%032d", i * 7919);
+    paths.push_back(extension + ".state");
+    paths.push_back(extension + ".location");
+    paths.push_back(extension + ".manifest.name");
+    paths.push_back(extension + ".manifest.version");
+    paths.push_back(extension + ".manifest.permissions_count");
+  }
+  return paths;
+}
+
+// Returns keys like those of per-site content settings, which are not paths.
+std::vector<std::string> MakePatternKeys() {
+  std::vector<std::string> keys;
+  for (int i = 0; i < 1000; ++i)
+    keys.push_back(StringPrintf("[*.]site%d.example.com,*", i * 7919));
+  return keys;
+}
+
+}  // namespace
+
+TEST(ValuesPerfTest, PreferenceTree) {
+  std::vector<std::string> paths = MakePreferencePaths();
+  std::vector<std::string> keys = MakePatternKeys();
+
+  scoped_ptr<DictionaryValue> tree;
+  DictionaryValue* pattern_pairs = NULL;
+  PerfTimer insert_timer;
+  for (int iteration = 0; iteration < kInsertIterations; ++iteration) {
+    tree.reset(new DictionaryValue);
+    for (size_t i = 0; i < paths.size(); ++i)
+      tree->SetInteger(paths[i], static_cast<int>(i));
+    pattern_pairs = new DictionaryValue;
+    tree->Set("profile.content_settings.pattern_pairs", pattern_pairs);
+    for (size_t i = 0; i < keys.size(); ++i) {
+      DictionaryValue* setting = new DictionaryValue;
+      setting->SetInteger("setting", static_cast<int>(i));
+      pattern_pairs->SetWithoutPathExpansion(keys[i], setting);
+    }
+  }
+  LogPerfResult("DictionaryValue_Set",
+                (paths.size() + keys.size()) * kInsertIterations /
+                    insert_timer.Elapsed().InSecondsF(),
+                "sets/s");
+
+  int found = 0;
+  PerfTimer lookup_timer;
+  for (int iteration = 0; iteration < kLookupIterations; ++iteration) {
+    for (size_t i = 0; i < paths.size(); ++i) {
+      int value = 0;
+      if (tree->GetInteger(paths[i], &value))
+        found += value == static_cast<int>(i);
+    }
+  }
+  LogPerfResult("DictionaryValue_GetInteger",
+                paths.size() * kLookupIterations /
+                    lookup_timer.Elapsed().InSecondsF(),
+                "gets/s");
+  EXPECT_EQ(static_cast<int>(paths.size()) * kLookupIterations, found);
+
+  // Lookups of the keys of the largest dictionary, without path expansion.
+  found = 0;
+  PerfTimer key_timer;
+  for (int iteration = 0; iteration < kLookupIterations; ++iteration) {
+    for (size_t i = 0; i < keys.size(); ++i) {
+      DictionaryValue* setting = NULL;
+      found += pattern_pairs->GetDictionaryWithoutPathExpansion(keys[i],
+                                                                &setting);
+    }
+  }
+  LogPerfResult("DictionaryValue_GetWithoutPathExpansion",
+                keys.size() * kLookupIterations /
+                    key_timer.Elapsed().InSecondsF(),
+                "gets/s");
+  EXPECT_EQ(static_cast<int>(keys.size()) * kLookupIterations, found);
+}
+
+}  // namespace base
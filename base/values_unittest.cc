@@ -3,9 +3,11 @@
 // found in the LICENSE file.
 
 #include <limits>
+#include <map>
 
 #include "base/memory/scoped_ptr.h"
 #include "base/string16.h"
+#include "base/stringprintf.h"
 #include "base/utf_string_conversions.h"
 #include "base/values.h"
 #include "testing/gtest/include/gtest/gtest.h"
@@ -786,4 +788,62 @@ TEST(ValuesTest, DictionaryIterator) {
   EXPECT_TRUE(seen2);
 }
 
+// Large dictionaries, which are hashed, find the same entries as small ones
+// through inserts, replacements and removals, and still iterate in key order.
+TEST(ValuesTest, LargeDictionary) {
+  DictionaryValue dict;
+  std::map<std::string, int> expected;
+  for (int i = 0; i < 2000; ++i) {
+    // Keys repeat, and every third operation removes one.
+    std::string key = StringPrintf("key%d", (i * 7919) % 701);
+    if (i % 3 == 2) {
+      EXPECT_EQ(expected.erase(key) == 1,
+                dict.RemoveWithoutPathExpansion(key, NULL));
+    } else {
+      dict.SetWithoutPathExpansion(key, Value::CreateIntegerValue(i));
+      expected[key] = i;
+    }
+  }
+  ASSERT_EQ(expected.size(), dict.size());
+
+  std::map<std::string, int>::const_iterator expected_it = expected.begin();
+  for (DictionaryValue::Iterator it(dict); it.HasNext(); it.Advance()) {
+    ASSERT_TRUE(expected_it != expected.end());
+    EXPECT_EQ(expected_it->first, it.key());
+    ++expected_it;
+  }
+  EXPECT_TRUE(expected_it == expected.end());
+
+  for (int i = 0; i < 701; ++i) {
+    std::string key = StringPrintf("key%d", i);
+    int value = -1;
+    bool has_key = expected.count(key) == 1;
+    EXPECT_EQ(has_key, dict.HasKey(key));
+    EXPECT_EQ(has_key, dict.GetIntegerWithoutPathExpansion(key, &value));
+    if (has_key)
+      EXPECT_EQ(expected[key], value);
+  }
+
+  // Paths go through the hashed dictionaries too.
+  DictionaryValue root;
+  root.Set("a.b", dict.DeepCopy());
+  int value = -1;
+  EXPECT_TRUE(root.GetInteger("a.b." + expected.begin()->first, &value));
+  EXPECT_EQ(expected.begin()->second, value);
+  EXPECT_FALSE(root.GetInteger("a.b.missing", &value));
+  EXPECT_FALSE(root.GetInteger("a.b." + expected.begin()->first + ".c",
+                               &value));
+
+  // The index moves with the entries.
+  DictionaryValue other;
+  other.Swap(&dict);
+  EXPECT_EQ(0u, dict.size());
+  EXPECT_FALSE(dict.HasKey(expected.begin()->first));
+  EXPECT_TRUE(other.HasKey(expected.begin()->first));
+  other.Clear();
+  EXPECT_FALSE(other.HasKey(expected.begin()->first));
+  other.SetInteger("x", 1);
+  EXPECT_TRUE(other.HasKey("x"));
+}
+
 }  // namespace base
@@ -18,12 +18,12 @@ Version::~Version() {
 }
 
 Version::Version(const std::string& version_str) {
-  std::vector<std::string> numbers;
-  base::SplitString(version_str, '.', &numbers);
+  std::vector<base::StringPiece> numbers;
+  base::SplitStringPiece(version_str, '.', &numbers);
   if (numbers.empty())
     return;
   std::vector<uint16> parsed;
-  for (std::vector<std::string>::iterator i = numbers.begin();
+  for (std::vector<base::StringPiece>::iterator i = numbers.begin();
        i != numbers.end(); ++i) {
     int num;
     if (!base::StringToInt(*i, &num))
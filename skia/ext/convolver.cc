@@ -5,6 +5,15 @@
 #include <algorithm>
 
 #include "skia/ext/convolver.h"
+
+#include "base/atomicops.h"
+#include "base/bind.h"
+#include "base/location.h"
+#include "base/memory/ref_counted.h"
+#include "base/synchronization/lock.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/task_runner.h"
+#include "skia/ext/convolver_simd.h"
 #include "third_party/skia/include/core/SkTypes.h"
 
 #if defined(SIMD_SSE2)
@@ -42,7 +51,11 @@ class CircularRowBuffer {
         num_rows_(max_y_filter_size),
         next_row_(0),
         next_row_coordinate_(first_input_row) {
-    buffer_.resize(row_byte_width_ * max_y_filter_size);
+    // The vertical SIMD kernels read whole vectors, so they may read past
+    // the end of a row when |dest_row_pixel_width| is not a multiple of the
+    // vector width. Pad the buffer so those reads stay inside it for the last
+    // row too, whatever width the caller rounds the rows to.
+    buffer_.resize(row_byte_width_ * max_y_filter_size + kRowPaddingBytes);
     row_addresses_.resize(num_rows_);
   }
 
@@ -91,7 +104,12 @@ class CircularRowBuffer {
   }
 
  private:
-  // The buffer storing the rows. They are packed, each one row_byte_width_.
+  // Bytes after the last row, enough for one 32-byte AVX2 load from its last
+  // pixel.
+  static const int kRowPaddingBytes = 32;
+
+  // The buffer storing the rows. They are packed, each one row_byte_width_,
+  // and followed by kRowPaddingBytes.
   std::vector<unsigned char> buffer_;
 
   // Number of bytes per row in the |buffer_|.
@@ -715,19 +733,88 @@ void ConvolutionFilter1D::AddFilter(int filter_offset,
   max_filter_ = std::max(max_filter_, filter_length);
 }
 
-void BGRAConvolve2D(const unsigned char* source_data,
-                    int source_byte_row_stride,
-                    bool source_has_alpha,
-                    const ConvolutionFilter1D& filter_x,
-                    const ConvolutionFilter1D& filter_y,
-                    int output_byte_row_stride,
-                    unsigned char* output,
-                    bool use_sse2) {
+namespace {
+
+// The level GetConvolverSimdLevel() returns, or -1 before the CPU is checked.
+base::subtle::Atomic32 g_convolver_simd_level = -1;
+
+ConvolverSimdLevel GetCPULevel() {
+#if defined(SKIA_CONVOLVER_AVX2)
+  base::CPU cpu;
+  if (cpu.has_avx2())
+    return CONVOLVER_SIMD_AVX2;
+#endif
+  return CONVOLVER_SIMD_SSE2;
+}
+
+// Convolves horizontally along one or four rows with the best SIMD kernels.
+void ConvolveHorizontally_SIMD(const unsigned char* src_data,
+                               const ConvolutionFilter1D& filter,
+                               unsigned char* out_row,
+                               bool use_avx2) {
+#if defined(SKIA_CONVOLVER_AVX2)
+  if (use_avx2) {
+    ConvolveHorizontally_AVX2(src_data, filter, out_row);
+    return;
+  }
+#endif
+  ConvolveHorizontally_SSE2(src_data, filter, out_row);
+}
+
+void ConvolveHorizontally4_SIMD(const unsigned char* src_data[4],
+                                const ConvolutionFilter1D& filter,
+                                unsigned char* out_row[4],
+                                bool use_avx2) {
+#if defined(SKIA_CONVOLVER_AVX2)
+  if (use_avx2) {
+    ConvolveHorizontally4_AVX2(src_data, filter, out_row);
+    return;
+  }
+#endif
+  ConvolveHorizontally4_SSE2(src_data, filter, out_row);
+}
+
+// Does vertical convolution to produce one output row with the best SIMD
+// kernel.
+template<bool has_alpha>
+void ConvolveVertically_SIMD(const ConvolutionFilter1D::Fixed* filter_values,
+                             int filter_length,
+                             unsigned char* const* source_data_rows,
+                             int pixel_width,
+                             unsigned char* out_row,
+                             bool use_avx2) {
+#if defined(SKIA_CONVOLVER_AVX2)
+  if (use_avx2) {
+    ConvolveVertically_AVX2(filter_values, filter_length, source_data_rows,
+                            pixel_width, has_alpha, out_row);
+    return;
+  }
+#endif
+  ConvolveVertically_SSE2<has_alpha>(filter_values, filter_length,
+                                     source_data_rows, pixel_width, out_row);
+}
+
+// Convolves the output rows [begin_row, end_row) of BGRAConvolve2D(). Only the
+// source rows that the vertical filters of those rows reference are convolved
+// horizontally, so separate bands of output rows can be convolved
+// independently of each other.
+void ConvolveRows(const unsigned char* source_data,
+                  int source_byte_row_stride,
+                  bool source_has_alpha,
+                  const ConvolutionFilter1D& filter_x,
+                  const ConvolutionFilter1D& filter_y,
+                  int output_byte_row_stride,
+                  unsigned char* output,
+                  bool use_sse2,
+                  int begin_row,
+                  int end_row) {
 #if !defined(SIMD_SSE2)
   // Even we have runtime support for SSE2 instructions, since the binary
   // was not built with SSE2 support, we had to fallback to C version.
   use_sse2 = false;
 #endif
+  const bool use_avx2 =
+      use_sse2 && GetConvolverSimdLevel() == CONVOLVER_SIMD_AVX2;
 
   int max_y_filter_size = filter_y.max_filter();
 
@@ -735,10 +822,11 @@ void BGRAConvolve2D(const unsigned char* source_data,
   // convolved row for. If the filter doesn't start at the beginning of the
   // image (this is the case when we are only resizing a subset), then we
   // don't want to generate any output rows before that. Compute the starting
-  // row for convolution as the first pixel for the first vertical filter.
+  // row for convolution as the first pixel for the first vertical filter of
+  // the band.
   int filter_offset, filter_length;
   const ConvolutionFilter1D::Fixed* filter_values =
-      filter_y.FilterForValue(0, &filter_offset, &filter_length);
+      filter_y.FilterForValue(begin_row, &filter_offset, &filter_length);
   int next_x_row = filter_offset;
 
   // We loop over each row in the input doing a horizontal convolution. This
@@ -757,7 +845,7 @@ void BGRAConvolve2D(const unsigned char* source_data,
                                row_buffer_height,
                                filter_offset);
 
-  // Loop over every possible output row, processing just enough horizontal
+  // Loop over every output row of the band, processing just enough horizontal
   // convolutions to run each subsequent vertical convolution.
   SkASSERT(output_byte_row_stride >= filter_x.num_values() * 4);
   int num_output_rows = filter_y.num_values();
@@ -768,7 +856,7 @@ void BGRAConvolve2D(const unsigned char* source_data,
   filter_y.FilterForValue(num_output_rows - 1, &last_filter_offset,
                           &last_filter_length);
 
-  for (int out_y = 0; out_y < num_output_rows; out_y++) {
+  for (int out_y = begin_row; out_y < end_row; out_y++) {
     filter_values = filter_y.FilterForValue(out_y,
                                             &filter_offset, &filter_length);
 
@@ -782,7 +870,7 @@ void BGRAConvolve2D(const unsigned char* source_data,
             src[i] = &source_data[(next_x_row + i) * source_byte_row_stride];
             out_row[i] = row_buffer.AdvanceRow();
           }
-          ConvolveHorizontally4_SSE2(src, filter_x, out_row);
+          ConvolveHorizontally4_SIMD(src, filter_x, out_row, use_avx2);
           next_x_row += 4;
         } else {
           // For the last row, SSE2 load possibly to access data beyond the
@@ -798,9 +886,9 @@ void BGRAConvolve2D(const unsigned char* source_data,
                   filter_x, row_buffer.AdvanceRow());
             }
           } else {
-            ConvolveHorizontally_SSE2(
+            ConvolveHorizontally_SIMD(
                 &source_data[next_x_row * source_byte_row_stride],
-                filter_x, row_buffer.AdvanceRow());
+                filter_x, row_buffer.AdvanceRow(), use_avx2);
           }
           next_x_row++;
         }
@@ -835,9 +923,10 @@ void BGRAConvolve2D(const unsigned char* source_data,
 
     if (source_has_alpha) {
       if (use_sse2) {
-        ConvolveVertically_SSE2<true>(filter_values, filter_length,
+        ConvolveVertically_SIMD<true>(filter_values, filter_length,
                                       first_row_for_filter,
-                                      filter_x.num_values(), cur_output_row);
+                                      filter_x.num_values(), cur_output_row,
+                                      use_avx2);
       } else {
         ConvolveVertically<true>(filter_values, filter_length,
                                  first_row_for_filter,
@@ -845,9 +934,10 @@ void BGRAConvolve2D(const unsigned char* source_data,
       }
     } else {
       if (use_sse2) {
-        ConvolveVertically_SSE2<false>(filter_values, filter_length,
+        ConvolveVertically_SIMD<false>(filter_values, filter_length,
                                        first_row_for_filter,
-                                       filter_x.num_values(), cur_output_row);
+                                       filter_x.num_values(), cur_output_row,
+                                       use_avx2);
       } else {
         ConvolveVertically<false>(filter_values, filter_length,
                                  first_row_for_filter,
@@ -857,4 +947,150 @@ void BGRAConvolve2D(const unsigned char* source_data,
   }
 }
 
+// Shares the bands of a BGRAConvolve2DParallel() call between the calling
+// thread and the tasks that it posts. Whichever thread gets to a band first
+// convolves it, so the call finishes even if the posted tasks never run; tasks
+// that run after all the bands were taken do nothing.
+class ConvolveBandsJob : public base::RefCountedThreadSafe<ConvolveBandsJob> {
+ public:
+  ConvolveBandsJob(const unsigned char* source_data,
+                   int source_byte_row_stride,
+                   bool source_has_alpha,
+                   const ConvolutionFilter1D& filter_x,
+                   const ConvolutionFilter1D& filter_y,
+                   int output_byte_row_stride,
+                   unsigned char* output,
+                   bool use_sse2,
+                   int num_bands)
+      : source_data_(source_data),
+        source_byte_row_stride_(source_byte_row_stride),
+        source_has_alpha_(source_has_alpha),
+        filter_x_(&filter_x),
+        filter_y_(&filter_y),
+        output_byte_row_stride_(output_byte_row_stride),
+        output_(output),
+        use_sse2_(use_sse2),
+        num_bands_(num_bands),
+        next_band_(0),
+        bands_left_(num_bands),
+        done_(true, false) {
+  }
+
+  // Convolves bands until none are left to take.
+  void RunBands() {
+    for (;;) {
+      int band;
+      {
+        base::AutoLock lock(lock_);
+        if (next_band_ == num_bands_)
+          return;
+        band = next_band_++;
+      }
+
+      // Spread the output rows evenly over the bands.
+      const int num_rows = filter_y_->num_values();
+      ConvolveRows(source_data_, source_byte_row_stride_, source_has_alpha_,
+                   *filter_x_, *filter_y_, output_byte_row_stride_, output_,
+                   use_sse2_, num_rows * band / num_bands_,
+                   num_rows * (band + 1) / num_bands_);
+
+      base::AutoLock lock(lock_);
+      if (--bands_left_ == 0)
+        done_.Signal();
+    }
+  }
+
+  // Blocks until all the bands are convolved.
+  void Wait() {
+    done_.Wait();
+  }
+
+ private:
+  friend class base::RefCountedThreadSafe<ConvolveBandsJob>;
+
+  ~ConvolveBandsJob() {}
+
+  // The arguments of BGRAConvolve2DParallel(). They are only used while bands
+  // are left, which is before BGRAConvolve2DParallel() returns.
+  const unsigned char* source_data_;
+  int source_byte_row_stride_;
+  bool source_has_alpha_;
+  const ConvolutionFilter1D* filter_x_;
+  const ConvolutionFilter1D* filter_y_;
+  int output_byte_row_stride_;
+  unsigned char* output_;
+  bool use_sse2_;
+  int num_bands_;
+
+  // Protects |next_band_| and |bands_left_|.
+  base::Lock lock_;
+  int next_band_;
+  int bands_left_;
+
+  // Signaled when |bands_left_| drops to 0.
+  base::WaitableEvent done_;
+
+  DISALLOW_COPY_AND_ASSIGN(ConvolveBandsJob);
+};
+
+}  // namespace
+
+ConvolverSimdLevel GetConvolverSimdLevel() {
+  base::subtle::Atomic32 level =
+      base::subtle::NoBarrier_Load(&g_convolver_simd_level);
+  if (level < 0) {
+    // Racing threads all store the same value.
+    level = GetCPULevel();
+    base::subtle::NoBarrier_Store(&g_convolver_simd_level, level);
+  }
+  return static_cast<ConvolverSimdLevel>(level);
+}
+
+void SetConvolverSimdLevelForTesting(ConvolverSimdLevel level) {
+  base::subtle::NoBarrier_Store(&g_convolver_simd_level,
+                                std::min(level, GetCPULevel()));
+}
+
+void BGRAConvolve2D(const unsigned char* source_data,
+                    int source_byte_row_stride,
+                    bool source_has_alpha,
+                    const ConvolutionFilter1D& filter_x,
+                    const ConvolutionFilter1D& filter_y,
+                    int output_byte_row_stride,
+                    unsigned char* output,
+                    bool use_sse2) {
+  ConvolveRows(source_data, source_byte_row_stride, source_has_alpha,
+               filter_x, filter_y, output_byte_row_stride, output, use_sse2,
+               0, filter_y.num_values());
+}
+
+void BGRAConvolve2DParallel(const unsigned char* source_data,
+                            int source_byte_row_stride,
+                            bool source_has_alpha,
+                            const ConvolutionFilter1D& filter_x,
+                            const ConvolutionFilter1D& filter_y,
+                            int output_byte_row_stride,
+                            unsigned char* output,
+                            bool use_sse2,
+                            base::TaskRunner* task_runner,
+                            int num_bands) {
+  num_bands = std::min(num_bands, filter_y.num_values());
+  if (!task_runner || num_bands <= 1) {
+    BGRAConvolve2D(source_data, source_byte_row_stride, source_has_alpha,
+                   filter_x, filter_y, output_byte_row_stride, output,
+                   use_sse2);
+    return;
+  }
+
+  scoped_refptr<ConvolveBandsJob> job(new ConvolveBandsJob(
+      source_data, source_byte_row_stride, source_has_alpha, filter_x,
+      filter_y, output_byte_row_stride, output, use_sse2, num_bands));
+  for (int i = 1; i < num_bands; ++i) {
+    task_runner->PostTask(FROM_HERE,
+                          base::Bind(&ConvolveBandsJob::RunBands, job));
+  }
+  job->RunBands();
+  job->Wait();
+}
+
 }  // namespace skia
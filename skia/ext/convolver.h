@@ -26,6 +26,10 @@
 #undef FixedToFloat
 #endif
 
+namespace base {
+class TaskRunner;
+}
+
 namespace skia {
 
 // Represents a filter in one dimension. Each output pixel has one entry in this
@@ -168,6 +172,27 @@ SK_API void BGRAConvolve2D(const unsigned char* source_data,
                            int output_byte_row_stride,
                            unsigned char* output,
                            bool use_sse2);
+
+// Does the same convolution as BGRAConvolve2D(), but splits the output rows
+// into |num_bands| bands of about the same height that are convolved in
+// parallel: on the calling thread and in tasks posted to |task_runner|. The
+// call returns once every band is convolved. The calling thread convolves the
+// bands that no task has started on, so this can't deadlock waiting for a busy
+// or stopped |task_runner|.
+//
+// Each band convolves horizontally the source rows that its vertical filters
+// need, so the rows shared by neighboring bands are convolved once per band.
+// The output is identical to BGRAConvolve2D()'s.
+SK_API void BGRAConvolve2DParallel(const unsigned char* source_data,
+                                   int source_byte_row_stride,
+                                   bool source_has_alpha,
+                                   const ConvolutionFilter1D& xfilter,
+                                   const ConvolutionFilter1D& yfilter,
+                                   int output_byte_row_stride,
+                                   unsigned char* output,
+                                   bool use_sse2,
+                                   base::TaskRunner* task_runner,
+                                   int num_bands);
 }  // namespace skia
 
 #endif  // SKIA_EXT_CONVOLVER_H_
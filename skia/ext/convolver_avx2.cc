@@ -0,0 +1,322 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "skia/ext/convolver_simd.h"
+
+#include <immintrin.h>
+#include <string.h>
+
+// The kernels multiply 16 bit pixel channels with 16 bit filter coefficients
+// and add pairs of products with vpmaddwd. The sums are exact, so the results
+// are the same as those of the SSE2 kernels, which add the products one by
+// one.
+
+namespace skia {
+
+namespace {
+
+// Zero extends the channels of two pixels of each 128 bit lane to 16 bits and
+// interleaves them, so that vpmaddwd adds the products of the same channel of
+// both: [16] a1 a0 r1 r0 g1 g0 b1 b0. FirstPairShuffle() takes the first and
+// second pixels of the lane, SecondPairShuffle() the third and fourth.
+#define PAIR_SHUFFLE(p)                                                \
+    (p) * 4, -1, (p) * 4 + 4, -1, (p) * 4 + 1, -1, (p) * 4 + 5, -1,    \
+    (p) * 4 + 2, -1, (p) * 4 + 6, -1, (p) * 4 + 3, -1, (p) * 4 + 7, -1
+
+inline __m128i FirstPairShuffle() {
+  return _mm_setr_epi8(PAIR_SHUFFLE(0));
+}
+
+inline __m128i SecondPairShuffle() {
+  return _mm_setr_epi8(PAIR_SHUFFLE(2));
+}
+
+#undef PAIR_SHUFFLE
+
+// Masks out the coefficients loaded past the last |r| taps of a filter, where
+// |r| is 1, 2 or 3.
+inline __m128i TailMask(int r) {
+  static const short kMask[3][8] = {
+    { -1, 0, 0, 0, 0, 0, 0, 0 },
+    { -1, -1, 0, 0, 0, 0, 0, 0 },
+    { -1, -1, -1, 0, 0, 0, 0, 0 },
+  };
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(kMask[r - 1]));
+}
+
+// Adds the products of four pixels at |src| and the four coefficients in the
+// low 64 bits of |coeff| to the channel sums in |accum|.
+inline __m128i Accumulate4(const unsigned char* src, __m128i coeff,
+                           __m128i accum) {
+  // [8] a3 b3 g3 r3 a2 b2 g2 r2 a1 b1 g1 r1 a0 b0 g0 r0
+  __m128i src8 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+  // [16] c1 c0 c1 c0 c1 c0 c1 c0
+  __m128i coeff01 = _mm_shuffle_epi32(coeff, _MM_SHUFFLE(0, 0, 0, 0));
+  // [16] c3 c2 c3 c2 c3 c2 c3 c2
+  __m128i coeff23 = _mm_shuffle_epi32(coeff, _MM_SHUFFLE(1, 1, 1, 1));
+  // [32] a1*c1+a0*c0 r1*c1+r0*c0 g1*c1+g0*c0 b1*c1+b0*c0
+  accum = _mm_add_epi32(accum, _mm_madd_epi16(
+      _mm_shuffle_epi8(src8, FirstPairShuffle()), coeff01));
+  // [32] a3*c3+a2*c2 r3*c3+r2*c2 g3*c3+g2*c2 b3*c3+b2*c2
+  return _mm_add_epi32(accum, _mm_madd_epi16(
+      _mm_shuffle_epi8(src8, SecondPairShuffle()), coeff23));
+}
+
+// Adds the products of eight pixels at |src| and eight coefficients to the
+// channel sums in |accum|. The low lane of |coeff0145| holds the first and
+// second coefficients, the high lane the fifth and sixth; |coeff2367| holds
+// the others the same way. The low lane of |accum| sums the first four
+// pixels, the high lane the last four.
+inline __m256i Accumulate8(const unsigned char* src, __m256i coeff0145,
+                           __m256i coeff2367, __m256i accum) {
+  __m256i src8 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+  __m256i first_pairs = _mm256_broadcastsi128_si256(FirstPairShuffle());
+  __m256i second_pairs = _mm256_broadcastsi128_si256(SecondPairShuffle());
+  accum = _mm256_add_epi32(accum, _mm256_madd_epi16(
+      _mm256_shuffle_epi8(src8, first_pairs), coeff0145));
+  return _mm256_add_epi32(accum, _mm256_madd_epi16(
+      _mm256_shuffle_epi8(src8, second_pairs), coeff2367));
+}
+
+// Spreads the eight coefficients at |filter_values| over the lanes the way
+// Accumulate8() expects them.
+inline void LoadCoefficients8(const ConvolutionFilter1D::Fixed* filter_values,
+                              __m256i* coeff0145, __m256i* coeff2367) {
+  // [16] c7 c6 c5 c4 c3 c2 c1 c0
+  __m256i coeff = _mm256_castsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(filter_values)));
+  *coeff0145 = _mm256_permutevar8x32_epi32(
+      coeff, _mm256_setr_epi32(0, 0, 0, 0, 2, 2, 2, 2));
+  *coeff2367 = _mm256_permutevar8x32_epi32(
+      coeff, _mm256_setr_epi32(1, 1, 1, 1, 3, 3, 3, 3));
+}
+
+// Adds the high lane of |accum| to its low lane.
+inline __m128i AddLanes(__m256i accum) {
+  return _mm_add_epi32(_mm256_castsi256_si128(accum),
+                       _mm256_extracti128_si256(accum, 1));
+}
+
+// Brings the channel sums in |accum| back in range and stores them as one
+// pixel.
+inline void StorePixel(__m128i accum, unsigned char* out) {
+  __m128i zero = _mm_setzero_si128();
+  accum = _mm_srai_epi32(accum, ConvolutionFilter1D::kShiftBits);
+  accum = _mm_packs_epi32(accum, zero);
+  accum = _mm_packus_epi16(accum, zero);
+  *(reinterpret_cast<int*>(out)) = _mm_cvtsi128_si32(accum);
+}
+
+// Adds the products of eight pixels of two rows and the coefficients in
+// |coeff|, which holds the coefficient of the first row in the low 16 bits of
+// each 32 and that of the second row in the high 16, to the channel sums of
+// the pixels. |accum[0]| sums the first and fifth pixels, |accum[1]| the
+// second and sixth, and so on.
+inline void AccumulateRows(__m256i src0, __m256i src1, __m256i coeff,
+                           __m256i accum[4]) {
+  __m256i zero = _mm256_setzero_si256();
+  // [8] pixels 1 and 0 (5 and 4 in the high lane) of both rows, interleaved.
+  __m256i lo = _mm256_unpacklo_epi8(src0, src1);
+  // [8] pixels 3 and 2 (7 and 6) of both rows, interleaved.
+  __m256i hi = _mm256_unpackhi_epi8(src0, src1);
+  accum[0] = _mm256_add_epi32(accum[0], _mm256_madd_epi16(
+      _mm256_unpacklo_epi8(lo, zero), coeff));
+  accum[1] = _mm256_add_epi32(accum[1], _mm256_madd_epi16(
+      _mm256_unpackhi_epi8(lo, zero), coeff));
+  accum[2] = _mm256_add_epi32(accum[2], _mm256_madd_epi16(
+      _mm256_unpacklo_epi8(hi, zero), coeff));
+  accum[3] = _mm256_add_epi32(accum[3], _mm256_madd_epi16(
+      _mm256_unpackhi_epi8(hi, zero), coeff));
+}
+
+template<bool has_alpha>
+void ConvolveVertically(const ConvolutionFilter1D::Fixed* filter_values,
+                        int filter_length,
+                        unsigned char* const* source_data_rows,
+                        int pixel_width,
+                        unsigned char* out_row) {
+  // Output eight pixels (32 bytes) per iteration.
+  for (int out_x = 0; out_x < pixel_width; out_x += 8) {
+    const int byte_offset = out_x * 4;
+    __m256i accum[4] = {
+      _mm256_setzero_si256(), _mm256_setzero_si256(),
+      _mm256_setzero_si256(), _mm256_setzero_si256(),
+    };
+
+    // Convolve with two filter coefficients per iteration.
+    int filter_y = 0;
+    for (; filter_y + 1 < filter_length; filter_y += 2) {
+      __m256i coeff = _mm256_set1_epi32(
+          static_cast<unsigned short>(filter_values[filter_y]) |
+          (static_cast<unsigned>(static_cast<unsigned short>(
+              filter_values[filter_y + 1])) << 16));
+      AccumulateRows(
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(
+              &source_data_rows[filter_y][byte_offset])),
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(
+              &source_data_rows[filter_y + 1][byte_offset])),
+          coeff, accum);
+    }
+    if (filter_y < filter_length) {
+      __m256i coeff = _mm256_set1_epi32(
+          static_cast<unsigned short>(filter_values[filter_y]));
+      AccumulateRows(
+          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(
+              &source_data_rows[filter_y][byte_offset])),
+          _mm256_setzero_si256(), coeff, accum);
+    }
+
+    // Shift right for fixed point implementation, then pack to 16 and 8 bits
+    // per channel with saturation, which keeps the pixels in order.
+    for (int i = 0; i < 4; i++)
+      accum[i] = _mm256_srai_epi32(accum[i], ConvolutionFilter1D::kShiftBits);
+    // [8] pixels 3 2 1 0 (7 6 5 4 in the high lane)
+    __m256i result = _mm256_packus_epi16(
+        _mm256_packs_epi32(accum[0], accum[1]),
+        _mm256_packs_epi32(accum[2], accum[3]));
+
+    if (has_alpha) {
+      // Make sure the value of alpha channel is always larger than maximum
+      // value of color channels.
+      __m256i a = _mm256_srli_epi32(result, 8);
+      __m256i b = _mm256_max_epu8(a, result);  // Max of r and g.
+      a = _mm256_srli_epi32(result, 16);
+      b = _mm256_max_epu8(a, b);  // Max of r and g and b.
+      b = _mm256_slli_epi32(b, 24);
+      result = _mm256_max_epu8(b, result);
+    } else {
+      // Set value of alpha channels to 0xFF.
+      result = _mm256_or_si256(result, _mm256_set1_epi32(0xff000000));
+    }
+
+    if (out_x + 8 <= pixel_width) {
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(&out_row[byte_offset]),
+                          result);
+    } else {
+      // Only store the pixels that are part of the output.
+      unsigned char pixels[32];
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(pixels), result);
+      memcpy(&out_row[byte_offset], pixels, (pixel_width - out_x) * 4);
+    }
+  }
+}
+
+}  // namespace
+
+void ConvolveHorizontally_AVX2(const unsigned char* src_data,
+                               const ConvolutionFilter1D& filter,
+                               unsigned char* out_row) {
+  int num_values = filter.num_values();
+  int filter_offset, filter_length;
+
+  // Output one pixel each iteration, calculating all channels (RGBA) together.
+  for (int out_x = 0; out_x < num_values; out_x++) {
+    const ConvolutionFilter1D::Fixed* filter_values =
+        filter.FilterForValue(out_x, &filter_offset, &filter_length);
+    const unsigned char* row_to_filter = &src_data[filter_offset << 2];
+
+    // Eight taps per iteration while there are eight left.
+    __m256i accum8 = _mm256_setzero_si256();
+    int filter_x = 0;
+    for (; filter_x + 8 <= filter_length; filter_x += 8) {
+      __m256i coeff0145, coeff2367;
+      LoadCoefficients8(&filter_values[filter_x], &coeff0145, &coeff2367);
+      accum8 = Accumulate8(&row_to_filter[filter_x << 2], coeff0145,
+                           coeff2367, accum8);
+    }
+    __m128i accum = AddLanes(accum8);
+
+    // Then four, then the last one to three taps, loading the pixels and
+    // coefficients past them as ConvolveHorizontally_SSE2() does.
+    if (filter_x + 4 <= filter_length) {
+      __m128i coeff = _mm_loadl_epi64(
+          reinterpret_cast<const __m128i*>(&filter_values[filter_x]));
+      accum = Accumulate4(&row_to_filter[filter_x << 2], coeff, accum);
+      filter_x += 4;
+    }
+    int r = filter_length - filter_x;
+    if (r) {
+      __m128i coeff = _mm_loadl_epi64(
+          reinterpret_cast<const __m128i*>(&filter_values[filter_x]));
+      coeff = _mm_and_si128(coeff, TailMask(r));
+      accum = Accumulate4(&row_to_filter[filter_x << 2], coeff, accum);
+    }
+
+    StorePixel(accum, out_row);
+    out_row += 4;
+  }
+}
+
+void ConvolveHorizontally4_AVX2(const unsigned char* src_data[4],
+                                const ConvolutionFilter1D& filter,
+                                unsigned char* out_row[4]) {
+  int num_values = filter.num_values();
+  int filter_offset, filter_length;
+
+  // Output one pixel of each row per iteration.
+  for (int out_x = 0; out_x < num_values; out_x++) {
+    const ConvolutionFilter1D::Fixed* filter_values =
+        filter.FilterForValue(out_x, &filter_offset, &filter_length);
+    const int start = filter_offset << 2;
+
+    __m256i accum8[4] = {
+      _mm256_setzero_si256(), _mm256_setzero_si256(),
+      _mm256_setzero_si256(), _mm256_setzero_si256(),
+    };
+    int filter_x = 0;
+    for (; filter_x + 8 <= filter_length; filter_x += 8) {
+      __m256i coeff0145, coeff2367;
+      LoadCoefficients8(&filter_values[filter_x], &coeff0145, &coeff2367);
+      for (int i = 0; i < 4; i++) {
+        accum8[i] = Accumulate8(&src_data[i][start + (filter_x << 2)],
+                                coeff0145, coeff2367, accum8[i]);
+      }
+    }
+    __m128i accum[4];
+    for (int i = 0; i < 4; i++)
+      accum[i] = AddLanes(accum8[i]);
+
+    if (filter_x + 4 <= filter_length) {
+      __m128i coeff = _mm_loadl_epi64(
+          reinterpret_cast<const __m128i*>(&filter_values[filter_x]));
+      for (int i = 0; i < 4; i++) {
+        accum[i] = Accumulate4(&src_data[i][start + (filter_x << 2)], coeff,
+                               accum[i]);
+      }
+      filter_x += 4;
+    }
+    int r = filter_length - filter_x;
+    if (r) {
+      __m128i coeff = _mm_loadl_epi64(
+          reinterpret_cast<const __m128i*>(&filter_values[filter_x]));
+      coeff = _mm_and_si128(coeff, TailMask(r));
+      for (int i = 0; i < 4; i++) {
+        accum[i] = Accumulate4(&src_data[i][start + (filter_x << 2)], coeff,
+                               accum[i]);
+      }
+    }
+
+    for (int i = 0; i < 4; i++) {
+      StorePixel(accum[i], out_row[i]);
+      out_row[i] += 4;
+    }
+  }
+}
+
+void ConvolveVertically_AVX2(const ConvolutionFilter1D::Fixed* filter_values,
+                             int filter_length,
+                             unsigned char* const* source_data_rows,
+                             int pixel_width,
+                             bool has_alpha,
+                             unsigned char* out_row) {
+  if (has_alpha) {
+    ConvolveVertically<true>(filter_values, filter_length, source_data_rows,
+                             pixel_width, out_row);
+  } else {
+    ConvolveVertically<false>(filter_values, filter_length, source_data_rows,
+                              pixel_width, out_row);
+  }
+}
+
+}  // namespace skia
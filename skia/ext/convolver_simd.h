@@ -0,0 +1,59 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// AVX2 versions of the SSE2 convolution kernels of convolver.cc. They are
+// built in the skia_convolver_avx2 target, so that only convolver_avx2.cc is
+// compiled with -mavx2. The target defines SKIA_CONVOLVER_AVX2 for skia, which
+// picks the kernels at runtime with GetConvolverSimdLevel().
+//
+// This should only be used by the convolver and its tests.
+
+#ifndef SKIA_EXT_CONVOLVER_SIMD_H_
+#define SKIA_EXT_CONVOLVER_SIMD_H_
+#pragma once
+
+#include "skia/ext/convolver.h"
+#include "third_party/skia/include/core/SkTypes.h"
+
+namespace skia {
+
+// The kernels that BGRAConvolve2D() uses when it is asked to use SSE2.
+enum ConvolverSimdLevel {
+  CONVOLVER_SIMD_SSE2,
+  CONVOLVER_SIMD_AVX2
+};
+
+// Returns the best kernels the convolver can use on this CPU. Always
+// CONVOLVER_SIMD_SSE2 without SKIA_CONVOLVER_AVX2.
+SK_API ConvolverSimdLevel GetConvolverSimdLevel();
+
+// Makes the convolver use at most |level|, so that tests can cover every
+// kernel. Not thread safe.
+SK_API void SetConvolverSimdLevelForTesting(ConvolverSimdLevel level);
+
+// Same as ConvolveHorizontally_SSE2(), eight filter taps at a time.
+void ConvolveHorizontally_AVX2(const unsigned char* src_data,
+                               const ConvolutionFilter1D& filter,
+                               unsigned char* out_row);
+
+// Same as ConvolveHorizontally4_SSE2(), eight filter taps at a time.
+void ConvolveHorizontally4_AVX2(const unsigned char* src_data[4],
+                                const ConvolutionFilter1D& filter,
+                                unsigned char* out_row[4]);
+
+// Same as ConvolveVertically_SSE2(), eight pixels and two filter rows at a
+// time. It reads up to 7 pixels past |pixel_width| in every row of
+// |source_data_rows|, where the SSE2 version reads up to 3, but only writes
+// |pixel_width| pixels. The rows must be followed by at least 28 readable
+// bytes, which BGRAConvolve2D()'s row buffer pads its last row with.
+void ConvolveVertically_AVX2(const ConvolutionFilter1D::Fixed* filter_values,
+                             int filter_length,
+                             unsigned char* const* source_data_rows,
+                             int pixel_width,
+                             bool has_alpha,
+                             unsigned char* out_row);
+
+}  // namespace skia
+
+#endif  // SKIA_EXT_CONVOLVER_SIMD_H_
@@ -4,12 +4,16 @@
 
 #include <string.h>
 #include <time.h>
+#include <algorithm>
 #include <vector>
 
 #include "base/basictypes.h"
 #include "base/logging.h"
+#include "base/message_loop_proxy.h"
+#include "base/threading/thread.h"
 #include "base/time.h"
 #include "skia/ext/convolver.h"
+#include "skia/ext/convolver_simd.h"
 #include "testing/gtest/include/gtest/gtest.h"
 #include "third_party/skia/include/core/SkBitmap.h"
 #include "third_party/skia/include/core/SkColorPriv.h"
@@ -55,6 +59,35 @@ void FillBoxFilter(int size, ConvolutionFilter1D* filter) {
     filter->AddFilter(i * 2, box, 2);
 }
 
+// Fills |filter| with a 6-tap filter that scales |source_size| pixels to
+// |dest_size|.
+void FillScaleFilter(int source_size, int dest_size,
+                     ConvolutionFilter1D* filter) {
+  const float taps[] = { 0.05f, -0.15f, 0.6f, 0.6f, -0.15f, 0.05f };
+  const int num_taps = static_cast<int>(arraysize(taps));
+  for (int i = 0; i < dest_size; i++) {
+    int offset = std::min(source_size * i / dest_size, source_size - num_taps);
+    filter->AddFilter(offset, taps, num_taps);
+  }
+}
+
+// Fills |filter| with |dest_size| filters of random lengths from 1 to
+// |max_length| and random coefficients, over a source of |source_size|
+// pixels. Like the filters of a resize, the last one ends at the last pixel.
+void FillRandomFilter(int source_size, int dest_size, int max_length,
+                      ConvolutionFilter1D* filter) {
+  std::vector<float> taps(max_length);
+  for (int i = 0; i < dest_size; i++) {
+    int length = 1 + rand() % max_length;
+    for (int j = 0; j < length; j++)
+      taps[j] = (rand() % 1000 - 300) / (700.0f * length);
+    int offset = source_size - length;
+    if (i < dest_size - 1)
+      offset = std::min(source_size * i / dest_size, offset);
+    filter->AddFilter(offset, &taps[0], length);
+  }
+}
+
 }  // namespace
 
 // Tests that each pixel, when set and run through the impulse filter, does
@@ -318,4 +351,111 @@ TEST(Convolver, SIMDVerification) {
 #endif
 }
 
+TEST(Convolver, Parallel) {
+  const int source_width = 325;
+  const int source_height = 241;
+  const int dest_width = 177;
+  const int dest_height = 123;
+
+  ConvolutionFilter1D x_filter, y_filter;
+  FillScaleFilter(source_width, dest_width, &x_filter);
+  FillScaleFilter(source_height, dest_height, &y_filter);
+
+  std::vector<unsigned char> source(source_width * source_height * 4);
+  srand(static_cast<unsigned int>(time(0)));
+  for (size_t i = 0; i < source.size(); i++)
+    source[i] = rand() % 255;
+
+  base::Thread thread("ConvolverTest");
+  ASSERT_TRUE(thread.Start());
+  scoped_refptr<base::MessageLoopProxy> task_runner =
+      thread.message_loop_proxy();
+
+  const int output_stride = dest_width * 4;
+  std::vector<unsigned char> expected(output_stride * dest_height);
+  std::vector<unsigned char> output(expected.size());
+  const int band_counts[] = { 2, 3, 7, dest_height, dest_height + 10 };
+  base::CPU cpu;
+  for (int sse2 = 0; sse2 < 2; sse2++) {
+    const bool use_sse2 = sse2 && cpu.has_sse2();
+    for (int alpha = 0; alpha < 2; alpha++) {
+      BGRAConvolve2D(&source[0], source_width * 4, alpha != 0, x_filter,
+                     y_filter, output_stride, &expected[0], use_sse2);
+      for (size_t i = 0; i < arraysize(band_counts); i++) {
+        std::fill(output.begin(), output.end(), 0);
+        BGRAConvolve2DParallel(&source[0], source_width * 4, alpha != 0,
+                               x_filter, y_filter, output_stride, &output[0],
+                               use_sse2, task_runner, band_counts[i]);
+        EXPECT_TRUE(expected == output) << band_counts[i] << " bands";
+      }
+    }
+  }
+
+  // Tasks posted to a stopped thread never run, so the calling thread
+  // convolves all the bands.
+  thread.Stop();
+  std::fill(output.begin(), output.end(), 0);
+  BGRAConvolve2DParallel(&source[0], source_width * 4, true, x_filter,
+                         y_filter, output_stride, &output[0], false,
+                         task_runner, 4);
+  BGRAConvolve2D(&source[0], source_width * 4, true, x_filter, y_filter,
+                 output_stride, &expected[0], false);
+  EXPECT_TRUE(expected == output);
+}
+
+// Every SIMD kernel the CPU supports gives the same output as the C code, for
+// filters of all lengths up to twice the widest kernel and widths that aren't
+// multiples of the number of pixels the kernels write at a time.
+TEST(Convolver, SIMDKernelsMatch) {
+#if defined(SIMD_SSE2)
+  base::CPU cpu;
+  if (!cpu.has_sse2())
+    return;
+
+  const int sizes[][4] = {
+    // source width, source height, destination width, destination height
+    { 100, 80, 67, 41 },
+    { 64, 64, 64, 64 },
+    { 37, 29, 83, 61 },
+    { 300, 200, 9, 7 },
+  };
+  srand(static_cast<unsigned int>(time(0)));
+
+  const ConvolverSimdLevel max_level = GetConvolverSimdLevel();
+  for (size_t i = 0; i < arraysize(sizes); i++) {
+    const int source_width = sizes[i][0];
+    const int source_height = sizes[i][1];
+    const int dest_width = sizes[i][2];
+    const int dest_height = sizes[i][3];
+
+    ConvolutionFilter1D x_filter, y_filter;
+    FillRandomFilter(source_width, dest_width, 17, &x_filter);
+    FillRandomFilter(source_height, dest_height, 17, &y_filter);
+
+    std::vector<unsigned char> source(source_width * source_height * 4);
+    for (size_t j = 0; j < source.size(); j++)
+      source[j] = rand() % 256;
+
+    const int output_stride = dest_width * 4;
+    std::vector<unsigned char> expected(output_stride * dest_height);
+    std::vector<unsigned char> output(expected.size());
+    for (int alpha = 0; alpha < 2; alpha++) {
+      BGRAConvolve2D(&source[0], source_width * 4, alpha != 0, x_filter,
+                     y_filter, output_stride, &expected[0], false);
+      for (int level = CONVOLVER_SIMD_SSE2; level <= max_level; level++) {
+        SetConvolverSimdLevelForTesting(
+            static_cast<ConvolverSimdLevel>(level));
+        std::fill(output.begin(), output.end(), 0);
+        BGRAConvolve2D(&source[0], source_width * 4, alpha != 0, x_filter,
+                       y_filter, output_stride, &output[0], true);
+        EXPECT_TRUE(expected == output) << "level " << level << ", "
+            << source_width << "x" << source_height << " to " << dest_width
+            << "x" << dest_height << (alpha ? " with alpha" : " w/o alpha");
+      }
+    }
+  }
+  SetConvolverSimdLevelForTesting(max_level);
+#endif
+}
+
 }  // namespace skia
@@ -34,6 +34,11 @@ inline int FloorInt(float val) {
   return static_cast<int>(floor(val));
 }
 
+// The fewest destination rows worth splitting off into a band of a parallel
+// resize. Every band convolves the source rows its first destination rows
+// share with the previous band again, so thin bands waste work.
+const int kMinRowsPerBand = 32;
+
 // Filter function computation -------------------------------------------------
 
 // Evaluates the box filter, which goes from -0.5 to +0.5.
@@ -352,16 +357,31 @@ SkBitmap ImageOperations::Resize(const SkBitmap& source,
                                  ResizeMethod method,
                                  int dest_width, int dest_height,
                                  const SkIRect& dest_subset) {
-  if (method == ImageOperations::RESIZE_SUBPIXEL)
-    return ResizeSubpixel(source, dest_width, dest_height, dest_subset);
-  else
-    return ResizeBasic(source, method, dest_width, dest_height, dest_subset);
+  return Resize(source, method, dest_width, dest_height, dest_subset, NULL, 1);
+}
+
+// static
+SkBitmap ImageOperations::Resize(const SkBitmap& source,
+                                 ResizeMethod method,
+                                 int dest_width, int dest_height,
+                                 const SkIRect& dest_subset,
+                                 base::TaskRunner* task_runner,
+                                 int num_threads) {
+  if (method == ImageOperations::RESIZE_SUBPIXEL) {
+    return ResizeSubpixel(source, dest_width, dest_height, dest_subset,
+                          task_runner, num_threads);
+  } else {
+    return ResizeBasic(source, method, dest_width, dest_height, dest_subset,
+                       task_runner, num_threads);
+  }
 }
 
 // static
 SkBitmap ImageOperations::ResizeSubpixel(const SkBitmap& source,
                                          int dest_width, int dest_height,
-                                         const SkIRect& dest_subset) {
+                                         const SkIRect& dest_subset,
+                                         base::TaskRunner* task_runner,
+                                         int num_threads) {
   TRACE_EVENT2("skia", "ImageOperations::ResizeSubpixel",
                "src_pixels", source.width()*source.height(),
                "dst_pixels", dest_width*dest_height);
@@ -392,7 +412,7 @@ SkBitmap ImageOperations::ResizeSubpixel(const SkBitmap& source,
                      dest_subset.fLeft + dest_subset.width() * w,
                      dest_subset.fTop + dest_subset.height() * h };
   SkBitmap img = ResizeBasic(source, ImageOperations::RESIZE_LANCZOS3, width,
-                             height, subset);
+                             height, subset, task_runner, num_threads);
   const int row_words = img.rowBytes() / 4;
   if (w == 1 && h == 1)
     return img;
@@ -472,7 +492,9 @@ SkBitmap ImageOperations::ResizeSubpixel(const SkBitmap& source,
 SkBitmap ImageOperations::ResizeBasic(const SkBitmap& source,
                                       ResizeMethod method,
                                       int dest_width, int dest_height,
-                                      const SkIRect& dest_subset) {
+                                      const SkIRect& dest_subset,
+                                      base::TaskRunner* task_runner,
+                                      int num_threads) {
   TRACE_EVENT2("skia", "ImageOperations::ResizeBasic",
                "src_pixels", source.width()*source.height(),
                "dst_pixels", dest_width*dest_height);
@@ -522,11 +544,13 @@ SkBitmap ImageOperations::ResizeBasic(const SkBitmap& source,
   if (!result.readyToDraw())
     return SkBitmap();
 
-  BGRAConvolve2D(source_subset, static_cast<int>(source.rowBytes()),
-                 !source.isOpaque(), filter.x_filter(), filter.y_filter(),
-                 static_cast<int>(result.rowBytes()),
-                 static_cast<unsigned char*>(result.getPixels()),
-                 cpu.has_sse2());
+  const int num_bands = std::min(num_threads,
+                                dest_subset.height() / kMinRowsPerBand);
+  BGRAConvolve2DParallel(source_subset, static_cast<int>(source.rowBytes()),
+                         !source.isOpaque(), filter.x_filter(),
+                         filter.y_filter(), static_cast<int>(result.rowBytes()),
+                         static_cast<unsigned char*>(result.getPixels()),
+                         cpu.has_sse2(), task_runner, num_bands);
 
   // Preserve the "opaque" flag for use as an optimization later.
   result.setIsOpaque(source.isOpaque());
@@ -545,4 +569,15 @@ SkBitmap ImageOperations::Resize(const SkBitmap& source,
   return Resize(source, method, dest_width, dest_height, dest_subset);
 }
 
+// static
+SkBitmap ImageOperations::Resize(const SkBitmap& source,
+                                 ResizeMethod method,
+                                 int dest_width, int dest_height,
+                                 base::TaskRunner* task_runner,
+                                 int num_threads) {
+  SkIRect dest_subset = { 0, 0, dest_width, dest_height };
+  return Resize(source, method, dest_width, dest_height, dest_subset,
+                task_runner, num_threads);
+}
+
 }  // namespace skia
@@ -11,6 +11,10 @@
 class SkBitmap;
 struct SkIRect;
 
+namespace base {
+class TaskRunner;
+}
+
 namespace skia {
 
 class SK_API ImageOperations {
@@ -110,6 +114,23 @@ class SK_API ImageOperations {
                          ResizeMethod method,
                          int dest_width, int dest_height);
 
+  // Like the versions above, but splits the destination rows into up to
+  // |num_threads| bands that are resized in parallel: on the calling thread
+  // and in tasks posted to |task_runner|, which should run them on other
+  // threads. The result is the same as the single-threaded Resize()'s. Images
+  // too small to be worth splitting are resized on the calling thread only.
+  static SkBitmap Resize(const SkBitmap& source,
+                         ResizeMethod method,
+                         int dest_width, int dest_height,
+                         const SkIRect& dest_subset,
+                         base::TaskRunner* task_runner,
+                         int num_threads);
+  static SkBitmap Resize(const SkBitmap& source,
+                         ResizeMethod method,
+                         int dest_width, int dest_height,
+                         base::TaskRunner* task_runner,
+                         int num_threads);
+
  private:
   ImageOperations();  // Class for scoping only.
 
@@ -117,12 +138,16 @@ class SK_API ImageOperations {
   static SkBitmap ResizeBasic(const SkBitmap& source,
                               ResizeMethod method,
                               int dest_width, int dest_height,
-                              const SkIRect& dest_subset);
+                              const SkIRect& dest_subset,
+                              base::TaskRunner* task_runner,
+                              int num_threads);
 
   // Subpixel renderer.
   static SkBitmap ResizeSubpixel(const SkBitmap& source,
                                  int dest_width, int dest_height,
-                                 const SkIRect& dest_subset);
+                                 const SkIRect& dest_subset,
+                                 base::TaskRunner* task_runner,
+                                 int num_threads);
 };
 
 }  // namespace skia
@@ -9,7 +9,9 @@
 #include "base/basictypes.h"
 #include "base/compiler_specific.h"
 #include "base/file_util.h"
+#include "base/message_loop_proxy.h"
 #include "base/string_util.h"
+#include "base/threading/thread.h"
 #include "skia/ext/image_operations.h"
 #include "testing/gtest/include/gtest/gtest.h"
 #include "third_party/skia/include/core/SkBitmap.h"
@@ -643,3 +645,42 @@ TEST(ImageOperations, CompareLanczosMethods) {
 #endif  // #if DEBUG_BITMAP_GENERATION
   }
 }
+
+// Resizing in parallel bands gives the same result as resizing on one thread.
+TEST(ImageOperations, ResizeInParallel) {
+  SkBitmap src;
+  DrawGridToBitmap(640, 480, SK_ColorBLUE, SK_ColorRED, 8, 4, &src);
+
+  base::Thread thread("ImageOperationsTest");
+  ASSERT_TRUE(thread.Start());
+  scoped_refptr<base::MessageLoopProxy> task_runner =
+      thread.message_loop_proxy();
+
+  const skia::ImageOperations::ResizeMethod methods[] = {
+    skia::ImageOperations::RESIZE_BOX,
+    skia::ImageOperations::RESIZE_LANCZOS3,
+  };
+  const int dest_sizes[][2] = { { 160, 120 }, { 300, 400 }, { 17, 9 } };
+  for (size_t i = 0; i < arraysize(methods); ++i) {
+    for (size_t j = 0; j < arraysize(dest_sizes); ++j) {
+      const int dest_w = dest_sizes[j][0];
+      const int dest_h = dest_sizes[j][1];
+      SkBitmap expected = skia::ImageOperations::Resize(src, methods[i],
+                                                        dest_w, dest_h);
+      SkBitmap dest = skia::ImageOperations::Resize(src, methods[i],
+                                                    dest_w, dest_h,
+                                                    task_runner, 4);
+      ASSERT_EQ(dest_w, dest.width());
+      ASSERT_EQ(dest_h, dest.height());
+
+      SkAutoLockPixels expected_lock(expected);
+      SkAutoLockPixels dest_lock(dest);
+      for (int y = 0; y < dest_h; ++y) {
+        for (int x = 0; x < dest_w; ++x) {
+          ASSERT_EQ(*expected.getAddr32(x, y), *dest.getAddr32(x, y))
+              << "method " << methods[i] << " at " << x << ", " << y;
+        }
+      }
+    }
+  }
+}
@@ -740,6 +740,7 @@
         'ext/canvas_paint_win.h',
         'ext/convolver.cc',
         'ext/convolver.h',
+        'ext/convolver_simd.h',
         'ext/google_logging.cc',
         'ext/image_operations.cc',
         'ext/image_operations.h',
@@ -868,6 +869,11 @@
             '../third_party/skia/src/opts/opts_check_SSE2.cpp'
           ],
         }],
+        [ 'OS in ["linux", "freebsd", "openbsd", "solaris"] and target_arch != "arm"', {
+          'dependencies': [
+            'skia_convolver_avx2',
+          ],
+        }],
         [ 'use_glib == 1', {
           'dependencies': [
             '../build/linux/system.gyp:fontconfig',
@@ -1269,6 +1275,42 @@
         }],
       ],
     },
+    # Same as skia_opts_ssse3, for the AVX2 kernels of the convolver in
+    # skia/ext. convolver.cc only uses them if the CPU supports AVX2.
+    {
+      'target_name': 'skia_convolver_avx2',
+      'type': 'static_library',
+      'variables': {
+        'optimize': 'max',
+      },
+      'include_dirs': [
+        '..',
+        'config',
+        '../third_party/skia/include/config',
+        '../third_party/skia/include/core',
+      ],
+      'sources': [
+        'ext/convolver_avx2.cc',
+        'ext/convolver_simd.h',
+      ],
+      'cflags': [
+        '-mavx2',
+      ],
+      'direct_dependent_settings': {
+        'defines': [
+          'SKIA_CONVOLVER_AVX2',
+        ],
+      },
+      'conditions': [
+        ['order_profiling != 0', {
+          'target_conditions' : [
+            ['_toolset=="target"', {
+              'cflags!': [ '-finstrument-functions' ],
+            }],
+          ],
+        }],
+      ],
+    },
     {
       'target_name': 'image_operations_bench',
       'type': 'executable',
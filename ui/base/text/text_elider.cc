@@ -9,6 +9,7 @@
 
 #include "ui/base/text/text_elider.h"
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -27,6 +28,7 @@
 #include "net/base/net_util.h"
 #include "net/base/registry_controlled_domain.h"
 #endif
+#include "ui/gfx/canvas.h"
 #include "ui/gfx/font.h"
 #include "unicode/rbbi.h"
 #include "unicode/uloc.h"
@@ -55,21 +57,31 @@ class StringSlicer {
   // beginning and end of the string; otherwise, the end of the string is
   // removed and only the beginning remains.  If |insert_ellipsis| is true,
   // then an ellipsis character will by inserted at the cut point.
-  string16 CutString(size_t length, bool insert_ellipsis) {
+  string16 CutString(size_t length, bool insert_ellipsis) const {
     const string16 ellipsis_text = insert_ellipsis ? ellipsis_ : string16();
 
-    if (!elide_in_middle_)
-      return text_.substr(0, FindValidBoundaryBefore(length)) + ellipsis_text;
+    size_t prefix_length;
+    size_t suffix_start;
+    GetCut(length, &prefix_length, &suffix_start);
+    return text_.substr(0, prefix_length) + ellipsis_text +
+           text_.substr(suffix_start);
+  }
+
+  // Returns the text that CutString() keeps: the first |prefix_length|
+  // characters and the ones from |suffix_start| on.
+  void GetCut(size_t length,
+              size_t* prefix_length,
+              size_t* suffix_start) const {
+    if (!elide_in_middle_) {
+      *prefix_length = FindValidBoundaryBefore(length);
+      *suffix_start = text_.length();
+      return;
+    }
 
     // We put the extra character, if any, before the cut.
     const size_t half_length = length / 2;
-    const size_t prefix_length = FindValidBoundaryBefore(length - half_length);
-    const size_t suffix_start_guess = text_.length() - half_length;
-    const size_t suffix_start = FindValidBoundaryAfter(suffix_start_guess);
-    const size_t suffix_length =
-        half_length - (suffix_start_guess - suffix_start);
-    return text_.substr(0, prefix_length) + ellipsis_text +
-           text_.substr(suffix_start, suffix_length);
+    *prefix_length = FindValidBoundaryBefore(length - half_length);
+    *suffix_start = FindValidBoundaryAfter(text_.length() - half_length);
   }
 
  private:
@@ -101,6 +113,175 @@ class StringSlicer {
   DISALLOW_COPY_AND_ASSIGN(StringSlicer);
 };
 
+// The widths of the prefixes of a string, from a single layout of the whole
+// string. They give the width of any cut of the string without laying the cut
+// out, leaving out kerning and shaping across the cut.
+class PrefixWidths {
+ public:
+  PrefixWidths(const string16& text, const gfx::Font& font) {
+    std::vector<size_t> boundaries;
+    std::vector<int> widths;
+    if (!gfx::Canvas::GetStringPrefixWidths(text, font, &boundaries, &widths))
+      return;
+    // Pango returns 0 width for absurdly long strings; see
+    // ElideTextWithWidths().
+    if (widths.back() <= 0 || boundaries.back() != text.length())
+      return;
+
+    // An index inside a grapheme gets the width before the grapheme.
+    widths_.resize(text.length() + 1);
+    for (size_t i = 0; i + 1 < boundaries.size(); ++i) {
+      std::fill(widths_.begin() + boundaries[i],
+                widths_.begin() + boundaries[i + 1], widths[i]);
+    }
+    widths_.back() = widths.back();
+  }
+
+  // The widths of the part of |other|'s text that starts at |offset|.
+  PrefixWidths(const PrefixWidths& other, size_t offset) {
+    if (!other.is_valid())
+      return;
+    widths_.assign(other.widths_.begin() + offset, other.widths_.end());
+    for (size_t i = 0; i < widths_.size(); ++i)
+      widths_[i] -= other.widths_[offset];
+    if (widths_.back() <= 0)
+      widths_.clear();
+  }
+
+  bool is_valid() const { return !widths_.empty(); }
+
+  int text_width() const { return widths_.back(); }
+
+  // Returns the width of the characters of the text in [begin, end).
+  int GetWidth(size_t begin, size_t end) const {
+    return widths_[end] - widths_[begin];
+  }
+
+  // Returns the longest |length| up to |max_length| for which the text that
+  // |slicer| keeps is at most |available_pixel_width| wide.
+  size_t FindLongestCut(const StringSlicer& slicer,
+                        size_t max_length,
+                        int available_pixel_width) const {
+    // The widths only grow with |length|. Cuts of |fits| characters fit and
+    // cuts of |overflows| characters don't.
+    size_t fits = 0;
+    size_t overflows = max_length + 1;
+    while (overflows - fits > 1) {
+      const size_t length = fits + (overflows - fits) / 2;
+      size_t prefix_length;
+      size_t suffix_start;
+      slicer.GetCut(length, &prefix_length, &suffix_start);
+      const int width = GetWidth(0, prefix_length) +
+          GetWidth(suffix_start, widths_.size() - 1);
+      if (width <= available_pixel_width)
+        fits = length;
+      else
+        overflows = length;
+    }
+    return fits;
+  }
+
+ private:
+  // The width of the text before each index, from 0 to the text length.
+  std::vector<int> widths_;
+
+  DISALLOW_COPY_AND_ASSIGN(PrefixWidths);
+};
+
+// Does the work of ElideText(), with the widths of |text| in |widths| if they
+// are valid.
+string16 ElideTextWithWidths(const string16& text,
+                             const PrefixWidths& widths,
+                             const gfx::Font& font,
+                             int available_pixel_width,
+                             ElideBehavior elide_behavior) {
+  if (text.empty())
+    return text;
+
+  const string16 kEllipsisUTF16 = UTF8ToUTF16(kEllipsis);
+
+  const int current_text_pixel_width = widths.is_valid() ?
+      widths.text_width() : font.GetStringWidth(text);
+  const bool elide_in_middle = (elide_behavior == ELIDE_IN_MIDDLE);
+  const bool insert_ellipsis = (elide_behavior != TRUNCATE_AT_END);
+
+  StringSlicer slicer(text, kEllipsisUTF16, elide_in_middle);
+
+  // Pango will return 0 width for absurdly long strings. Cut the string in
+  // half and try again.
+  // This is caused by an int overflow in Pango (specifically, in
+  // pango_glyph_string_extents_range). It's actually more subtle than just
+  // returning 0, since on super absurdly long strings, the int can wrap and
+  // return positive numbers again. Detecting that is probably not worth it
+  // (eliding way too much from a ridiculous string is probably still
+  // ridiculous), but we should check other widths for bogus values as well.
+  if (current_text_pixel_width <= 0 && !text.empty()) {
+    const string16 cut = slicer.CutString(text.length() / 2, false);
+    return ElideText(cut, font, available_pixel_width, elide_behavior);
+  }
+
+  if (current_text_pixel_width <= available_pixel_width)
+    return text;
+
+  const int ellipsis_pixel_width = font.GetStringWidth(kEllipsisUTF16);
+  if (ellipsis_pixel_width > available_pixel_width)
+    return string16();
+
+  size_t lo = 0;
+  size_t hi = text.length() - 1;
+
+  // Start from the cut that the widths of the prefixes say is the longest
+  // that fits. Kerning and shaping across the cut can make it wider or
+  // narrower than that, so it is measured along with the next few longer
+  // ones, and the binary search below takes over if they don't settle it.
+  if (widths.is_valid()) {
+    const int kMaxExtraCuts = 3;
+    const size_t estimate = widths.FindLongestCut(
+        slicer, hi,
+        available_pixel_width - (insert_ellipsis ? ellipsis_pixel_width : 0));
+    const int estimate_width =
+        font.GetStringWidth(slicer.CutString(estimate, insert_ellipsis));
+    if (estimate_width > available_pixel_width) {
+      if (estimate > 0)
+        hi = estimate - 1;
+    } else if (estimate_width > 0) {
+      lo = estimate + 1;
+      for (int i = 0; i < kMaxExtraCuts && lo <= hi; ++i) {
+        const int cut_width =
+            font.GetStringWidth(slicer.CutString(lo, insert_ellipsis));
+        if (cut_width <= 0)
+          break;
+        if (cut_width > available_pixel_width) {
+          hi = lo - 1;
+          break;
+        }
+        ++lo;
+      }
+    }
+  }
+
+  // Use binary search to compute the elided text.
+  size_t guess;
+  for (guess = (lo + hi) / 2; lo <= hi; guess = (lo + hi) / 2) {
+    // We check the length of the whole desired string at once to ensure we
+    // handle kerning/ligatures/etc. correctly.
+    const string16 cut = slicer.CutString(guess, insert_ellipsis);
+    const int guess_length = font.GetStringWidth(cut);
+    // Check again that we didn't hit a Pango width overflow. If so, cut the
+    // current string in half and start over.
+    if (guess_length <= 0) {
+      return ElideText(slicer.CutString(guess / 2, false),
+                       font, available_pixel_width, elide_behavior);
+    }
+    if (guess_length > available_pixel_width)
+      hi = guess - 1;
+    else
+      lo = guess + 1;
+  }
+
+  return slicer.CutString(guess, insert_ellipsis);
+}
+
 // Build a path from the first |num_components| elements in |path_elements|.
 // Prepends |path_prefix|, appends |filename|, inserts ellipsis if appropriate.
 string16 BuildPathFromComponents(const string16& path_prefix,
@@ -464,55 +645,10 @@ string16 ElideText(const string16& text,
   if (text.empty())
     return text;
 
-  const string16 kEllipsisUTF16 = UTF8ToUTF16(kEllipsis);
-
-  const int current_text_pixel_width = font.GetStringWidth(text);
-  const bool elide_in_middle = (elide_behavior == ELIDE_IN_MIDDLE);
-  const bool insert_ellipsis = (elide_behavior != TRUNCATE_AT_END);
-
-  StringSlicer slicer(text, kEllipsisUTF16, elide_in_middle);
-
-  // Pango will return 0 width for absurdly long strings. Cut the string in
-  // half and try again.
-  // This is caused by an int overflow in Pango (specifically, in
-  // pango_glyph_string_extents_range). It's actually more subtle than just
-  // returning 0, since on super absurdly long strings, the int can wrap and
-  // return positive numbers again. Detecting that is probably not worth it
-  // (eliding way too much from a ridiculous string is probably still
-  // ridiculous), but we should check other widths for bogus values as well.
-  if (current_text_pixel_width <= 0 && !text.empty()) {
-    const string16 cut = slicer.CutString(text.length() / 2, false);
-    return ElideText(cut, font, available_pixel_width, elide_behavior);
-  }
-
-  if (current_text_pixel_width <= available_pixel_width)
-    return text;
-
-  if (font.GetStringWidth(kEllipsisUTF16) > available_pixel_width)
-    return string16();
-
-  // Use binary search to compute the elided text.
-  size_t lo = 0;
-  size_t hi = text.length() - 1;
-  size_t guess;
-  for (guess = (lo + hi) / 2; lo <= hi; guess = (lo + hi) / 2) {
-    // We check the length of the whole desired string at once to ensure we
-    // handle kerning/ligatures/etc. correctly.
-    const string16 cut = slicer.CutString(guess, insert_ellipsis);
-    const int guess_length = font.GetStringWidth(cut);
-    // Check again that we didn't hit a Pango width overflow. If so, cut the
-    // current string in half and start over.
-    if (guess_length <= 0) {
-      return ElideText(slicer.CutString(guess / 2, false),
-                       font, available_pixel_width, elide_behavior);
-    }
-    if (guess_length > available_pixel_width)
-      hi = guess - 1;
-    else
-      lo = guess + 1;
-  }
-
-  return slicer.CutString(guess, insert_ellipsis);
+  // Lay the text out once, rather than once for every cut that is tried.
+  const PrefixWidths widths(text, font);
+  return ElideTextWithWidths(text, widths, font, available_pixel_width,
+                             elide_behavior);
 }
 
 SortedDisplayURL::SortedDisplayURL(const GURL& url,
@@ -962,17 +1098,21 @@ void RectangleText::AddLine(const string16& line) {
 }
 
 int RectangleText::WrapWord(const string16& word) {
-  // Word is so wide that it must be fragmented.
-  string16 text = word;
+  // Word is so wide that it must be fragmented. Lay it out once for all the
+  // fragments.
+  const ui::PrefixWidths word_widths(word, font_);
+  size_t offset = 0;
   int lines_added = 0;
   bool first_fragment = true;
-  while (!full_ && !text.empty()) {
-    const string16 fragment =
-        ui::ElideText(text, font_, available_pixel_width_, ui::TRUNCATE_AT_END);
+  while (!full_ && offset < word.length()) {
+    const string16 text = word.substr(offset);
+    const string16 fragment = ui::ElideTextWithWidths(
+        text, ui::PrefixWidths(word_widths, offset), font_,
+        available_pixel_width_, ui::TRUNCATE_AT_END);
     if (!first_fragment && NewLine())
       lines_added++;
     AddToCurrentLine(fragment);
-    text = text.substr(fragment.length());
+    offset += fragment.length();
     first_fragment = false;
   }
   return lines_added;
@@ -320,6 +320,27 @@ TEST(TextEliderTest, ElideTextTruncate) {
   }
 }
 
+// Checks that ElideText() finds the longest prefix that fits, whichever way it
+// gets there.
+TEST(TextEliderTest, ElideTextLongestPrefix) {
+  const gfx::Font font;
+  const string16 text =
+      ASCIIToUTF16("The quick brown fox jumps over the lazy dog");
+  const string16 ellipsis = UTF8ToUTF16(kEllipsis);
+  const int text_width = font.GetStringWidth(text);
+
+  for (int width = font.GetStringWidth(ellipsis); width < text_width;
+       width += 3) {
+    const string16 result = ElideText(text, font, width, ELIDE_AT_END);
+    ASSERT_TRUE(EndsWith(result, ellipsis, true));
+    const size_t length = result.length() - ellipsis.length();
+    EXPECT_EQ(text.substr(0, length), result.substr(0, length));
+    EXPECT_LE(font.GetStringWidth(result), width);
+    EXPECT_GT(font.GetStringWidth(text.substr(0, length + 1) + ellipsis),
+              width);
+  }
+}
+
 // Checks that all occurrences of |first_char| are followed by |second_char| and
 // all occurrences of |second_char| are preceded by |first_char| in |text|.
 static void CheckSurrogatePairs(const string16& text,
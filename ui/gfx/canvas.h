@@ -126,6 +126,17 @@ class UI_EXPORT Canvas {
   // |text| with |font|.
   static int GetStringWidth(const string16& text, const gfx::Font& font);
 
+  // Lays |text| out once with |font| and returns its grapheme boundaries in
+  // |boundaries| and the width of the text before each of them in |widths|,
+  // so that callers can find where to cut the text without measuring every
+  // candidate with GetStringWidth(). The widths leave out kerning and shaping
+  // across the boundaries. Returns false if the widths aren't available on
+  // this platform or for this text.
+  static bool GetStringPrefixWidths(const string16& text,
+                                    const gfx::Font& font,
+                                    std::vector<size_t>* boundaries,
+                                    std::vector<int>* widths);
+
   // Returns the default text alignment to be used when drawing text on a
   // gfx::Canvas based on the directionality of the system locale language.
   // This function is used by gfx::Canvas::DrawStringInt when the text alignment
@@ -244,6 +244,14 @@ void Canvas::DrawStringWithHalo(const string16& text,
   context.DrawWithHalo(text_color, halo_color);
 }
 
+// static
+bool Canvas::GetStringPrefixWidths(const string16& text,
+                                   const gfx::Font& font,
+                                   std::vector<size_t>* boundaries,
+                                   std::vector<int>* widths) {
+  return false;
+}
+
 void Canvas::DrawStringWithShadows(const string16& text,
                                    const gfx::Font& font,
                                    SkColor color,
@@ -51,6 +51,14 @@ void Canvas::SizeStringInt(const string16& text,
   *height = font.GetHeight();
 }
 
+// static
+bool Canvas::GetStringPrefixWidths(const string16& text,
+                                   const gfx::Font& font,
+                                   std::vector<size_t>* boundaries,
+                                   std::vector<int>* widths) {
+  return false;
+}
+
 void Canvas::DrawStringWithShadows(const string16& text,
                                    const gfx::Font& font,
                                    SkColor color,
@@ -0,0 +1,96 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ui/gfx/canvas.h"
+
+#include <vector>
+
+#include "base/perftimer.h"
+#include "base/stringprintf.h"
+#include "base/utf_string_conversions.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "ui/gfx/font.h"
+#include "ui/gfx/size.h"
+#include "ui/gfx/text_layout_cache.h"
+
+namespace gfx {
+
+namespace {
+
+const int kRows = 250;
+const int kColumns = 4;
+const int kColumnWidth = 200;
+const int kRowHeight = 20;
+const int kFrames = 10;
+
+// A table of kRows * kColumns = 1,000 labels, like a task manager or a list of
+// downloads.
+class LabelTable {
+ public:
+  LabelTable() {
+    for (int row = 0; row < kRows; ++row) {
+      labels_.push_back(ASCIIToUTF16(base::StringPrintf("Process %d", row)));
+      labels_.push_back(ASCIIToUTF16(base::StringPrintf("%d K", row * 1031)));
+      labels_.push_back(ASCIIToUTF16(base::StringPrintf("%d.%d%%", row % 100,
+                                                        row % 10)));
+      labels_.push_back(ASCIIToUTF16(base::StringPrintf("pid %d", 1000 + row)));
+    }
+  }
+
+  // Sizes and draws every label, as a view hierarchy would on a repaint.
+  void Paint(Canvas* canvas) const {
+    for (int row = 0; row < kRows; ++row) {
+      for (int column = 0; column < kColumns; ++column) {
+        const string16& label = labels_[row * kColumns + column];
+        int width = kColumnWidth;
+        int height = 0;
+        Canvas::SizeStringInt(label, font_, &width, &height, 0);
+        canvas->DrawStringInt(label, font_, SK_ColorBLACK,
+                              column * kColumnWidth, row * kRowHeight,
+                              kColumnWidth, kRowHeight);
+      }
+    }
+  }
+
+ private:
+  std::vector<string16> labels_;
+  Font font_;
+};
+
+}  // namespace
+
+TEST(CanvasPerfTest, RepaintLabelTable) {
+  TextLayoutCache* cache = TextLayoutCache::GetInstance();
+  ASSERT_TRUE(cache);
+  ASSERT_GE(TextLayoutCache::kDefaultMaxRenderTexts,
+            static_cast<size_t>(kRows * kColumns));
+
+  LabelTable table;
+  Canvas canvas(Size(kColumns * kColumnWidth, kRows * kRowHeight), true);
+
+  // Every frame lays the labels out again.
+  PerfTimer uncached_timer;
+  for (int i = 0; i < kFrames; ++i) {
+    cache->Clear();
+    table.Paint(&canvas);
+  }
+  LogPerfResult("RepaintLabelTable_uncached",
+                uncached_timer.Elapsed().InMillisecondsF() / kFrames, "ms");
+
+  // The first frame fills the cache, the others hit it.
+  cache->Clear();
+  PerfTimer cached_timer;
+  for (int i = 0; i < kFrames; ++i)
+    table.Paint(&canvas);
+  LogPerfResult("RepaintLabelTable_cached",
+                cached_timer.Elapsed().InMillisecondsF() / kFrames, "ms");
+  LogPerfResult("RepaintLabelTable_hit_rate", cache->GetHitRate() * 100, "%");
+
+  const size_t lookups = kFrames * kRows * kColumns;
+  EXPECT_EQ(lookups, cache->size_hits() + cache->size_misses());
+  EXPECT_EQ(lookups - kRows * kColumns, cache->size_hits());
+  EXPECT_EQ(lookups - kRows * kColumns, cache->render_text_hits());
+}
+
+}  // namespace gfx
@@ -16,9 +16,14 @@
 #include "ui/gfx/render_text.h"
 #include "ui/gfx/shadow_value.h"
 #include "ui/gfx/skia_util.h"
+#include "ui/gfx/text_layout_cache.h"
 
 namespace {
 
+// If the string is too long, the call by |RenderTextWin| to |ScriptShape()|
+// will inexplicably fail with result E_INVALIDARG. Guard against this.
+const size_t kMaxRenderTextLength = 5000;
+
 // If necessary, wraps |text| with RTL/LTR directionality characters based on
 // |flags| and |text| content.
 // Returns true if the text will be rendered right-to-left.
@@ -206,6 +211,16 @@ void Canvas::SizeStringInt(const string16& text,
 
   flags = AdjustPlatformSpecificFlags(text, flags);
 
+  // The height passed in doesn't change the result, so it isn't in the key.
+  TextLayoutCache* cache = TextLayoutCache::GetInstance();
+  const TextLayoutCache::Key key(text, font, flags, *width, 0);
+  Size cached_size;
+  if (cache && cache->GetSize(key, &cached_size)) {
+    *width = cached_size.width();
+    *height = cached_size.height();
+    return;
+  }
+
   string16 adjusted_text = text;
 #if defined(OS_WIN)
   AdjustStringDirection(flags, &adjusted_text);
@@ -237,9 +252,6 @@ void Canvas::SizeStringInt(const string16& text,
     *width = w;
     *height = h;
   } else {
-    // If the string is too long, the call by |RenderTextWin| to |ScriptShape()|
-    // will inexplicably fail with result E_INVALIDARG. Guard against this.
-    const size_t kMaxRenderTextLength = 5000;
     if (adjusted_text.length() >= kMaxRenderTextLength) {
       *width = adjusted_text.length() * font.GetAverageCharacterWidth();
       *height = font.GetHeight();
@@ -253,6 +265,23 @@ void Canvas::SizeStringInt(const string16& text,
       *height = string_size.height();
     }
   }
+
+  if (cache)
+    cache->PutSize(key, Size(*width, *height));
+}
+
+// static
+bool Canvas::GetStringPrefixWidths(const string16& text,
+                                   const gfx::Font& font,
+                                   std::vector<size_t>* boundaries,
+                                   std::vector<int>* widths) {
+  if (text.length() >= kMaxRenderTextLength)
+    return false;
+
+  scoped_ptr<RenderText> render_text(RenderText::CreateRenderText());
+  UpdateRenderText(gfx::Rect(), text, font, NO_ELLIPSIS, 0, render_text.get());
+  render_text->GetGraphemePrefixWidths(boundaries, widths);
+  return true;
 }
 
 void Canvas::DrawStringWithShadows(const string16& text,
@@ -288,10 +317,10 @@ void Canvas::DrawStringWithShadows(const string16& text,
   AdjustStringDirection(flags, &adjusted_text);
 #endif
 
-  scoped_ptr<RenderText> render_text(RenderText::CreateRenderText());
-  render_text->SetTextShadows(shadows);
-
   if (flags & MULTI_LINE) {
+    scoped_ptr<RenderText> render_text(RenderText::CreateRenderText());
+    render_text->SetTextShadows(shadows);
+
     ui::WordWrapBehavior wrap_behavior = ui::IGNORE_LONG_WORDS;
     if (flags & CHARACTER_BREAK)
       wrap_behavior = ui::WRAP_LONG_WORDS;
@@ -326,37 +355,55 @@ void Canvas::DrawStringWithShadows(const string16& text,
       rect.Offset(0, line_height);
     }
   } else {
-    ui::Range range = StripAcceleratorChars(flags, &adjusted_text);
-    bool elide_text = (flags & NO_ELLIPSIS) ? false : true;
+    // A single line laid out for the same text, font, flags, color and width
+    // only needs to be moved to |rect|. Text with shadows isn't cached.
+    TextLayoutCache* cache =
+        shadows.empty() ? TextLayoutCache::GetInstance() : NULL;
+    const TextLayoutCache::Key key(text, font, flags, text_bounds.width(),
+                                   color);
+    RenderText* render_text = cache ? cache->GetRenderText(key) : NULL;
+    scoped_ptr<RenderText> uncached_render_text;
+
+    if (!render_text) {
+      uncached_render_text.reset(RenderText::CreateRenderText());
+      render_text = uncached_render_text.get();
+      render_text->SetTextShadows(shadows);
+
+      ui::Range range = StripAcceleratorChars(flags, &adjusted_text);
+      bool elide_text = (flags & NO_ELLIPSIS) ? false : true;
 
 #if defined(OS_LINUX)
-    // On Linux, eliding really means fading the end of the string. But only
-    // for LTR text. RTL text is still elided (on the left) with "...".
-    if (elide_text) {
-      render_text->SetText(adjusted_text);
-      if (render_text->GetTextDirection() == base::i18n::LEFT_TO_RIGHT) {
-        render_text->set_fade_tail(true);
-        elide_text = false;
+      // On Linux, eliding really means fading the end of the string. But only
+      // for LTR text. RTL text is still elided (on the left) with "...".
+      if (elide_text) {
+        render_text->SetText(adjusted_text);
+        if (render_text->GetTextDirection() == base::i18n::LEFT_TO_RIGHT) {
+          render_text->set_fade_tail(true);
+          elide_text = false;
+        }
       }
-    }
 #endif
 
-    if (elide_text) {
-      ElideTextAndAdjustRange(font,
-                              text_bounds.width(),
-                              &adjusted_text,
-                              &range);
-    }
+      if (elide_text) {
+        ElideTextAndAdjustRange(font,
+                                text_bounds.width(),
+                                &adjusted_text,
+                                &range);
+      }
 
-    UpdateRenderText(rect, adjusted_text, font, flags, color,
-                     render_text.get());
+      UpdateRenderText(rect, adjusted_text, font, flags, color, render_text);
+      ApplyUnderlineStyle(range, render_text);
 
+      if (cache)
+        cache->PutRenderText(key, uncached_render_text.release());
+    }
+
+    // The width of |rect| is the one in the key, so moving the RenderText
+    // doesn't lay it out again.
     const int line_height = render_text->GetStringSize().height();
     rect.Offset(0, VAlignText(line_height, flags, text_bounds.height()));
     rect.set_height(line_height);
     render_text->SetDisplayRect(rect);
-
-    ApplyUnderlineStyle(range, render_text.get());
     render_text->Draw(this);
   }
 
@@ -370,6 +370,14 @@ void Canvas::DrawStringInt(const string16& text,
                    clip.height());
 }
 
+// static
+bool Canvas::GetStringPrefixWidths(const string16& text,
+                                   const gfx::Font& font,
+                                   std::vector<size_t>* boundaries,
+                                   std::vector<int>* widths) {
+  return false;
+}
+
 void Canvas::DrawStringWithShadows(const string16& text,
                                    const gfx::Font& font,
                                    SkColor color,
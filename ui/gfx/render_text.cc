@@ -603,6 +603,23 @@ VisualCursorDirection RenderText::GetVisualDirectionOfLogicalEnd() {
       CURSOR_RIGHT : CURSOR_LEFT;
 }
 
+void RenderText::GetGraphemePrefixWidths(std::vector<size_t>* boundaries,
+                                         std::vector<int>* widths) {
+  EnsureLayout();
+  boundaries->assign(1, 0);
+  widths->assign(1, 0);
+  int width = 0;
+  for (size_t index = 0; index < text().length(); ) {
+    ui::Range xspan;
+    int height;
+    GetGlyphBounds(index, &xspan, &height);
+    width += xspan.length();
+    index = IndexOfAdjacentGrapheme(index, CURSOR_FORWARD);
+    boundaries->push_back(index);
+    widths->push_back(width);
+  }
+}
+
 void RenderText::Draw(Canvas* canvas) {
   EnsureLayout();
 
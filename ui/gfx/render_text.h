@@ -252,6 +252,14 @@ class UI_EXPORT RenderText {
   // the margin area of text shadows.
   virtual Size GetStringSize() = 0;
 
+  // Lays the text out once and returns its grapheme boundaries in logical
+  // order, from 0 to the length of the text, in |boundaries|, and the width of
+  // the graphemes before each boundary in |widths|. Kerning and shaping across
+  // a boundary are not accounted for, so a prefix may render slightly wider
+  // or narrower on its own.
+  virtual void GetGraphemePrefixWidths(std::vector<size_t>* boundaries,
+                                       std::vector<int>* widths);
+
   void Draw(Canvas* canvas);
 
   // Gets the SelectionModel from a visual point in local coordinates.
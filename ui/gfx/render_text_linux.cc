@@ -100,6 +100,52 @@ Size RenderTextLinux::GetStringSize() {
   return Size(width, height);
 }
 
+void RenderTextLinux::GetGraphemePrefixWidths(std::vector<size_t>* boundaries,
+                                              std::vector<int>* widths) {
+  EnsureLayout();
+
+  // Map the byte indices in |layout_text_| to character offsets.
+  std::vector<int> offsets(layout_text_len_ + 1);
+  int offset = 0;
+  for (const char* p = layout_text_; p < layout_text_ + layout_text_len_;
+       p = g_utf8_next_char(p)) {
+    offsets[p - layout_text_] = offset++;
+  }
+  offsets[layout_text_len_] = offset;
+
+  // Add up the advances of the clusters, which Pango visits in visual order,
+  // by the character they start with, in Pango units.
+  std::vector<int> advances(offset, 0);
+  PangoLayoutIter* iter = pango_layout_get_iter(layout_);
+  do {
+    const int index = pango_layout_iter_get_index(iter);
+    if (index < static_cast<int>(layout_text_len_)) {
+      PangoRectangle logical_rect;
+      pango_layout_iter_get_cluster_extents(iter, NULL, &logical_rect);
+      advances[offsets[index]] += std::max(0, logical_rect.width);
+    }
+  } while (pango_layout_iter_next_cluster(iter));
+  pango_layout_iter_free(iter);
+
+  // Walk the characters in logical order, stopping at grapheme boundaries.
+  // The character offsets in |layout_text_| are the same as in text().
+  boundaries->assign(1, 0);
+  widths->assign(1, 0);
+  int width = 0;
+  size_t text_index = 0;
+  for (int i = 0; i < offset && text_index < text().length(); ++i) {
+    width += advances[i];
+    do {
+      ++text_index;
+    } while (!ui::IsValidCodePointIndex(text(), text_index));
+    if (text_index == text().length() ||
+        (i + 1 < num_log_attrs_ && log_attrs_[i + 1].is_cursor_position)) {
+      boundaries->push_back(text_index);
+      widths->push_back(PANGO_PIXELS_CEIL(width));
+    }
+  }
+}
+
 SelectionModel RenderTextLinux::FindCursorPosition(const Point& point) {
   EnsureLayout();
 
@@ -22,6 +22,8 @@ class RenderTextLinux : public RenderText {
   // Overridden from RenderText:
   virtual base::i18n::TextDirection GetTextDirection() OVERRIDE;
   virtual Size GetStringSize() OVERRIDE;
+  virtual void GetGraphemePrefixWidths(std::vector<size_t>* boundaries,
+                                       std::vector<int>* widths) OVERRIDE;
   virtual SelectionModel FindCursorPosition(const Point& point) OVERRIDE;
   virtual std::vector<FontSpan> GetFontSpansForTesting() OVERRIDE;
 
@@ -948,6 +948,35 @@ TEST_F(RenderTextTest, StringSizeSanity) {
   EXPECT_GT(string_size.height(), 0);
 }
 
+TEST_F(RenderTextTest, GraphemePrefixWidths) {
+  // ab, e with a combining acute accent, the surrogate pair of U+1D11E, cd.
+  const string16 text = UTF8ToUTF16("abe\xCC\x81\xF0\x9D\x84\x9E" "cd");
+  scoped_ptr<RenderText> render_text(RenderText::CreateRenderText());
+  render_text->SetText(text);
+
+  std::vector<size_t> boundaries;
+  std::vector<int> widths;
+  render_text->GetGraphemePrefixWidths(&boundaries, &widths);
+
+  const size_t kExpectedBoundaries[] = { 0, 1, 2, 4, 6, 7, 8 };
+  ASSERT_EQ(arraysize(kExpectedBoundaries), boundaries.size());
+  ASSERT_EQ(boundaries.size(), widths.size());
+  for (size_t i = 0; i < boundaries.size(); ++i)
+    EXPECT_EQ(kExpectedBoundaries[i], boundaries[i]);
+
+  EXPECT_EQ(0, widths[0]);
+  for (size_t i = 1; i < widths.size(); ++i)
+    EXPECT_LE(widths[i - 1], widths[i]);
+  EXPECT_LT(widths[0], widths[1]);
+  EXPECT_NEAR(render_text->GetStringSize().width(), widths.back(), 1);
+
+  render_text->SetText(string16());
+  render_text->GetGraphemePrefixWidths(&boundaries, &widths);
+  ASSERT_EQ(1U, boundaries.size());
+  EXPECT_EQ(0U, boundaries[0]);
+  EXPECT_EQ(0, widths[0]);
+}
+
 TEST_F(RenderTextTest, StringSizeEmptyString) {
   const Font font;
   scoped_ptr<RenderText> render_text(RenderText::CreateRenderText());
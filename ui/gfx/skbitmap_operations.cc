@@ -10,7 +10,6 @@
 #include "base/logging.h"
 #include "third_party/skia/include/core/SkBitmap.h"
 #include "third_party/skia/include/core/SkCanvas.h"
-#include "third_party/skia/include/core/SkColorFilter.h"
 #include "third_party/skia/include/core/SkColorPriv.h"
 #include "third_party/skia/include/core/SkUnPreMultiply.h"
 #include "third_party/skia/include/effects/SkBlurImageFilter.h"
@@ -18,6 +17,142 @@
 #include "ui/gfx/point.h"
 #include "ui/gfx/size.h"
 
+#if defined(ARCH_CPU_X86_FAMILY)
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || _M_IX86_FP==2
+// This is where we had compiler support for SSE2 instructions. The SSE2 loops
+// below also need SkPMColor to have the same byte order as SkColor.
+#if SK_A32_SHIFT == 24 && SK_R32_SHIFT == 16 && SK_G32_SHIFT == 8 && \
+    SK_B32_SHIFT == 0
+#define SIMD_SSE2 1
+#endif
+#endif
+#endif
+
+#if defined(SIMD_SSE2)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Whether the operations use their SSE2 loops, when they are built.
+bool g_use_simd = true;
+
+#if defined(SIMD_SSE2)
+
+// The SSE2 loops work on four pixels at a time, one pixel per 32-bit lane, and
+// split them into one register per channel so that every lane does the same
+// arithmetic as the C++ loop does on one channel of one pixel.
+
+// Returns the channel of the four pixels of |pixels| at bit |shift|.
+inline __m128i GetChannels(__m128i pixels, int shift) {
+  return _mm_and_si128(_mm_srli_epi32(pixels, shift), _mm_set1_epi32(0xFF));
+}
+
+// Packs four pixels from their channels, like SkPackARGB32() and
+// SkColorSetARGB() do.
+inline __m128i PackChannels(__m128i a, __m128i r, __m128i g, __m128i b) {
+  return _mm_or_si128(
+      _mm_or_si128(_mm_slli_epi32(a, 24), _mm_slli_epi32(r, 16)),
+      _mm_or_si128(_mm_slli_epi32(g, 8), b));
+}
+
+// Returns the low 32 bits of the products of the lanes of |a| and |b|, which
+// is the same for signed and unsigned lanes. SSE2 has no pmulld.
+inline __m128i MulLo32(__m128i a, __m128i b) {
+  __m128i even = _mm_mul_epu32(a, b);
+  __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+  return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+                            _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+// Divides signed lanes by 2^|shift|, rounding towards zero like C++ does.
+inline __m128i DivideByPowerOf2(__m128i a, int shift) {
+  __m128i bias = _mm_and_si128(_mm_srai_epi32(a, 31),
+                               _mm_set1_epi32((1 << shift) - 1));
+  return _mm_srai_epi32(_mm_add_epi32(a, bias), shift);
+}
+
+// Calls SkUnPreMultiply::PMColorToColor() on four pixels. |in| must be the
+// same four pixels, for the lookups in the scale table.
+inline __m128i UnPreMultiply4(const SkPMColor* in, __m128i pixels) {
+  const SkUnPreMultiply::Scale* table = SkUnPreMultiply::GetScaleTable();
+  __m128i scale = _mm_set_epi32(table[SkGetPackedA32(in[3])],
+                                table[SkGetPackedA32(in[2])],
+                                table[SkGetPackedA32(in[1])],
+                                table[SkGetPackedA32(in[0])]);
+  __m128i half = _mm_set1_epi32(1 << 23);
+  __m128i r = _mm_srli_epi32(
+      _mm_add_epi32(MulLo32(GetChannels(pixels, 16), scale), half), 24);
+  __m128i g = _mm_srli_epi32(
+      _mm_add_epi32(MulLo32(GetChannels(pixels, 8), scale), half), 24);
+  __m128i b = _mm_srli_epi32(
+      _mm_add_epi32(MulLo32(GetChannels(pixels, 0), scale), half), 24);
+  return PackChannels(_mm_srli_epi32(pixels, 24), r, g, b);
+}
+
+// Converts the two low lanes of |a| to doubles, or the two high ones.
+inline __m128d LanesToDouble(__m128i a, bool high) {
+  return high ? _mm_cvtepi32_pd(_mm_shuffle_epi32(a, _MM_SHUFFLE(1, 0, 3, 2)))
+              : _mm_cvtepi32_pd(a);
+}
+
+// Truncates the doubles of |lo| and |hi| back into four lanes.
+inline __m128i DoublesToLanes(__m128d lo, __m128d hi) {
+  return _mm_unpacklo_epi64(_mm_cvttpd_epi32(lo), _mm_cvttpd_epi32(hi));
+}
+
+// Computes static_cast<int>(a * a_scale + b * b_scale) for each lane, in
+// double precision like the C++ loops.
+inline __m128i Blend4(__m128i a, __m128d a_scale, __m128i b, __m128d b_scale) {
+  __m128d blended[2];
+  for (int half = 0; half < 2; ++half) {
+    bool high = half == 1;
+    blended[half] = _mm_add_pd(_mm_mul_pd(LanesToDouble(a, high), a_scale),
+                               _mm_mul_pd(LanesToDouble(b, high), b_scale));
+  }
+  return DoublesToLanes(blended[0], blended[1]);
+}
+
+// Does the arithmetic of CreateButtonBackground() for four pixels. |bg| holds
+// the channels of the background color, blue first.
+inline __m128i ButtonBackground4(const __m128d bg[4],
+                                 __m128i image_pixels,
+                                 __m128i mask_pixels) {
+  const __m128d one = _mm_set1_pd(1.0);
+  const __m128d max = _mm_set1_pd(255.0);
+  __m128d channels[4][2];
+  for (int half = 0; half < 2; ++half) {
+    bool high = half == 1;
+    __m128d img_a = LanesToDouble(_mm_srli_epi32(image_pixels, 24), high);
+    __m128d img_alpha = _mm_div_pd(img_a, max);
+    __m128d img_inv = _mm_sub_pd(one, img_alpha);
+    __m128d mask_a = _mm_div_pd(
+        LanesToDouble(_mm_srli_epi32(mask_pixels, 24), high), max);
+
+    channels[3][half] = _mm_mul_pd(_mm_min_pd(max, _mm_add_pd(bg[3], img_a)),
+                                   mask_a);
+    for (int i = 0; i < 3; ++i) {
+      __m128d img = LanesToDouble(GetChannels(image_pixels, i * 8), high);
+      channels[i][half] = _mm_mul_pd(
+          _mm_add_pd(_mm_mul_pd(bg[i], img_inv), _mm_mul_pd(img, img_alpha)),
+          mask_a);
+    }
+  }
+  return PackChannels(DoublesToLanes(channels[3][0], channels[3][1]),
+                      DoublesToLanes(channels[2][0], channels[2][1]),
+                      DoublesToLanes(channels[1][0], channels[1][1]),
+                      DoublesToLanes(channels[0][0], channels[0][1]));
+}
+
+#endif  // defined(SIMD_SSE2)
+
+}  // namespace
+
+// static
+void SkBitmapOperations::SetUseSIMDForTesting(bool use_simd) {
+  g_use_simd = use_simd;
+}
+
 // static
 SkBitmap SkBitmapOperations::CreateInvertedBitmap(const SkBitmap& image) {
   DCHECK(image.config() == SkBitmap::kARGB_8888_Config);
@@ -109,7 +244,30 @@ SkBitmap SkBitmapOperations::CreateBlendedBitmap(const SkBitmap& first,
     uint32* second_row = second.getAddr32(0, y);
     uint32* dst_row = blended.getAddr32(0, y);
 
-    for (int x = 0; x < first.width(); ++x) {
+    int x = 0;
+#if defined(SIMD_SSE2)
+    if (g_use_simd) {
+      __m128d first_scale = _mm_set1_pd(first_alpha);
+      __m128d second_scale = _mm_set1_pd(alpha);
+      for (; x + 4 <= first.width(); x += 4) {
+        __m128i first_pixels = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(first_row + x));
+        __m128i second_pixels = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(second_row + x));
+        __m128i channels[4];
+        for (int i = 0; i < 4; ++i) {
+          channels[i] = Blend4(GetChannels(first_pixels, i * 8), first_scale,
+                               GetChannels(second_pixels, i * 8),
+                               second_scale);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst_row + x),
+                         PackChannels(channels[3], channels[2], channels[1],
+                                      channels[0]));
+      }
+    }
+#endif
+
+    for (; x < first.width(); ++x) {
       uint32 first_pixel = first_row[x];
       uint32 second_pixel = second_row[x];
 
@@ -152,7 +310,31 @@ SkBitmap SkBitmapOperations::CreateMaskedBitmap(const SkBitmap& rgb,
     uint32* alpha_row = alpha.getAddr32(0, y);
     uint32* dst_row = masked.getAddr32(0, y);
 
-    for (int x = 0; x < masked.width(); ++x) {
+    int x = 0;
+#if defined(SIMD_SSE2)
+    if (g_use_simd) {
+      for (; x + 4 <= masked.width(); x += 4) {
+        __m128i rgb_pixels = UnPreMultiply4(rgb_row + x, _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(rgb_row + x)));
+        __m128i alpha_pixels = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(alpha_row + x));
+        // All the products fit in 16 bits, like SkAlphaMul() expects.
+        __m128i a = _mm_srli_epi32(
+            _mm_mullo_epi16(_mm_srli_epi32(rgb_pixels, 24),
+                            _mm_srli_epi32(alpha_pixels, 24)), 8);
+        __m128i r = _mm_srli_epi32(
+            _mm_mullo_epi16(GetChannels(rgb_pixels, 16), a), 8);
+        __m128i g = _mm_srli_epi32(
+            _mm_mullo_epi16(GetChannels(rgb_pixels, 8), a), 8);
+        __m128i b = _mm_srli_epi32(
+            _mm_mullo_epi16(GetChannels(rgb_pixels, 0), a), 8);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst_row + x),
+                         PackChannels(a, r, g, b));
+      }
+    }
+#endif
+
+    for (; x < masked.width(); ++x) {
       SkColor rgb_pixel = SkUnPreMultiply::PMColorToColor(rgb_row[x]);
       SkColor alpha_pixel = SkUnPreMultiply::PMColorToColor(alpha_row[x]);
       int alpha = SkAlphaMul(SkColorGetA(rgb_pixel), SkColorGetA(alpha_pixel));
@@ -192,7 +374,35 @@ SkBitmap SkBitmapOperations::CreateButtonBackground(SkColor color,
     uint32* image_row = image.getAddr32(0, y % image.height());
     uint32* mask_row = mask.getAddr32(0, y);
 
-    for (int x = 0; x < mask.width(); ++x) {
+    int x = 0;
+#if defined(SIMD_SSE2)
+    if (g_use_simd) {
+      const __m128d bg[4] = {
+        _mm_set1_pd(bg_b), _mm_set1_pd(bg_g), _mm_set1_pd(bg_r),
+        _mm_set1_pd(bg_a)
+      };
+      for (; x + 4 <= mask.width(); x += 4) {
+        // |image| is tiled, so the four pixels may wrap around its row.
+        int image_x = x % image.width();
+        __m128i image_pixels;
+        if (image_x + 4 <= image.width()) {
+          image_pixels = _mm_loadu_si128(
+              reinterpret_cast<const __m128i*>(image_row + image_x));
+        } else {
+          image_pixels = _mm_set_epi32(image_row[(x + 3) % image.width()],
+                                       image_row[(x + 2) % image.width()],
+                                       image_row[(x + 1) % image.width()],
+                                       image_row[image_x]);
+        }
+        __m128i mask_pixels = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(mask_row + x));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst_row + x),
+                         ButtonBackground4(bg, image_pixels, mask_pixels));
+      }
+    }
+#endif
+
+    for (; x < mask.width(); ++x) {
       uint32 image_pixel = image_row[x % image.width()];
 
       double img_a = SkColorGetA(image_pixel);
@@ -272,6 +482,33 @@ enum OperationOnL { kOpLNone = 0, kOpLDec, kOpLInc, kNumLOps };
 // be small enough, but let's play it safe>
 const double epsilon = 0.0005;
 
+#if defined(SIMD_SSE2)
+// Does the first step of the LineProcHnopSdec*() processors below on four
+// pixels: each of |r|, |g| and |b| gets |denom_l + c * s_numer - s_numer_l|
+// for its channel c, with |denom| = 2^|denom_shift|.
+inline void Desaturate4(__m128i pixels,
+                        int denom_shift,
+                        __m128i s_numer,
+                        __m128i* r,
+                        __m128i* g,
+                        __m128i* b) {
+  *r = GetChannels(pixels, 16);
+  *g = GetChannels(pixels, 8);
+  *b = GetChannels(pixels, 0);
+
+  // The channels fit in 16 bits, which SSE2 can compare.
+  __m128i vmax = _mm_max_epi16(_mm_max_epi16(*r, *g), *b);
+  __m128i vmin = _mm_min_epi16(_mm_min_epi16(*r, *g), *b);
+  __m128i sum = _mm_add_epi32(vmax, vmin);
+
+  __m128i denom_l = _mm_slli_epi32(sum, denom_shift - 1);
+  __m128i s_numer_l = DivideByPowerOf2(MulLo32(sum, s_numer), 1);
+  *r = _mm_sub_epi32(_mm_add_epi32(denom_l, MulLo32(*r, s_numer)), s_numer_l);
+  *g = _mm_sub_epi32(_mm_add_epi32(denom_l, MulLo32(*g, s_numer)), s_numer_l);
+  *b = _mm_sub_epi32(_mm_add_epi32(denom_l, MulLo32(*b, s_numer)), s_numer_l);
+}
+#endif
+
 // Line processor: default/universal (i.e., old-school).
 void LineProcDefault(const color_utils::HSL& hsl_shift,
                      const SkPMColor* in,
@@ -306,7 +543,22 @@ void LineProcHnopSnopLdec(const color_utils::HSL& hsl_shift,
   DCHECK(hsl_shift.l <= 0.5 - HSLShift::epsilon && hsl_shift.l >= 0);
 
   uint32_t ldec_num = static_cast<uint32_t>(hsl_shift.l * 2 * den);
-  for (int x = 0; x < width; x++) {
+  int x = 0;
+#if defined(SIMD_SSE2)
+  if (g_use_simd) {
+    __m128i ldec = _mm_set1_epi32(ldec_num);
+    for (; x + 4 <= width; x += 4) {
+      __m128i pixels =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + x));
+      __m128i r = _mm_srli_epi32(MulLo32(GetChannels(pixels, 16), ldec), 16);
+      __m128i g = _mm_srli_epi32(MulLo32(GetChannels(pixels, 8), ldec), 16);
+      __m128i b = _mm_srli_epi32(MulLo32(GetChannels(pixels, 0), ldec), 16);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x),
+                       PackChannels(_mm_srli_epi32(pixels, 24), r, g, b));
+    }
+  }
+#endif
+  for (; x < width; x++) {
     uint32_t a = SkGetPackedA32(in[x]);
     uint32_t r = SkGetPackedR32(in[x]);
     uint32_t g = SkGetPackedG32(in[x]);
@@ -330,7 +582,26 @@ void LineProcHnopSnopLinc(const color_utils::HSL& hsl_shift,
   DCHECK(hsl_shift.l >= 0.5 + HSLShift::epsilon && hsl_shift.l <= 1);
 
   uint32_t linc_num = static_cast<uint32_t>((hsl_shift.l - 0.5) * 2 * den);
-  for (int x = 0; x < width; x++) {
+  int x = 0;
+#if defined(SIMD_SSE2)
+  if (g_use_simd) {
+    __m128i linc = _mm_set1_epi32(linc_num);
+    for (; x + 4 <= width; x += 4) {
+      __m128i pixels =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + x));
+      __m128i a = _mm_srli_epi32(pixels, 24);
+      __m128i channels[3];
+      for (int i = 0; i < 3; ++i) {
+        __m128i c = GetChannels(pixels, i * 8);
+        channels[i] = _mm_add_epi32(c, _mm_srli_epi32(
+            MulLo32(_mm_sub_epi32(a, c), linc), 16));
+      }
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x),
+                       PackChannels(a, channels[2], channels[1], channels[0]));
+    }
+  }
+#endif
+  for (; x < width; x++) {
     uint32_t a = SkGetPackedA32(in[x]);
     uint32_t r = SkGetPackedR32(in[x]);
     uint32_t g = SkGetPackedG32(in[x]);
@@ -376,7 +647,24 @@ void LineProcHnopSdecLnop(const color_utils::HSL& hsl_shift,
 
   const int32_t denom = 65536;
   int32_t s_numer = static_cast<int32_t>(hsl_shift.s * 2 * denom);
-  for (int x = 0; x < width; x++) {
+  int x = 0;
+#if defined(SIMD_SSE2)
+  if (g_use_simd) {
+    __m128i s = _mm_set1_epi32(s_numer);
+    for (; x + 4 <= width; x += 4) {
+      __m128i pixels =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + x));
+      __m128i r, g, b;
+      Desaturate4(pixels, 16, s, &r, &g, &b);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x),
+                       PackChannels(_mm_srli_epi32(pixels, 24),
+                                    DivideByPowerOf2(r, 16),
+                                    DivideByPowerOf2(g, 16),
+                                    DivideByPowerOf2(b, 16)));
+    }
+  }
+#endif
+  for (; x < width; x++) {
     int32_t a = static_cast<int32_t>(SkGetPackedA32(in[x]));
     int32_t r = static_cast<int32_t>(SkGetPackedR32(in[x]));
     int32_t g = static_cast<int32_t>(SkGetPackedG32(in[x]));
@@ -415,7 +703,25 @@ void LineProcHnopSdecLdec(const color_utils::HSL& hsl_shift,
   const int32_t denom = 1024;
   int32_t l_numer = static_cast<int32_t>(hsl_shift.l * 2 * denom);
   int32_t s_numer = static_cast<int32_t>(hsl_shift.s * 2 * denom);
-  for (int x = 0; x < width; x++) {
+  int x = 0;
+#if defined(SIMD_SSE2)
+  if (g_use_simd) {
+    __m128i l = _mm_set1_epi32(l_numer);
+    __m128i s = _mm_set1_epi32(s_numer);
+    for (; x + 4 <= width; x += 4) {
+      __m128i pixels =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + x));
+      __m128i r, g, b;
+      Desaturate4(pixels, 10, s, &r, &g, &b);
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x),
+                       PackChannels(_mm_srli_epi32(pixels, 24),
+                                    DivideByPowerOf2(MulLo32(r, l), 20),
+                                    DivideByPowerOf2(MulLo32(g, l), 20),
+                                    DivideByPowerOf2(MulLo32(b, l), 20)));
+    }
+  }
+#endif
+  for (; x < width; x++) {
     int32_t a = static_cast<int32_t>(SkGetPackedA32(in[x]));
     int32_t r = static_cast<int32_t>(SkGetPackedR32(in[x]));
     int32_t g = static_cast<int32_t>(SkGetPackedG32(in[x]));
@@ -454,7 +760,29 @@ void LineProcHnopSdecLinc(const color_utils::HSL& hsl_shift,
   const int32_t denom = 1024;
   int32_t l_numer = static_cast<int32_t>((hsl_shift.l - 0.5) * 2 * denom);
   int32_t s_numer = static_cast<int32_t>(hsl_shift.s * 2 * denom);
-  for (int x = 0; x < width; x++) {
+  int x = 0;
+#if defined(SIMD_SSE2)
+  if (g_use_simd) {
+    __m128i l = _mm_set1_epi32(l_numer);
+    __m128i s = _mm_set1_epi32(s_numer);
+    for (; x + 4 <= width; x += 4) {
+      __m128i pixels =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + x));
+      __m128i a = _mm_srli_epi32(pixels, 24);
+      __m128i a_denom = _mm_slli_epi32(a, 10);
+      __m128i channels[3];
+      Desaturate4(pixels, 10, s, &channels[2], &channels[1], &channels[0]);
+      for (int i = 0; i < 3; ++i) {
+        __m128i c = channels[i];
+        channels[i] = DivideByPowerOf2(_mm_add_epi32(
+            _mm_slli_epi32(c, 10), MulLo32(_mm_sub_epi32(a_denom, c), l)), 20);
+      }
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(out + x),
+                       PackChannels(a, channels[2], channels[1], channels[0]));
+    }
+  }
+#endif
+  for (; x < width; x++) {
     int32_t a = static_cast<int32_t>(SkGetPackedA32(in[x]));
     int32_t r = static_cast<int32_t>(SkGetPackedR32(in[x]));
     int32_t g = static_cast<int32_t>(SkGetPackedG32(in[x]));
@@ -650,7 +978,41 @@ SkBitmap SkBitmapOperations::DownsampleByTwo(const SkBitmap& bitmap) {
 
     SkPMColor* SK_RESTRICT cur_dst = result.getAddr32(0, dest_y);
 
-    for (int dest_x = 0; dest_x <= resultLastX; ++dest_x) {
+    int dest_x = 0;
+#if defined(SIMD_SSE2)
+    if (g_use_simd) {
+      // Averages 2x8 source pixels into 4 destination pixels at a time, with
+      // the channels widened to 16 bits. The sums of four channels fit.
+      const __m128i zero = _mm_setzero_si128();
+      for (; (dest_x << 1) + 7 <= srcLastX; dest_x += 4) {
+        __m128i sums[4];
+        for (int i = 0; i < 2; ++i) {
+          __m128i top = _mm_loadu_si128(
+              reinterpret_cast<const __m128i*>(cur_src0 + i * 4));
+          __m128i bottom = _mm_loadu_si128(
+              reinterpret_cast<const __m128i*>(cur_src1 + i * 4));
+          sums[i * 2] = _mm_add_epi16(_mm_unpacklo_epi8(top, zero),
+                                      _mm_unpacklo_epi8(bottom, zero));
+          sums[i * 2 + 1] = _mm_add_epi16(_mm_unpackhi_epi8(top, zero),
+                                          _mm_unpackhi_epi8(bottom, zero));
+        }
+        // Each sum holds two source columns; add the left ones of each pair
+        // to the right ones.
+        __m128i dst01 = _mm_add_epi16(_mm_unpacklo_epi64(sums[0], sums[1]),
+                                      _mm_unpackhi_epi64(sums[0], sums[1]));
+        __m128i dst23 = _mm_add_epi16(_mm_unpacklo_epi64(sums[2], sums[3]),
+                                      _mm_unpackhi_epi64(sums[2], sums[3]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(cur_dst),
+                         _mm_packus_epi16(_mm_srli_epi16(dst01, 2),
+                                          _mm_srli_epi16(dst23, 2)));
+        cur_dst += 4;
+        cur_src0 += 8;
+        cur_src1 += 8;
+      }
+    }
+#endif
+
+    for (; dest_x <= resultLastX; ++dest_x) {
       // This code is based on downsampleby2_proc32 in SkBitmap.cpp. It is very
       // clever in that it does two channels at once: alpha and green ("ag")
       // and red and blue ("rb"). Each channel gets averaged across 4 pixels
@@ -707,7 +1069,20 @@ SkBitmap SkBitmapOperations::UnPreMultiply(const SkBitmap& bitmap) {
     SkAutoLockPixels bitmap_lock(bitmap);
     SkAutoLockPixels opaque_bitmap_lock(opaque_bitmap);
     for (int y = 0; y < opaque_bitmap.height(); y++) {
-      for (int x = 0; x < opaque_bitmap.width(); x++) {
+      int x = 0;
+#if defined(SIMD_SSE2)
+      if (g_use_simd) {
+        const SkPMColor* src_row = bitmap.getAddr32(0, y);
+        uint32* dst_row = opaque_bitmap.getAddr32(0, y);
+        for (; x + 4 <= opaque_bitmap.width(); x += 4) {
+          __m128i pixels = _mm_loadu_si128(
+              reinterpret_cast<const __m128i*>(src_row + x));
+          _mm_storeu_si128(reinterpret_cast<__m128i*>(dst_row + x),
+                           UnPreMultiply4(src_row + x, pixels));
+        }
+      }
+#endif
+      for (; x < opaque_bitmap.width(); x++) {
         uint32 src_pixel = *bitmap.getAddr32(x, y);
         uint32* dst_pixel = opaque_bitmap.getAddr32(x, y);
         SkColor unmultiplied = SkUnPreMultiply::PMColorToColor(src_pixel);
@@ -752,15 +1127,49 @@ SkBitmap SkBitmapOperations::CreateColorMask(const SkBitmap& bitmap,
   color_mask.setConfig(SkBitmap::kARGB_8888_Config,
                        bitmap.width(), bitmap.height());
   color_mask.allocPixels();
-  color_mask.eraseARGB(0, 0, 0, 0);
 
-  SkCanvas canvas(color_mask);
+  SkAutoLockPixels lock_bitmap(bitmap);
+  SkAutoLockPixels lock_color_mask(color_mask);
+
+  // This is what drawing |bitmap| with a kSrcIn_Mode color filter of |c| does:
+  // the premultiplied color, scaled by the alpha of each pixel.
+  SkPMColor color = SkPreMultiplyColor(c);
+  for (int y = 0; y < bitmap.height(); ++y) {
+    const SkPMColor* src_row = bitmap.getAddr32(0, y);
+    SkPMColor* dst_row = color_mask.getAddr32(0, y);
+
+    int x = 0;
+#if defined(SIMD_SSE2)
+    if (g_use_simd) {
+      // All the products fit in 16 bits, like SkAlphaMulQ() expects.
+      const __m128i one = _mm_set1_epi32(1);
+      const __m128i colors[4] = {
+        _mm_set1_epi32(SkGetPackedB32(color)),
+        _mm_set1_epi32(SkGetPackedG32(color)),
+        _mm_set1_epi32(SkGetPackedR32(color)),
+        _mm_set1_epi32(SkGetPackedA32(color))
+      };
+      for (; x + 4 <= bitmap.width(); x += 4) {
+        __m128i pixels =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(src_row + x));
+        __m128i scale = _mm_add_epi32(_mm_srli_epi32(pixels, 24), one);
+        __m128i channels[4];
+        for (int i = 0; i < 4; ++i) {
+          channels[i] = _mm_srli_epi32(_mm_mullo_epi16(colors[i], scale), 8);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst_row + x),
+                         PackChannels(channels[3], channels[2], channels[1],
+                                      channels[0]));
+      }
+    }
+#endif
+
+    for (; x < bitmap.width(); ++x) {
+      dst_row[x] = SkAlphaMulQ(
+          color, SkAlpha255To256(SkGetPackedA32(src_row[x])));
+    }
+  }
 
-  SkColorFilter* color_filter = SkColorFilter::CreateModeFilter(
-      c, SkXfermode::kSrcIn_Mode);
-  SkPaint paint;
-  paint.setColorFilter(color_filter)->unref();
-  canvas.drawBitmap(bitmap, SkIntToScalar(0), SkIntToScalar(0), &paint);
   return color_mask;
 }
 
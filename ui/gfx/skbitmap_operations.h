@@ -110,6 +110,11 @@ class UI_EXPORT SkBitmapOperations {
   static SkBitmap CreateDropShadow(const SkBitmap& bitmap,
                                    const gfx::ShadowValues& shadows);
 
+  // Most operations work on four pixels at a time with SSE2 where it is
+  // available. Passing false makes them use their C++ loops instead, so that
+  // tests can check that both give the same pixels. Not thread safe.
+  static void SetUseSIMDForTesting(bool use_simd);
+
  private:
   SkBitmapOperations();  // Class for scoping only.
 
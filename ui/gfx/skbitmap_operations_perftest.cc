@@ -0,0 +1,92 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ui/gfx/skbitmap_operations.h"
+
+#include "base/bind.h"
+#include "base/callback.h"
+#include "base/perftimer.h"
+#include "base/stringprintf.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "third_party/skia/include/core/SkBitmap.h"
+#include "third_party/skia/include/core/SkColorPriv.h"
+
+namespace {
+
+// About the size of a themed frame or a large button background.
+const int kWidth = 512;
+const int kHeight = 256;
+const int kIterations = 20;
+
+// Fills |bitmap| with premultiplied colors from a fixed pseudo-random sequence
+// which starts at |seed|.
+void FillBitmap(int w, int h, uint32 seed, SkBitmap* bitmap) {
+  bitmap->setConfig(SkBitmap::kARGB_8888_Config, w, h);
+  bitmap->allocPixels();
+
+  SkAutoLockPixels lock(*bitmap);
+  for (int y = 0; y < h; ++y) {
+    for (int x = 0; x < w; ++x) {
+      seed = seed * 1103515245 + 12345;
+      unsigned a = (seed >> 24) & 0xFF;
+      *bitmap->getAddr32(x, y) = SkPackARGB32(a,
+                                              ((seed >> 16) & 0xFF) * a / 255,
+                                              ((seed >> 8) & 0xFF) * a / 255,
+                                              (seed & 0xFF) * a / 255);
+    }
+  }
+}
+
+// Runs |operation| with the C++ loops and then with the SIMD ones, and logs
+// the mean time of a run for each.
+void TimeOperation(const char* name,
+                   const base::Callback<SkBitmap(void)>& operation) {
+  for (int use_simd = 0; use_simd < 2; ++use_simd) {
+    SkBitmapOperations::SetUseSIMDForTesting(use_simd == 1);
+    PerfTimer timer;
+    for (int i = 0; i < kIterations; ++i)
+      operation.Run();
+    LogPerfResult(
+        base::StringPrintf("%s_%s", name, use_simd ? "simd" : "c").c_str(),
+        timer.Elapsed().InMillisecondsF() / kIterations, "ms");
+  }
+  SkBitmapOperations::SetUseSIMDForTesting(true);
+}
+
+}  // namespace
+
+TEST(SkBitmapOperationsPerfTest, PixelOperations) {
+  SkBitmap first, second, tile;
+  FillBitmap(kWidth, kHeight, 1, &first);
+  FillBitmap(kWidth, kHeight, 2, &second);
+  FillBitmap(kWidth / 4 + 1, kHeight / 4 + 1, 3, &tile);
+
+  // Saturation and lightness shifts that have fixed-point loops.
+  color_utils::HSL desaturate_and_darken = { -1, 0.2, 0.3 };
+  color_utils::HSL lighten = { -1, -1, 0.7 };
+
+  TimeOperation("CreateBlendedBitmap",
+                base::Bind(&SkBitmapOperations::CreateBlendedBitmap,
+                           first, second, 0.3));
+  TimeOperation("CreateMaskedBitmap",
+                base::Bind(&SkBitmapOperations::CreateMaskedBitmap,
+                           first, second));
+  TimeOperation("CreateButtonBackground",
+                base::Bind(&SkBitmapOperations::CreateButtonBackground,
+                           SkColorSetARGB(0x80, 0x10, 0x80, 0xF0), tile,
+                           second));
+  TimeOperation("CreateHSLShiftedBitmap_desaturate_and_darken",
+                base::Bind(&SkBitmapOperations::CreateHSLShiftedBitmap,
+                           first, desaturate_and_darken));
+  TimeOperation("CreateHSLShiftedBitmap_lighten",
+                base::Bind(&SkBitmapOperations::CreateHSLShiftedBitmap,
+                           first, lighten));
+  TimeOperation("UnPreMultiply",
+                base::Bind(&SkBitmapOperations::UnPreMultiply, first));
+  TimeOperation("DownsampleByTwo",
+                base::Bind(&SkBitmapOperations::DownsampleByTwo, first));
+  TimeOperation("CreateColorMask",
+                base::Bind(&SkBitmapOperations::CreateColorMask,
+                           first, SK_ColorRED));
+}
@@ -4,8 +4,14 @@
 
 #include "ui/gfx/skbitmap_operations.h"
 
+#include <string.h>
+
+#include <vector>
+
 #include "testing/gtest/include/gtest/gtest.h"
 #include "third_party/skia/include/core/SkBitmap.h"
+#include "third_party/skia/include/core/SkCanvas.h"
+#include "third_party/skia/include/core/SkColorFilter.h"
 #include "third_party/skia/include/core/SkColorPriv.h"
 #include "third_party/skia/include/core/SkUnPreMultiply.h"
 
@@ -40,6 +46,46 @@ bool BitmapsClose(const SkBitmap& a, const SkBitmap& b) {
   return true;
 }
 
+// Returns true if the two bitmaps have the same size and exactly the same
+// pixels.
+bool BitmapsEqual(const SkBitmap& a, const SkBitmap& b) {
+  if (a.width() != b.width() || a.height() != b.height())
+    return false;
+
+  SkAutoLockPixels a_lock(a);
+  SkAutoLockPixels b_lock(b);
+
+  for (int y = 0; y < a.height(); y++) {
+    if (memcmp(a.getAddr32(0, y), b.getAddr32(0, y),
+               a.width() * sizeof(uint32_t)) != 0)
+      return false;
+  }
+  return true;
+}
+
+// Fills |bmp| with premultiplied colors from a fixed pseudo-random sequence
+// which starts at |seed|.
+void FillRandomDataToBitmap(int w, int h, uint32_t seed, SkBitmap* bmp) {
+  bmp->setConfig(SkBitmap::kARGB_8888_Config, w, h);
+  bmp->allocPixels();
+
+  SkAutoLockPixels lock(*bmp);
+  for (int y = 0; y < h; y++) {
+    for (int x = 0; x < w; x++) {
+      seed = seed * 1103515245 + 12345;
+      unsigned a = (seed >> 24) & 0xFF;
+      // Keep some pixels opaque and some transparent.
+      if (a > 0xF0)
+        a = 0xFF;
+      else if (a < 0x10)
+        a = 0;
+      *bmp->getAddr32(x, y) = SkPackARGB32(a, ((seed >> 16) & 0xFF) * a / 255,
+                                           ((seed >> 8) & 0xFF) * a / 255,
+                                           (seed & 0xFF) * a / 255);
+    }
+  }
+}
+
 void FillDataToBitmap(int w, int h, SkBitmap* bmp) {
   bmp->setConfig(SkBitmap::kARGB_8888_Config, w, h);
   bmp->allocPixels();
@@ -82,6 +128,24 @@ SkBitmap ReferenceCreateHSLShiftedBitmap(
   return shifted;
 }
 
+// The reference (i.e., old) implementation of |CreateColorMask()|.
+SkBitmap ReferenceCreateColorMask(const SkBitmap& bitmap, SkColor c) {
+  SkBitmap color_mask;
+  color_mask.setConfig(SkBitmap::kARGB_8888_Config,
+                       bitmap.width(), bitmap.height());
+  color_mask.allocPixels();
+  color_mask.eraseARGB(0, 0, 0, 0);
+
+  SkCanvas canvas(color_mask);
+
+  SkColorFilter* color_filter = SkColorFilter::CreateModeFilter(
+      c, SkXfermode::kSrcIn_Mode);
+  SkPaint paint;
+  paint.setColorFilter(color_filter)->unref();
+  canvas.drawBitmap(bitmap, SkIntToScalar(0), SkIntToScalar(0), &paint);
+  return color_mask;
+}
+
 }  // namespace
 
 // Invert bitmap and verify the each pixel is inverted and the alpha value is
@@ -515,3 +579,69 @@ TEST(SkBitmapOperationsTest, CreateTransposedBitmap) {
     }
   }
 }
+
+// Compare the color masks with the ones Skia draws.
+TEST(SkBitmapOperationsTest, CreateColorMask) {
+  SkBitmap src;
+  FillRandomDataToBitmap(37, 5, 1, &src);
+
+  const SkColor colors[] = {
+    SK_ColorBLACK,
+    SK_ColorRED,
+    SkColorSetARGB(0x80, 0x20, 0x40, 0x60),
+    SkColorSetARGB(0, 0xFF, 0xFF, 0xFF),
+  };
+  for (size_t i = 0; i < arraysize(colors); ++i) {
+    SkBitmap color_mask = SkBitmapOperations::CreateColorMask(src, colors[i]);
+    EXPECT_TRUE(BitmapsEqual(ReferenceCreateColorMask(src, colors[i]),
+                             color_mask)) << i;
+  }
+}
+
+// Check that the SSE2 loops give the same pixels as the C++ ones, with sizes
+// that leave pixels for the C++ loops to finish.
+TEST(SkBitmapOperationsTest, SIMDMatchesC) {
+  SkBitmap first, second, small, wide, odd;
+  FillRandomDataToBitmap(37, 5, 1, &first);
+  FillRandomDataToBitmap(37, 5, 2, &second);
+  FillRandomDataToBitmap(3, 2, 3, &small);
+  FillRandomDataToBitmap(40, 6, 4, &wide);
+  FillRandomDataToBitmap(38, 7, 5, &odd);
+
+  const color_utils::HSL hsl_shifts[] = {
+    { -1, -1, -1 },
+    { -1, -1, 0.2 },
+    { -1, -1, 0.8 },
+    { -1, 0.2, -1 },
+    { -1, 0.2, 0.2 },
+    { -1, 0.2, 0.8 },
+    { -1, 0.8, 0.5 },
+    { 0.3, 0.5, 0.5 },
+  };
+
+  std::vector<SkBitmap> results[2];
+  for (int use_simd = 0; use_simd < 2; ++use_simd) {
+    SkBitmapOperations::SetUseSIMDForTesting(use_simd == 1);
+    std::vector<SkBitmap>& out = results[use_simd];
+    out.push_back(SkBitmapOperations::CreateBlendedBitmap(first, second, 0.3));
+    out.push_back(SkBitmapOperations::CreateMaskedBitmap(first, second));
+    out.push_back(SkBitmapOperations::CreateButtonBackground(
+        SkColorSetARGB(0x80, 0x10, 0x80, 0xF0), small, first));
+    out.push_back(SkBitmapOperations::CreateButtonBackground(
+        SK_ColorWHITE, wide, first));
+    for (size_t i = 0; i < arraysize(hsl_shifts); ++i) {
+      out.push_back(SkBitmapOperations::CreateHSLShiftedBitmap(
+          first, hsl_shifts[i]));
+    }
+    out.push_back(SkBitmapOperations::UnPreMultiply(first));
+    out.push_back(SkBitmapOperations::DownsampleByTwo(first));
+    out.push_back(SkBitmapOperations::DownsampleByTwo(odd));
+    out.push_back(SkBitmapOperations::CreateColorMask(
+        first, SkColorSetARGB(0x80, 0x20, 0x40, 0x60)));
+  }
+  SkBitmapOperations::SetUseSIMDForTesting(true);
+
+  ASSERT_EQ(results[0].size(), results[1].size());
+  for (size_t i = 0; i < results[0].size(); ++i)
+    EXPECT_TRUE(BitmapsEqual(results[0][i], results[1][i])) << i;
+}
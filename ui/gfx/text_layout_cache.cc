@@ -0,0 +1,147 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ui/gfx/text_layout_cache.h"
+
+#include "base/i18n/rtl.h"
+#include "base/lazy_instance.h"
+#include "base/logging.h"
+#include "ui/gfx/font.h"
+#include "ui/gfx/render_text.h"
+
+namespace gfx {
+
+namespace {
+
+base::LazyInstance<TextLayoutCache>::Leaky g_text_layout_cache =
+    LAZY_INSTANCE_INITIALIZER;
+
+}  // namespace
+
+TextLayoutCache::Key::Key(const string16& text,
+                          const Font& font,
+                          int flags,
+                          int width,
+                          SkColor color)
+    : text(text),
+      font_name(font.GetFontName()),
+      font_size(font.GetFontSize()),
+      font_style(font.GetStyle()),
+      flags(flags),
+      width(width),
+      color(color),
+      rtl(base::i18n::IsRTL()) {
+}
+
+TextLayoutCache::Key::~Key() {
+}
+
+bool TextLayoutCache::Key::operator<(const Key& other) const {
+  // Compare the cheap fields first.
+  if (width != other.width)
+    return width < other.width;
+  if (flags != other.flags)
+    return flags < other.flags;
+  if (font_size != other.font_size)
+    return font_size < other.font_size;
+  if (font_style != other.font_style)
+    return font_style < other.font_style;
+  if (color != other.color)
+    return color < other.color;
+  if (rtl != other.rtl)
+    return rtl < other.rtl;
+  if (text != other.text)
+    return text < other.text;
+  return font_name < other.font_name;
+}
+
+const size_t TextLayoutCache::kDefaultMaxRenderTexts = 1024;
+const size_t TextLayoutCache::kDefaultMaxSizes = 4096;
+
+TextLayoutCache::TextLayoutCache()
+    : render_texts_(kDefaultMaxRenderTexts),
+      sizes_(kDefaultMaxSizes),
+      render_text_hits_(0),
+      render_text_misses_(0),
+      size_hits_(0),
+      size_misses_(0),
+      thread_id_(base::kInvalidThreadId) {
+}
+
+TextLayoutCache::TextLayoutCache(size_t max_render_texts, size_t max_sizes)
+    : render_texts_(max_render_texts),
+      sizes_(max_sizes),
+      render_text_hits_(0),
+      render_text_misses_(0),
+      size_hits_(0),
+      size_misses_(0),
+      thread_id_(base::kInvalidThreadId) {
+}
+
+TextLayoutCache::~TextLayoutCache() {
+}
+
+// static
+TextLayoutCache* TextLayoutCache::GetInstance() {
+  TextLayoutCache* cache = g_text_layout_cache.Pointer();
+  return cache->BindToCurrentThread() ? cache : NULL;
+}
+
+RenderText* TextLayoutCache::GetRenderText(const Key& key) {
+  DCHECK(BindToCurrentThread());
+  base::OwningMRUCache<Key, RenderText*>::iterator it = render_texts_.Get(key);
+  if (it == render_texts_.end()) {
+    ++render_text_misses_;
+    return NULL;
+  }
+  ++render_text_hits_;
+  return it->second;
+}
+
+void TextLayoutCache::PutRenderText(const Key& key, RenderText* render_text) {
+  DCHECK(BindToCurrentThread());
+  render_texts_.Put(key, render_text);
+}
+
+bool TextLayoutCache::GetSize(const Key& key, Size* size) {
+  DCHECK(BindToCurrentThread());
+  base::MRUCache<Key, Size>::iterator it = sizes_.Get(key);
+  if (it == sizes_.end()) {
+    ++size_misses_;
+    return false;
+  }
+  ++size_hits_;
+  *size = it->second;
+  return true;
+}
+
+void TextLayoutCache::PutSize(const Key& key, const Size& size) {
+  DCHECK(BindToCurrentThread());
+  sizes_.Put(key, size);
+}
+
+void TextLayoutCache::Clear() {
+  render_texts_.Clear();
+  sizes_.Clear();
+  render_text_hits_ = 0;
+  render_text_misses_ = 0;
+  size_hits_ = 0;
+  size_misses_ = 0;
+}
+
+double TextLayoutCache::GetHitRate() const {
+  const size_t hits = render_text_hits_ + size_hits_;
+  const size_t lookups = hits + render_text_misses_ + size_misses_;
+  return lookups ? static_cast<double>(hits) / lookups : 0.0;
+}
+
+bool TextLayoutCache::BindToCurrentThread() {
+  const base::PlatformThreadId current = base::PlatformThread::CurrentId();
+  base::AutoLock lock(thread_lock_);
+  if (thread_id_ == base::kInvalidThreadId)
+    thread_id_ = current;
+  return thread_id_ == current;
+}
+
+}  // namespace gfx
@@ -0,0 +1,116 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef UI_GFX_TEXT_LAYOUT_CACHE_H_
+#define UI_GFX_TEXT_LAYOUT_CACHE_H_
+#pragma once
+
+#include <string>
+
+#include "base/basictypes.h"
+#include "base/memory/mru_cache.h"
+#include "base/string16.h"
+#include "base/synchronization/lock.h"
+#include "base/threading/platform_thread.h"
+#include "third_party/skia/include/core/SkColor.h"
+#include "ui/base/ui_export.h"
+#include "ui/gfx/size.h"
+
+namespace gfx {
+
+class Font;
+class RenderText;
+
+// Keeps the RenderTexts that Canvas draws single lines of text with and the
+// sizes that Canvas::SizeStringInt() measures, so that repainting or measuring
+// the same string with the same font doesn't lay it out and shape it again.
+// Both caches are bounded and evict their least recently used entries.
+//
+// The cache is bound to the first thread that calls GetInstance(); Canvas
+// doesn't cache text on other threads.
+class UI_EXPORT TextLayoutCache {
+ public:
+  // Identifies a string laid out with a font and Canvas flags in the UI
+  // direction of the current locale.
+  struct UI_EXPORT Key {
+    Key(const string16& text,
+        const Font& font,
+        int flags,
+        int width,
+        SkColor color);
+    ~Key();
+
+    bool operator<(const Key& other) const;
+
+    string16 text;
+    std::string font_name;
+    int font_size;
+    int font_style;
+    int flags;
+    int width;
+    SkColor color;
+    // Whether the UI was right-to-left, which changes the default alignment
+    // and directionality of the text.
+    bool rtl;
+  };
+
+  // The default number of RenderTexts and sizes that are kept.
+  static const size_t kDefaultMaxRenderTexts;
+  static const size_t kDefaultMaxSizes;
+
+  TextLayoutCache();
+  TextLayoutCache(size_t max_render_texts, size_t max_sizes);
+  ~TextLayoutCache();
+
+  // Returns the cache of the calling thread, or NULL if the cache is bound to
+  // another thread.
+  static TextLayoutCache* GetInstance();
+
+  // Returns the RenderText laid out for |key|, or NULL if there is none.
+  RenderText* GetRenderText(const Key& key);
+
+  // Takes ownership of |render_text|, which is laid out for |key|.
+  void PutRenderText(const Key& key, RenderText* render_text);
+
+  // Returns true and sets |size| if the size of the text for |key| is cached.
+  bool GetSize(const Key& key, Size* size);
+
+  void PutSize(const Key& key, const Size& size);
+
+  // Empties both caches and resets the counters.
+  void Clear();
+
+  // Lookups of the RenderTexts and sizes that were and weren't found since
+  // the cache was created or last cleared.
+  size_t render_text_hits() const { return render_text_hits_; }
+  size_t render_text_misses() const { return render_text_misses_; }
+  size_t size_hits() const { return size_hits_; }
+  size_t size_misses() const { return size_misses_; }
+
+  // Returns the fraction of all lookups that were found, or 0 if there were
+  // none.
+  double GetHitRate() const;
+
+ private:
+  // Binds the cache to the calling thread if it isn't bound yet. Returns true
+  // if it is bound to the calling thread.
+  bool BindToCurrentThread();
+
+  base::OwningMRUCache<Key, RenderText*> render_texts_;
+  base::MRUCache<Key, Size> sizes_;
+
+  size_t render_text_hits_;
+  size_t render_text_misses_;
+  size_t size_hits_;
+  size_t size_misses_;
+
+  base::Lock thread_lock_;
+  base::PlatformThreadId thread_id_;
+
+  DISALLOW_COPY_AND_ASSIGN(TextLayoutCache);
+};
+
+}  // namespace gfx
+
+#endif  // UI_GFX_TEXT_LAYOUT_CACHE_H_
@@ -0,0 +1,159 @@
+// Copyright (c) 2012 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "ui/gfx/text_layout_cache.h"
+
+#include "base/i18n/rtl.h"
+#include "base/utf_string_conversions.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "ui/gfx/canvas.h"
+#include "ui/gfx/font.h"
+#include "ui/base/l10n/l10n_util.h"
+#include "ui/gfx/render_text.h"
+
+namespace gfx {
+
+TEST(TextLayoutCacheTest, Keys) {
+  const Font font;
+  const string16 text = ASCIIToUTF16("label");
+  const TextLayoutCache::Key key(text, font, 0, 100, SK_ColorBLACK);
+
+  EXPECT_FALSE(key < key);
+  EXPECT_FALSE(key < TextLayoutCache::Key(text, font, 0, 100, SK_ColorBLACK));
+
+  // Every field tells keys apart.
+  const TextLayoutCache::Key others[] = {
+    TextLayoutCache::Key(ASCIIToUTF16("labels"), font, 0, 100, SK_ColorBLACK),
+    TextLayoutCache::Key(text, font.DeriveFont(1), 0, 100, SK_ColorBLACK),
+    TextLayoutCache::Key(text, font.DeriveFont(0, Font::BOLD), 0, 100,
+                         SK_ColorBLACK),
+    TextLayoutCache::Key(text, font, Canvas::TEXT_ALIGN_RIGHT, 100,
+                         SK_ColorBLACK),
+    TextLayoutCache::Key(text, font, 0, 101, SK_ColorBLACK),
+    TextLayoutCache::Key(text, font, 0, 100, SK_ColorRED),
+  };
+  for (size_t i = 0; i < arraysize(others); ++i)
+    EXPECT_TRUE(key < others[i] || others[i] < key) << i;
+}
+
+TEST(TextLayoutCacheTest, KeysDependOnUIDirection) {
+  const Font font;
+  const string16 text = ASCIIToUTF16("label");
+  std::string locale = l10n_util::GetApplicationLocale("");
+
+  base::i18n::SetICUDefaultLocale("en");
+  const TextLayoutCache::Key ltr_key(text, font, 0, 100, SK_ColorBLACK);
+  // Set the locale to Hebrew for RTL UI.
+  base::i18n::SetICUDefaultLocale("he");
+  const TextLayoutCache::Key rtl_key(text, font, 0, 100, SK_ColorBLACK);
+  EXPECT_TRUE(ltr_key < rtl_key || rtl_key < ltr_key);
+
+  // Reset locale.
+  base::i18n::SetICUDefaultLocale(locale);
+}
+
+TEST(TextLayoutCacheTest, Sizes) {
+  const Font font;
+  TextLayoutCache cache(2, 2);
+  const TextLayoutCache::Key a(ASCIIToUTF16("a"), font, 0, 10, 0);
+  const TextLayoutCache::Key b(ASCIIToUTF16("b"), font, 0, 10, 0);
+  const TextLayoutCache::Key c(ASCIIToUTF16("c"), font, 0, 10, 0);
+
+  Size size;
+  EXPECT_FALSE(cache.GetSize(a, &size));
+  cache.PutSize(a, Size(1, 2));
+  cache.PutSize(b, Size(3, 4));
+  EXPECT_TRUE(cache.GetSize(a, &size));
+  EXPECT_EQ(Size(1, 2), size);
+
+  // |b| is the least recently used.
+  cache.PutSize(c, Size(5, 6));
+  EXPECT_FALSE(cache.GetSize(b, &size));
+  EXPECT_TRUE(cache.GetSize(a, &size));
+  EXPECT_TRUE(cache.GetSize(c, &size));
+  EXPECT_EQ(Size(5, 6), size);
+
+  EXPECT_EQ(3U, cache.size_hits());
+  EXPECT_EQ(2U, cache.size_misses());
+  EXPECT_DOUBLE_EQ(0.6, cache.GetHitRate());
+
+  cache.Clear();
+  EXPECT_FALSE(cache.GetSize(a, &size));
+  EXPECT_EQ(0U, cache.size_hits());
+  EXPECT_EQ(1U, cache.size_misses());
+}
+
+TEST(TextLayoutCacheTest, RenderTexts) {
+  const Font font;
+  TextLayoutCache cache(1, 1);
+  const TextLayoutCache::Key a(ASCIIToUTF16("a"), font, 0, 10, 0);
+  const TextLayoutCache::Key b(ASCIIToUTF16("b"), font, 0, 10, 0);
+
+  EXPECT_EQ(NULL, cache.GetRenderText(a));
+  RenderText* render_text = RenderText::CreateRenderText();
+  cache.PutRenderText(a, render_text);
+  EXPECT_EQ(render_text, cache.GetRenderText(a));
+
+  // Putting |b| deletes the RenderText for |a|.
+  cache.PutRenderText(b, RenderText::CreateRenderText());
+  EXPECT_EQ(NULL, cache.GetRenderText(a));
+  EXPECT_TRUE(cache.GetRenderText(b));
+
+  EXPECT_EQ(2U, cache.render_text_hits());
+  EXPECT_EQ(2U, cache.render_text_misses());
+}
+
+TEST(TextLayoutCacheTest, CanvasSizesAreCached) {
+  TextLayoutCache* cache = TextLayoutCache::GetInstance();
+  ASSERT_TRUE(cache);
+  cache->Clear();
+
+  const Font font;
+  const string16 text = ASCIIToUTF16("Cached");
+  int width = 0;
+  int height = 0;
+  Canvas::SizeStringInt(text, font, &width, &height, 0);
+  EXPECT_GT(width, 0);
+  EXPECT_GT(height, 0);
+  EXPECT_EQ(0U, cache->size_hits());
+
+  int cached_width = 0;
+  int cached_height = 0;
+  Canvas::SizeStringInt(text, font, &cached_width, &cached_height, 0);
+  EXPECT_EQ(width, cached_width);
+  EXPECT_EQ(height, cached_height);
+  EXPECT_EQ(1U, cache->size_hits());
+
+  // A different width or different flags are measured again.
+  int multi_line_width = 1000;
+  int multi_line_height = 0;
+  Canvas::SizeStringInt(text, font, &multi_line_width, &multi_line_height,
+                        Canvas::MULTI_LINE);
+  EXPECT_GT(multi_line_width, 0);
+  EXPECT_GT(multi_line_height, 0);
+  EXPECT_EQ(1U, cache->size_hits());
+  EXPECT_EQ(2U, cache->size_misses());
+}
+
+TEST(TextLayoutCacheTest, CanvasDrawsAreCached) {
+  TextLayoutCache* cache = TextLayoutCache::GetInstance();
+  ASSERT_TRUE(cache);
+  cache->Clear();
+
+  const Font font;
+  const string16 text = ASCIIToUTF16("Cached");
+  Canvas canvas(Size(100, 100), false);
+  canvas.DrawStringInt(text, font, SK_ColorBLACK, 0, 0, 100, 20);
+  EXPECT_EQ(0U, cache->render_text_hits());
+  EXPECT_EQ(1U, cache->render_text_misses());
+
+  // Moving the text reuses its layout; changing the width doesn't.
+  canvas.DrawStringInt(text, font, SK_ColorBLACK, 0, 50, 100, 20);
+  EXPECT_EQ(1U, cache->render_text_hits());
+  canvas.DrawStringInt(text, font, SK_ColorBLACK, 0, 50, 90, 20);
+  EXPECT_EQ(1U, cache->render_text_hits());
+  EXPECT_EQ(2U, cache->render_text_misses());
+}
+
+}  // namespace gfx
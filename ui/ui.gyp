@@ -410,6 +410,8 @@
         'gfx/skia_utils_gtk.h',
         'gfx/sys_color_change_listener.cc',
         'gfx/sys_color_change_listener.h',
+        'gfx/text_layout_cache.cc',
+        'gfx/text_layout_cache.h',
         'gfx/transform.cc',
         'gfx/transform.h',
         'gfx/transform_util.cc',
@@ -437,6 +439,8 @@
         }, {  # use_canvas_skia!=1
           'sources!': [
             'gfx/canvas_skia.cc',
+            'gfx/text_layout_cache.cc',
+            'gfx/text_layout_cache.h',
           ],
         }],
         ['use_aura==1', {